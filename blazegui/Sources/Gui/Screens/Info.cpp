@@ -8,6 +8,7 @@
 #include <cmath>
 #include <ctime>
 #include <map>
+#include <memory>
 #include <iomanip>
 #include <sstream>
 #include <stdexcept>
@@ -47,7 +48,7 @@ const std::unordered_map<Info::Section, std::tuple<double, double, double>> Info
 /**
  * @brief View is about to appear
  *
- * Set up and start the page flip timer
+ * Set up and start the page flip timer, and request the information for the current page.
  */
 void Info::didAppear(DisplayManager *mgr) {
     Screen::didAppear(mgr);
@@ -58,6 +59,8 @@ void Info::didAppear(DisplayManager *mgr) {
             [this](auto timer) {
         this->timerFired();
     }, true);
+
+    this->refresh();
 }
 
 /**
@@ -144,6 +147,8 @@ cairo_pattern_t *Info::makeGradient(const std::tuple<double, double, double> &rg
 
 /**
  * @brief Timer has fired
+ *
+ * Flip the page (or mark it for redrawing), then request updated information for it.
  */
 void Info::timerFired() {
     // flip page if needed
@@ -159,6 +164,8 @@ void Info::timerFired() {
             this->dirtyFlag = true;
         }
     }
+
+    this->refresh();
 }
 
 /**
@@ -176,6 +183,76 @@ void Info::flipPage() {
     this->dirtyFlag = true;
 }
 
+/**
+ * @brief Request the blazed information needed by the current page
+ *
+ * The page is redrawn once the responses arrive.
+ */
+void Info::refresh() {
+    switch(this->page) {
+        case Section::BlazeNetStatus:
+            this->fetch(&Info::radioConfig, &Rpc::BlazedClient::getRadioConfig);
+            break;
+
+        case Section::BlazeNetTraffic:
+            this->fetch(&Info::radioStats, &Rpc::BlazedClient::getRadioStats);
+            break;
+
+        case Section::Versions:
+            this->fetch(&Info::version, &Rpc::BlazedClient::getVersion);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Request a piece of information from blazed
+ *
+ * Nothing is requested if a previous request for it is still outstanding. When the request
+ * completes, the snapshot is updated and the page marked as dirty; if the screen has gone away by
+ * then, the result is discarded.
+ *
+ * @param snapshot Snapshot to receive the result
+ * @param method Client method to invoke to make the request
+ */
+template<typename T>
+void Info::fetch(Snapshot<T> Info::*snapshot,
+        void (Rpc::BlazedClient::*method)(const Rpc::BlazedClient::Completion<T> &)) {
+    if((this->*snapshot).pending) {
+        return;
+    }
+    (this->*snapshot).pending = true;
+
+    std::weak_ptr<Info> weakThis = this->weak_from_this();
+
+    ((*Rpc::BlazedClient::The()).*method)([weakThis, snapshot](auto result, auto error) {
+        auto self = weakThis.lock();
+        if(!self) {
+            return;
+        }
+
+        auto &out = (*self).*snapshot;
+        out.pending = false;
+
+        if(result) {
+            out.value = *result;
+            out.error.clear();
+        } else {
+            try {
+                std::rethrow_exception(error);
+            } catch(const std::exception &e) {
+                out.error = e.what();
+            }
+
+            PLOG_WARNING << "blazed request failed: " << out.error;
+        }
+
+        self->dirtyFlag = true;
+    });
+}
+
 
 
 /**
@@ -349,24 +426,17 @@ void Info::drawPageBlazeStatus(cairo_t *ctx, TextRenderer &text) {
     DrawTitle(ctx, text, "Radio");
     DrawFooter(ctx, text);
 
-    // fetch the info
-    std::string region{"???"};
-    size_t channel{0}, numClients{0};
-    double txPower{NAN};
-
-    try {
-        auto &rpc = Rpc::BlazedClient::The();
-        rpc->getRadioConfig(region, channel, txPower);
-        rpc->getClientStats(numClients);
-    }
-    // draw pretty errors
-    catch(const std::exception &e) {
-        DrawError(ctx, text, e.what());
-
-        PLOG_ERROR << "failed to get BlazeNet status: " << e.what();
+    // draw from the most recently received info
+    if(!this->radioConfig.value) {
+        DrawError(ctx, text, this->radioConfig.error.empty() ? "Waiting for blazed…" :
+                this->radioConfig.error);
         return;
     }
 
+    const auto &[region, channel, txPower] = *this->radioConfig.value;
+    size_t numClients{0};
+    Rpc::BlazedClient::The()->getClientStats(numClients);
+
     // left section (labels)
     text.setFont("DINish Condensed Bold", 18);
     text.draw(ctx, {0, 44}, {110, 32}, {1, 1, 1}, "Region:",
@@ -409,21 +479,16 @@ void Info::drawPageBlazeTraffic(cairo_t *ctx, TextRenderer &text) {
     DrawTitle(ctx, text, "BlazeNet");
     DrawFooter(ctx, text);
 
-    // get status
-    size_t rxGood{0}, rxCorrupt{0}, rxOverrun{0}, txGood{0}, txCcaFail{0}, txUnderrun{0};
-
-    try {
-        auto &rpc = Rpc::BlazedClient::The();
-        rpc->getRadioStats(rxGood, rxCorrupt, rxOverrun, txGood, txCcaFail, txUnderrun);
-    }
-    // draw pretty errors
-    catch(const std::exception &e) {
-        DrawError(ctx, text, e.what());
-
-        PLOG_ERROR << "failed to get BlazeNet radio counters: " << e.what();
+    // draw from the most recently received counters
+    if(!this->radioStats.value) {
+        DrawError(ctx, text, this->radioStats.error.empty() ? "Waiting for blazed…" :
+                this->radioStats.error);
         return;
     }
 
+    const auto &[rxGood, rxCorrupt, rxOverrun, txGood, txCcaFail, txUnderrun] =
+        *this->radioStats.value;
+
     // left section (labels)
     text.setFont("DINish Condensed Bold", 18);
     text.draw(ctx, {0, 44}, {110, 32}, {1, 1, 1}, "Receive:",
@@ -553,21 +618,8 @@ void Info::drawPageVersions(cairo_t *ctx, TextRenderer &text) {
     DrawTitle(ctx, text, "Version");
     DrawFooter(ctx, text);
 
-    // get blazed info
-    std::string blazedVersion{""}, blazedBuild{""}, radioVersion{""};
-    bool hasBlazedInfo{false};
-
-    try {
-        auto &rpc = Rpc::BlazedClient::The();
-        rpc->getVersion(blazedVersion, blazedBuild, radioVersion);
-
-        hasBlazedInfo = true;
-    }
-    // draw pretty errors
-    catch(const std::exception &e) {
-        PLOG_WARNING << "failed to get BlazeNet version: " << e.what();
-        hasBlazedInfo = false;
-    }
+    // get blazed info (from the most recent response)
+    const bool hasBlazedInfo = this->version.value.has_value();
     // left section (labels)
     text.setFont("DINish Condensed Bold", 18);
     text.draw(ctx, {0, 44}, {110, 32}, {1, 1, 1}, "blazed:",
@@ -583,6 +635,8 @@ void Info::drawPageVersions(cairo_t *ctx, TextRenderer &text) {
     text.setFont("DINish", 18);
 
     if(hasBlazedInfo) {
+        const auto &[blazedVersion, blazedBuild, radioVersion] = *this->version.value;
+
         text.draw(ctx, {115, 44}, {124, 32}, {1, 1, 1}, fmt::format("{} ({})", blazedVersion,
                     blazedBuild), TextRenderer::HorizontalAlign::Left,
                 TextRenderer::VerticalAlign::Middle);
@@ -2,11 +2,15 @@
 #define GUI_SCREENS_INFO_H
 
 #include <cstddef>
+#include <memory>
+#include <optional>
+#include <string>
 #include <string_view>
 #include <tuple>
 #include <unordered_map>
 
 #include "Gui/Screen.h"
+#include "Rpc/BlazedClient.h"
 
 namespace Gui {
 class TextRenderer;
@@ -18,8 +22,11 @@ namespace Gui::Screens {
  *
  * Renders a series of informational screens about the system on the display. This is driven by a
  * timer that fires periodically.
+ *
+ * Information from blazed is requested asynchronously whenever the timer fires, and the pages are
+ * drawn from the most recently received results; drawing never waits for blazed.
  */
-class Info: public Screen {
+class Info: public Screen, public std::enable_shared_from_this<Info> {
     private:
         /// Page update interval (µsec)
         constexpr static const size_t kPageFlipInterval{1 * 1000 * 1000};
@@ -50,6 +57,17 @@ class Info: public Screen {
             std::unordered_map<size_t, struct sockaddr *> addresses;
         };
 
+        /// Most recent result of a blazed request
+        template<typename T>
+        struct Snapshot {
+            /// Most recently received value (if any)
+            std::optional<T> value;
+            /// Reason the most recent request failed (empty if it succeeded)
+            std::string error;
+            /// Set while a request is outstanding
+            bool pending{false};
+        };
+
     public:
         void draw(struct _cairo *ctx, const bool dirty) override;
 
@@ -67,6 +85,11 @@ class Info: public Screen {
         void timerFired();
         void flipPage();
 
+        void refresh();
+        template<typename T>
+        void fetch(Snapshot<T> Info::*snapshot,
+                void (Rpc::BlazedClient::*method)(const Rpc::BlazedClient::Completion<T> &));
+
         void drawPageNetwork(struct _cairo *, TextRenderer &);
         size_t drawNetworkInterface(struct _cairo *, TextRenderer &, const double,
                 const InterfaceInfo &, const std::string &);
@@ -97,6 +120,13 @@ class Info: public Screen {
         std::shared_ptr<TristLib::Event::Timer> timer;
         /// Number of redraw cycles we've gone through
         size_t pageCycles{0};
+
+        /// blazed (and radio firmware) versions
+        Snapshot<Rpc::BlazedClient::Version> version;
+        /// Radio configuration
+        Snapshot<Rpc::BlazedClient::RadioConfig> radioConfig;
+        /// Radio performance counters
+        Snapshot<Rpc::BlazedClient::RadioStats> radioStats;
 };
 }
 
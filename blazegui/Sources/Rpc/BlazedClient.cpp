@@ -6,14 +6,14 @@
 #include <fmt/format.h>
 #include <TristLib/Core.h>
 #include <TristLib/Core/Cbor.h>
-#include <TristLib/Core/HexDump.h>
+#include <TristLib/Event.h>
 
 #include <algorithm>
+#include <array>
 #include <cerrno>
 #include <cstring>
 #include <memory>
 #include <stdexcept>
-#include <sstream>
 #include <system_error>
 
 #include "Config/Reader.h"
@@ -52,197 +52,350 @@ void BlazedClient::CleanUp() {
 /**
  * @brief Allocate the blazed client
  *
- * Read out the config for the RPC socket path
+ * Read out the config for the RPC socket path, then start connecting to blazed.
  */
 BlazedClient::BlazedClient() {
     // TODO: read from config
     this->socketPath = "/var/run/blazed/rpc.sock";
 
-    // set up buffers
-    this->rxBuffer.reserve(kMaxPacketSize);
+    this->timeoutTimer = std::make_shared<TristLib::Event::Timer>(
+            TristLib::Event::RunLoop::Current(), std::chrono::microseconds(kTimeoutCheckInterval),
+            [this](auto) {
+        this->checkTimeouts();
+    }, true);
+
+    this->connect();
 }
 
 /**
  * @brief Clean up client resources
  *
- * This will close the RPC socket, if it's still open.
+ * This will close the RPC socket, if it's still open. Outstanding requests are discarded without
+ * invoking their callbacks.
  */
 BlazedClient::~BlazedClient() {
-    this->tearDown();
+    this->timeoutTimer.reset();
+    this->reconnectTimer.reset();
+
+    this->requests.clear();
+    this->socket.reset();
 }
 
 /**
  * @brief Connect the RPC socket
+ *
+ * The socket is non-blocking; since it's a local socket, the connection is established (or fails)
+ * right away. If it fails, another attempt is scheduled.
  */
 void BlazedClient::connect() {
-    int fd, err;
+    int fd{-1}, err;
 
-    // close previous socket, if any
-    if(this->socket != -1) {
-        close(this->socket);
-        this->socket = -1;
-    }
+    try {
+        // create the socket
+        fd = ::socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if(fd == -1) {
+            throw std::system_error(errno, std::generic_category(), "create rpc socket");
+        }
 
-    // create the socket
-    fd = ::socket(AF_UNIX, SOCK_SEQPACKET, 0);
-    if(fd == -1) {
-        throw std::system_error(errno, std::generic_category(), "create rpc socket");
-    }
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+
+        strncpy(addr.sun_path, this->socketPath.native().c_str(), sizeof(addr.sun_path) - 1);
 
-    struct sockaddr_un addr;
-    memset(&addr, 0, sizeof(addr));
-    addr.sun_family = AF_UNIX;
+        // dial it
+        err = ::connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+        if(err == -1) {
+            throw std::system_error(errno, std::generic_category(), "dial rpc socket");
+        }
 
-    strncpy(addr.sun_path, this->socketPath.native().c_str(), sizeof(addr.sun_path) - 1);
+        // set up the socket event (it owns the socket from here on)
+        this->socket = std::make_shared<TristLib::Event::Socket>(
+                TristLib::Event::RunLoop::Current(), fd, true);
+        fd = -1;
+
+        this->socket->setReadWatermark({sizeof(RequestHeader), SIZE_MAX});
+
+        this->socket->setReadCallback([this](auto) {
+            try {
+                this->handleRead();
+            } catch(const std::exception &e) {
+                PLOG_ERROR << "blazed rpc read failed: " << e.what();
+                this->disconnect(std::current_exception());
+            }
+        });
+
+        this->socket->setEventCallback([this](auto, auto events) {
+            if(events & (TristLib::Event::Socket::Event::EndOfFile |
+                        TristLib::Event::Socket::Event::UnrecoverableError)) {
+                PLOG_WARNING << "blazed rpc connection closed";
+                this->disconnect(std::make_exception_ptr(
+                            std::runtime_error("connection to blazed closed")));
+            }
+        });
+
+        this->socket->enableEvents(true, false);
+    } catch(const std::exception &e) {
+        if(fd != -1) {
+            close(fd);
+        }
+        this->socket.reset();
 
-    // dial it
-    err = ::connect(fd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
-    if(err == -1) {
-        close(fd);
-        throw std::system_error(errno, std::generic_category(), "dial rpc socket");
+        PLOG_WARNING << "failed to connect to blazed: " << e.what();
+        return this->scheduleReconnect();
     }
 
-    this->socket = fd;
+    PLOG_INFO << "connected to blazed";
+    this->reconnectDelay = kMinReconnectDelay;
 }
 
 /**
- * @brief Tear down the RPC socket
+ * @brief Tear down the RPC connection
+ *
+ * Close the socket, fail all outstanding requests, and schedule a reconnection attempt.
  *
- * Clean up all resources associated with the RPC socket to prepare it for an eventual
- * reconnection.
+ * @param reason Reason the connection was torn down; outstanding requests fail with it
  */
-void BlazedClient::tearDown() {
-    if(this->socket != -1) {
-        close(this->socket);
-        this->socket = -1;
+void BlazedClient::disconnect(const std::exception_ptr &reason) {
+    this->socket.reset();
+    this->rxStream.clear();
+
+    // responses to outstanding requests will never arrive
+    auto requests = std::move(this->requests);
+    this->requests.clear();
+
+    for(auto &[tag, request] : requests) {
+        Fail(request, reason);
     }
+
+    this->scheduleReconnect();
 }
 
 /**
- * @brief Ensure the RPC connection is valid
+ * @brief Schedule an attempt to reconnect
  *
- * Establish the RPC connection if not already done.
+ * The delay between attempts doubles with every failed attempt, up to a maximum.
  */
-void BlazedClient::ensureConnection() {
-    // connection never created?
-    if(this->socket == -1) {
-        return this->connect();
+void BlazedClient::scheduleReconnect() {
+    if(this->reconnectTimer) {
+        return;
     }
 
-    // TODO: ensure the socket is valid
+    PLOG_DEBUG << fmt::format("reconnecting to blazed in {} ms", this->reconnectDelay.count());
+
+    this->reconnectTimer = std::make_shared<TristLib::Event::Timer>(
+            TristLib::Event::RunLoop::Current(), std::chrono::microseconds(this->reconnectDelay),
+            [this](auto) {
+        // keep the timer alive until its callback returns
+        auto timer = std::move(this->reconnectTimer);
+        this->connect();
+    });
+
+    this->reconnectDelay = std::min(this->reconnectDelay * 2, kMaxReconnectDelay);
+}
+
+/**
+ * @brief Check whether any requests timed out
+ *
+ * If so, blazed is either hung, or the connection broke; either way, we start over with a new
+ * connection.
+ */
+void BlazedClient::checkTimeouts() {
+    const auto now = std::chrono::steady_clock::now();
+
+    for(const auto &[tag, request] : this->requests) {
+        if(now >= request.deadline) {
+            PLOG_WARNING << fmt::format("blazed rpc request ${:02x} timed out", tag);
+            return this->disconnect(std::make_exception_ptr(
+                        std::runtime_error("blazed request timed out")));
+        }
+    }
 }
 
 /**
- * @brief Send a raw packet to the remote
+ * @brief Fail a request
  *
- * This assumes the packet already has a `struct RpcHeader` prepended.
+ * Invoke the request's callback (or its stream completion) with an error.
  */
-void BlazedClient::sendRaw(std::span<const std::byte> payload) {
-    int err = write(this->socket, payload.data(), payload.size());
-    if(err == -1) {
-        throw std::system_error(errno, std::generic_category(), "write");
+void BlazedClient::Fail(Request &request, const std::exception_ptr &reason) {
+    try {
+        if(request.handler) {
+            request.handler(nullptr, reason);
+        } else if(request.streamCompletion) {
+            request.streamCompletion(reason);
+        }
+    } catch(const std::exception &e) {
+        PLOG_ERROR << "blazed rpc completion failed: " << e.what();
     }
 }
 
 
+
 /**
- * @brief Send a packet to the remote, adding a packet header
+ * @brief Read packets from the connection
  *
- * Generate a full packet (including packet header) and send it to the remote.
+ * Read out all data waiting on the connection, and handle every complete packet in it.
  *
- * @return Tag value associated with the packet
+ * A single record on the socket may contain several packets (or only part of one) if blazed had
+ * output queued, so the received data is treated as a stream of packets.
  */
-uint8_t BlazedClient::sendPacket(const uint8_t endpoint, std::span<const std::byte> payload) {
-    std::vector<std::byte> buffer;
-    buffer.resize(sizeof(struct RequestHeader) + payload.size(), std::byte{0});
-
-    // build up the header
-    auto hdr = reinterpret_cast<struct RequestHeader *>(buffer.data());
-    hdr->version = kCurrentVersion;
-    hdr->length = sizeof(*hdr) + payload.size();
-    hdr->endpoint = endpoint;
+void BlazedClient::handleRead() {
+    std::array<std::byte, kMaxPacketSize> buffer;
+    size_t read;
 
     do {
-        hdr->tag = ++this->nextTag;
-        // TODO: ensure there isn't a packet with this tag outstanding
-    } while(!hdr->tag);
+        read = this->socket->read(buffer);
+        this->rxStream.insert(this->rxStream.end(), buffer.begin(), buffer.begin() + read);
+    } while(read == buffer.size());
+
+    // handle all complete packets
+    size_t offset{0};
+
+    while(this->rxStream.size() - offset >= sizeof(RequestHeader)) {
+        auto hdr = reinterpret_cast<const RequestHeader *>(this->rxStream.data() + offset);
+
+        if(hdr->version != kCurrentVersion) {
+            throw std::runtime_error(fmt::format("invalid rpc version: ${:04x}", hdr->version));
+        } else if(hdr->length < sizeof(*hdr) || hdr->length > kMaxPacketSize) {
+            throw std::runtime_error(fmt::format("invalid header size ({})", hdr->length));
+        } else if(hdr->length > this->rxStream.size() - offset) {
+            break;
+        }
 
-    // copy payload
-    if(!payload.empty()) {
-        std::copy(payload.begin(), payload.end(), buffer.begin() + sizeof(*hdr));
+        this->handlePacket(std::span(this->rxStream).subspan(offset, hdr->length));
+        offset += hdr->length;
+
+        // a callback may have torn down the connection
+        if(!this->socket) {
+            return;
+        }
     }
 
-    // send and return tag
-    this->sendRaw(buffer);
-    return hdr->tag;
+    this->rxStream.erase(this->rxStream.begin(), this->rxStream.begin() + offset);
 }
 
 /**
- * @brief Serialize a CBOR message and send it
+ * @brief Handle a single received packet
  *
- * @param endpoint Endpoint to submit the packet to
- * @param root CBOR item to serialize as the root of the message
+ * Complete the request (or continue the stream) with the packet's tag.
  *
- * @return Tag of the transmitted packet
+ * @param packet Full packet (including its header); its length was already validated
  */
-uint8_t BlazedClient::sendPacket(const uint8_t endpoint, cbor_item_t* &root) {
-    uint8_t tag;
+void BlazedClient::handlePacket(std::span<const std::byte> packet) {
+    auto hdr = reinterpret_cast<const RequestHeader *>(packet.data());
 
-    // serialize message
-    size_t rootBufLen;
-    unsigned char *rootBuf{nullptr};
-    const size_t serializedBytes = cbor_serialize_alloc(root, &rootBuf, &rootBufLen);
-    cbor_decref(&root);
+    if(hdr->tag == kPushTag) {
+        PLOG_VERBOSE << fmt::format("ignoring message pushed from endpoint ${:02x}",
+                hdr->endpoint);
+        return;
+    }
+
+    auto it = this->requests.find(hdr->tag);
+    if(it == this->requests.end()) {
+        PLOG_WARNING << fmt::format("discarding response with unknown tag ${:02x}", hdr->tag);
+        return;
+    }
+
+    auto payload = DecodePayload(packet);
 
-    // then try to send the packet
     try {
-        tag = this->sendPacket(endpoint, {reinterpret_cast<std::byte *>(rootBuf), serializedBytes});
-        free(rootBuf);
-    } catch(const std::exception &e) {
-        free(rootBuf);
-        this->tearDown();
+        if(it->second.itemHandler) {
+            this->handleChunk(hdr->tag, it->second, payload);
+        } else {
+            auto handler = std::move(it->second.handler);
+            this->requests.erase(it);
+
+            try {
+                handler(payload, nullptr);
+            } catch(const std::exception &e) {
+                PLOG_ERROR << "blazed rpc completion failed: " << e.what();
+            }
+        }
+    } catch(const std::exception &) {
+        if(payload) {
+            cbor_decref(&payload);
+        }
         throw;
     }
 
-    return tag;
+    if(payload) {
+        cbor_decref(&payload);
+    }
 }
 
 /**
- * @brief Wait to receive a response
- *
- * Read the next full packet from the socket. Its tag must match the specified tag. On completion,
- * the full response is in the class receive buffer.
+ * @brief Handle a chunk of a stream
  *
- * @param expectedTag Tag we expect for the next message
+ * Pass its items to the stream's item handler, then either grant more credits, or complete the
+ * stream if it was the final chunk.
  *
- * @return Payload of the message decoded as CBOR, if any
+ * @param tag Tag of the stream
+ * @param request Stream the chunk belongs to
+ * @param chunk Decoded chunk
  */
-cbor_item_t *BlazedClient::readResponse(const uint8_t expectedTag) {
-    // wait to receive a message
-    this->rxBuffer.resize(kMaxPacketSize);
-    const auto read = recv(this->socket, this->rxBuffer.data(), this->rxBuffer.size(), 0);
-    if(read == -1) {
-        throw std::system_error(errno, std::generic_category(), "receive rpc response");
+void BlazedClient::handleChunk(const uint8_t tag, Request &request, const cbor_item_t *chunk) {
+    // chunks can't go missing, so start over with a new connection if they do
+    auto seq = chunk ? TristLib::Core::CborMapGet(chunk, "seq") : nullptr;
+    if(!seq || !cbor_isa_uint(seq)) {
+        throw std::runtime_error("invalid stream chunk (missing `seq`)");
+    } else if(TristLib::Core::CborReadUint(seq) != request.sequence) {
+        throw std::runtime_error(fmt::format("stream chunk out of sequence (got {}, expected {})",
+                    TristLib::Core::CborReadUint(seq), request.sequence));
     }
 
-    this->rxBuffer.resize(read);
+    request.sequence++;
+    request.deadline = std::chrono::steady_clock::now() + kRequestTimeout;
+
+    // hand over the items
+    auto items = TristLib::Core::CborMapGet(chunk, "items");
+    if(items && cbor_isa_array(items)) {
+        const auto handles = cbor_array_handle(items);
 
-    // validate the header
-    if(this->rxBuffer.size() < sizeof(RequestHeader)) {
-        throw std::runtime_error(fmt::format("packet too small (got {} bytes)", read));
+        for(size_t i = 0; i < cbor_array_size(items); i++) {
+            try {
+                request.itemHandler(handles[i]);
+            } catch(const std::exception &e) {
+                PLOG_ERROR << "blazed rpc stream item handler failed: " << e.what();
+            }
+        }
     }
 
-    auto hdr = reinterpret_cast<const RequestHeader *>(this->rxBuffer.data());
+    // complete the stream, or let blazed send more chunks
+    auto final = TristLib::Core::CborMapGet(chunk, "final");
+    if(final && cbor_is_bool(final) && cbor_get_bool(final)) {
+        auto completion = std::move(request.streamCompletion);
+        this->requests.erase(tag);
 
-    if(hdr->version != kCurrentVersion) {
-        throw std::runtime_error(fmt::format("invalid rpc version: ${:04x}", hdr->version));
-    } else if(hdr->length < sizeof(*hdr) || hdr->length > this->rxBuffer.size()) {
-        throw std::runtime_error(fmt::format("invalid header size ({}, have {})", hdr->length,
-                    this->rxBuffer.size()));
-    } else if(hdr->tag != expectedTag) {
-        throw std::runtime_error(fmt::format("invalid tag: got ${:02x}, expected ${:02x}",
-                    hdr->tag, expectedTag));
+        try {
+            completion(nullptr);
+        } catch(const std::exception &e) {
+            PLOG_ERROR << "blazed rpc completion failed: " << e.what();
+        }
+    } else if(++request.unacknowledged >= kStreamCreditBatch) {
+        auto root = cbor_new_definite_map(2);
+        cbor_map_add(root, (struct cbor_pair) {
+            .key = cbor_move(cbor_build_string("op")),
+            .value = cbor_move(cbor_build_string("credit"))
+        });
+        cbor_map_add(root, (struct cbor_pair) {
+            .key = cbor_move(cbor_build_string("credits")),
+            .value = cbor_move(cbor_build_uint8(request.unacknowledged))
+        });
+        this->sendPacket(RequestEndpoint::Stream, tag, root);
+
+        request.unacknowledged = 0;
     }
+}
+
+/**
+ * @brief Decode the payload of a packet
+ *
+ * @param packet Full packet, including its header
+ *
+ * @return Payload of the message decoded as CBOR, if any
+ */
+cbor_item_t *BlazedClient::DecodePayload(std::span<const std::byte> packet) {
+    auto hdr = reinterpret_cast<const RequestHeader *>(packet.data());
 
     std::span<const std::byte> payload(reinterpret_cast<const std::byte *>(hdr->payload),
             hdr->length - sizeof(*hdr));
@@ -267,85 +420,246 @@ cbor_item_t *BlazedClient::readResponse(const uint8_t expectedTag) {
 
 
 /**
- * @brief Get remote software version
+ * @brief Allocate a tag for a new request
  *
- * Read out the version of the blazed daemon, as well as the radio firmware, if any.
+ * Tags are handed out sequentially; the tag of any request that's still waiting for its response
+ * is skipped, as is zero.
+ *
+ * @return Tag that's not in use by any outstanding request
+ */
+uint8_t BlazedClient::allocTag() {
+    if(this->requests.size() >= UINT8_MAX) {
+        throw std::runtime_error("too many outstanding rpc requests");
+    }
+
+    uint8_t tag;
+    do {
+        tag = ++this->nextTag;
+    } while(!tag || this->requests.contains(tag));
+
+    return tag;
+}
+
+/**
+ * @brief Serialize a CBOR message and send it
+ *
+ * The message is queued on the socket, and sent as soon as it's writable.
  *
- * @param outVersion blazed version
- * @param outBuild blazed build (commit hash)
- * @param outRadioVersion Radio firmware version
+ * @param endpoint Endpoint to submit the packet to
+ * @param tag Tag to send the packet with
+ * @param root CBOR item to serialize as the root of the message; it's released
  */
-void BlazedClient::getVersion(std::string &outVersion, std::string &outBuild,
-        std::string &outRadioVersion) {
-    this->ensureConnection();
+void BlazedClient::sendPacket(const uint8_t endpoint, const uint8_t tag, cbor_item_t* &root) {
+    // serialize message
+    size_t rootBufLen;
+    unsigned char *rootBuf{nullptr};
+    const size_t serializedBytes = cbor_serialize_alloc(root, &rootBuf, &rootBufLen);
+    cbor_decref(&root);
 
-    // submit request and receive the response
-    auto root = cbor_new_definite_map(1);
-    cbor_map_add(root, (struct cbor_pair) {
-        .key = cbor_move(cbor_build_string("get")),
-        .value = cbor_move(cbor_build_string("version"))
-    });
+    std::vector<std::byte> buffer(sizeof(struct RequestHeader) + serializedBytes);
 
-    auto response = this->sendWithResponse(RequestEndpoint::Config, root);
+    // build up the header, then copy payload
+    auto hdr = reinterpret_cast<struct RequestHeader *>(buffer.data());
+    hdr->version = kCurrentVersion;
+    hdr->length = buffer.size();
+    hdr->endpoint = endpoint;
+    hdr->tag = tag;
+
+    memcpy(buffer.data() + sizeof(*hdr), rootBuf, serializedBytes);
+    free(rootBuf);
+
+    this->socket->write(buffer);
+}
+
+/**
+ * @brief Send a request
+ *
+ * If not connected, the request fails right away.
+ *
+ * @param endpoint Endpoint to send the request to
+ * @param root CBOR item to serialize as the root of the request; it's released
+ * @param handler Invoked with the response (or an error) once it arrives
+ */
+void BlazedClient::request(const uint8_t endpoint, cbor_item_t* &root,
+        const ResponseHandler &handler) {
+    uint8_t tag;
 
-    // decode response
-    if(auto version = TristLib::Core::CborMapGet(response, "version")) {
-        if(cbor_isa_string(version)) {
-            outVersion = std::string(reinterpret_cast<const char *>(cbor_string_handle(version)));
+    try {
+        if(!this->socket) {
+            throw std::runtime_error("not connected to blazed");
         }
+
+        tag = this->allocTag();
+    } catch(const std::exception &) {
+        cbor_decref(&root);
+        return handler(nullptr, std::current_exception());
     }
 
-    if(auto build = TristLib::Core::CborMapGet(response, "build")) {
-        if(cbor_isa_string(build)) {
-            outBuild = std::string(reinterpret_cast<const char *>(cbor_string_handle(build)));
+    this->sendPacket(endpoint, tag, root);
+
+    this->requests.emplace(tag, Request{
+        .deadline = std::chrono::steady_clock::now() + kRequestTimeout,
+        .handler = handler,
+    });
+}
+
+
+
+/**
+ * @brief Open a result stream
+ *
+ * If not connected, the stream fails right away.
+ *
+ * @param source Name of the data set to stream (such as `nodes`)
+ * @param itemHandler Invoked for each item of the result, as it arrives
+ * @param completion Invoked once the stream ends (or fails)
+ *
+ * @return Tag of the stream (to cancel it), or 0 if it failed to open
+ */
+uint8_t BlazedClient::openStream(const std::string_view source,
+        const StreamItemHandler &itemHandler, const StreamCompletion &completion) {
+    uint8_t tag;
+
+    try {
+        if(!this->socket) {
+            throw std::runtime_error("not connected to blazed");
         }
+
+        tag = this->allocTag();
+    } catch(const std::exception &) {
+        completion(std::current_exception());
+        return 0;
     }
 
-    if(auto version = TristLib::Core::CborMapGet(response, "radioVersion")) {
-        if(cbor_isa_string(version)) {
-            outRadioVersion = std::string(
-                    reinterpret_cast<const char *>(cbor_string_handle(version)));
-        }
+    auto root = cbor_new_definite_map(3);
+    cbor_map_add(root, (struct cbor_pair) {
+        .key = cbor_move(cbor_build_string("op")),
+        .value = cbor_move(cbor_build_string("open"))
+    });
+    cbor_map_add(root, (struct cbor_pair) {
+        .key = cbor_move(cbor_build_string("source")),
+        .value = cbor_move(cbor_build_stringn(source.data(), source.size()))
+    });
+    cbor_map_add(root, (struct cbor_pair) {
+        .key = cbor_move(cbor_build_string("credits")),
+        .value = cbor_move(cbor_build_uint8(kStreamCredits))
+    });
+
+    this->sendPacket(RequestEndpoint::Stream, tag, root);
+
+    this->requests.emplace(tag, Request{
+        .deadline = std::chrono::steady_clock::now() + kRequestTimeout,
+        .itemHandler = itemHandler,
+        .streamCompletion = completion,
+    });
+
+    return tag;
+}
+
+/**
+ * @brief Cancel a result stream
+ *
+ * The stream completes once blazed acknowledges the cancellation; items that were already on
+ * their way may still be delivered until then.
+ *
+ * @param tag Tag of the stream, as returned by openStream()
+ */
+void BlazedClient::cancelStream(const uint8_t tag) {
+    auto it = this->requests.find(tag);
+    if(it == this->requests.end() || !it->second.itemHandler || !this->socket) {
+        return;
     }
 
-    cbor_decref(&response);
+    auto root = cbor_new_definite_map(1);
+    cbor_map_add(root, (struct cbor_pair) {
+        .key = cbor_move(cbor_build_string("op")),
+        .value = cbor_move(cbor_build_string("cancel"))
+    });
+    this->sendPacket(RequestEndpoint::Stream, tag, root);
 }
 
+
+
 /**
- * @brief Get current radio configuration
+ * @brief Read a string from a CBOR map
  *
- * @param outRegion Regulatory region the radio is operating in
- * @param outChannel Channel number the radio is using
- * @param outTxPower Transmit power (in dBm)
+ * @return String value of the key, or an empty string if it's missing (or not a string)
  */
-void BlazedClient::getRadioConfig(std::string &outRegion, size_t &outChannel, double &outTxPower) {
-    this->ensureConnection();
+static std::string GetString(const cbor_item_t *map, const char *key) {
+    auto item = TristLib::Core::CborMapGet(map, key);
+    if(!item || !cbor_isa_string(item)) {
+        return "";
+    }
+
+    return std::string(reinterpret_cast<const char *>(cbor_string_handle(item)),
+            cbor_string_length(item));
+}
+
+/**
+ * @brief Get remote software version
+ *
+ * Read out the version of the blazed daemon, as well as the radio firmware, if any.
+ *
+ * @param completion Invoked with the versions
+ */
+void BlazedClient::getVersion(const Completion<Version> &completion) {
+    auto root = cbor_new_definite_map(1);
+    cbor_map_add(root, (struct cbor_pair) {
+        .key = cbor_move(cbor_build_string("get")),
+        .value = cbor_move(cbor_build_string("version"))
+    });
+
+    this->request(RequestEndpoint::Config, root, [completion](auto response, auto error) {
+        if(!response) {
+            return completion(nullptr, error ? error :
+                    std::make_exception_ptr(std::runtime_error("empty version response")));
+        }
+
+        const Version version{
+            .version = GetString(response, "version"),
+            .build = GetString(response, "build"),
+            .radioVersion = GetString(response, "radioVersion"),
+        };
+        completion(&version, nullptr);
+    });
+}
 
-    // submit request and receive the response
+/**
+ * @brief Get current radio configuration
+ *
+ * @param completion Invoked with the radio configuration
+ */
+void BlazedClient::getRadioConfig(const Completion<RadioConfig> &completion) {
     auto root = cbor_new_definite_map(1);
     cbor_map_add(root, (struct cbor_pair) {
         .key = cbor_move(cbor_build_string("get")),
         .value = cbor_move(cbor_build_string("radio"))
     });
 
-    auto response = this->sendWithResponse(RequestEndpoint::Config, root);
+    this->request(RequestEndpoint::Config, root, [completion](auto response, auto error) {
+        if(!response) {
+            return completion(nullptr, error ? error :
+                    std::make_exception_ptr(std::runtime_error("empty radio config response")));
+        }
+
+        RadioConfig config;
 
-    // decode response
-    if(auto channel = TristLib::Core::CborMapGet(response, "channel")) {
-        if(cbor_isa_uint(channel)) {
-            outChannel = TristLib::Core::CborReadUint(channel);
+        if(auto channel = TristLib::Core::CborMapGet(response, "channel")) {
+            if(cbor_isa_uint(channel)) {
+                config.channel = TristLib::Core::CborReadUint(channel);
+            }
         }
-    }
 
-    if(auto txPower = TristLib::Core::CborMapGet(response, "txPower")) {
-        if(cbor_isa_float_ctrl(txPower)) {
-            outTxPower = TristLib::Core::CborReadFloat(txPower);
+        if(auto txPower = TristLib::Core::CborMapGet(response, "txPower")) {
+            if(cbor_isa_float_ctrl(txPower)) {
+                config.txPower = TristLib::Core::CborReadFloat(txPower);
+            }
         }
-    }
 
-    // TODO: region string
+        // TODO: region string
 
-    cbor_decref(&response);
+        completion(&config, nullptr);
+    });
 }
 
 /**
@@ -353,70 +667,62 @@ void BlazedClient::getRadioConfig(std::string &outRegion, size_t &outChannel, do
  *
  * This reads out relevant performance counters of the radio.
  *
- * @param outRxGood Total number of successfully received frames
- * @param outRxCorrupt Number of received frames with uncorrectable errors
- * @param outRxFifoOverruns Receive packets dropped due to FIFO overruns
- * @param outTxGood Total number of successfully transmitted frames (including beacons)
- * @param outTxCcaFails Number of frames that failed transmission due to carriers sense failure
- * @param outTxFifoUnderruns Transmit ackets dropped due to FIFO underruns
+ * @param completion Invoked with the radio counters
  */
-void BlazedClient::getRadioStats(size_t &outRxGood, size_t &outRxCorrupt, size_t &outRxFifoOverruns,
-        size_t &outTxGood, size_t &outTxCcaFails, size_t &outTxFifoUnderruns) {
-    this->ensureConnection();
-    std::stringstream hexDump;
-
-    // submit request and receive response
+void BlazedClient::getRadioStats(const Completion<RadioStats> &completion) {
     auto root = cbor_new_definite_map(1);
     cbor_map_add(root, (struct cbor_pair) {
         .key = cbor_move(cbor_build_string("get")),
         .value = cbor_move(cbor_build_string("radio.counters"))
     });
 
-    auto response = this->sendWithResponse(RequestEndpoint::Status, root);
-
-    // decode response
-    const cbor_item_t *count{nullptr};
-
-    auto rxCounters = TristLib::Core::CborMapGet(response, "rx");
-    if(rxCounters && cbor_isa_map(rxCounters)) {
-        count = TristLib::Core::CborMapGet(rxCounters, "good");
-        if(count && cbor_isa_uint(count)) {
-            outRxGood = TristLib::Core::CborReadUint(count);
-        }
-        count = TristLib::Core::CborMapGet(rxCounters, "errors");
-        if(count && cbor_isa_uint(count)) {
-            outRxCorrupt = TristLib::Core::CborReadUint(count);
-        }
-        count = TristLib::Core::CborMapGet(rxCounters, "fifoOverruns");
-        if(count && cbor_isa_uint(count)) {
-            outRxFifoOverruns = TristLib::Core::CborReadUint(count);
+    this->request(RequestEndpoint::Status, root, [completion](auto response, auto error) {
+        if(!response) {
+            return completion(nullptr, error ? error :
+                    std::make_exception_ptr(std::runtime_error("empty radio stats response")));
         }
-    } else {
-        TristLib::Core::HexDump::DumpBuffer<std::stringstream, std::byte>(hexDump, this->rxBuffer);
-        PLOG_WARNING << "invalid rx counters field: " << hexDump.str();
-    }
 
-    auto txCounters = TristLib::Core::CborMapGet(response, "tx");
-    if(txCounters && cbor_isa_map(txCounters)) {
-        count = TristLib::Core::CborMapGet(txCounters, "good");
-        if(count && cbor_isa_uint(count)) {
-            outTxGood = TristLib::Core::CborReadUint(count);
-        }
-        count = TristLib::Core::CborMapGet(txCounters, "ccaFails");
-        if(count && cbor_isa_uint(count)) {
-            outTxCcaFails = TristLib::Core::CborReadUint(count);
+        RadioStats stats;
+        const cbor_item_t *count{nullptr};
+
+        auto rxCounters = TristLib::Core::CborMapGet(response, "rx");
+        if(rxCounters && cbor_isa_map(rxCounters)) {
+            count = TristLib::Core::CborMapGet(rxCounters, "good");
+            if(count && cbor_isa_uint(count)) {
+                stats.rxGood = TristLib::Core::CborReadUint(count);
+            }
+            count = TristLib::Core::CborMapGet(rxCounters, "errors");
+            if(count && cbor_isa_uint(count)) {
+                stats.rxCorrupt = TristLib::Core::CborReadUint(count);
+            }
+            count = TristLib::Core::CborMapGet(rxCounters, "fifoOverruns");
+            if(count && cbor_isa_uint(count)) {
+                stats.rxFifoOverruns = TristLib::Core::CborReadUint(count);
+            }
+        } else {
+            PLOG_WARNING << "invalid rx counters field";
         }
-        count = TristLib::Core::CborMapGet(txCounters, "fifoUnderruns");
-        if(count && cbor_isa_uint(count)) {
-            outTxFifoUnderruns = TristLib::Core::CborReadUint(count);
+
+        auto txCounters = TristLib::Core::CborMapGet(response, "tx");
+        if(txCounters && cbor_isa_map(txCounters)) {
+            count = TristLib::Core::CborMapGet(txCounters, "good");
+            if(count && cbor_isa_uint(count)) {
+                stats.txGood = TristLib::Core::CborReadUint(count);
+            }
+            count = TristLib::Core::CborMapGet(txCounters, "ccaFails");
+            if(count && cbor_isa_uint(count)) {
+                stats.txCcaFails = TristLib::Core::CborReadUint(count);
+            }
+            count = TristLib::Core::CborMapGet(txCounters, "fifoUnderruns");
+            if(count && cbor_isa_uint(count)) {
+                stats.txFifoUnderruns = TristLib::Core::CborReadUint(count);
+            }
+        } else {
+            PLOG_WARNING << "invalid tx counters field";
         }
-    } else {
-        TristLib::Core::HexDump::DumpBuffer<std::stringstream, std::byte>(hexDump, this->rxBuffer);
-        PLOG_WARNING << "invalid tx counters field: " << hexDump.str();
-    }
 
-    // clean up
-    cbor_decref(&response);
+        completion(&stats, nullptr);
+    });
 }
 
 /**
@@ -427,6 +733,5 @@ void BlazedClient::getRadioStats(size_t &outRxGood, size_t &outRxCorrupt, size_t
  * @param outNumConnected Total number of currently connected clients
  */
 void BlazedClient::getClientStats(size_t &outNumConnected) {
-    this->ensureConnection();
     // TODO: implement
 }
@@ -1,31 +1,72 @@
 #ifndef RPC_BLAZEDCLIENT_H
 #define RPC_BLAZEDCLIENT_H
 
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <exception>
 #include <filesystem>
+#include <functional>
 #include <memory>
 #include <span>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
+namespace TristLib::Event {
+class Socket;
+class Timer;
+}
+
 namespace Rpc {
 /**
  * @brief blazed local RPC client
  *
- * Interfaces to the local blazed rpc endpoint. The exposed interface will block the caller for the
- * duration of the request.
+ * Interfaces to the local blazed rpc endpoint. It's driven by the run loop, and never blocks the
+ * caller: requests complete asynchronously, by invoking a callback with the result (or an error)
+ * once the response was received.
+ *
+ * Every request is sent with a unique tag, and blazed may answer requests in any order; any
+ * number of requests may be outstanding at once.
+ *
+ * If a response doesn't arrive within the request timeout, blazed is assumed to be hung (or the
+ * connection broken): the connection is torn down, all outstanding requests fail, and it's
+ * reestablished. Reconnection attempts back off exponentially, for as long as blazed can't be
+ * reached; requests made while disconnected fail right away.
+ *
+ * Large results (such as the node table) are streamed by blazed in chunks; their items are passed
+ * to a callback as the chunks arrive, and flow control credits are granted as they're consumed.
  */
 class BlazedClient {
     private:
         /// Maximum size of an RPC packet
         constexpr static const size_t kMaxPacketSize{4096};
 
+        /// Time to wait for a response before giving up on the connection
+        constexpr static const std::chrono::milliseconds kRequestTimeout{2'000};
+        /// Interval at which request timeouts are checked
+        constexpr static const std::chrono::milliseconds kTimeoutCheckInterval{250};
+        /// Delay before the first reconnection attempt
+        constexpr static const std::chrono::milliseconds kMinReconnectDelay{500};
+        /// Maximum delay between reconnection attempts
+        constexpr static const std::chrono::milliseconds kMaxReconnectDelay{30'000};
+
+        /// Chunks blazed may send before it's granted more credits
+        constexpr static const size_t kStreamCredits{8};
+        /// Credits are granted once this many chunks were received
+        constexpr static const size_t kStreamCreditBatch{kStreamCredits / 2};
+
         /**
          * @brief Current supported RPC version
          */
         constexpr static const uint16_t kCurrentVersion{0x0100};
 
+        /**
+         * @brief Tag of messages pushed by blazed (rather than responses)
+         */
+        constexpr static const uint8_t kPushTag{0x00};
+
         /**
          * @brief Header structure prepended to all RPC requests
          */
@@ -66,6 +107,97 @@ class BlazedClient {
             Config                      = 0x01,
             /// Get status of various components
             Status                      = 0x02,
+            /// Stream large results
+            Stream                      = 0x06,
+        };
+
+    public:
+        /**
+         * @brief Completion callback of a request
+         *
+         * @param result Result of the request, or `nullptr` if it failed
+         * @param error Reason the request failed, if it did
+         */
+        template<typename T>
+        using Completion = std::function<void(const T *result, const std::exception_ptr &error)>;
+
+        /**
+         * @brief Callback for the items of a stream
+         *
+         * @param item A single item of the stream
+         */
+        using StreamItemHandler = std::function<void(const struct cbor_item_t *item)>;
+        /**
+         * @brief Callback for the end of a stream
+         *
+         * @param error Reason the stream failed, if it did
+         */
+        using StreamCompletion = std::function<void(const std::exception_ptr &error)>;
+
+        /**
+         * @brief Software versions
+         */
+        struct Version {
+            /// blazed version
+            std::string version;
+            /// blazed build (commit hash)
+            std::string build;
+            /// Radio firmware version
+            std::string radioVersion;
+        };
+
+        /**
+         * @brief Radio configuration
+         */
+        struct RadioConfig {
+            /// Regulatory region the radio is operating in
+            std::string region{"???"};
+            /// Channel number the radio is using
+            size_t channel{0};
+            /// Transmit power (in dBm)
+            double txPower{0};
+        };
+
+        /**
+         * @brief Radio performance counters
+         */
+        struct RadioStats {
+            /// Total number of successfully received frames
+            size_t rxGood{0};
+            /// Number of received frames with uncorrectable errors
+            size_t rxCorrupt{0};
+            /// Receive packets dropped due to FIFO overruns
+            size_t rxFifoOverruns{0};
+            /// Total number of successfully transmitted frames (including beacons)
+            size_t txGood{0};
+            /// Number of frames that failed transmission due to carrier sense failure
+            size_t txCcaFails{0};
+            /// Transmit packets dropped due to FIFO underruns
+            size_t txFifoUnderruns{0};
+        };
+
+    private:
+        /// Handler for the response to a request: its payload (if any) or an error
+        using ResponseHandler = Completion<struct cbor_item_t>;
+
+        /**
+         * @brief A request waiting for its response
+         */
+        struct Request {
+            /// Time by which the (next) response must have arrived
+            std::chrono::steady_clock::time_point deadline;
+
+            /// Invoked with the response (for regular requests)
+            ResponseHandler handler;
+
+            /// Invoked for each item (for streams)
+            StreamItemHandler itemHandler;
+            /// Invoked when the stream ends
+            StreamCompletion streamCompletion;
+            /// Expected sequence number of the next chunk (for streams)
+            uint32_t sequence{0};
+            /// Chunks received since credits were last granted (for streams)
+            size_t unacknowledged{0};
         };
 
     public:
@@ -76,51 +208,60 @@ class BlazedClient {
         BlazedClient();
         ~BlazedClient();
 
-        void getVersion(std::string &outVersion, std::string &outBuild,
-                std::string &outRadioVersion);
-
-        void getRadioConfig(std::string &outRegion, size_t &outChannel, double &outTxPower);
+        /**
+         * @brief Determine whether the connection to blazed is established
+         */
+        inline bool isConnected() const {
+            return !!this->socket;
+        }
 
-        void getRadioStats(size_t &outRxGood, size_t &outRxCorrupt, size_t &outRxFifoOverruns,
-                size_t &outTxGood, size_t &outTxCcaFails, size_t &outTxFifoUnderruns);
+        void getVersion(const Completion<Version> &completion);
+        void getRadioConfig(const Completion<RadioConfig> &completion);
+        void getRadioStats(const Completion<RadioStats> &completion);
         void getClientStats(size_t &outNumConnected);
 
+        uint8_t openStream(const std::string_view source, const StreamItemHandler &itemHandler,
+                const StreamCompletion &completion);
+        void cancelStream(const uint8_t tag);
+
     private:
-        void ensureConnection();
         void connect();
-        void tearDown();
-        void sendRaw(std::span<const std::byte>);
+        void disconnect(const std::exception_ptr &reason);
+        void scheduleReconnect();
 
-        uint8_t sendPacket(const uint8_t, struct cbor_item_t* &);
-        uint8_t sendPacket(const uint8_t, std::span<const std::byte>);
-        [[nodiscard]] struct cbor_item_t *readResponse(const uint8_t tag);
+        void handleRead();
+        void handlePacket(std::span<const std::byte> packet);
+        void handleChunk(const uint8_t tag, Request &request, const struct cbor_item_t *chunk);
+        void checkTimeouts();
 
-        /**
-         * @brief Send a packet and read response
-         *
-         * @param endpoint Endpoint to send the packet to
-         * @param root CBOR item to serialize as the root
-         *
-         * @return Deserialized CBOR payload, if any
-         *
-         * @remark Caller is responsible for deallocating the returned CBOR item
-         */
-        inline auto sendWithResponse(const uint8_t endpoint, struct cbor_item_t* &root) {
-            const auto tag = this->sendPacket(endpoint, root);
-            return this->readResponse(tag);
-        }
+        uint8_t allocTag();
+        void sendPacket(const uint8_t endpoint, const uint8_t tag, struct cbor_item_t* &root);
+        void request(const uint8_t endpoint, struct cbor_item_t* &root,
+                const ResponseHandler &handler);
+
+        static void Fail(Request &request, const std::exception_ptr &reason);
+        static struct cbor_item_t *DecodePayload(std::span<const std::byte> packet);
 
     private:
         /// Path for the RPC socket file
         std::filesystem::path socketPath;
-        /// File descriptor for the local RPC socket
-        int socket{-1};
+        /// Connection to blazed (if established)
+        std::shared_ptr<TristLib::Event::Socket> socket;
+
+        /// Timer for the next reconnection attempt
+        std::shared_ptr<TristLib::Event::Timer> reconnectTimer;
+        /// Delay before the next reconnection attempt
+        std::chrono::milliseconds reconnectDelay{kMinReconnectDelay};
+        /// Timer to periodically check for requests that timed out
+        std::shared_ptr<TristLib::Event::Timer> timeoutTimer;
 
         /// Tag for the next outgoing message
         uint8_t nextTag{0};
+        /// Requests (and streams) waiting for responses, by tag
+        std::unordered_map<uint8_t, Request> requests;
 
-        /// Packet receive buffer
-        std::vector<std::byte> rxBuffer;
+        /// Data received from the socket that wasn't split into packets yet
+        std::vector<std::byte> rxStream;
 };
 }
 
@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <cmath>
+
+#include <fmt/format.h>
+
+#include <TristLib/Core.h>
+
+#include "AirtimeLimiter.h"
+
+/**
+ * @brief Apply the limits of a regulatory region
+ *
+ * All buckets are reset to the new region's capacity.
+ *
+ * @param newRegion Region whose limits to apply
+ */
+void AirtimeLimiter::setRegion(const Config::Regions::Region &newRegion) {
+    this->region = &newRegion;
+
+    const auto now = Clock::now();
+    for(auto &[channel, bucket] : this->buckets) {
+        bucket.tokens = this->capacity();
+        bucket.lastRefill = now;
+    }
+
+    PLOG_DEBUG << fmt::format("airtime: region {}, duty cycle {:.1f}% per {} ms", newRegion.name,
+            newRegion.dutyCycle * 100.f, newRegion.dutyWindow.count());
+}
+
+
+
+/**
+ * @brief Determine how long a transmission must be delayed
+ *
+ * @param channel Channel to transmit on
+ * @param airtime Time on air of the transmission
+ * @param floor Lowest balance the bucket may be left at, as a fraction of its capacity
+ *
+ * @return Time until the transmission may take place; zero if it may happen right away
+ */
+std::chrono::microseconds AirtimeLimiter::delayFor(const uint16_t channel,
+        const std::chrono::microseconds airtime, const float floor, const Clock::time_point now) {
+    if(!this->isLimited()) {
+        return std::chrono::microseconds(0);
+    }
+
+    auto &bucket = this->refill(channel, now);
+    const double needed = (floor * this->capacity()) + airtime.count() - bucket.tokens;
+
+    if(needed <= 0.) {
+        return std::chrono::microseconds(0);
+    }
+    return std::chrono::microseconds(static_cast<int64_t>(
+                std::ceil(needed / this->region->dutyCycle)));
+}
+
+/**
+ * @brief Account for a transmission
+ *
+ * @param channel Channel the frame was transmitted on
+ * @param airtime Time on air of the frame
+ */
+void AirtimeLimiter::consume(const uint16_t channel, const std::chrono::microseconds airtime,
+        const Clock::time_point now) {
+    auto &bucket = this->refill(channel, now);
+    const double used = airtime.count();
+
+    // track borrowing (the part of the airtime not covered by the balance)
+    if(this->isLimited() && used > bucket.tokens) {
+        bucket.stats.borrowed += used - std::max(0., bucket.tokens);
+    }
+    bucket.tokens -= used;
+
+    // decay and update the recent usage
+    this->getUtilization(channel, now);
+    bucket.recent += used;
+
+    bucket.stats.airtime += airtime.count();
+    bucket.stats.frames++;
+}
+
+/**
+ * @brief Record that a transmission was deferred for lack of airtime
+ *
+ * @param channel Channel the transmission was intended for
+ */
+void AirtimeLimiter::deferred(const uint16_t channel) {
+    this->buckets[channel].stats.deferrals++;
+}
+
+
+
+/**
+ * @brief Get the airtime utilization of a channel
+ *
+ * This is the fraction of time spent transmitting, averaged (with exponential decay) over
+ * approximately one duty cycle window.
+ *
+ * @param channel Channel to query
+ *
+ * @return Utilization, in [0, 1]
+ */
+double AirtimeLimiter::getUtilization(const uint16_t channel, const Clock::time_point now) {
+    auto it = this->buckets.find(channel);
+    if(it == this->buckets.end()) {
+        return 0.;
+    }
+
+    auto &bucket = it->second;
+    const double window = std::chrono::duration<double, std::micro>(
+            this->region->dutyWindow).count();
+    const double elapsed = std::chrono::duration<double, std::micro>(
+            now - bucket.lastDecay).count();
+
+    if(elapsed > 0.) {
+        bucket.recent *= std::exp(-elapsed / window);
+        bucket.lastDecay = now;
+    }
+
+    return std::min(1., bucket.recent / window);
+}
+
+/**
+ * @brief Get the airtime balance of a channel
+ *
+ * @param channel Channel to query
+ *
+ * @return Available airtime (µs); negative if airtime was borrowed
+ */
+double AirtimeLimiter::getBalance(const uint16_t channel, const Clock::time_point now) {
+    return this->refill(channel, now).tokens;
+}
+
+/**
+ * @brief Refill a channel's bucket
+ *
+ * Credit the airtime allowance accumulated since the last refill. The bucket is created (full) if
+ * the channel wasn't used before.
+ *
+ * @param channel Channel whose bucket to refill
+ */
+AirtimeLimiter::Bucket &AirtimeLimiter::refill(const uint16_t channel,
+        const Clock::time_point now) {
+    auto [it, inserted] = this->buckets.try_emplace(channel);
+    auto &bucket = it->second;
+
+    if(inserted || !bucket.lastRefill.time_since_epoch().count()) {
+        bucket.tokens = this->capacity();
+        bucket.lastRefill = bucket.lastDecay = now;
+        return bucket;
+    }
+
+    const double elapsed = std::chrono::duration<double, std::micro>(
+            now - bucket.lastRefill).count();
+    if(elapsed > 0.) {
+        bucket.tokens = std::min(this->capacity(),
+                bucket.tokens + (elapsed * this->region->dutyCycle));
+        bucket.lastRefill = now;
+    }
+
+    return bucket;
+}
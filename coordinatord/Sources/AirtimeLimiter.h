@@ -0,0 +1,122 @@
+#ifndef AIRTIMELIMITER_H
+#define AIRTIMELIMITER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+#include "Config/Regions.h"
+
+/**
+ * @brief Airtime accounting and duty cycle limiter
+ *
+ * Keeps track of how much time is spent transmitting on each channel, and enforces the duty cycle
+ * limit of the regulatory region with a token bucket per channel. The bucket holds up to one
+ * window's worth of airtime allowance, and is refilled continuously at the duty cycle rate.
+ *
+ * Callers decide how much of the bucket a transmission may use by specifying a floor: the lowest
+ * balance the bucket may be left at. A positive floor keeps a reserve for more important traffic,
+ * while a negative floor allows borrowing against future allowance. Borrowed airtime is repaid as
+ * the bucket refills, delaying subsequent transmissions.
+ */
+class AirtimeLimiter {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /**
+         * @brief Airtime statistics for a channel
+         */
+        struct ChannelStats {
+            /// Total airtime used (µs)
+            uint_least64_t airtime{0};
+            /// Number of frames transmitted
+            uint_least64_t frames{0};
+            /// Number of times a transmission was deferred for lack of airtime
+            uint_least64_t deferrals{0};
+            /// Total airtime borrowed against future allowance (µs)
+            uint_least64_t borrowed{0};
+        };
+
+    private:
+        /**
+         * @brief Per-channel accounting state
+         */
+        struct Bucket {
+            /// Available airtime (µs); negative if borrowed
+            double tokens{0};
+            /// Time the bucket was last refilled
+            Clock::time_point lastRefill;
+
+            /// Exponentially decaying sum of recently used airtime (µs)
+            double recent{0};
+            /// Time the recent airtime was last decayed
+            Clock::time_point lastDecay;
+
+            /// Statistics
+            ChannelStats stats{};
+        };
+
+    public:
+        void setRegion(const Config::Regions::Region &region);
+
+        /**
+         * @brief Get the time on air of a frame
+         *
+         * @param length Frame length in bytes (including PHY header)
+         */
+        constexpr inline std::chrono::microseconds airtimeFor(const size_t length) const {
+            return this->region->channels.airtime(length);
+        }
+        /**
+         * @brief Determine whether the duty cycle is limited at all
+         */
+        constexpr inline bool isLimited() const {
+            return this->region->dutyCycle < 1.f;
+        }
+        /**
+         * @brief Get the regulatory region whose limits are enforced
+         */
+        constexpr inline auto &getRegion() const {
+            return *this->region;
+        }
+
+        std::chrono::microseconds delayFor(const uint16_t channel,
+                const std::chrono::microseconds airtime, const float floor,
+                const Clock::time_point now = Clock::now());
+        void consume(const uint16_t channel, const std::chrono::microseconds airtime,
+                const Clock::time_point now = Clock::now());
+        void deferred(const uint16_t channel);
+
+        double getUtilization(const uint16_t channel, const Clock::time_point now = Clock::now());
+        double getBalance(const uint16_t channel, const Clock::time_point now = Clock::now());
+
+        /**
+         * @brief Get the accounting state of all channels
+         *
+         * Only channels that were transmitted on are present.
+         */
+        inline const auto &getChannels() const {
+            return this->buckets;
+        }
+
+    private:
+        /**
+         * @brief Get the bucket size (µs)
+         */
+        constexpr inline double capacity() const {
+            return this->region->dutyCycle * std::chrono::duration<double, std::micro>(
+                    this->region->dutyWindow).count();
+        }
+
+        Bucket &refill(const uint16_t channel, const Clock::time_point now);
+
+    private:
+        /// Region whose limits are applied
+        const Config::Regions::Region *region{&Config::Regions::kRegions.back()};
+
+        /// Accounting state of each channel
+        std::unordered_map<uint16_t, Bucket> buckets;
+};
+
+#endif
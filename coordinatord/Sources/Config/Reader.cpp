@@ -3,6 +3,8 @@
 
 #include <TristLib/Core.h>
 
+#include <algorithm>
+#include <cctype>
 #include <filesystem>
 #include <memory>
 #include <stdexcept>
@@ -14,6 +16,7 @@ using namespace Config;
 
 static toml::table gConfig;
 static toml::table gTransportConfig;
+static const Regions::Region *gRegion{&Regions::kRegions.back()};
 
 static void ReadConfd(const toml::table &);
 static void ReadRadio(const toml::table &);
@@ -37,6 +40,15 @@ const toml::table &Config::GetConfig() {
     return gConfig;
 }
 
+/**
+ * @brief Get the regulatory region
+ *
+ * This is determined by the country specified in the `radio.region` section.
+ */
+const Regions::Region &Config::GetRegion() {
+    return *gRegion;
+}
+
 
 
 /**
@@ -156,6 +168,8 @@ static void ReadRadioTransport(const toml::table &root) {
  * available:
  *
  * - country: A two character country code
+ *
+ * Countries not found in the region table are treated as part of the most restrictive region.
  */
 static void ReadRadioRegion(const toml::table &root) {
     const auto country = root["country"];
@@ -163,7 +177,16 @@ static void ReadRadioRegion(const toml::table &root) {
         throw std::runtime_error("missing or invalid `radio.region.country` key");
     }
 
-    // TODO: set radio country
-    const std::string countryStr = country.value_or("");
-    PLOG_VERBOSE << "Radio country: " << countryStr;
+    std::string countryStr = country.value_or("");
+    std::transform(countryStr.begin(), countryStr.end(), countryStr.begin(),
+            [](unsigned char c){ return std::toupper(c); });
+
+    gRegion = &Regions::Find(countryStr);
+
+    if(!gRegion->hasCountry(countryStr)) {
+        PLOG_WARNING << fmt::format("Unknown radio country `{}`, using region {}", countryStr,
+                gRegion->name);
+    } else {
+        PLOG_VERBOSE << fmt::format("Radio country: {} (region {})", countryStr, gRegion->name);
+    }
 }
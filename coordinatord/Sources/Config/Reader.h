@@ -4,11 +4,14 @@
 #include <filesystem>
 #include <toml++/toml.h>
 
+#include "Config/Regions.h"
+
 namespace Config {
 void Read(const std::filesystem::path &configFile);
 
 const toml::table &GetTransportConfig();
 const toml::table &GetConfig();
+const Regions::Region &GetRegion();
 };
 
 #endif
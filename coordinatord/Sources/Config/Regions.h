@@ -0,0 +1,193 @@
+/**
+ * @file
+ *
+ * @brief Regulatory region definitions
+ *
+ * Describes the channel plan and transmit limits that apply in each regulatory region. The table
+ * is evaluated entirely at compile time; a country code from the config file is resolved to its
+ * region with Config::Regions::Find().
+ *
+ * @remark The limits are deliberately conservative. In particular, the duty cycle limits for the
+ *         ETSI region are those for non-adaptive equipment (10% medium utilization) even though
+ *         the radio performs clear channel assessment before every transmission.
+ */
+#ifndef CONFIG_REGIONS_H
+#define CONFIG_REGIONS_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace Config::Regions {
+/**
+ * @brief Channel plan
+ *
+ * Describes a range of evenly spaced channels, and the PHY used on them.
+ */
+struct ChannelPlan {
+    /// First valid channel number
+    uint16_t first;
+    /// Last valid channel number (inclusive)
+    uint16_t last;
+    /// Center frequency of the first channel (kHz)
+    uint32_t baseFrequency;
+    /// Spacing between channels (kHz)
+    uint32_t spacing;
+
+    /// PHY bit rate (bits per second)
+    uint32_t bitRate;
+    /// Bytes sent on air in addition to the frame (preamble, start of frame delimiter, FCS)
+    uint8_t overhead;
+
+    /**
+     * @brief Check whether a channel is part of this plan
+     */
+    constexpr inline bool contains(const uint16_t channel) const {
+        return channel >= this->first && channel <= this->last;
+    }
+
+    /**
+     * @brief Get the center frequency of a channel (kHz)
+     */
+    constexpr inline uint32_t frequency(const uint16_t channel) const {
+        return this->baseFrequency + (channel - this->first) * this->spacing;
+    }
+
+    /**
+     * @brief Calculate the time on air of a frame
+     *
+     * @param length Frame length in bytes, including the PHY header
+     */
+    constexpr inline std::chrono::microseconds airtime(const size_t length) const {
+        return std::chrono::microseconds(((length + this->overhead) * 8ULL * 1'000'000ULL)
+                / this->bitRate);
+    }
+};
+
+/**
+ * @brief Regulatory region
+ */
+struct Region {
+    /// Short name of the region
+    std::string_view name;
+    /// ISO 3166 country codes in this region, separated by spaces
+    std::string_view countries;
+
+    /// Channel plan
+    ChannelPlan channels;
+    /// Maximum transmit power (⅒th dBm)
+    uint16_t maxTxPower;
+
+    /**
+     * @brief Maximum fraction of time spent transmitting, per channel
+     *
+     * A value of 1 indicates there is no duty cycle limit.
+     */
+    float dutyCycle;
+    /// Time window over which the duty cycle is measured
+    std::chrono::milliseconds dutyWindow;
+    /// Maximum duration of a single transmission (0 = no limit)
+    std::chrono::microseconds maxDwell;
+
+    /**
+     * @brief Check whether a country belongs to this region
+     *
+     * @param country Two letter country code (upper case)
+     */
+    constexpr bool hasCountry(const std::string_view country) const {
+        if(country.size() != 2) {
+            return false;
+        }
+
+        for(size_t i = 0; i + 1 < this->countries.size(); i += 3) {
+            if(this->countries.substr(i, 2) == country) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+/// IEEE 802.15.4 O-QPSK PHY in the 2.4GHz band
+constexpr static const ChannelPlan kPlan2450{
+    .first = 11,
+    .last = 26,
+    .baseFrequency = 2'405'000,
+    .spacing = 5'000,
+    .bitRate = 250'000,
+    // 4 byte preamble, start of frame delimiter, 2 byte FCS
+    .overhead = 7,
+};
+
+/**
+ * @brief All known regions
+ *
+ * The last entry is used for countries not found in any other region, and applies the strictest
+ * limits of all regions.
+ */
+constexpr static const std::array<Region, 4> kRegions{{
+    {
+        .name = "FCC",
+        .countries = "US CA MX PR",
+        .channels = kPlan2450,
+        .maxTxPower = 300,
+        .dutyCycle = 1.f,
+        .dutyWindow = std::chrono::milliseconds(1'000),
+        .maxDwell = std::chrono::microseconds(0),
+    },
+    {
+        .name = "ETSI",
+        .countries = "AT BE BG HR CY CZ DK EE FI FR DE GR HU IE IT LV LT LU MT NL PL PT RO SK SI "
+            "ES SE GB CH NO IS LI",
+        .channels = kPlan2450,
+        .maxTxPower = 200,
+        .dutyCycle = .1f,
+        .dutyWindow = std::chrono::milliseconds(1'000),
+        .maxDwell = std::chrono::microseconds(0),
+    },
+    {
+        .name = "ARIB",
+        .countries = "JP",
+        .channels = kPlan2450,
+        .maxTxPower = 100,
+        .dutyCycle = 1.f,
+        .dutyWindow = std::chrono::milliseconds(1'000),
+        .maxDwell = std::chrono::microseconds(0),
+    },
+    {
+        .name = "World",
+        .countries = "",
+        .channels = kPlan2450,
+        .maxTxPower = 100,
+        .dutyCycle = .1f,
+        .dutyWindow = std::chrono::milliseconds(1'000),
+        .maxDwell = std::chrono::microseconds(0),
+    },
+}};
+
+/**
+ * @brief Find the region a country belongs to
+ *
+ * @param country Two letter country code (upper case)
+ *
+ * @return Region for the country; or the most restrictive region, if the country is unknown
+ */
+constexpr inline const Region &Find(const std::string_view country) {
+    for(const auto &region : kRegions) {
+        if(region.hasCountry(country)) {
+            return region;
+        }
+    }
+    return kRegions.back();
+}
+
+static_assert(Find("US").name == "FCC");
+static_assert(Find("DE").name == "ETSI");
+static_assert(Find("LI").name == "ETSI");
+static_assert(Find("XX").name == "World");
+static_assert(kPlan2450.airtime(127).count() == 4'288);
+}
+
+#endif
@@ -0,0 +1,125 @@
+#include <BlazeNet/Types.h>
+
+#include "NetControl.h"
+#include "AddressAllocator.h"
+
+using namespace Protocol;
+
+/**
+ * @brief Initialize the address allocator
+ *
+ * All addresses are available, except for the broadcast address and the range reserved for
+ * multicast groups.
+ */
+AddressAllocator::AddressAllocator() {
+    this->reserve(BlazeNet::Types::Mac::kBroadcastAddress);
+
+    for(uint32_t group = NetControl::kFirstGroupAddress; group <= NetControl::kLastGroupAddress;
+            group++) {
+        this->reserve(group);
+    }
+}
+
+/**
+ * @brief Allocate a free address
+ *
+ * The search starts at the address following the one allocated last, and wraps around at the end
+ * of the address space; so a released address is only handed out again once the search has come
+ * all the way around to it.
+ *
+ * @return An address that was not previously in use, or nothing if all addresses are taken
+ */
+std::optional<uint16_t> AddressAllocator::allocate() {
+    if(!this->numFree) {
+        return std::nullopt;
+    }
+
+    // the first word is visited again at the end, for the addresses below the starting point
+    const size_t first = this->hint / kBitsPerWord;
+
+    for(size_t i = 0; i <= kNumWords; i++) {
+        const auto index = (first + i) % kNumWords;
+        auto &word = this->bitmap[index];
+
+        uint64_t available = ~word;
+        if(!i) {
+            available &= (~0ULL << (this->hint % kBitsPerWord));
+        }
+        if(!available) {
+            continue;
+        }
+
+        const auto bit = __builtin_ctzll(available);
+        word |= (1ULL << bit);
+
+        this->numFree--;
+
+        const size_t address = (index * kBitsPerWord) + bit;
+        this->hint = (address + 1) % (kNumWords * kBitsPerWord);
+
+        return address;
+    }
+
+    return std::nullopt;
+}
+
+/**
+ * @brief Mark a specific address as in use
+ *
+ * @param address Address to reserve
+ *
+ * @return Whether the address was free (and is now reserved)
+ */
+bool AddressAllocator::reserve(const uint16_t address) {
+    auto &word = this->bitmap[address / kBitsPerWord];
+    const auto mask = 1ULL << (address % kBitsPerWord);
+
+    if(word & mask) {
+        return false;
+    }
+
+    word |= mask;
+    this->numFree--;
+    return true;
+}
+
+/**
+ * @brief Return an address to the pool
+ *
+ * @param address Address to release; releasing an address that's not in use has no effect.
+ */
+void AddressAllocator::release(const uint16_t address) {
+    auto &word = this->bitmap[address / kBitsPerWord];
+    const auto mask = 1ULL << (address % kBitsPerWord);
+
+    if(word & mask) {
+        word &= ~mask;
+        this->numFree++;
+    }
+}
+
+/**
+ * @brief Find the next address that's in use
+ *
+ * @param start Address to start searching at
+ *
+ * @return The lowest address at or above `start` that's in use, or nothing if there's none
+ */
+std::optional<uint16_t> AddressAllocator::findAllocated(const uint32_t start) const {
+    if(start >= kNumWords * kBitsPerWord) {
+        return std::nullopt;
+    }
+
+    size_t index = start / kBitsPerWord;
+    // ignore addresses below the start in the first word
+    uint64_t word = this->bitmap[index] & (~0ULL << (start % kBitsPerWord));
+
+    while(!word) {
+        if(++index == kNumWords) {
+            return std::nullopt;
+        }
+        word = this->bitmap[index];
+    }
+
+    return (index * kBitsPerWord) + __builtin_ctzll(word);
+}
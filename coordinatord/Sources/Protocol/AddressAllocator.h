@@ -0,0 +1,57 @@
+#ifndef PROTOCOL_ADDRESSALLOCATOR_H
+#define PROTOCOL_ADDRESSALLOCATOR_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace Protocol {
+/**
+ * @brief Short address allocator
+ *
+ * Tracks which of the 16-bit short addresses are in use with a bitmap covering the entire address
+ * space (8K bytes.) Allocation scans the bitmap a word at a time, starting after the most recently
+ * allocated address and wrapping around, so that freed addresses aren't immediately handed out
+ * again.
+ */
+class AddressAllocator {
+    private:
+        /// Number of addresses per bitmap word
+        constexpr static const size_t kBitsPerWord{64};
+        /// Total number of words in the bitmap
+        constexpr static const size_t kNumWords{0x10000 / kBitsPerWord};
+
+    public:
+        AddressAllocator();
+
+        std::optional<uint16_t> allocate();
+        bool reserve(const uint16_t address);
+        void release(const uint16_t address);
+
+        /**
+         * @brief Determine whether an address is in use
+         */
+        constexpr inline bool isAllocated(const uint16_t address) const {
+            return this->bitmap[address / kBitsPerWord] & (1ULL << (address % kBitsPerWord));
+        }
+        std::optional<uint16_t> findAllocated(const uint32_t start) const;
+
+        /**
+         * @brief Get the number of available addresses
+         */
+        constexpr inline size_t getNumFree() const {
+            return this->numFree;
+        }
+
+    private:
+        /// Bitmap of addresses in use (set bits)
+        std::array<uint64_t, kNumWords> bitmap{};
+        /// Number of clear bits in the bitmap
+        size_t numFree{0x10000};
+        /// Address at which the next search starts (following the most recently allocated one)
+        size_t hint{0};
+};
+}
+
+#endif
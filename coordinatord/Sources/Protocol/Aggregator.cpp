@@ -0,0 +1,255 @@
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include <TristLib/Core.h>
+#include <TristLib/Event.h>
+
+#include "Config/Reader.h"
+#include "Radio.h"
+#include "Handler.h"
+#include "NetControl.h"
+#include "Aggregator.h"
+
+using namespace Protocol;
+
+/**
+ * @brief Initialize the aggregator
+ *
+ * Read the configuration. The timer used to flush batches is created when a batch is started.
+ *
+ * @param handler Protocol handler that instantiated us
+ */
+Aggregator::Aggregator(Handler &handler) : handler(handler) {
+    this->reloadConfig();
+}
+
+/**
+ * @brief Clean up the aggregator
+ *
+ * Messages that haven't been sent yet are failed.
+ */
+Aggregator::~Aggregator() {
+    this->flushTimer.reset();
+
+    auto batches = std::move(this->batches);
+    for(auto &[key, batch] : batches) {
+        for(const auto &callback : batch.callbacks) {
+            if(callback) {
+                callback(false);
+            }
+        }
+    }
+}
+
+
+
+/**
+ * @brief Read the aggregation configuration
+ *
+ * All keys are optional, and live in the `protocol.aggregation` table of the config file:
+ *
+ * - delay: Maximum time a message may be held to be aggregated with others (msec); 0 disables
+ *   aggregation.
+ */
+void Aggregator::reloadConfig() {
+    const auto &root = Config::GetConfig();
+
+    auto delay = root.at_path(kConfDelay);
+    if(delay && delay.is_integer()) {
+        this->delay = std::chrono::milliseconds(
+                std::max<int64_t>(0, delay.value_or(kDefaultDelay.count())));
+    }
+
+    PLOG_DEBUG << fmt::format("aggregation delay: {} ms", this->delay.count());
+}
+
+
+
+/**
+ * @brief Submit a message for aggregation
+ *
+ * @param destination Short address of the node to send to
+ * @param endpoint Endpoint flags of the message
+ * @param priority Transmission priority
+ * @param payload Message payload
+ * @param completion Invoked once the frame carrying the message is acknowledged, or failed
+ *
+ * @return Whether the message was accepted; if not, the caller should send it directly.
+ */
+bool Aggregator::submit(const uint16_t destination,
+        const BlazeNet::Types::Mac::HeaderFlags endpoint, const Radio::PacketPriority priority,
+        std::span<const std::byte> payload, const CompletionCallback &completion) {
+    using namespace BlazeNet::Types;
+
+    // is the message eligible?
+    if(!this->isEnabled() || priority > Radio::PacketPriority::Normal) {
+        return false;
+    } else if((endpoint & NetControl::kEndpointMask) ==
+            (Mac::HeaderFlags::EndpointNetControl & NetControl::kEndpointMask)) {
+        return false;
+    }
+
+    const auto entrySize = sizeof(NetControl::AggregateEntry) + payload.size();
+    if(sizeof(NetControl::Header) + entrySize > Handler::kMaxPayloadSize) {
+        return false;
+    }
+
+    // get the batch for this destination, and make room if needed
+    auto [it, inserted] = this->batches.try_emplace(MakeKey(destination, priority));
+    auto &batch = it->second;
+
+    if(inserted) {
+        batch.destination = destination;
+        batch.priority = priority;
+
+        batch.buffer.reserve(Handler::kMaxPayloadSize);
+        batch.buffer.resize(sizeof(NetControl::Header));
+
+        auto ncHdr = reinterpret_cast<NetControl::Header *>(batch.buffer.data());
+        ncHdr->type = static_cast<uint8_t>(NetControl::MessageType::Aggregate);
+    } else if(batch.buffer.size() + entrySize > Handler::kMaxPayloadSize) {
+        this->flush(batch);
+    }
+
+    // append the message
+    const auto offset = batch.buffer.size();
+    batch.buffer.resize(offset + entrySize);
+
+    auto entry = reinterpret_cast<NetControl::AggregateEntry *>(batch.buffer.data() + offset);
+    entry->endpoint = endpoint;
+    entry->length = payload.size();
+    if(!payload.empty()) {
+        memcpy(entry->data, payload.data(), payload.size());
+    }
+
+    batch.count++;
+    batch.callbacks.emplace_back(completion);
+    this->counters.messages++;
+
+    this->armTimer();
+    return true;
+}
+
+/**
+ * @brief Transmit all pending batches
+ */
+void Aggregator::flushAll() {
+    auto batches = std::move(this->batches);
+    this->batches.clear();
+
+    for(auto &[key, batch] : batches) {
+        if(batch.count) {
+            this->flush(batch);
+        }
+    }
+}
+
+/**
+ * @brief Transmit a batch
+ *
+ * A batch containing only a single message is sent as a regular frame. The batch is reset before
+ * the frame is submitted, so completions may submit new messages.
+ *
+ * @param batch Batch to transmit
+ */
+void Aggregator::flush(Batch &batch) {
+    using namespace BlazeNet::Types;
+
+    // take the batch's contents
+    const auto count = batch.count;
+    std::vector<std::byte> frame(batch.buffer);
+    auto callbacks = std::move(batch.callbacks);
+
+    batch.buffer.resize(sizeof(NetControl::Header));
+    batch.callbacks.clear();
+    batch.count = 0;
+
+    this->counters.frames++;
+
+    // single message: no need for the aggregate header
+    if(count == 1) {
+        auto entry = reinterpret_cast<const NetControl::AggregateEntry *>(frame.data()
+                + sizeof(NetControl::Header));
+        const std::span<const std::byte> payload(reinterpret_cast<const std::byte *>(entry->data),
+                entry->length);
+
+        this->handler.sendFrame(batch.destination, static_cast<Mac::HeaderFlags>(entry->endpoint),
+                batch.priority, payload, callbacks.front());
+        return;
+    }
+
+    // otherwise, all messages complete together
+    this->counters.aggregated += count;
+
+    auto shared = std::make_shared<std::vector<CompletionCallback>>(std::move(callbacks));
+    this->handler.sendFrame(batch.destination, Mac::HeaderFlags::EndpointNetControl,
+            batch.priority, frame, [shared](const bool success) {
+        for(const auto &callback : *shared) {
+            if(callback) {
+                callback(success);
+            }
+        }
+    });
+}
+
+/**
+ * @brief Start the flush timer, if not already running
+ */
+void Aggregator::armTimer() {
+    if(this->flushTimer) {
+        return;
+    }
+
+    this->flushTimer = std::make_shared<TristLib::Event::Timer>(
+            TristLib::Event::RunLoop::Current(), std::chrono::microseconds(this->delay),
+            [this](auto) {
+        // keep the timer alive until its callback returns
+        auto timer = std::move(this->flushTimer);
+
+        try {
+            this->flushAll();
+        } catch(const std::exception &e) {
+            PLOG_ERROR << fmt::format("failed to flush aggregated messages: {}", e.what());
+        }
+    });
+}
+
+
+
+/**
+ * @brief Split a received aggregate frame into its messages
+ *
+ * Each message is delivered as if it had been received in its own frame. Processing stops at the
+ * first malformed entry.
+ *
+ * @param source Address of the node that sent the frame
+ * @param payload Aggregate message (following the network control header)
+ */
+void Aggregator::handleAggregate(const uint16_t source, std::span<const std::byte> payload) {
+    this->counters.rxFrames++;
+
+    while(!payload.empty()) {
+        if(payload.size() < sizeof(NetControl::AggregateEntry)) {
+            this->counters.rxInvalid++;
+            return;
+        }
+
+        auto entry = reinterpret_cast<const NetControl::AggregateEntry *>(payload.data());
+        const size_t length = entry->length;
+
+        if(payload.size() < sizeof(*entry) + length) {
+            this->counters.rxInvalid++;
+            return;
+        }
+
+        this->counters.rxMessages++;
+        this->handler.deliverMessage(source,
+                static_cast<BlazeNet::Types::Mac::HeaderFlags>(entry->endpoint),
+                payload.subspan(sizeof(*entry), length));
+
+        payload = payload.subspan(sizeof(*entry) + length);
+    }
+}
@@ -0,0 +1,150 @@
+#ifndef PROTOCOL_AGGREGATOR_H
+#define PROTOCOL_AGGREGATOR_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <BlazeNet/Types.h>
+
+#include "Radio.h"
+
+namespace TristLib::Event {
+class Timer;
+}
+
+namespace Protocol {
+class Handler;
+
+/**
+ * @brief Downlink message aggregator
+ *
+ * Coalesces small messages to the same node (at the same priority) into a single frame, so they
+ * share the PHY/MAC overhead, a single transfer to the radio and a single channel access. Messages
+ * are held for at most the configured delay budget, or until the frame is full, whichever comes
+ * first. The receiver splits the frame back into individual messages.
+ *
+ * Only background and normal priority messages are aggregated; more urgent traffic is never
+ * delayed. Aggregation is disabled if the delay budget is zero (the default.)
+ */
+class Aggregator {
+    private:
+        /// Config key for the delay budget (msec)
+        constexpr static const std::string_view kConfDelay{"protocol.aggregation.delay"};
+
+        /// Default delay budget
+        constexpr static const std::chrono::milliseconds kDefaultDelay{0};
+
+    public:
+        /**
+         * @brief Completion callback
+         *
+         * @param success Whether the message was acknowledged by its destination
+         */
+        using CompletionCallback = std::function<void(const bool success)>;
+
+        /**
+         * @brief Aggregation performance counters
+         */
+        struct Counters {
+            /// Messages submitted for aggregation
+            uint_least64_t messages{0};
+            /// Frames transmitted for those messages
+            uint_least64_t frames{0};
+            /// Messages that shared a frame with at least one other message
+            uint_least64_t aggregated{0};
+            /// Aggregate frames received
+            uint_least64_t rxFrames{0};
+            /// Messages extracted from received aggregate frames
+            uint_least64_t rxMessages{0};
+            /// Malformed aggregate frames received
+            uint_least64_t rxInvalid{0};
+        };
+
+    private:
+        /**
+         * @brief Messages waiting to be sent to a node
+         */
+        struct Batch {
+            /// Destination address
+            uint16_t destination;
+            /// Transmit priority
+            Radio::PacketPriority priority;
+
+            /// Number of messages in the batch
+            size_t count{0};
+            /// Aggregate message (network control header, followed by the entries)
+            std::vector<std::byte> buffer;
+            /// Completion callbacks of each message
+            std::vector<CompletionCallback> callbacks;
+        };
+
+    public:
+        Aggregator(Handler &handler);
+        ~Aggregator();
+
+        void reloadConfig();
+
+        /**
+         * @brief Determine whether aggregation is enabled
+         */
+        inline bool isEnabled() const {
+            return this->delay.count() > 0;
+        }
+
+        bool submit(const uint16_t destination, const BlazeNet::Types::Mac::HeaderFlags endpoint,
+                const Radio::PacketPriority priority, std::span<const std::byte> payload,
+                const CompletionCallback &completion);
+        void flushAll();
+
+        void handleAggregate(const uint16_t source, std::span<const std::byte> payload);
+
+        /**
+         * @brief Get the average number of messages per transmitted frame
+         */
+        inline double getRatio() const {
+            return this->counters.frames ? (static_cast<double>(this->counters.messages) /
+                    this->counters.frames) : 0.;
+        }
+        /**
+         * @brief Get the performance counters
+         */
+        inline const auto &getCounters() const {
+            return this->counters;
+        }
+
+    private:
+        /// Build the key for the batch map
+        constexpr static inline uint32_t MakeKey(const uint16_t destination,
+                const Radio::PacketPriority priority) {
+            return (static_cast<uint32_t>(destination) << 8) | static_cast<uint8_t>(priority);
+        }
+
+        void flush(Batch &batch);
+        void armTimer();
+
+    private:
+        /// Handle to the protocol handler that owns us
+        Handler &handler;
+
+        /// Maximum time a message is held
+        std::chrono::milliseconds delay{kDefaultDelay};
+
+        /// Messages waiting to be sent, keyed by destination and priority
+        std::unordered_map<uint32_t, Batch> batches;
+
+        /// Timer to flush batches once the delay budget expires (only exists while armed)
+        std::shared_ptr<TristLib::Event::Timer> flushTimer;
+
+        /// Performance counters
+        Counters counters{};
+};
+}
+
+#endif
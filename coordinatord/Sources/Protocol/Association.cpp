@@ -0,0 +1,404 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <BlazeNet/Types.h>
+#include <fmt/format.h>
+
+#include <TristLib/Core.h>
+#include <TristLib/Event.h>
+
+#include "Config/Reader.h"
+#include "Radio.h"
+#include "GroupTable.h"
+#include "Handler.h"
+#include "IndirectQueue.h"
+#include "LinkQuality.h"
+#include "OtaDistributor.h"
+#include "PowerControl.h"
+#include "Retransmitter.h"
+#include "Security.h"
+#include "Superframe.h"
+#include "Association.h"
+
+using namespace Protocol;
+
+/**
+ * @brief Initialize the association manager
+ *
+ * Read the configuration, reserve the addresses that may never be assigned to nodes, and set up
+ * the timer used to expire pending associations.
+ *
+ * @param handler Protocol handler that instantiated us
+ */
+Association::Association(Handler &handler) : handler(handler) {
+    this->addresses.reserve(this->handler.radio->getAddress());
+    this->addresses.reserve(NetControl::kUnassignedAddress);
+
+    this->reloadConfig();
+
+    this->tickTimer = std::make_shared<TristLib::Event::Timer>(
+            TristLib::Event::RunLoop::Current(), kTickInterval, [this](auto timer) {
+        this->tick();
+    }, true);
+}
+
+/**
+ * @brief Clean up the association manager
+ */
+Association::~Association() {
+    this->tickTimer.reset();
+}
+
+
+
+/**
+ * @brief Read the association configuration
+ *
+ * All keys are optional, and live in the `protocol.association` table of the config file:
+ *
+ * - pairing: Whether new nodes may join the network
+ * - maxPending: Maximum number of associations that may be pending at once
+ * - joinRate: Average number of join requests accepted per second
+ * - joinBurst: Maximum number of join requests accepted in a burst
+ * - retryInterval: Minimum time between join attempts of a single node (msec)
+ * - timeout: Time to wait for a node to confirm its association (msec)
+ */
+void Association::reloadConfig() {
+    const auto &root = Config::GetConfig();
+
+    auto pairing = root.at_path(kConfPairing);
+    if(pairing && pairing.is_boolean()) {
+        this->pairingEnabled = pairing.value_or(false);
+    }
+
+    auto maxPending = root.at_path(kConfMaxPending);
+    if(maxPending && maxPending.is_integer()) {
+        this->maxPending = std::max<int64_t>(1, maxPending.value_or(kDefaultMaxPending));
+    }
+
+    auto joinRate = root.at_path(kConfJoinRate);
+    if(joinRate && joinRate.is_number()) {
+        this->joinRate = joinRate.value_or(kDefaultJoinRate);
+    }
+    auto joinBurst = root.at_path(kConfJoinBurst);
+    if(joinBurst && joinBurst.is_number()) {
+        this->joinBurst = joinBurst.value_or(kDefaultJoinBurst);
+    }
+    if(this->joinRate <= 0 || this->joinBurst < 1) {
+        throw std::runtime_error(fmt::format("invalid `{}` or `{}`: must be positive",
+                    kConfJoinRate, kConfJoinBurst));
+    }
+
+    auto retryInterval = root.at_path(kConfRetryInterval);
+    if(retryInterval && retryInterval.is_integer()) {
+        this->retryInterval = std::chrono::milliseconds(
+                retryInterval.value_or(kDefaultRetryInterval.count()));
+    }
+    auto timeout = root.at_path(kConfTimeout);
+    if(timeout && timeout.is_integer()) {
+        this->timeout = std::chrono::milliseconds(timeout.value_or(kDefaultTimeout.count()));
+    }
+    if(this->timeout < kTickInterval) {
+        throw std::runtime_error(fmt::format("invalid `{}`: must be at least {} ms", kConfTimeout,
+                    kTickInterval.count()));
+    }
+
+    this->joinTokens = std::min(this->joinTokens, this->joinBurst);
+
+    PLOG_DEBUG << fmt::format("association: pairing {}, max pending {}, {}/s (burst {})",
+            this->pairingEnabled ? "enabled" : "disabled", this->maxPending, this->joinRate,
+            this->joinBurst);
+}
+
+
+
+/**
+ * @brief Process an association request
+ *
+ * Admission checks are performed first (cheapest first) so that excess requests are discarded
+ * with as little work as possible.
+ *
+ * @param source Source address of the request frame
+ * @param payload Request message (following the network control header)
+ */
+void Association::handleRequest(const uint16_t source, std::span<const std::byte> payload) {
+    const auto now = std::chrono::steady_clock::now();
+    this->counters.requests++;
+
+    if(payload.size() < sizeof(NetControl::AssociationRequest)) {
+        this->counters.invalid++;
+        return;
+    }
+
+    auto req = reinterpret_cast<const NetControl::AssociationRequest *>(payload.data());
+    uint64_t eui64;
+    memcpy(&eui64, req->eui64, sizeof(eui64));
+
+    // limit how often each node may try to join
+    auto attempt = this->lastAttempt.find(eui64);
+    if(attempt != this->lastAttempt.end()) {
+        if(now - attempt->second < this->retryInterval) {
+            this->counters.rateLimited++;
+            return;
+        }
+        attempt->second = now;
+    } else if(this->lastAttempt.size() >= kMaxTrackedAttempts) {
+        this->counters.throttled++;
+        return;
+    } else {
+        this->lastAttempt.emplace(eui64, now);
+    }
+
+    // admission limits
+    if(this->numPending >= this->maxPending || !this->admit(now)) {
+        this->counters.throttled++;
+        return;
+    }
+
+    // known nodes may always rejoin (with the same address)
+    auto it = this->nodes.find(eui64);
+
+    if(it == this->nodes.end()) {
+        if(!this->pairingEnabled) {
+            this->counters.refused++;
+            this->sendResponse(eui64, NetControl::AssociationStatus::PairingDisabled, 0);
+            return;
+        }
+
+        const auto address = this->addresses.allocate();
+        if(!address) {
+            this->counters.refused++;
+            this->sendResponse(eui64, NetControl::AssociationStatus::NetworkFull, 0);
+            return;
+        }
+
+        it = this->nodes.emplace(eui64, Node{
+            .eui64 = eui64,
+            .address = *address,
+            .state = State::Associated,
+        }).first;
+        this->addressMap.emplace(*address, eui64);
+    }
+
+    auto &node = it->second;
+
+    if(node.state != State::Pending) {
+        node.rejoining = (node.state == State::Associated);
+        node.state = State::Pending;
+        this->numPending++;
+    }
+    node.sleepy = (req->capabilities & NetControl::AssociationCapabilities::Sleepy);
+    node.realTime = (req->capabilities & NetControl::AssociationCapabilities::RealTime);
+    node.joinedAt = now;
+
+    // a node that rejoins has restarted, so it may secure frames with a new epoch
+    this->handler.security->allowNewEpoch(node.address);
+
+    this->counters.accepted++;
+
+    PLOG_INFO << fmt::format("association request from {:016x} (via ${:04x}): address ${:04x}",
+            eui64, source, node.address);
+    this->sendResponse(eui64, NetControl::AssociationStatus::Success, node.address);
+}
+
+/**
+ * @brief Take a token from the join token bucket
+ *
+ * @return Whether a token was available
+ */
+bool Association::admit(const std::chrono::steady_clock::time_point now) {
+    const std::chrono::duration<double> elapsed = now - this->lastRefill;
+    this->lastRefill = now;
+
+    this->joinTokens = std::min(this->joinBurst,
+            this->joinTokens + (elapsed.count() * this->joinRate));
+
+    if(this->joinTokens < 1.) {
+        return false;
+    }
+
+    this->joinTokens -= 1.;
+    return true;
+}
+
+/**
+ * @brief Complete a pending association
+ *
+ * @param source Short address a frame was received from
+ */
+void Association::confirm(const uint16_t source) {
+    auto addr = this->addressMap.find(source);
+    if(addr == this->addressMap.end()) {
+        return;
+    }
+
+    auto &node = this->nodes.at(addr->second);
+    if(node.state != State::Pending) {
+        return;
+    }
+
+    node.state = State::Associated;
+    this->numPending--;
+
+    // the frame that confirmed the association was authentic, so it can settle the epoch
+    this->handler.security->confirmEpoch(node.address);
+
+    this->handler.indirect->setSleepy(node.address, node.sleepy);
+    this->handler.superframe->setRealTime(node.address, node.realTime);
+
+    PLOG_INFO << fmt::format("node {:016x} associated (address ${:04x})", node.eui64,
+            node.address);
+
+    for(const auto &handler : this->joinHandlers) {
+        handler(node.eui64, node.address);
+    }
+}
+
+/**
+ * @brief Remove a node from the network
+ *
+ * Its address is freed, and any state associated with it discarded; frames that are still held
+ * for it, or waiting to be acknowledged by it, fail.
+ *
+ * @param address Short address of the node
+ */
+void Association::disassociate(const uint16_t address) {
+    auto addr = this->addressMap.find(address);
+    if(addr == this->addressMap.end()) {
+        return;
+    }
+
+    auto it = this->nodes.find(addr->second);
+    if(it->second.state == State::Pending) {
+        this->numPending--;
+    }
+
+    this->nodes.erase(it);
+    this->addressMap.erase(addr);
+    this->addresses.release(address);
+
+    // fail frames still waiting for the node, so they can't reach the address' next owner
+    this->handler.indirect->remove(address);
+    this->handler.retransmitter->cancel(address);
+
+    this->handler.security->removePeer(address);
+    this->handler.linkQuality->remove(address);
+    this->handler.powerControl->remove(address);
+    this->handler.superframe->remove(address);
+    this->handler.groups->removeNode(address);
+    this->handler.ota->remove(address);
+}
+
+/**
+ * @brief Find the next node, in order of short address
+ *
+ * This can be used to walk the node table a piece at a time: since the position is just an
+ * address, it stays valid even if nodes join or leave in between (nodes that join or leave
+ * during the walk may or may not be returned.)
+ *
+ * @param cursor Address to start searching at (start at 0); it's updated to the address
+ *        following the returned node
+ *
+ * @return The node with the lowest short address at or above the cursor, or `nullptr` if there
+ *         are no more nodes
+ */
+const Association::Node *Association::findNode(uint32_t &cursor) const {
+    while(auto address = this->addresses.findAllocated(cursor)) {
+        cursor = *address + 1;
+
+        // skip addresses that are reserved, rather than assigned to a node
+        if(auto addr = this->addressMap.find(*address); addr != this->addressMap.end()) {
+            return &this->nodes.at(addr->second);
+        }
+    }
+
+    cursor = 0x10000;
+    return nullptr;
+}
+
+
+
+/**
+ * @brief Send an association response
+ *
+ * The response is sent in the clear to the broadcast address, since the node doesn't have an
+ * address (or possibly keys) yet.
+ *
+ * @param eui64 EUI-64 of the node
+ * @param status Result of the association
+ * @param address Short address assigned to the node
+ */
+void Association::sendResponse(const uint64_t eui64, const NetControl::AssociationStatus status,
+        const uint16_t address) {
+    using namespace BlazeNet::Types;
+
+    this->txBuffer.assign(Handler::kFrameHeaderSize + sizeof(NetControl::Header)
+            + sizeof(NetControl::AssociationResponse), std::byte(0));
+
+    auto phyHdr = reinterpret_cast<Phy::Header *>(this->txBuffer.data());
+    phyHdr->length = this->txBuffer.size() - 1;
+
+    auto macHdr = reinterpret_cast<Mac::Header *>(phyHdr->payload);
+    macHdr->flags = Mac::HeaderFlags::EndpointNetControl;
+    macHdr->sequence = this->handler.nextSequence++;
+    macHdr->source = this->handler.radio->getAddress();
+    macHdr->destination = Mac::kBroadcastAddress;
+
+    auto ncHdr = reinterpret_cast<NetControl::Header *>(this->txBuffer.data()
+            + Handler::kFrameHeaderSize);
+    ncHdr->type = static_cast<uint8_t>(NetControl::MessageType::AssociationResponse);
+
+    auto resp = reinterpret_cast<NetControl::AssociationResponse *>(ncHdr->payload);
+    memcpy(resp->eui64, &eui64, sizeof(resp->eui64));
+    resp->status = static_cast<uint8_t>(status);
+    resp->address = address;
+
+    this->handler.radio->queueTransmitPacket(Radio::PacketPriority::Background, this->txBuffer);
+}
+
+/**
+ * @brief Expire pending associations and stale attempt records
+ */
+void Association::tick() {
+    const auto now = std::chrono::steady_clock::now();
+
+    // forget about join attempts older than the retry interval
+    std::erase_if(this->lastAttempt, [&](const auto &item) {
+        return (now - item.second) >= this->retryInterval;
+    });
+
+    // discard pending associations the node never confirmed
+    if(!this->numPending) {
+        return;
+    }
+
+    std::vector<uint16_t> expired;
+    for(auto &[eui64, node] : this->nodes) {
+        if(node.state != State::Pending || (now - node.joinedAt) < this->timeout) {
+            continue;
+        }
+
+        /*
+         * Rejoin requests aren't authenticated, so one that's never confirmed may not have come
+         * from the node at all: it keeps its association (and epoch) rather than being removed.
+         */
+        if(node.rejoining) {
+            node.state = State::Associated;
+            this->numPending--;
+            this->counters.timeouts++;
+
+            this->handler.security->confirmEpoch(node.address);
+            continue;
+        }
+
+        expired.push_back(node.address);
+    }
+
+    for(const auto address : expired) {
+        PLOG_VERBOSE << fmt::format("association for ${:04x} timed out", address);
+
+        this->counters.timeouts++;
+        this->disassociate(address);
+    }
+}
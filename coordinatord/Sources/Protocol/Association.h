@@ -0,0 +1,258 @@
+#ifndef PROTOCOL_ASSOCIATION_H
+#define PROTOCOL_ASSOCIATION_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "AddressAllocator.h"
+#include "NetControl.h"
+
+namespace TristLib::Event {
+class Timer;
+}
+
+namespace Protocol {
+class Handler;
+
+/**
+ * @brief Node association manager
+ *
+ * Handles association requests from nodes wishing to join the network, and assigns them short
+ * addresses. A node's association goes through two states:
+ *
+ * - Pending: The request was accepted and a response sent, but we haven't heard from the node
+ *   under its new address yet. If that doesn't happen within a timeout, the association is
+ *   discarded and the address freed; a node that was already associated when it sent the request
+ *   instead goes back to being associated.
+ * - Associated: The node has sent a frame from its assigned address.
+ *
+ * Join requests are subject to admission control, so that a flood of requests (for example, all
+ * nodes rejoining at once after a power outage) can't starve regular traffic: each EUI-64 may only
+ * attempt to join once per retry interval, the total rate of accepted requests is limited by a
+ * token bucket, and only a limited number of associations may be pending at once. Requests that
+ * exceed these limits are dropped without a response, before doing any other work. Responses are
+ * sent at background priority.
+ *
+ * Nodes already known (by EUI-64) may always rejoin, and get their previous address back; new
+ * nodes may only join while pairing is enabled.
+ */
+class Association {
+    private:
+        /// Config key for whether new nodes may join
+        constexpr static const std::string_view kConfPairing{"protocol.association.pairing"};
+        /// Config key for the maximum number of pending associations
+        constexpr static const std::string_view kConfMaxPending{
+            "protocol.association.maxPending"};
+        /// Config key for the rate of accepted join requests (per second)
+        constexpr static const std::string_view kConfJoinRate{"protocol.association.joinRate"};
+        /// Config key for the maximum burst of accepted join requests
+        constexpr static const std::string_view kConfJoinBurst{"protocol.association.joinBurst"};
+        /// Config key for the minimum time between join attempts of a node (msec)
+        constexpr static const std::string_view kConfRetryInterval{
+            "protocol.association.retryInterval"};
+        /// Config key for the time a pending association waits for the node (msec)
+        constexpr static const std::string_view kConfTimeout{"protocol.association.timeout"};
+
+        /// Default maximum number of pending associations
+        constexpr static const size_t kDefaultMaxPending{8};
+        /// Default rate of accepted join requests (per second)
+        constexpr static const double kDefaultJoinRate{5.};
+        /// Default maximum burst of accepted join requests
+        constexpr static const double kDefaultJoinBurst{10.};
+        /// Default minimum time between join attempts of a node
+        constexpr static const std::chrono::milliseconds kDefaultRetryInterval{5'000};
+        /// Default time a pending association waits for the node
+        constexpr static const std::chrono::milliseconds kDefaultTimeout{10'000};
+
+        /// Maximum number of nodes whose join attempts are tracked for rate limiting
+        constexpr static const size_t kMaxTrackedAttempts{1024};
+        /// Interval at which pending associations and attempt records are expired
+        constexpr static const std::chrono::milliseconds kTickInterval{1'000};
+
+    public:
+        /**
+         * @brief Association performance counters
+         */
+        struct Counters {
+            /// Association requests received
+            uint_least64_t requests{0};
+            /// Requests that were accepted
+            uint_least64_t accepted{0};
+            /// Requests that were refused (with a response)
+            uint_least64_t refused{0};
+            /// Requests dropped because the node retried too quickly
+            uint_least64_t rateLimited{0};
+            /// Requests dropped due to admission limits
+            uint_least64_t throttled{0};
+            /// Pending associations that timed out
+            uint_least64_t timeouts{0};
+            /// Malformed requests
+            uint_least64_t invalid{0};
+        };
+
+        /**
+         * @brief Join callback
+         *
+         * Invoked whenever a node completes its association (including when it rejoins.)
+         *
+         * @param eui64 EUI-64 of the node
+         * @param address Short address assigned to the node
+         */
+        using JoinHandler = std::function<void(const uint64_t eui64, const uint16_t address)>;
+
+        /**
+         * @brief Association state of a node
+         */
+        enum class State: uint8_t {
+            Pending,
+            Associated,
+        };
+
+        /**
+         * @brief Information about a node
+         */
+        struct Node {
+            /// EUI-64 of the node
+            uint64_t eui64;
+            /// Short address assigned to the node
+            uint16_t address;
+            /// Current state
+            State state;
+            /// Whether the node is a sleepy node
+            bool sleepy{false};
+            /// Whether the node wants a guaranteed time slot
+            bool realTime{false};
+            /// Whether the node was associated before its pending (re)join
+            bool rejoining{false};
+
+            /// Time at which the node last (re)joined
+            std::chrono::steady_clock::time_point joinedAt;
+        };
+
+    public:
+        Association(Handler &handler);
+        ~Association();
+
+        void reloadConfig();
+
+        /**
+         * @brief Determine whether new nodes may join the network
+         */
+        constexpr inline bool isPairingEnabled() const {
+            return this->pairingEnabled;
+        }
+
+        void handleRequest(const uint16_t source, std::span<const std::byte> payload);
+
+        /**
+         * @brief Note that a frame was received from a node
+         *
+         * This completes any pending association for the node.
+         *
+         * @param source Short address of the node
+         */
+        inline void handleFrame(const uint16_t source) {
+            if(this->numPending) {
+                this->confirm(source);
+            }
+        }
+
+        void disassociate(const uint16_t address);
+
+        /**
+         * @brief Register a join handler
+         *
+         * @param handler Function to invoke for each node that joins
+         */
+        inline void addJoinHandler(const JoinHandler &handler) {
+            this->joinHandlers.emplace_back(handler);
+        }
+
+        /**
+         * @brief Determine whether a short address is assigned to a node
+         */
+        inline bool isAssociated(const uint16_t address) const {
+            return this->addressMap.contains(address);
+        }
+
+        const Node *findNode(uint32_t &cursor) const;
+
+        /**
+         * @brief Get the number of nodes that are associated (or pending)
+         */
+        inline size_t getNumNodes() const {
+            return this->nodes.size();
+        }
+        /**
+         * @brief Get the performance counters
+         */
+        inline const auto &getCounters() const {
+            return this->counters;
+        }
+
+    private:
+        bool admit(const std::chrono::steady_clock::time_point now);
+        void confirm(const uint16_t source);
+        void sendResponse(const uint64_t eui64, const NetControl::AssociationStatus status,
+                const uint16_t address);
+
+        void tick();
+
+    private:
+        /// Handle to the protocol handler that owns us
+        Handler &handler;
+
+        /// Whether new nodes may join
+        bool pairingEnabled{false};
+        /// Maximum number of pending associations
+        size_t maxPending{kDefaultMaxPending};
+        /// Token bucket refill rate (accepted requests per second)
+        double joinRate{kDefaultJoinRate};
+        /// Token bucket size
+        double joinBurst{kDefaultJoinBurst};
+        /// Minimum time between join attempts of a node
+        std::chrono::milliseconds retryInterval{kDefaultRetryInterval};
+        /// Time a pending association waits for the node
+        std::chrono::milliseconds timeout{kDefaultTimeout};
+
+        /// Short address allocator
+        AddressAllocator addresses;
+
+        /// All known nodes, keyed by EUI-64
+        std::unordered_map<uint64_t, Node> nodes;
+        /// Map of short address to EUI-64
+        std::unordered_map<uint16_t, uint64_t> addressMap;
+        /// Number of nodes in the pending state
+        size_t numPending{0};
+
+        /// Time of the most recent join attempt, by EUI-64
+        std::unordered_map<uint64_t, std::chrono::steady_clock::time_point> lastAttempt;
+
+        /// Tokens available in the join token bucket
+        double joinTokens{kDefaultJoinBurst};
+        /// Time at which the token bucket was last refilled
+        std::chrono::steady_clock::time_point lastRefill{};
+
+        /// Buffer used to assemble response frames
+        std::vector<std::byte> txBuffer;
+
+        /// Event loop timer to expire pending associations
+        std::shared_ptr<TristLib::Event::Timer> tickTimer;
+
+        /// Handlers for nodes that joined
+        std::vector<JoinHandler> joinHandlers;
+
+        /// Performance counters
+        Counters counters{};
+};
+}
+
+#endif
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cmath>
 #include <sstream>
 #include <stdexcept>
@@ -13,10 +14,18 @@
 #include "Support/Confd.h"
 #include "Radio.h"
 #include "Handler.h"
+#include "Association.h"
+#include "NetControl.h"
 #include "Beaconator.h"
 
 using namespace Protocol;
 
+/// Size of the fixed headers at the start of the beacon frame
+constexpr static const size_t kBeaconHeaderBytes{
+    sizeof(BlazeNet::Types::Phy::Header) + sizeof(BlazeNet::Types::Mac::Header)
+        + sizeof(BlazeNet::Types::Beacon::Header)
+};
+
 /**
  * @brief Initialize the beacon manager
  *
@@ -28,7 +37,7 @@ Beaconator::Beaconator(Handler &handler) : handler(handler) {
     this->reloadConfig(false);
 
     this->updateBeaconBuffer();
-    this->uploadBeaconFrame(true);
+    this->uploadBeaconFrame();
 }
 
 /**
@@ -57,21 +66,92 @@ void Beaconator::reloadConfig(const bool upload) {
                     beaconInterval, kMinBeaconInterval));
     }
 
-    this->interval = std::chrono::milliseconds(
+    const auto newInterval = std::chrono::milliseconds(
             static_cast<size_t>(std::ceil(beaconInterval / 10.) * 10));
+    if(newInterval != this->interval) {
+        this->interval = newInterval;
+        this->dirty |= DirtyFlags::Config;
+    }
     PLOG_DEBUG << "Beacon interval: " << this->interval.count() << " ms";
 
     // read the network UUID
-    const auto idBytesRead = Support::Confd::GetBlob(kConfBeaconId, this->networkId);
-    if(idBytesRead != this->networkId.size()) {
+    std::array<std::byte, 16> newId{};
+    const auto idBytesRead = Support::Confd::GetBlob(kConfBeaconId, newId);
+    if(idBytesRead != newId.size()) {
         throw std::runtime_error(fmt::format("failed to read network id (`{}`): got {} bytes",
                     kConfBeaconId, idBytesRead));
     }
 
+    if(newId != this->networkId) {
+        this->networkId = newId;
+        this->dirty |= DirtyFlags::Header;
+    }
+
     // upload config to radio if needed
     if(upload) {
-        this->uploadBeaconFrame(true);
+        this->updateBeaconBuffer();
+        this->uploadBeaconFrame();
+    }
+}
+
+
+
+/**
+ * @brief Update the pending traffic map
+ *
+ * Set the list of sleeping nodes that have frames waiting. The beacon is regenerated and uploaded
+ * only if the advertised list actually changed.
+ *
+ * @param addresses Sorted list of node addresses with pending traffic
+ */
+void Beaconator::setPendingTraffic(std::span<const uint16_t> addresses) {
+    const auto advertised = addresses.subspan(0, std::min(addresses.size(),
+                kMaxPendingAddresses));
+
+    if(std::equal(advertised.begin(), advertised.end(), this->pendingTraffic.begin(),
+                this->pendingTraffic.end())) {
+        return;
+    }
+
+    this->pendingTraffic.assign(advertised.begin(), advertised.end());
+    this->dirty |= DirtyFlags::PendingTraffic;
+
+    this->updateBeaconBuffer();
+    this->uploadBeaconFrame();
+}
+
+/**
+ * @brief Update the channel switch announcement
+ *
+ * @param announcement Channel switch to announce, or an empty value to stop announcing
+ */
+void Beaconator::setChannelSwitch(const std::optional<NetControl::ChannelSwitch> &announcement) {
+    this->channelSwitch = announcement;
+    this->dirty |= DirtyFlags::ChannelSwitch;
+
+    this->updateBeaconBuffer();
+    this->uploadBeaconFrame();
+}
+
+
+
+/**
+ * @brief Update the superframe structure
+ *
+ * @param structure Superframe structure (a NetControl::Superframe, followed by the slot owners) or
+ *        an empty buffer if superframe mode is disabled
+ */
+void Beaconator::setSuperframe(std::span<const std::byte> structure) {
+    if(std::equal(structure.begin(), structure.end(), this->superframe.begin(),
+                this->superframe.end())) {
+        return;
     }
+
+    this->superframe.assign(structure.begin(), structure.end());
+    this->dirty |= DirtyFlags::Superframe;
+
+    this->updateBeaconBuffer();
+    this->uploadBeaconFrame();
 }
 
 
@@ -79,19 +159,39 @@ void Beaconator::reloadConfig(const bool upload) {
 /**
  * @brief Generate the beacon frame
  *
- * Regenerate the beacon frame buffer.
+ * Rebuild the parts of the beacon frame buffer that changed since it was last generated.
  */
 void Beaconator::updateBeaconBuffer() {
-    using namespace std::chrono_literals;
-    auto &radio = this->handler.radio;
+    if(this->buffer.size() < kBeaconHeaderBytes) {
+        this->buffer.resize(kBeaconHeaderBytes);
+        this->dirty |= DirtyFlags::Header | DirtyFlags::Extensions;
+    }
+
+    if(this->dirty & DirtyFlags::Header) {
+        this->buildHeaders();
+    }
+    if(this->dirty & DirtyFlags::Extensions) {
+        this->buildExtensions();
+    }
+
+    this->dirty &= ~(DirtyFlags::Header | DirtyFlags::Extensions);
+
+    // fill in PHY header with the final length
+    if(this->buffer.size() > 0xff) {
+        throw std::runtime_error(fmt::format("beacon too large: {}", this->buffer.size()));
+    }
+    this->buffer[0] = std::byte(this->buffer.size() - 1);
+}
 
-    // figure out how big we need for the basic MAC and beacon header
-    constexpr static const size_t kPayloadBaseBytes{
-        sizeof(BlazeNet::Types::Mac::Header) + sizeof(BlazeNet::Types::Beacon::Header)
-    };
+/**
+ * @brief Build the fixed beacon headers
+ *
+ * Fill in the MAC and beacon headers at the start of the frame buffer.
+ */
+void Beaconator::buildHeaders() {
+    auto &radio = this->handler.radio;
 
-    this->buffer.resize(sizeof(BlazeNet::Types::Phy::Header) + kPayloadBaseBytes);
-    std::fill(this->buffer.begin(), this->buffer.end(), std::byte(0));
+    std::fill(this->buffer.begin(), this->buffer.begin() + kBeaconHeaderBytes, std::byte(0));
 
     // prepare PHY header
     auto phyHdr = reinterpret_cast<BlazeNet::Types::Phy::Header *>(this->buffer.data());
@@ -109,42 +209,112 @@ void Beaconator::updateBeaconBuffer() {
             + sizeof(*macHdr));
     beaconHdr->version = BlazeNet::Types::kProtocolVersion;
 
-    if(this->inBandPairingEnabled) {
+    if(this->handler.association->isPairingEnabled()) {
         beaconHdr->flags |= BlazeNet::Types::Beacon::HeaderFlags::PairingEnable;
     }
 
     memcpy(beaconHdr->id, this->networkId.data(), sizeof(beaconHdr->id));
+}
 
-    // TODO: bonus beacon headers (pending traffic map, etc.)
+/**
+ * @brief Build the beacon extensions
+ *
+ * Replace all extensions following the fixed headers.
+ */
+void Beaconator::buildExtensions() {
+    this->buffer.resize(kBeaconHeaderBytes);
 
-    // fill in PHY header with the final length
-    if(this->buffer.size() > 0xff) {
-        throw std::runtime_error(fmt::format("beacon too large: {}", this->buffer.size()));
+    // pending traffic map
+    if(!this->pendingTraffic.empty()) {
+        const auto extLength = this->pendingTraffic.size() * sizeof(uint16_t);
+        const auto offset = this->buffer.size();
+        this->buffer.resize(offset + sizeof(NetControl::BeaconExtension) + extLength);
+
+        auto ext = reinterpret_cast<NetControl::BeaconExtension *>(this->buffer.data() + offset);
+        ext->type = static_cast<uint8_t>(NetControl::BeaconExtensionType::PendingTraffic);
+        ext->length = extLength;
+        memcpy(ext->payload, this->pendingTraffic.data(), extLength);
     }
-    this->buffer[0] = std::byte(this->buffer.size() - 1);
 
-    // secrete the final frame (for debugging)
-    if(kLogBeaconFrame) {
-        std::stringstream str;
-        TristLib::Core::HexDump::DumpBuffer<std::stringstream, std::byte>(str, this->buffer);
-        PLOG_DEBUG << "Beacon frame:" << std::endl << str.str();
+    // channel switch announcement
+    if(this->channelSwitch) {
+        const auto offset = this->buffer.size();
+        this->buffer.resize(offset + sizeof(NetControl::BeaconExtension)
+                + sizeof(NetControl::ChannelSwitch));
+
+        auto ext = reinterpret_cast<NetControl::BeaconExtension *>(this->buffer.data() + offset);
+        ext->type = static_cast<uint8_t>(NetControl::BeaconExtensionType::ChannelSwitch);
+        ext->length = sizeof(NetControl::ChannelSwitch);
+        memcpy(ext->payload, &*this->channelSwitch, sizeof(NetControl::ChannelSwitch));
+    }
+
+    // superframe structure
+    if(!this->superframe.empty()) {
+        const auto offset = this->buffer.size();
+        this->buffer.resize(offset + sizeof(NetControl::BeaconExtension)
+                + this->superframe.size());
+
+        auto ext = reinterpret_cast<NetControl::BeaconExtension *>(this->buffer.data() + offset);
+        ext->type = static_cast<uint8_t>(NetControl::BeaconExtensionType::Superframe);
+        ext->length = this->superframe.size();
+        memcpy(ext->payload, this->superframe.data(), this->superframe.size());
     }
 }
 
+
+
 /**
  * @brief Upload beacon configuration to radio
  *
- * Send the beacon frame and current interval to the radio.
- *
- * @param frameChanged When set, the content of the beacon frame has changed and needs to be
- *        uploaded again
+ * Send the beacon configuration to the radio if it changed; otherwise, send only the frame if its
+ * contents differ from what was last uploaded. Nothing is sent if neither changed.
  */
-void Beaconator::uploadBeaconFrame(const bool frameChanged) {
+void Beaconator::uploadBeaconFrame() {
     auto &radio = this->handler.radio;
 
-    if(frameChanged) {
-        radio->setBeaconConfig(true, this->interval, this->buffer);
+    const bool frameChanged = (this->buffer != this->uploaded);
+
+    if(this->dirty & DirtyFlags::Config) {
+        if(frameChanged) {
+            radio->setBeaconConfig(true, this->interval, this->buffer);
+        } else {
+            radio->setBeaconConfig(true, this->interval);
+        }
+
+        this->dirty &= ~DirtyFlags::Config;
+    } else if(frameChanged) {
+        radio->setBeaconConfig(this->buffer);
     } else {
-        radio->setBeaconConfig(true, this->interval);
+        return;
+    }
+
+    if(frameChanged) {
+        this->uploaded = this->buffer;
+        this->logBeaconFrame();
     }
 }
+
+/**
+ * @brief Log the beacon frame
+ *
+ * Frames are dumped at most once per logging interval; updates in between are only counted.
+ */
+void Beaconator::logBeaconFrame() {
+    if(!kLogBeaconFrame) {
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if(now - this->lastLogged < kLogBeaconInterval) {
+        this->numUnlogged++;
+        return;
+    }
+
+    std::stringstream str;
+    TristLib::Core::HexDump::DumpBuffer<std::stringstream, std::byte>(str, this->buffer);
+    PLOG_DEBUG << "Beacon frame (" << this->numUnlogged << " updates not logged):" << std::endl
+        << str.str();
+
+    this->lastLogged = now;
+    this->numUnlogged = 0;
+}
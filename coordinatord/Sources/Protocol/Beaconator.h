@@ -4,10 +4,15 @@
 #include <array>
 #include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <optional>
+#include <span>
 #include <string_view>
 #include <vector>
 
+#include "NetControl.h"
+
 namespace Protocol {
 class Handler;
 
@@ -16,6 +21,10 @@ class Handler;
  *
  * This dude handles the beaconing configuration of an attached radio, including uploading a new
  * kind of beacon frame and formatting it based on the configuration.
+ *
+ * The beacon frame is kept resident, and only the parts that changed are rebuilt. Likewise, the
+ * radio is only sent what it needs: the full configuration if the interval changed, just the
+ * frame if its contents changed, or nothing at all if the frame is identical to the last one.
  */
 class Beaconator {
     private:
@@ -29,8 +38,38 @@ class Beaconator {
          */
         constexpr static const size_t kMinBeaconInterval{1'000};
 
+        /**
+         * @brief Maximum number of addresses in the pending traffic map
+         *
+         * Nodes beyond this limit aren't advertised, and will only see their traffic once they
+         * poll on their own, or the map shrinks.
+         */
+        constexpr static const size_t kMaxPendingAddresses{32};
+
         /// Whether beacon frame updates are logged
         constexpr static const bool kLogBeaconFrame{true};
+        /// Minimum time between logged beacon frames
+        constexpr static const std::chrono::seconds kLogBeaconInterval{10};
+
+        /**
+         * @brief Parts of the beacon that need to be rebuilt or uploaded
+         */
+        enum DirtyFlags: uint8_t {
+            /// Beacon configuration (interval, enabled state) needs to be uploaded
+            Config                              = (1 << 0),
+            /// MAC and beacon headers need to be rebuilt
+            Header                              = (1 << 1),
+            /// Pending traffic extension needs to be rebuilt
+            PendingTraffic                      = (1 << 2),
+            /// Channel switch extension needs to be rebuilt
+            ChannelSwitch                       = (1 << 3),
+            /// Superframe structure extension needs to be rebuilt
+            Superframe                          = (1 << 4),
+
+            /// Any of the extensions need to be rebuilt
+            Extensions                          = (PendingTraffic | ChannelSwitch | Superframe),
+            All                                 = (Config | Header | Extensions),
+        };
 
     public:
         Beaconator(Handler &handler);
@@ -38,9 +77,24 @@ class Beaconator {
 
         void reloadConfig(const bool upload);
 
+        void setPendingTraffic(std::span<const uint16_t> addresses);
+        void setChannelSwitch(const std::optional<NetControl::ChannelSwitch> &announcement);
+        void setSuperframe(std::span<const std::byte> structure);
+
+        /**
+         * @brief Get the beacon interval
+         */
+        constexpr inline auto getInterval() const {
+            return this->interval;
+        }
+
     private:
         void updateBeaconBuffer();
-        void uploadBeaconFrame(const bool frameChanged);
+        void buildHeaders();
+        void buildExtensions();
+
+        void uploadBeaconFrame();
+        void logBeaconFrame();
 
     private:
         /// Handle to the protocol handler that owns us
@@ -51,11 +105,25 @@ class Beaconator {
         /// Network identifier
         std::array<std::byte, 16> networkId{};
 
+        /// Parts of the beacon that changed (see DirtyFlags)
+        uint8_t dirty{DirtyFlags::All};
+
         /// Buffer for beacon frames
         std::vector<std::byte> buffer;
+        /// Beacon frame most recently uploaded to the radio
+        std::vector<std::byte> uploaded;
+
+        /// Addresses of sleeping nodes with pending traffic (sorted)
+        std::vector<uint16_t> pendingTraffic;
+        /// Channel switch announcement, if any
+        std::optional<NetControl::ChannelSwitch> channelSwitch;
+        /// Superframe structure (extension payload); empty if superframe mode is disabled
+        std::vector<std::byte> superframe;
 
-        /// Is pairing of new devices over-the-air enabled? (TODO: read from Handler)
-        bool inBandPairingEnabled{false};
+        /// Time at which a beacon frame was last logged
+        std::chrono::steady_clock::time_point lastLogged{};
+        /// Number of beacon frame updates not logged since then
+        size_t numUnlogged{0};
 };
 }
 
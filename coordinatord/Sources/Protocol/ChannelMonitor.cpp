@@ -0,0 +1,339 @@
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include <TristLib/Core.h>
+#include <TristLib/Event.h>
+
+#include "Config/Reader.h"
+#include "Radio.h"
+#include "Handler.h"
+#include "Beaconator.h"
+#include "NetControl.h"
+#include "ChannelMonitor.h"
+
+using namespace Protocol;
+
+/**
+ * @brief Initialize the channel monitor
+ *
+ * Read the configuration, take a baseline of the radio counters, and start sampling. Beacons sent
+ * by the radio advance channel migrations.
+ *
+ * @param handler Protocol handler that instantiated us
+ */
+ChannelMonitor::ChannelMonitor(Handler &handler) : handler(handler) {
+    this->reloadConfig();
+
+    const auto &tx = this->handler.radio->getTxCounters();
+    const auto &rx = this->handler.radio->getRxCounters();
+    this->lastCcaFails = tx.ccaFails;
+    this->lastTxGood = tx.goodFrames;
+    this->lastFrameErrors = rx.frameErrors;
+    this->lastRxGood = rx.goodFrames;
+
+    this->sampleTimer = std::make_shared<TristLib::Event::Timer>(
+            TristLib::Event::RunLoop::Current(), this->interval, [this](auto timer) {
+        this->sample();
+    }, true);
+
+    this->handler.radio->addBeaconHandler([this](auto when) {
+        this->beaconSent(when);
+    });
+}
+
+/**
+ * @brief Clean up the channel monitor
+ *
+ * Any migration in progress is abandoned.
+ */
+ChannelMonitor::~ChannelMonitor() {
+    this->sampleTimer.reset();
+    this->migrationTimer.reset();
+}
+
+
+
+/**
+ * @brief Read the channel monitor configuration
+ *
+ * All keys are optional, and live in the `protocol.channel` table of the config file:
+ *
+ * - interval: How often the radio counters are sampled (msec)
+ * - ccaThreshold: CCA failure rate (of all transmit attempts) considered congested
+ * - ferThreshold: Frame error rate (of all received frames) considered noisy
+ * - holdIntervals: Number of consecutive intervals a threshold must be exceeded to migrate
+ * - cooldown: Minimum time between migrations (msec)
+ * - candidates: Array of channels the network may migrate between; they must all be permitted in
+ *   the configured region. If not specified, the channel quality is monitored, but the channel is
+ *   never changed.
+ *
+ * A change to the sampling interval takes effect when the daemon is restarted.
+ */
+void ChannelMonitor::reloadConfig() {
+    const auto &root = Config::GetConfig();
+
+    auto interval = root.at_path(kConfInterval);
+    if(interval && interval.is_integer()) {
+        this->interval = std::chrono::milliseconds(interval.value_or(kDefaultInterval.count()));
+    }
+    if(this->interval.count() <= 0) {
+        throw std::runtime_error(fmt::format("invalid `{}`: must be positive", kConfInterval));
+    }
+
+    auto cca = root.at_path(kConfCcaThreshold);
+    if(cca && cca.is_number()) {
+        this->ccaThreshold = cca.value_or(kDefaultCcaThreshold);
+    }
+    auto fer = root.at_path(kConfFerThreshold);
+    if(fer && fer.is_number()) {
+        this->ferThreshold = fer.value_or(kDefaultFerThreshold);
+    }
+    if(this->ccaThreshold <= 0.f || this->ccaThreshold > 1.f) {
+        throw std::runtime_error(fmt::format("invalid `{}`: must be in (0, 1]", kConfCcaThreshold));
+    } else if(this->ferThreshold <= 0.f || this->ferThreshold > 1.f) {
+        throw std::runtime_error(fmt::format("invalid `{}`: must be in (0, 1]", kConfFerThreshold));
+    }
+
+    auto hold = root.at_path(kConfHoldIntervals);
+    if(hold && hold.is_integer()) {
+        this->holdIntervals = std::max<int64_t>(1, hold.value_or(kDefaultHoldIntervals));
+    }
+    auto cooldown = root.at_path(kConfCooldown);
+    if(cooldown && cooldown.is_integer()) {
+        this->cooldown = std::chrono::milliseconds(
+                std::max<int64_t>(0, cooldown.value_or(kDefaultCooldown.count())));
+    }
+
+    const auto &region = Config::GetRegion();
+
+    this->candidates.clear();
+    if(auto list = root.at_path(kConfCandidates); list && list.is_array()) {
+        for(const auto &item : *list.as_array()) {
+            const auto channel = item.value<int64_t>();
+            if(!channel || *channel < 0 || *channel > std::numeric_limits<uint16_t>::max()) {
+                throw std::runtime_error(fmt::format("invalid `{}`: expected channel numbers",
+                            kConfCandidates));
+            } else if(!region.channels.contains(*channel)) {
+                throw std::runtime_error(fmt::format("invalid `{}`: channel {} is not permitted "
+                            "in region {}", kConfCandidates, *channel, region.name));
+            }
+            this->candidates.push_back(*channel);
+        }
+    }
+
+    PLOG_DEBUG << fmt::format("channel monitor: CCA {}, FER {}, hold {}; candidates {}",
+            this->ccaThreshold, this->ferThreshold, this->holdIntervals,
+            fmt::join(this->candidates, ", "));
+}
+
+
+
+/**
+ * @brief Sample the radio counters
+ *
+ * Calculate the failure rates over the last interval and fold them into the moving averages. If
+ * too few frames were sent or received in the interval, its rate is ignored; a handful of frames
+ * isn't enough to judge the channel by.
+ */
+void ChannelMonitor::sample() {
+    const auto &tx = this->handler.radio->getTxCounters();
+    const auto &rx = this->handler.radio->getRxCounters();
+
+    const auto ccaFails = tx.ccaFails - this->lastCcaFails,
+          txGood = tx.goodFrames - this->lastTxGood;
+    const auto frameErrors = rx.frameErrors - this->lastFrameErrors,
+          rxGood = rx.goodFrames - this->lastRxGood;
+
+    this->lastCcaFails = tx.ccaFails;
+    this->lastTxGood = tx.goodFrames;
+    this->lastFrameErrors = rx.frameErrors;
+    this->lastRxGood = rx.goodFrames;
+
+    if(const auto attempts = ccaFails + txGood; attempts >= kMinFrames) {
+        const auto rate = static_cast<float>(ccaFails) / attempts;
+        this->counters.ccaRate += kAlpha * (rate - this->counters.ccaRate);
+    }
+    if(const auto frames = frameErrors + rxGood; frames >= kMinFrames) {
+        const auto rate = static_cast<float>(frameErrors) / frames;
+        this->counters.ferRate += kAlpha * (rate - this->counters.ferRate);
+    }
+
+    const auto channel = this->handler.radio->getChannel();
+    this->channelScores[channel] = std::max(this->counters.ccaRate, this->counters.ferRate);
+
+    // is the channel bad (for long enough) to warrant moving?
+    if(this->counters.ccaRate < this->ccaThreshold && this->counters.ferRate < this->ferThreshold) {
+        this->overThreshold = 0;
+        return;
+    } else if(++this->overThreshold < this->holdIntervals) {
+        return;
+    }
+
+    if(this->isMigrating() || this->candidates.empty()) {
+        return;
+    } else if(this->counters.migrations &&
+            (std::chrono::steady_clock::now() - this->lastMigration) < this->cooldown) {
+        return;
+    }
+
+    // pick the candidate channel with the best score (those never visited are assumed clean)
+    std::optional<uint16_t> best;
+    float bestScore{std::numeric_limits<float>::max()};
+
+    for(const auto candidate : this->candidates) {
+        if(candidate == channel) {
+            continue;
+        }
+
+        auto it = this->channelScores.find(candidate);
+        const auto score = (it != this->channelScores.end()) ? it->second : 0.f;
+        if(score < bestScore) {
+            best = candidate;
+            bestScore = score;
+        }
+    }
+
+    if(!best || bestScore >= this->channelScores[channel]) {
+        PLOG_WARNING << fmt::format("channel {} degraded (CCA {:.2f}, FER {:.2f}), but no better "
+                "channel available", channel, this->counters.ccaRate, this->counters.ferRate);
+        this->overThreshold = 0;
+        return;
+    }
+
+    PLOG_INFO << fmt::format("channel {} degraded (CCA {:.2f}, FER {:.2f}): migrating to {}",
+            channel, this->counters.ccaRate, this->counters.ferRate, *best);
+    this->beginMigration(*best);
+}
+
+/**
+ * @brief Start migrating the network to a new channel
+ *
+ * The switch is announced in the beacon, and the radio changes channel once the announcement has
+ * been sent in the configured number of beacons. If beacons are disabled, there's no way to tell
+ * nodes, so the switch happens right away.
+ *
+ * @param channel Channel to migrate to
+ */
+void ChannelMonitor::beginMigration(const uint16_t channel) {
+    this->targetChannel = channel;
+    this->beaconsRemaining = kSwitchBeacons;
+    this->announcedAt = std::chrono::steady_clock::now();
+
+    if(this->handler.beaconator->getInterval().count() <= 0) {
+        PLOG_WARNING << "beacons disabled, switching channels without announcement";
+        this->beaconsRemaining = 1;
+        this->tryMigrationTick();
+        return;
+    }
+
+    this->handler.beaconator->setChannelSwitch(NetControl::ChannelSwitch{
+        .channel = channel,
+        .beaconsRemaining = this->beaconsRemaining,
+    });
+    this->armMigrationTimer();
+}
+
+/**
+ * @brief Handle a beacon transmitted by the radio
+ *
+ * During a migration, every beacon that went out with the announcement in it advances the
+ * countdown. This is only reported by radios with beacon timing support; otherwise, the countdown
+ * is advanced by a timer instead.
+ *
+ * @param when Time at which the beacon was transmitted
+ */
+void ChannelMonitor::beaconSent(const std::chrono::steady_clock::time_point when) {
+    // ignore beacons that went out before the switch was announced
+    if(!this->isMigrating() || when < this->announcedAt) {
+        return;
+    }
+
+    this->tryMigrationTick();
+}
+
+/**
+ * @brief Advance a channel migration by one beacon
+ *
+ * Update the countdown in the beacon; once it expires, move the radio to the new channel.
+ */
+void ChannelMonitor::migrationTick() {
+    if(!this->beaconsRemaining) {
+        return;
+    }
+
+    if(--this->beaconsRemaining) {
+        this->handler.beaconator->setChannelSwitch(NetControl::ChannelSwitch{
+            .channel = this->targetChannel,
+            .beaconsRemaining = this->beaconsRemaining,
+        });
+        this->armMigrationTimer();
+        return;
+    }
+
+    // switch the radio over, and stop announcing it
+    auto &radio = this->handler.radio;
+    const auto oldChannel = radio->getChannel();
+
+    radio->setChannel(this->targetChannel);
+    try {
+        radio->uploadConfig();
+    } catch(const std::exception &) {
+        radio->setChannel(oldChannel);
+        throw;
+    }
+
+    this->handler.beaconator->setChannelSwitch(std::nullopt);
+
+    // start over with fresh statistics on the new channel
+    this->overThreshold = 0;
+    this->counters.ccaRate = this->counters.ferRate = 0.f;
+    this->counters.migrations++;
+    this->lastMigration = std::chrono::steady_clock::now();
+
+    PLOG_INFO << fmt::format("channel migration complete: {} -> {}", oldChannel,
+            this->targetChannel);
+}
+
+/**
+ * @brief Advance a channel migration, abandoning it if that fails
+ *
+ * The migration is called off (and no longer announced in beacons) so that the network stays on
+ * the current channel.
+ */
+void ChannelMonitor::tryMigrationTick() {
+    try {
+        this->migrationTick();
+    } catch(const std::exception &e) {
+        PLOG_ERROR << fmt::format("channel migration to {} failed: {}", this->targetChannel,
+                e.what());
+
+        this->beaconsRemaining = 0;
+        this->handler.beaconator->setChannelSwitch(std::nullopt);
+    }
+}
+
+/**
+ * @brief Schedule the next migration step for one beacon interval from now
+ *
+ * This is only needed if the radio doesn't report when it transmits beacons; if it does, the
+ * migration is advanced by beaconSent() instead, which stays in step with the beacons actually
+ * sent (even if the radio delays or skips one.)
+ */
+void ChannelMonitor::armMigrationTimer() {
+    if(this->handler.radio->supportsBeaconTiming()) {
+        return;
+    }
+
+    this->migrationTimer = std::make_shared<TristLib::Event::Timer>(
+            TristLib::Event::RunLoop::Current(),
+            std::chrono::microseconds(this->handler.beaconator->getInterval()), [this](auto) {
+        // keep the timer alive until its callback returns
+        auto timer = std::move(this->migrationTimer);
+        this->tryMigrationTick();
+    });
+}
@@ -0,0 +1,154 @@
+#ifndef PROTOCOL_CHANNELMONITOR_H
+#define PROTOCOL_CHANNELMONITOR_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace TristLib::Event {
+class Timer;
+}
+
+namespace Protocol {
+class Handler;
+
+/**
+ * @brief Channel quality monitor
+ *
+ * Periodically samples the radio's performance counters to derive the clear channel assessment
+ * (CCA) failure rate and the receive frame error rate, both smoothed with a moving average. If
+ * either stays above its threshold for several consecutive intervals, the network is migrated to
+ * the best of the configured candidate channels.
+ *
+ * A migration is announced in the beacon for a few beacons before the radio actually changes
+ * channel, so that nodes can follow along. The countdown follows the beacons the radio reports as
+ * sent; only if its firmware can't report them is it advanced by a timer, once per beacon
+ * interval. The rates last observed on each channel are remembered to avoid moving back to a
+ * channel that was just left.
+ */
+class ChannelMonitor {
+    private:
+        /// Config key for the sampling interval (msec)
+        constexpr static const std::string_view kConfInterval{"protocol.channel.interval"};
+        /// Config key for the CCA failure rate threshold
+        constexpr static const std::string_view kConfCcaThreshold{"protocol.channel.ccaThreshold"};
+        /// Config key for the frame error rate threshold
+        constexpr static const std::string_view kConfFerThreshold{"protocol.channel.ferThreshold"};
+        /// Config key for the number of intervals a threshold must be exceeded
+        constexpr static const std::string_view kConfHoldIntervals{
+            "protocol.channel.holdIntervals"};
+        /// Config key for the minimum time between migrations (msec)
+        constexpr static const std::string_view kConfCooldown{"protocol.channel.cooldown"};
+        /// Config key for the list of channels to migrate between
+        constexpr static const std::string_view kConfCandidates{"protocol.channel.candidates"};
+
+        /// Default sampling interval
+        constexpr static const std::chrono::milliseconds kDefaultInterval{10'000};
+        /// Default CCA failure rate threshold
+        constexpr static const float kDefaultCcaThreshold{.25f};
+        /// Default frame error rate threshold
+        constexpr static const float kDefaultFerThreshold{.2f};
+        /// Default number of intervals a threshold must be exceeded
+        constexpr static const size_t kDefaultHoldIntervals{3};
+        /// Default minimum time between migrations
+        constexpr static const std::chrono::milliseconds kDefaultCooldown{600'000};
+
+        /// Smoothing factor for the rate moving averages
+        constexpr static const float kAlpha{.25f};
+        /// Minimum number of frames in an interval for its rates to be considered
+        constexpr static const uint_least64_t kMinFrames{20};
+        /// Number of beacons that announce a channel switch
+        constexpr static const uint8_t kSwitchBeacons{3};
+
+    public:
+        /**
+         * @brief Channel monitor counters
+         */
+        struct Counters {
+            /// Smoothed CCA failure rate
+            float ccaRate{0};
+            /// Smoothed receive frame error rate
+            float ferRate{0};
+            /// Number of channel migrations performed
+            uint_least64_t migrations{0};
+        };
+
+    public:
+        ChannelMonitor(Handler &handler);
+        ~ChannelMonitor();
+
+        void reloadConfig();
+
+        /**
+         * @brief Determine whether a channel migration is in progress
+         */
+        inline bool isMigrating() const {
+            return this->beaconsRemaining != 0;
+        }
+
+        /**
+         * @brief Get the performance counters
+         */
+        inline const auto &getCounters() const {
+            return this->counters;
+        }
+
+    private:
+        void sample();
+        void beginMigration(const uint16_t channel);
+        void beaconSent(const std::chrono::steady_clock::time_point when);
+        void migrationTick();
+        void tryMigrationTick();
+        void armMigrationTimer();
+
+    private:
+        /// Handle to the protocol handler that owns us
+        Handler &handler;
+
+        /// Sampling interval
+        std::chrono::milliseconds interval{kDefaultInterval};
+        /// CCA failure rate above which the channel is considered congested
+        float ccaThreshold{kDefaultCcaThreshold};
+        /// Frame error rate above which the channel is considered noisy
+        float ferThreshold{kDefaultFerThreshold};
+        /// Consecutive intervals over threshold required to migrate
+        size_t holdIntervals{kDefaultHoldIntervals};
+        /// Minimum time between migrations
+        std::chrono::milliseconds cooldown{kDefaultCooldown};
+        /// Channels we may migrate to; if empty, the channel is only monitored
+        std::vector<uint16_t> candidates;
+
+        /// Radio transmit counters at the last sample (CCA failures, good frames)
+        uint_least64_t lastCcaFails{0}, lastTxGood{0};
+        /// Radio receive counters at the last sample (frame errors, good frames)
+        uint_least64_t lastFrameErrors{0}, lastRxGood{0};
+        /// Number of consecutive intervals a threshold was exceeded
+        size_t overThreshold{0};
+        /// Time at which the last migration completed
+        std::chrono::steady_clock::time_point lastMigration{};
+
+        /// Worst smoothed rate last observed on each channel
+        std::unordered_map<uint16_t, float> channelScores;
+
+        /// Channel being migrated to
+        uint16_t targetChannel{0};
+        /// Beacons remaining before the migration takes place
+        uint8_t beaconsRemaining{0};
+        /// Time at which the migration in progress was first announced
+        std::chrono::steady_clock::time_point announcedAt{};
+
+        /// Sampling timer
+        std::shared_ptr<TristLib::Event::Timer> sampleTimer;
+        /// Timer counting down a migration if beacons aren't reported (only exists while armed)
+        std::shared_ptr<TristLib::Event::Timer> migrationTimer;
+
+        /// Performance counters
+        Counters counters{};
+};
+}
+
+#endif
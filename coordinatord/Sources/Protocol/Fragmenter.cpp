@@ -0,0 +1,319 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include <TristLib/Core.h>
+#include <TristLib/Event.h>
+
+#include "Config/Reader.h"
+#include "Radio.h"
+#include "Handler.h"
+#include "Fragmenter.h"
+
+using namespace Protocol;
+
+/**
+ * @brief Initialize the fragmentation handler
+ *
+ * Read the configuration, allocate the reassembly buffer pool, and set up the timer used to
+ * advance the reassembly timeout wheel.
+ *
+ * @param handler Protocol handler that instantiated us
+ */
+Fragmenter::Fragmenter(Handler &handler) : handler(handler) {
+    this->txBuffer.reserve(Handler::kMaxPayloadSize);
+
+    this->reloadConfig();
+
+    this->tickTimer = std::make_shared<TristLib::Event::Timer>(
+            TristLib::Event::RunLoop::Current(), kTickInterval, [this](auto timer) {
+        this->tick();
+    }, true);
+}
+
+/**
+ * @brief Clean up the fragmentation handler
+ *
+ * Any partially reassembled messages are discarded.
+ */
+Fragmenter::~Fragmenter() {
+    this->tickTimer.reset();
+}
+
+
+
+/**
+ * @brief Read the fragmentation configuration
+ *
+ * All keys are optional, and live in the `protocol.fragmentation` table of the config file:
+ *
+ * - timeout: Time after which a partially received message is discarded (msec)
+ * - buffers: Number of messages that may be reassembled concurrently
+ *
+ * @remark Changing the number of buffers discards all partially reassembled messages.
+ */
+void Fragmenter::reloadConfig() {
+    const auto &root = Config::GetConfig();
+
+    auto timeout = root.at_path(kConfTimeout);
+    if(timeout && timeout.is_integer()) {
+        this->timeout = std::chrono::milliseconds(timeout.value_or(kDefaultTimeout.count()));
+    }
+    if(this->timeout < kTickInterval) {
+        throw std::runtime_error(fmt::format("invalid `{}`: must be at least {} ms", kConfTimeout,
+                    kTickInterval.count()));
+    }
+
+    size_t numBuffers{kDefaultNumBuffers};
+    auto buffers = root.at_path(kConfNumBuffers);
+    if(buffers && buffers.is_integer()) {
+        numBuffers = std::max<int64_t>(0, buffers.value_or(kDefaultNumBuffers));
+    }
+
+    if(numBuffers * kMaxMessageSize != this->bufferStorage.size()) {
+        this->allocBuffers(numBuffers);
+    }
+
+    PLOG_DEBUG << fmt::format("reassembly: {} buffers of {} bytes, timeout {} ms", numBuffers,
+            kMaxMessageSize, this->timeout.count());
+}
+
+/**
+ * @brief Allocate the reassembly buffer pool
+ *
+ * @param count Number of buffers to allocate
+ */
+void Fragmenter::allocBuffers(const size_t count) {
+    this->contexts.clear();
+    this->contextsPerSource.clear();
+    this->wheel.clear();
+
+    this->bufferStorage.assign(count * kMaxMessageSize, std::byte(0));
+    this->bufferStorage.shrink_to_fit();
+
+    this->freeBuffers.clear();
+    for(size_t i = 0; i < count; i++) {
+        this->freeBuffers.push_back(count - 1 - i);
+    }
+}
+
+/**
+ * @brief Get a reassembly buffer
+ *
+ * @param index Buffer index
+ */
+std::span<std::byte> Fragmenter::getBuffer(const size_t index) {
+    return std::span(this->bufferStorage).subspan(index * kMaxMessageSize, kMaxMessageSize);
+}
+
+
+
+/**
+ * @brief Transmit a message, split into fragments
+ *
+ * All fragments are built up front, then handed to the protocol handler as a single train (so
+ * they're secured in one pass), and queued for transmission immediately.
+ *
+ * @param destination Short address of the node to send to (or the broadcast address)
+ * @param endpoint Endpoint the message is addressed to
+ * @param priority Transmission priority
+ * @param payload Message to send
+ * @param completion Invoked once all fragments have been acknowledged, or any fragment failed
+ */
+void Fragmenter::send(const uint16_t destination,
+        const BlazeNet::Types::Mac::HeaderFlags endpoint, const Radio::PacketPriority priority,
+        std::span<const std::byte> payload, const CompletionCallback &completion) {
+    if(payload.size() > kMaxMessageSize) {
+        throw std::invalid_argument(fmt::format("message too large ({}, max {})", payload.size(),
+                    kMaxMessageSize));
+    }
+
+    const size_t count = (payload.size() + kMaxFragmentData - 1) / kMaxFragmentData;
+    const auto id = this->nextMessageId++;
+
+    // completion is reported once for the whole message
+    struct State {
+        size_t remaining;
+        bool done{false};
+        CompletionCallback callback;
+    };
+
+    auto state = std::make_shared<State>();
+    state->remaining = count;
+    state->callback = completion;
+
+    auto fragmentDone = [state](const bool success) {
+        if(state->done) {
+            return;
+        }
+
+        if(!success || !--state->remaining) {
+            state->done = true;
+            if(state->callback) {
+                state->callback(success);
+            }
+        }
+    };
+
+    // build all fragments back to back, then send them as one train
+    constexpr static const size_t kHeaderSize{sizeof(NetControl::Header)
+        + sizeof(NetControl::Fragment)};
+
+    this->txBuffer.resize(count * kHeaderSize + payload.size());
+    this->txFragments.clear();
+
+    for(size_t i = 0, bufferOffset = 0; i < count; i++) {
+        const auto offset = i * kMaxFragmentData;
+        const auto chunk = payload.subspan(offset, std::min(kMaxFragmentData,
+                    payload.size() - offset));
+
+        auto ncHdr = reinterpret_cast<NetControl::Header *>(this->txBuffer.data() + bufferOffset);
+        ncHdr->type = static_cast<uint8_t>(NetControl::MessageType::Fragment);
+
+        auto frag = reinterpret_cast<NetControl::Fragment *>(ncHdr->payload);
+        frag->messageId = id;
+        frag->index = i;
+        frag->count = count;
+        frag->totalLength = payload.size();
+        frag->endpoint = endpoint;
+
+        memcpy(frag->data, chunk.data(), chunk.size());
+
+        this->txFragments.emplace_back(std::span(this->txBuffer).subspan(bufferOffset,
+                    kHeaderSize + chunk.size()));
+        bufferOffset += kHeaderSize + chunk.size();
+    }
+
+    this->handler.sendFrames(destination, BlazeNet::Types::Mac::HeaderFlags::EndpointNetControl,
+            priority, this->txFragments, fragmentDone);
+
+    this->counters.txFragments += count;
+    this->counters.txMessages++;
+}
+
+/**
+ * @brief Process a received fragment
+ *
+ * Copy the fragment's data into the reassembly buffer for its message, allocating one if this is
+ * the first fragment. Once all fragments have been received, the message is passed on to the
+ * protocol handler.
+ *
+ * @param source Address of the node that sent the fragment
+ * @param payload Fragment header and data
+ */
+void Fragmenter::handleFragment(const uint16_t source, std::span<const std::byte> payload) {
+    // validate the header
+    if(payload.size() < sizeof(NetControl::Fragment)) {
+        this->counters.rxInvalid++;
+        return;
+    }
+
+    auto frag = reinterpret_cast<const NetControl::Fragment *>(payload.data());
+    const auto data = payload.subspan(sizeof(*frag));
+
+    const size_t count = frag->count, index = frag->index, totalLength = frag->totalLength;
+    const size_t offset = index * kMaxFragmentData;
+
+    if(!count || count > kMaxFragments || index >= count || totalLength > kMaxMessageSize ||
+            offset >= totalLength ||
+            data.size() != std::min(kMaxFragmentData, totalLength - offset)) {
+        this->counters.rxInvalid++;
+        return;
+    }
+
+    // find the reassembly context, or create a new one
+    const auto key = MakeKey(source, frag->messageId);
+    auto it = this->contexts.find(key);
+
+    if(it == this->contexts.end()) {
+        auto &numContexts = this->contextsPerSource[source];
+        if(numContexts >= kMaxContextsPerSource || this->freeBuffers.empty()) {
+            if(!numContexts) {
+                this->contextsPerSource.erase(source);
+            }
+
+            this->counters.rxNoBuffer++;
+            return;
+        }
+
+        Context ctx;
+        ctx.buffer = this->freeBuffers.back();
+        ctx.count = count;
+        ctx.totalLength = totalLength;
+        ctx.endpoint = frag->endpoint;
+        ctx.timer = this->wheel.schedule(this->timeout, key);
+
+        this->freeBuffers.pop_back();
+        numContexts++;
+
+        it = this->contexts.emplace(key, ctx).first;
+    }
+
+    auto &ctx = it->second;
+
+    if(ctx.count != count || ctx.totalLength != totalLength || ctx.endpoint != frag->endpoint) {
+        this->counters.rxInvalid++;
+        return;
+    } else if(ctx.received & (1ULL << index)) {
+        this->counters.rxDuplicates++;
+        return;
+    }
+
+    // copy data into place
+    auto buffer = this->getBuffer(ctx.buffer);
+    std::copy(data.begin(), data.end(), buffer.begin() + offset);
+    ctx.received |= (1ULL << index);
+
+    // was this the last fragment?
+    const uint64_t allReceived = (count == 64) ? ~0ULL : ((1ULL << count) - 1);
+    if(ctx.received != allReceived) {
+        return;
+    }
+
+    this->counters.rxReassembled++;
+    this->wheel.cancel(ctx.timer);
+
+    const auto endpoint = static_cast<BlazeNet::Types::Mac::HeaderFlags>(ctx.endpoint);
+    this->handler.deliverMessage(source, endpoint, buffer.subspan(0, ctx.totalLength));
+
+    this->releaseContext(key);
+}
+
+/**
+ * @brief Release a reassembly context
+ *
+ * Its buffer is returned to the pool.
+ *
+ * @param key Key of the context to release
+ */
+void Fragmenter::releaseContext(const uint32_t key) {
+    auto it = this->contexts.find(key);
+    if(it == this->contexts.end()) {
+        return;
+    }
+
+    this->freeBuffers.push_back(it->second.buffer);
+    this->contexts.erase(it);
+
+    const uint16_t source = key >> 16;
+    if(auto count = this->contextsPerSource.find(source);
+            count != this->contextsPerSource.end() && !--count->second) {
+        this->contextsPerSource.erase(count);
+    }
+}
+
+/**
+ * @brief Advance the reassembly timeout wheel
+ *
+ * Discard all messages whose reassembly timed out.
+ */
+void Fragmenter::tick() {
+    this->wheel.advance(std::chrono::steady_clock::now(), [this](auto, const uint64_t key) {
+        PLOG_VERBOSE << fmt::format("reassembly timed out: ${:04x}:{}", key >> 16, key & 0xFFFF);
+
+        this->counters.rxTimeouts++;
+        this->releaseContext(key);
+    });
+}
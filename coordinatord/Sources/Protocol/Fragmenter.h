@@ -0,0 +1,183 @@
+#ifndef PROTOCOL_FRAGMENTER_H
+#define PROTOCOL_FRAGMENTER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <BlazeNet/Types.h>
+
+#include "Radio.h"
+#include "Handler.h"
+#include "NetControl.h"
+#include "TimerWheel.h"
+
+namespace TristLib::Event {
+class Timer;
+}
+
+namespace Protocol {
+/**
+ * @brief Message fragmentation and reassembly
+ *
+ * Splits messages that don't fit in a single frame into fragments, which are all queued for
+ * transmission at once; and reassembles fragmented messages received from nodes.
+ *
+ * Reassembly buffers are taken from a fixed size pool allocated up front, so that the memory used
+ * for reassembly is bounded regardless of how many nodes send fragments. Each partially received
+ * message is discarded if it's not completed within a timeout.
+ */
+class Fragmenter {
+    private:
+        /// Config key for the reassembly timeout (msec)
+        constexpr static const std::string_view kConfTimeout{"protocol.fragmentation.timeout"};
+        /// Config key for the number of reassembly buffers
+        constexpr static const std::string_view kConfNumBuffers{"protocol.fragmentation.buffers"};
+
+        /// Default reassembly timeout
+        constexpr static const std::chrono::milliseconds kDefaultTimeout{5'000};
+        /// Default number of reassembly buffers
+        constexpr static const size_t kDefaultNumBuffers{16};
+        /// Maximum number of messages a single node may have in reassembly at a time
+        constexpr static const size_t kMaxContextsPerSource{2};
+        /// Resolution of the reassembly timeout wheel
+        constexpr static const std::chrono::milliseconds kTickInterval{100};
+
+        /// Maximum number of fragments per message
+        constexpr static const size_t kMaxFragments{64};
+
+    public:
+        /// Maximum amount of message data in a single fragment
+        constexpr static const size_t kMaxFragmentData{
+            Handler::kMaxPayloadSize - sizeof(NetControl::Header) - sizeof(NetControl::Fragment)
+        };
+        /// Largest message that can be sent or received
+        constexpr static const size_t kMaxMessageSize{kMaxFragments * kMaxFragmentData};
+
+        /**
+         * @brief Message completion callback
+         *
+         * @param success Whether all fragments were acknowledged
+         */
+        using CompletionCallback = std::function<void(const bool success)>;
+
+        /**
+         * @brief Fragmentation performance counters
+         */
+        struct Counters {
+            /// Messages that were fragmented for transmission
+            uint_least64_t txMessages{0};
+            /// Fragments transmitted
+            uint_least64_t txFragments{0};
+
+            /// Messages successfully reassembled
+            uint_least64_t rxReassembled{0};
+            /// Messages discarded because they weren't completed in time
+            uint_least64_t rxTimeouts{0};
+            /// Fragments dropped because no reassembly buffer was available
+            uint_least64_t rxNoBuffer{0};
+            /// Fragments dropped because they were malformed or inconsistent
+            uint_least64_t rxInvalid{0};
+            /// Fragments that had already been received
+            uint_least64_t rxDuplicates{0};
+        };
+
+    private:
+        /**
+         * @brief Reassembly context
+         *
+         * Holds the state of a single message being reassembled.
+         */
+        struct Context {
+            /// Reassembly buffer index
+            size_t buffer;
+            /// Bitmap of fragments received so far
+            uint64_t received{0};
+            /// Total number of fragments
+            uint8_t count;
+            /// Total message length
+            uint16_t totalLength;
+            /// Endpoint the message is addressed to
+            uint16_t endpoint;
+
+            /// Reassembly timeout
+            TimerWheel::Handle timer{TimerWheel::kInvalidHandle};
+        };
+
+    public:
+        Fragmenter(Handler &handler);
+        ~Fragmenter();
+
+        void reloadConfig();
+
+        void send(const uint16_t destination, const BlazeNet::Types::Mac::HeaderFlags endpoint,
+                const Radio::PacketPriority priority, std::span<const std::byte> payload,
+                const CompletionCallback &completion);
+        void handleFragment(const uint16_t source, std::span<const std::byte> payload);
+
+        /**
+         * @brief Get the number of messages currently being reassembled
+         */
+        inline size_t getNumReassembling() const {
+            return this->contexts.size();
+        }
+        /**
+         * @brief Get the performance counters
+         */
+        inline const auto &getCounters() const {
+            return this->counters;
+        }
+
+    private:
+        /// Build the key for the reassembly context map
+        constexpr static inline uint32_t MakeKey(const uint16_t source, const uint16_t id) {
+            return (static_cast<uint32_t>(source) << 16) | id;
+        }
+
+        void allocBuffers(const size_t count);
+        std::span<std::byte> getBuffer(const size_t index);
+        void releaseContext(const uint32_t key);
+
+        void tick();
+
+    private:
+        /// Handle to the protocol handler that owns us
+        Handler &handler;
+
+        /// Reassembly timeout
+        std::chrono::milliseconds timeout{kDefaultTimeout};
+
+        /// Id for the next fragmented message we send
+        uint16_t nextMessageId{0};
+        /// Buffer used to assemble outgoing fragments
+        std::vector<std::byte> txBuffer;
+        /// Fragments of the message being sent, in the transmit buffer
+        std::vector<std::span<const std::byte>> txFragments;
+
+        /// Backing storage for all reassembly buffers
+        std::vector<std::byte> bufferStorage;
+        /// Indices of free reassembly buffers
+        std::vector<size_t> freeBuffers;
+
+        /// Messages being reassembled, keyed by source address and message id
+        std::unordered_map<uint32_t, Context> contexts;
+        /// Number of messages being reassembled, per source address
+        std::unordered_map<uint16_t, size_t> contextsPerSource;
+
+        /// Reassembly timeouts
+        TimerWheel wheel{kTickInterval};
+        /// Event loop timer to advance the wheel
+        std::shared_ptr<TristLib::Event::Timer> tickTimer;
+
+        /// Performance counters
+        Counters counters{};
+};
+}
+
+#endif
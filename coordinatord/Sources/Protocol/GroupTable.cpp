@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+#include <BlazeNet/Types.h>
+#include <fmt/format.h>
+
+#include <TristLib/Core.h>
+
+#include "Radio.h"
+#include "Association.h"
+#include "Handler.h"
+#include "NetControl.h"
+#include "PowerControl.h"
+#include "GroupTable.h"
+
+using namespace Protocol;
+
+/**
+ * @brief Initialize the group table
+ *
+ * @param handler Protocol handler that instantiated us
+ */
+GroupTable::GroupTable(Handler &handler) : handler(handler) {
+}
+
+
+
+/**
+ * @brief Create a new group
+ *
+ * @return Address of the new group, or an empty value if all group addresses are in use
+ */
+std::optional<uint16_t> GroupTable::create() {
+    for(uint32_t group = NetControl::kFirstGroupAddress; group <= NetControl::kLastGroupAddress;
+            group++) {
+        if(this->groups.try_emplace(group).second) {
+            PLOG_INFO << fmt::format("created group ${:04x}", group);
+            return group;
+        }
+    }
+
+    return std::nullopt;
+}
+
+/**
+ * @brief Delete a group
+ *
+ * All of its members are told that they've left the group.
+ *
+ * @param group Address of the group to delete
+ *
+ * @return Whether the group existed
+ */
+bool GroupTable::destroy(const uint16_t group) {
+    if(!this->exists(group)) {
+        return false;
+    }
+
+    for(const auto address : this->getMembers(group)) {
+        this->notify(group, address, false);
+    }
+    this->groups.erase(group);
+
+    PLOG_INFO << fmt::format("deleted group ${:04x}", group);
+    return true;
+}
+
+
+
+/**
+ * @brief Add a node to a group
+ *
+ * @param group Address of the group
+ * @param address Short address of the node to add
+ *
+ * @return Whether the node was added (false if it was already a member)
+ */
+bool GroupTable::add(const uint16_t group, const uint16_t address) {
+    auto &entry = this->getGroup(group);
+
+    if(!this->handler.association->isAssociated(address)) {
+        throw std::invalid_argument(fmt::format("node ${:04x} is not associated", address));
+    }
+
+    const size_t index = address / kBitsPerWord;
+    const auto mask = 1ULL << (address % kBitsPerWord);
+
+    if(entry.members.size() <= index) {
+        entry.members.resize(index + 1, 0);
+    } else if(entry.members[index] & mask) {
+        return false;
+    }
+
+    entry.members[index] |= mask;
+    entry.numMembers++;
+
+    this->notify(group, address, true);
+    return true;
+}
+
+/**
+ * @brief Remove a node from a group
+ *
+ * @param group Address of the group
+ * @param address Short address of the node to remove
+ *
+ * @return Whether the node was removed (false if it wasn't a member)
+ */
+bool GroupTable::remove(const uint16_t group, const uint16_t address) {
+    auto &entry = this->getGroup(group);
+
+    if(!this->isMember(group, address)) {
+        return false;
+    }
+
+    entry.members[address / kBitsPerWord] &= ~(1ULL << (address % kBitsPerWord));
+    entry.numMembers--;
+
+    // shrink the bitmap to the highest remaining member
+    while(!entry.members.empty() && !entry.members.back()) {
+        entry.members.pop_back();
+    }
+
+    this->notify(group, address, false);
+    return true;
+}
+
+/**
+ * @brief Remove a node from all groups
+ *
+ * Invoked when the node leaves the network; it isn't notified.
+ *
+ * @param address Short address of the node
+ */
+void GroupTable::removeNode(const uint16_t address) {
+    const size_t index = address / kBitsPerWord;
+    const auto mask = 1ULL << (address % kBitsPerWord);
+
+    for(auto &[group, entry] : this->groups) {
+        if(entry.members.size() <= index || !(entry.members[index] & mask)) {
+            continue;
+        }
+
+        entry.members[index] &= ~mask;
+        entry.numMembers--;
+
+        while(!entry.members.empty() && !entry.members.back()) {
+            entry.members.pop_back();
+        }
+    }
+}
+
+
+
+/**
+ * @brief Determine whether a node is a member of a group
+ *
+ * @param group Address of the group
+ * @param address Short address of the node
+ */
+bool GroupTable::isMember(const uint16_t group, const uint16_t address) const {
+    const auto &entry = this->getGroup(group);
+    const size_t index = address / kBitsPerWord;
+
+    return index < entry.members.size() &&
+        (entry.members[index] & (1ULL << (address % kBitsPerWord)));
+}
+
+/**
+ * @brief Get the members of a group
+ *
+ * @param group Address of the group
+ *
+ * @return Short addresses of all members, in ascending order
+ */
+std::vector<uint16_t> GroupTable::getMembers(const uint16_t group) const {
+    const auto &entry = this->getGroup(group);
+
+    std::vector<uint16_t> addresses;
+    addresses.reserve(entry.numMembers);
+
+    for(size_t i = 0; i < entry.members.size(); i++) {
+        for(auto word = entry.members[i]; word; word &= (word - 1)) {
+            addresses.push_back((i * kBitsPerWord) + __builtin_ctzll(word));
+        }
+    }
+
+    return addresses;
+}
+
+/**
+ * @brief Get the number of members in a group
+ *
+ * @param group Address of the group
+ */
+size_t GroupTable::getNumMembers(const uint16_t group) const {
+    return this->getGroup(group).numMembers;
+}
+
+/**
+ * @brief Get the addresses of all groups
+ *
+ * @return Group addresses, in ascending order
+ */
+std::vector<uint16_t> GroupTable::getGroups() const {
+    std::vector<uint16_t> addresses;
+    addresses.reserve(this->groups.size());
+
+    for(const auto &[group, entry] : this->groups) {
+        addresses.push_back(group);
+    }
+    std::sort(addresses.begin(), addresses.end());
+
+    return addresses;
+}
+
+
+
+/**
+ * @brief Get the transmit power to use for frames to a group
+ *
+ * This is the highest power needed to reach any of the group's members.
+ *
+ * @param group Address of the group
+ *
+ * @return Transmit power (in ⅒th dBm), or an empty value to use the configured transmit power
+ */
+std::optional<uint8_t> GroupTable::getTxPower(const uint16_t group) const {
+    const auto &entry = this->getGroup(group);
+    if(!entry.numMembers) {
+        return std::nullopt;
+    }
+
+    uint8_t power{0};
+    for(const auto address : this->getMembers(group)) {
+        const auto memberPower = this->handler.powerControl->getTxPower(address);
+        if(!memberPower) {
+            return std::nullopt;
+        }
+        power = std::max(power, *memberPower);
+    }
+
+    return power;
+}
+
+
+
+/**
+ * @brief Look up a group
+ *
+ * @param group Address of the group
+ *
+ * @throw std::invalid_argument If the group doesn't exist
+ */
+GroupTable::Group &GroupTable::getGroup(const uint16_t group) {
+    auto it = this->groups.find(group);
+    if(it == this->groups.end()) {
+        throw std::invalid_argument(fmt::format("unknown group ${:04x}", group));
+    }
+    return it->second;
+}
+
+const GroupTable::Group &GroupTable::getGroup(const uint16_t group) const {
+    auto it = this->groups.find(group);
+    if(it == this->groups.end()) {
+        throw std::invalid_argument(fmt::format("unknown group ${:04x}", group));
+    }
+    return it->second;
+}
+
+/**
+ * @brief Tell a node about a change to its group membership
+ *
+ * @param group Address of the group
+ * @param address Short address of the node
+ * @param member Whether the node is now a member of the group
+ */
+void GroupTable::notify(const uint16_t group, const uint16_t address, const bool member) {
+    std::array<std::byte, sizeof(NetControl::Header) + sizeof(NetControl::GroupMembership)> msg{};
+
+    auto ncHdr = reinterpret_cast<NetControl::Header *>(msg.data());
+    ncHdr->type = static_cast<uint8_t>(NetControl::MessageType::GroupMembership);
+
+    auto change = reinterpret_cast<NetControl::GroupMembership *>(ncHdr->payload);
+    change->group = group;
+    change->member = member ? 1 : 0;
+
+    this->handler.sendFrame(address, BlazeNet::Types::Mac::HeaderFlags::EndpointNetControl,
+            Radio::PacketPriority::Normal, msg, [group, address, member](const bool success) {
+        if(!success) {
+            PLOG_WARNING << fmt::format("failed to {} node ${:04x} {} group ${:04x}",
+                    member ? "add" : "remove", address, member ? "to" : "from", group);
+        }
+    });
+}
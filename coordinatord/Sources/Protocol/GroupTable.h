@@ -0,0 +1,120 @@
+#ifndef PROTOCOL_GROUPTABLE_H
+#define PROTOCOL_GROUPTABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "NetControl.h"
+
+namespace Protocol {
+class Handler;
+
+/**
+ * @brief Multicast group table
+ *
+ * Groups are identified by a short address from the range reserved for groups. A frame sent to a
+ * group address is transmitted once, and accepted by every node that's a member of the group;
+ * like broadcast frames, these aren't acknowledged or retransmitted.
+ *
+ * The membership of each group is stored as a bitmap over the short address space. It only
+ * extends up to the highest member's address (short addresses are handed out from the bottom of
+ * the address space) so it remains small even with many groups.
+ *
+ * Nodes are told about changes to their membership with a (reliable) network control message.
+ */
+class GroupTable {
+    private:
+        /// Number of addresses per bitmap word
+        constexpr static const size_t kBitsPerWord{64};
+
+    public:
+        /**
+         * @brief Group performance counters
+         */
+        struct Counters {
+            /// Frames transmitted to a group address
+            uint_least64_t frames{0};
+            /// Unicast frames that would have been needed to reach all members individually
+            uint_least64_t unicastEquivalent{0};
+            /// Frames to groups without members, which were not transmitted
+            uint_least64_t emptyGroups{0};
+        };
+
+    private:
+        /**
+         * @brief A single multicast group
+         */
+        struct Group {
+            /// Bitmap of member addresses (set bits)
+            std::vector<uint64_t> members;
+            /// Number of set bits in the bitmap
+            size_t numMembers{0};
+        };
+
+    public:
+        GroupTable(Handler &handler);
+
+        std::optional<uint16_t> create();
+        bool destroy(const uint16_t group);
+
+        bool add(const uint16_t group, const uint16_t address);
+        bool remove(const uint16_t group, const uint16_t address);
+        void removeNode(const uint16_t address);
+
+        bool isMember(const uint16_t group, const uint16_t address) const;
+        std::vector<uint16_t> getMembers(const uint16_t group) const;
+        size_t getNumMembers(const uint16_t group) const;
+        std::vector<uint16_t> getGroups() const;
+
+        std::optional<uint8_t> getTxPower(const uint16_t group) const;
+
+        /**
+         * @brief Determine whether a group exists
+         */
+        inline bool exists(const uint16_t group) const {
+            return this->groups.contains(group);
+        }
+        /**
+         * @brief Get the performance counters
+         */
+        inline const auto &getCounters() const {
+            return this->counters;
+        }
+        /**
+         * @brief Account for a frame transmitted to a group
+         *
+         * @param group Address of the group
+         */
+        inline void countFrame(const uint16_t group) {
+            this->counters.frames++;
+            this->counters.unicastEquivalent += this->getNumMembers(group);
+        }
+        /**
+         * @brief Account for a frame to a group without members
+         */
+        inline void countEmpty() {
+            this->counters.emptyGroups++;
+        }
+
+    private:
+        Group &getGroup(const uint16_t group);
+        const Group &getGroup(const uint16_t group) const;
+
+        void notify(const uint16_t group, const uint16_t address, const bool member);
+
+    private:
+        /// Handle to the protocol handler that owns us
+        Handler &handler;
+
+        /// All groups, keyed by their group address
+        std::unordered_map<uint16_t, Group> groups;
+
+        /// Performance counters
+        Counters counters{};
+};
+}
+
+#endif
@@ -1,5 +1,26 @@
+#include <cstring>
+#include <stdexcept>
+
+#include <BlazeNet/Types.h>
+#include <fmt/format.h>
+
+#include <TristLib/Core.h>
+
 #include "Radio.h"
+#include "Aggregator.h"
+#include "Association.h"
 #include "Beaconator.h"
+#include "ChannelMonitor.h"
+#include "Fragmenter.h"
+#include "GroupTable.h"
+#include "IndirectQueue.h"
+#include "LinkQuality.h"
+#include "NetControl.h"
+#include "OtaDistributor.h"
+#include "PowerControl.h"
+#include "Retransmitter.h"
+#include "Security.h"
+#include "Superframe.h"
 #include "Handler.h"
 
 using namespace Protocol;
@@ -10,8 +31,33 @@ using namespace Protocol;
  * @param radio Radio to communicate with (assumed to be set up already)
  */
 Handler::Handler(const std::shared_ptr<Radio> &_radio) : radio(_radio) {
+    this->txBuffer.reserve(kMaxFrameSize);
+    this->rxPlaintext.reserve(kMaxFrameSize);
+
     // initialize sub-components
+    this->security = std::make_shared<Security>(*this);
+    this->association = std::make_shared<Association>(*this);
+    this->linkQuality = std::make_shared<LinkQuality>(*this);
+    this->powerControl = std::make_shared<PowerControl>(*this);
     this->beaconator = std::make_shared<Beaconator>(*this);
+    this->superframe = std::make_shared<Superframe>(*this);
+    this->channelMonitor = std::make_shared<ChannelMonitor>(*this);
+    this->retransmitter = std::make_shared<Retransmitter>(*this);
+    this->fragmenter = std::make_shared<Fragmenter>(*this);
+    this->aggregator = std::make_shared<Aggregator>(*this);
+    this->indirect = std::make_shared<IndirectQueue>(*this);
+    this->groups = std::make_shared<GroupTable>(*this);
+    this->ota = std::make_shared<OtaDistributor>(*this);
+
+    // advertise pending traffic for sleeping nodes in the beacon
+    this->indirect->setPendingChangedCallback([this](auto addresses) {
+        this->beaconator->setPendingTraffic(addresses);
+    });
+
+    // receive frames from the radio
+    this->radio->addReceiveHandler([this](auto frame, auto rssi, auto lqi) {
+        this->handleReceivedFrame(frame, rssi, lqi);
+    });
 }
 
 /**
@@ -19,5 +65,447 @@ Handler::Handler(const std::shared_ptr<Radio> &_radio) : radio(_radio) {
  */
 Handler::~Handler() {
     // destroy child objects
+    this->ota.reset();
+    this->groups.reset();
+    this->aggregator.reset();
+    this->indirect.reset();
+    this->fragmenter.reset();
+    this->retransmitter.reset();
+    this->channelMonitor.reset();
+    this->superframe.reset();
     this->beaconator.reset();
+    this->powerControl.reset();
+    this->linkQuality.reset();
+    this->association.reset();
+    this->security.reset();
+}
+
+
+
+/**
+ * @brief Transmit a frame
+ *
+ * Prepend the PHY and MAC headers to the payload, then submit it to the radio. Unicast frames are
+ * tracked until they're acknowledged by their destination, and retransmitted if needed. Frames to
+ * sleeping nodes are instead held in the indirect queue until the node polls for them.
+ *
+ * Unicast frames are transmitted with the power selected for their destination by the power
+ * controller. Real time frames to nodes with a guaranteed time slot are held until that slot.
+ *
+ * Frames to a multicast group are transmitted once, like broadcasts, at the power needed to reach
+ * its farthest member. Sleeping members only receive them if they happen to be awake.
+ *
+ * @param destination Short address of the node to send to (or a group or the broadcast address)
+ * @param endpoint Endpoint flags for the MAC header
+ * @param priority Transmission priority
+ * @param payload Frame payload
+ * @param completion Invoked once the frame is acknowledged (or failed); broadcast and multicast
+ *        frames complete immediately after being queued
+ *
+ * @return Whether the frame was queued for transmission, held, or not sent at all
+ */
+Handler::SendResult Handler::sendFrame(const uint16_t destination,
+        const BlazeNet::Types::Mac::HeaderFlags endpoint, const Radio::PacketPriority priority,
+        std::span<const std::byte> payload, const CompletionCallback &completion) {
+    // don't bother transmitting to groups without members
+    if(!this->hasRecipients(destination)) {
+        if(completion) {
+            completion(true);
+        }
+        return SendResult::NoRecipients;
+    }
+
+    this->buildFrame(this->txBuffer, destination, endpoint, payload);
+    if(this->security->isEnabled()) {
+        this->security->protect(this->txBuffer);
+    }
+
+    return this->dispatchFrame(destination, priority, this->txBuffer, completion);
+}
+
+/**
+ * @brief Transmit a train of frames to a single destination
+ *
+ * This works the same as invoking sendFrame() for each payload in turn, except that all frames
+ * are built before any of them is sent, so they can be secured in a single pass.
+ *
+ * @param destination Short address of the node to send to (or a group or the broadcast address)
+ * @param endpoint Endpoint flags for the MAC header
+ * @param priority Transmission priority
+ * @param payloads Payloads of the frames, in the order they're sent
+ * @param completion Invoked once for each frame; see sendFrame()
+ *
+ * @return What happened to the frames (this is the same for all of them)
+ */
+Handler::SendResult Handler::sendFrames(const uint16_t destination,
+        const BlazeNet::Types::Mac::HeaderFlags endpoint, const Radio::PacketPriority priority,
+        std::span<const std::span<const std::byte>> payloads,
+        const CompletionCallback &completion) {
+    if(!this->hasRecipients(destination)) {
+        if(completion) {
+            for(size_t i = 0; i < payloads.size(); i++) {
+                completion(true);
+            }
+        }
+        return SendResult::NoRecipients;
+    }
+
+    // take the buffers, in case a completion sends another train while these are sent
+    auto frames = std::move(this->txFrames);
+    auto spans = std::move(this->txFrameSpans);
+
+    // build all frames, then secure them together
+    if(frames.size() < payloads.size()) {
+        frames.resize(payloads.size());
+    }
+    spans.clear();
+
+    for(size_t i = 0; i < payloads.size(); i++) {
+        this->buildFrame(frames[i], destination, endpoint, payloads[i]);
+        spans.emplace_back(frames[i]);
+    }
+
+    if(this->security->isEnabled()) {
+        this->security->protect(spans);
+    }
+
+    // then send them in order
+    auto result{SendResult::Queued};
+    for(const auto frame : spans) {
+        result = this->dispatchFrame(destination, priority, frame, completion);
+    }
+
+    this->txFrames = std::move(frames);
+    this->txFrameSpans = std::move(spans);
+
+    return result;
+}
+
+/**
+ * @brief Check whether a frame to the given destination would reach anyone
+ *
+ * This is only not the case for multicast groups without members; frames to them are counted.
+ */
+bool Handler::hasRecipients(const uint16_t destination) {
+    if(NetControl::IsGroupAddress(destination) && !this->groups->getNumMembers(destination)) {
+        this->groups->countEmpty();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Build an outgoing frame
+ *
+ * Fill in the PHY and MAC headers, and copy the payload behind them. If security is enabled, room
+ * is left for the security header and integrity code, and the frame is flagged as secured; it
+ * must then be passed to Security::protect() before it's sent.
+ *
+ * @param buffer Buffer to build the frame in (it's resized as needed)
+ * @param destination Short address the frame is addressed to
+ * @param endpoint Endpoint flags for the MAC header
+ * @param payload Frame payload
+ */
+void Handler::buildFrame(std::vector<std::byte> &buffer, const uint16_t destination,
+        const BlazeNet::Types::Mac::HeaderFlags endpoint, std::span<const std::byte> payload) {
+    using namespace BlazeNet::Types;
+
+    if(payload.size() > kMaxPayloadSize) {
+        throw std::invalid_argument(fmt::format("payload too large ({}, max {})", payload.size(),
+                    kMaxPayloadSize));
+    }
+
+    // leave room for the security header and integrity code
+    const bool secured = this->security->isEnabled();
+    const size_t payloadOffset = kFrameHeaderSize + (secured ? sizeof(SecurityHeader) : 0);
+
+    buffer.resize(payloadOffset + payload.size() + (secured ? Security::kMicSize : 0));
+    std::fill(buffer.begin(), buffer.begin() + payloadOffset, std::byte(0));
+
+    auto phyHdr = reinterpret_cast<Phy::Header *>(buffer.data());
+    phyHdr->length = buffer.size() - 1;
+
+    auto macHdr = reinterpret_cast<Mac::Header *>(phyHdr->payload);
+    macHdr->flags = endpoint;
+    macHdr->sequence = this->nextSequence++;
+    macHdr->source = this->radio->getAddress();
+    macHdr->destination = destination;
+
+    if(secured) {
+        macHdr->flags |= Security::kFlagSecured;
+    }
+
+    if(!payload.empty()) {
+        memcpy(buffer.data() + payloadOffset, payload.data(), payload.size());
+    }
+}
+
+/**
+ * @brief Send a frame that's been built (and secured, if needed)
+ *
+ * Frames to sleeping nodes are held in the indirect queue; all others are submitted for
+ * transmission, and unicast frames are tracked until they're acknowledged.
+ *
+ * @param destination Short address the frame is addressed to
+ * @param priority Transmission priority
+ * @param frame Full frame (including PHY header)
+ * @param completion Invoked once the frame is acknowledged (or failed); see sendFrame()
+ */
+Handler::SendResult Handler::dispatchFrame(const uint16_t destination,
+        const Radio::PacketPriority priority, std::span<const std::byte> frame,
+        const CompletionCallback &completion) {
+    using namespace BlazeNet::Types;
+
+    auto macHdr = reinterpret_cast<const Mac::Header *>(frame.data() + sizeof(Phy::Header));
+    const uint8_t sequence = macHdr->sequence;
+
+    // hold it if the destination is asleep
+    if(this->indirect->isSleepy(destination)) {
+        this->indirect->enqueue(destination, sequence, priority, frame, completion);
+        return SendResult::Held;
+    }
+
+    // otherwise, queue it, and track it for acknowledgement if unicast
+    const auto holdoff = this->transmit(destination, priority, frame);
+    const bool multicast = NetControl::IsGroupAddress(destination);
+
+    if(multicast) {
+        this->groups->countFrame(destination);
+    }
+
+    if(destination != Mac::kBroadcastAddress && !multicast) {
+        this->retransmitter->track(destination, sequence, priority, frame, completion, holdoff);
+    } else if(completion) {
+        completion(true);
+    }
+
+    return SendResult::Queued;
+}
+
+/**
+ * @brief Submit a frame for transmission
+ *
+ * Real time frames to nodes with a guaranteed time slot are handed to the superframe scheduler;
+ * everything else goes to the radio right away, with the destination's transmit power (or that of
+ * the farthest member, for multicast groups.)
+ *
+ * @param destination Short address of the node the frame is for
+ * @param priority Transmission priority
+ * @param frame Full frame (including PHY header)
+ *
+ * @return How long the frame is held before being transmitted (zero if submitted right away)
+ */
+std::chrono::milliseconds Handler::transmit(const uint16_t destination,
+        const Radio::PacketPriority priority, std::span<const std::byte> frame) {
+    if(auto holdoff = this->superframe->enqueue(destination, priority, frame)) {
+        return *holdoff;
+    }
+
+    const auto txPower = NetControl::IsGroupAddress(destination) ?
+        this->groups->getTxPower(destination) : this->powerControl->getTxPower(destination);
+
+    this->radio->queueTransmitPacket(priority, frame, txPower);
+    return std::chrono::milliseconds(0);
+}
+
+/**
+ * @brief Transmit a message
+ *
+ * Small messages may be held briefly to be aggregated with other messages to the same node.
+ * Messages that fit into a single frame are otherwise sent as-is; larger messages are split into
+ * fragments, which are reassembled by the receiver.
+ *
+ * @param destination Short address of the node to send to (or a group or the broadcast address)
+ * @param endpoint Endpoint flags for the MAC header
+ * @param priority Transmission priority
+ * @param payload Message payload
+ * @param completion Invoked once the message (all of its fragments) is acknowledged, or failed
+ */
+void Handler::sendMessage(const uint16_t destination,
+        const BlazeNet::Types::Mac::HeaderFlags endpoint, const Radio::PacketPriority priority,
+        std::span<const std::byte> payload, const CompletionCallback &completion) {
+    if(this->aggregator->submit(destination, endpoint, priority, payload, completion)) {
+        return;
+    } else if(payload.size() <= kMaxPayloadSize) {
+        this->sendFrame(destination, endpoint, priority, payload, completion);
+    } else {
+        this->fragmenter->send(destination, endpoint, priority, payload, completion);
+    }
+}
+
+
+
+/**
+ * @brief Process a received frame
+ *
+ * Validate the headers of the frame, then dispatch it based on its endpoint.
+ *
+ * @param frame Frame data (including PHY header)
+ * @param rssi Received signal strength (dB)
+ * @param lqi Link quality indicator
+ */
+void Handler::handleReceivedFrame(std::span<const std::byte> frame, const int8_t rssi,
+        const uint8_t lqi) {
+    using namespace BlazeNet::Types;
+
+    if(frame.size() < kFrameHeaderSize) {
+        PLOG_VERBOSE << "runt frame: " << frame.size() << " bytes";
+        return;
+    }
+
+    // the PHY length must cover the headers, and may not exceed the data received
+    auto phyHdr = reinterpret_cast<const Phy::Header *>(frame.data());
+    if(phyHdr->length + 1U > frame.size() || phyHdr->length + 1U < kFrameHeaderSize) {
+        PLOG_VERBOSE << fmt::format("invalid PHY length ({}, have {})",
+                static_cast<size_t>(phyHdr->length), frame.size());
+        return;
+    }
+
+    // ignore frames not addressed to us
+    auto macHdr = reinterpret_cast<const Mac::Header *>(phyHdr->payload);
+    if(macHdr->destination != this->radio->getAddress() &&
+            macHdr->destination != Mac::kBroadcastAddress) {
+        return;
+    }
+
+    const auto endpoint = macHdr->flags & NetControl::kEndpointMask;
+    const bool isNetControl = (endpoint ==
+            (Mac::HeaderFlags::EndpointNetControl & NetControl::kEndpointMask));
+
+    // verify and decrypt secured frames
+    auto payload = frame.subspan(kFrameHeaderSize, phyHdr->length + 1 - kFrameHeaderSize);
+
+    if(macHdr->flags & Security::kFlagSecured) {
+        if(!this->security->unprotect(frame.first(phyHdr->length + 1), this->rxPlaintext)) {
+            PLOG_VERBOSE << fmt::format("failed to verify frame from ${:04x}",
+                    static_cast<uint16_t>(macHdr->source));
+            return;
+        }
+
+        payload = this->rxPlaintext;
+    }
+    // only association requests (from nodes that don't have an address yet) may be in the clear
+    else if(this->security->isEnabled() && !IsAllowedInClear(*macHdr, payload)) {
+        PLOG_VERBOSE << fmt::format("dropping unsecured frame from ${:04x}",
+                static_cast<uint16_t>(macHdr->source));
+        return;
+    }
+
+    // completes a pending association, if any
+    this->association->handleFrame(macHdr->source);
+
+    if(macHdr->source != NetControl::kUnassignedAddress) {
+        this->linkQuality->update(macHdr->source, lqi, rssi);
+    }
+
+    // dispatch by endpoint
+
+    if(isNetControl) {
+        this->handleNetControl(*macHdr, payload);
+    } else {
+        this->deliverMessage(macHdr->source, static_cast<Mac::HeaderFlags>(macHdr->flags),
+                payload);
+    }
+}
+
+/**
+ * @brief Determine whether a frame may be received in the clear while security is enabled
+ *
+ * Nodes can't secure their association request, since they may not have keys yet; everything
+ * else must be secured. Unsecured frames are checked before any state is touched, so that they
+ * can't complete associations, acknowledge frames, or inject messages.
+ *
+ * @param header MAC header of the frame
+ * @param payload Frame payload
+ */
+bool Handler::IsAllowedInClear(const BlazeNet::Types::Mac::Header &header,
+        std::span<const std::byte> payload) {
+    using namespace BlazeNet::Types;
+
+    if((header.flags & NetControl::kEndpointMask) !=
+            (Mac::HeaderFlags::EndpointNetControl & NetControl::kEndpointMask) ||
+            header.source != NetControl::kUnassignedAddress ||
+            payload.size() < sizeof(NetControl::Header)) {
+        return false;
+    }
+
+    auto ncHdr = reinterpret_cast<const NetControl::Header *>(payload.data());
+    return static_cast<NetControl::MessageType>(ncHdr->type) ==
+        NetControl::MessageType::AssociationRequest;
+}
+
+/**
+ * @brief Process a network control message
+ *
+ * @param header MAC header of the frame that contained the message
+ * @param payload Message payload (starting with the network control header)
+ */
+void Handler::handleNetControl(const BlazeNet::Types::Mac::Header &header,
+        std::span<const std::byte> payload) {
+    if(payload.size() < sizeof(NetControl::Header)) {
+        return;
+    }
+
+    auto ncHdr = reinterpret_cast<const NetControl::Header *>(payload.data());
+    const auto body = payload.subspan(sizeof(*ncHdr));
+
+    switch(static_cast<NetControl::MessageType>(ncHdr->type)) {
+        case NetControl::MessageType::Ack: {
+            auto ack = reinterpret_cast<const NetControl::Ack *>(body.data());
+            if(body.size() < sizeof(*ack) || body.size() < sizeof(*ack) + ack->numSequences) {
+                PLOG_VERBOSE << fmt::format("invalid ack from ${:04x}",
+                        static_cast<uint16_t>(header.source));
+                break;
+            }
+
+            for(size_t i = 0; i < ack->numSequences; i++) {
+                this->retransmitter->handleAck(header.source, ack->sequences[i]);
+            }
+            break;
+        }
+
+        case NetControl::MessageType::Fragment:
+            this->fragmenter->handleFragment(header.source, body);
+            break;
+
+        case NetControl::MessageType::Poll:
+            this->indirect->handlePoll(header.source);
+            break;
+
+        case NetControl::MessageType::AssociationRequest:
+            this->association->handleRequest(header.source, body);
+            break;
+
+        case NetControl::MessageType::Aggregate:
+            this->aggregator->handleAggregate(header.source, body);
+            break;
+
+        case NetControl::MessageType::LinkReport:
+            this->powerControl->handleReport(header.source, body);
+            break;
+
+        case NetControl::MessageType::OtaStatus:
+            this->ota->handleStatus(header.source, body);
+            break;
+
+        default:
+            PLOG_VERBOSE << fmt::format("unhandled net control message ${:02x} from ${:04x}",
+                    static_cast<uint8_t>(ncHdr->type), static_cast<uint16_t>(header.source));
+            break;
+    }
+}
+
+/**
+ * @brief Pass a received message to all message handlers
+ *
+ * @param source Short address of the node that sent the message
+ * @param endpoint Endpoint flags of the message
+ * @param payload Message payload
+ */
+void Handler::deliverMessage(const uint16_t source,
+        const BlazeNet::Types::Mac::HeaderFlags endpoint, std::span<const std::byte> payload) {
+    for(const auto &handler : this->messageHandlers) {
+        handler(source, endpoint, payload);
+    }
 }
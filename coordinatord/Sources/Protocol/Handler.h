@@ -4,14 +4,31 @@
 #include <array>
 #include <chrono>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <span>
 #include <string_view>
 #include <vector>
 
-class Radio;
+#include <BlazeNet/Types.h>
+
+#include "Radio.h"
+#include "Security.h"
 
 namespace Protocol {
+class Aggregator;
+class Association;
 class Beaconator;
+class ChannelMonitor;
+class Fragmenter;
+class GroupTable;
+class IndirectQueue;
+class LinkQuality;
+class OtaDistributor;
+class PowerControl;
+class Retransmitter;
+class Superframe;
 
 /**
  * @brief Low level protocol packet handler
@@ -21,18 +38,233 @@ class Beaconator;
  * been received.
  */
 class Handler {
+    friend class Aggregator;
+    friend class Association;
     friend class Beaconator;
+    friend class ChannelMonitor;
+    friend class Fragmenter;
+    friend class GroupTable;
+    friend class IndirectQueue;
+    friend class OtaDistributor;
+    friend class PowerControl;
+    friend class Retransmitter;
+    friend class Superframe;
+
+    public:
+        /// Maximum size of a frame (including the PHY header)
+        constexpr static const size_t kMaxFrameSize{0xff};
+        /// Size of all headers preceding the payload of a frame
+        constexpr static const size_t kFrameHeaderSize{
+            sizeof(BlazeNet::Types::Phy::Header) + sizeof(BlazeNet::Types::Mac::Header)
+        };
+        /**
+         * @brief Maximum payload size of a single frame
+         *
+         * Room for the security overhead is always reserved, so that the payload size doesn't
+         * depend on whether security is enabled.
+         */
+        constexpr static const size_t kMaxPayloadSize{
+            kMaxFrameSize - kFrameHeaderSize - Security::kOverhead
+        };
+
+        /**
+         * @brief Frame completion callback
+         *
+         * @param success Whether the frame was acknowledged by its destination
+         */
+        using CompletionCallback = std::function<void(const bool success)>;
+
+        /**
+         * @brief What happened to a frame passed to sendFrame()
+         */
+        enum class SendResult: uint8_t {
+            /// Frame was submitted for transmission
+            Queued,
+            /// Destination is asleep; the frame is held until it polls for it
+            Held,
+            /// Destination is a multicast group without members; nothing was sent
+            NoRecipients,
+        };
+
+        /**
+         * @brief Message receive callback
+         *
+         * Invoked for every message received (and reassembled, if needed) that's addressed to an
+         * endpoint other than network control.
+         *
+         * @param source Short address of the node that sent the message
+         * @param endpoint Endpoint flags from the MAC header
+         * @param payload Message payload
+         */
+        using MessageHandler = std::function<void(const uint16_t source,
+                const BlazeNet::Types::Mac::HeaderFlags endpoint,
+                std::span<const std::byte> payload)>;
 
     public:
         Handler(const std::shared_ptr<Radio> &radio);
         ~Handler();
 
+        SendResult sendFrame(const uint16_t destination,
+                const BlazeNet::Types::Mac::HeaderFlags endpoint,
+                const Radio::PacketPriority priority, std::span<const std::byte> payload,
+                const CompletionCallback &completion = {});
+        SendResult sendFrames(const uint16_t destination,
+                const BlazeNet::Types::Mac::HeaderFlags endpoint,
+                const Radio::PacketPriority priority,
+                std::span<const std::span<const std::byte>> payloads,
+                const CompletionCallback &completion = {});
+        void sendMessage(const uint16_t destination,
+                const BlazeNet::Types::Mac::HeaderFlags endpoint,
+                const Radio::PacketPriority priority, std::span<const std::byte> payload,
+                const CompletionCallback &completion = {});
+
+        /**
+         * @brief Register a message handler
+         *
+         * @param handler Function to invoke for each received message
+         */
+        inline void addMessageHandler(const MessageHandler &handler) {
+            this->messageHandlers.emplace_back(handler);
+        }
+
+        /**
+         * @brief Get the downlink message aggregator
+         */
+        inline auto &getAggregator() const {
+            return this->aggregator;
+        }
+        /**
+         * @brief Get the association manager
+         */
+        inline auto &getAssociation() const {
+            return this->association;
+        }
+        /**
+         * @brief Get the channel quality monitor
+         */
+        inline auto &getChannelMonitor() const {
+            return this->channelMonitor;
+        }
+        /**
+         * @brief Get the fragmentation handler
+         */
+        inline auto &getFragmenter() const {
+            return this->fragmenter;
+        }
+        /**
+         * @brief Get the multicast group table
+         */
+        inline auto &getGroups() const {
+            return this->groups;
+        }
+        /**
+         * @brief Get the indirect transmission queue
+         */
+        inline auto &getIndirectQueue() const {
+            return this->indirect;
+        }
+        /**
+         * @brief Get the link layer security handler
+         */
+        inline auto &getSecurity() const {
+            return this->security;
+        }
+        /**
+         * @brief Get the link quality estimator
+         */
+        inline auto &getLinkQuality() const {
+            return this->linkQuality;
+        }
+        /**
+         * @brief Get the firmware distributor
+         */
+        inline auto &getOtaDistributor() const {
+            return this->ota;
+        }
+        /**
+         * @brief Get the transmit power controller
+         */
+        inline auto &getPowerControl() const {
+            return this->powerControl;
+        }
+        /**
+         * @brief Get the retransmission engine
+         */
+        inline auto &getRetransmitter() const {
+            return this->retransmitter;
+        }
+        /**
+         * @brief Get the superframe scheduler
+         */
+        inline auto &getSuperframe() const {
+            return this->superframe;
+        }
+
+    private:
+        void handleReceivedFrame(std::span<const std::byte> frame, const int8_t rssi,
+                const uint8_t lqi);
+        void handleNetControl(const BlazeNet::Types::Mac::Header &header,
+                std::span<const std::byte> payload);
+        void deliverMessage(const uint16_t source, const BlazeNet::Types::Mac::HeaderFlags endpoint,
+                std::span<const std::byte> payload);
+
+        bool hasRecipients(const uint16_t destination);
+        void buildFrame(std::vector<std::byte> &buffer, const uint16_t destination,
+                const BlazeNet::Types::Mac::HeaderFlags endpoint,
+                std::span<const std::byte> payload);
+        SendResult dispatchFrame(const uint16_t destination,
+                const Radio::PacketPriority priority, std::span<const std::byte> frame,
+                const CompletionCallback &completion);
+        std::chrono::milliseconds transmit(const uint16_t destination,
+                const Radio::PacketPriority priority, std::span<const std::byte> frame);
+
+        static bool IsAllowedInClear(const BlazeNet::Types::Mac::Header &header,
+                std::span<const std::byte> payload);
+
     private:
         /// Underlying radio we're communicating with
         std::shared_ptr<Radio> radio;
 
+        /// Link layer security
+        std::shared_ptr<Security> security;
+        /// Node association manager
+        std::shared_ptr<Association> association;
+        /// Per-node link quality estimates
+        std::shared_ptr<LinkQuality> linkQuality;
+        /// Per-node transmit power
+        std::shared_ptr<PowerControl> powerControl;
         /// Beacon manager
         std::shared_ptr<Beaconator> beaconator;
+        /// Superframe (guaranteed time slot) scheduler
+        std::shared_ptr<Superframe> superframe;
+        /// Channel quality monitor and migration
+        std::shared_ptr<ChannelMonitor> channelMonitor;
+        /// Acknowledgement and retransmission engine
+        std::shared_ptr<Retransmitter> retransmitter;
+        /// Fragmentation and reassembly
+        std::shared_ptr<Fragmenter> fragmenter;
+        /// Coalesces small downlink messages
+        std::shared_ptr<Aggregator> aggregator;
+        /// Frames held for sleeping nodes
+        std::shared_ptr<IndirectQueue> indirect;
+        /// Multicast group membership
+        std::shared_ptr<GroupTable> groups;
+        /// Over-the-air firmware distribution
+        std::shared_ptr<OtaDistributor> ota;
+
+        /// Handlers for received messages
+        std::vector<MessageHandler> messageHandlers;
+
+        /// Sequence number for the next outgoing frame
+        uint8_t nextSequence{0};
+        /// Buffer used to assemble outgoing frames
+        std::vector<std::byte> txBuffer;
+        /// Buffers used to assemble trains of outgoing frames (see sendFrames())
+        std::vector<std::vector<std::byte>> txFrames;
+        /// Frames of the train being sent, as they're passed to the security layer
+        std::vector<std::span<std::byte>> txFrameSpans;
+        /// Buffer for the decrypted payload of received secured frames
+        std::vector<std::byte> rxPlaintext;
 };
 }
 
@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include <TristLib/Core.h>
+#include <TristLib/Event.h>
+
+#include "Config/Reader.h"
+#include "Radio.h"
+#include "Handler.h"
+#include "Retransmitter.h"
+#include "IndirectQueue.h"
+
+using namespace Protocol;
+
+/**
+ * @brief Initialize the indirect queue
+ *
+ * Read the configuration, and set up the timer used to discard stale frames.
+ *
+ * @param handler Protocol handler that instantiated us
+ */
+IndirectQueue::IndirectQueue(Handler &handler) : handler(handler) {
+    this->reloadConfig();
+
+    this->tickTimer = std::make_shared<TristLib::Event::Timer>(
+            TristLib::Event::RunLoop::Current(), kTickInterval, [this](auto timer) {
+        this->tick();
+    }, true);
+}
+
+/**
+ * @brief Clean up the indirect queue
+ *
+ * All frames still held are failed.
+ */
+IndirectQueue::~IndirectQueue() {
+    this->tickTimer.reset();
+
+    this->pendingChangedCallback = {};
+    for(auto &[address, node] : this->nodes) {
+        this->fail(node);
+    }
+}
+
+
+
+/**
+ * @brief Read the indirect queue configuration
+ *
+ * All keys are optional, and live in the `protocol.indirect` table of the config file:
+ *
+ * - depth: Maximum number of frames held for a single node
+ * - timeout: Time after which frames that haven't been polled for are discarded (msec)
+ */
+void IndirectQueue::reloadConfig() {
+    const auto &root = Config::GetConfig();
+
+    auto depth = root.at_path(kConfDepth);
+    if(depth && depth.is_integer()) {
+        this->depth = std::max<int64_t>(1, depth.value_or(kDefaultDepth));
+    }
+    auto timeout = root.at_path(kConfTimeout);
+    if(timeout && timeout.is_integer()) {
+        this->timeout = std::chrono::milliseconds(timeout.value_or(kDefaultTimeout.count()));
+    }
+
+    if(this->timeout < kTickInterval) {
+        throw std::runtime_error(fmt::format("invalid `{}`: must be at least {} ms", kConfTimeout,
+                    kTickInterval.count()));
+    }
+
+    PLOG_DEBUG << fmt::format("indirect queue: depth {}, timeout {} ms", this->depth,
+            this->timeout.count());
+}
+
+
+
+/**
+ * @brief Mark a node as sleeping (or awake)
+ *
+ * Frames to sleeping nodes are held until the node polls for them. If a node is marked as awake,
+ * any frames held for it are released immediately.
+ *
+ * @param address Short address of the node
+ * @param sleepy Whether the node is sleeping
+ */
+void IndirectQueue::setSleepy(const uint16_t address, const bool sleepy) {
+    if(sleepy) {
+        this->nodes.try_emplace(address);
+        return;
+    }
+
+    auto it = this->nodes.find(address);
+    if(it == this->nodes.end()) {
+        return;
+    }
+
+    auto node = std::move(it->second);
+    this->nodes.erase(it);
+
+    this->release(address, node);
+}
+
+/**
+ * @brief Forget about a node
+ *
+ * Any frames held for the node are failed. This is used when a node leaves the network; its
+ * address may later be assigned to a different node.
+ *
+ * @param address Short address of the node
+ */
+void IndirectQueue::remove(const uint16_t address) {
+    auto it = this->nodes.find(address);
+    if(it == this->nodes.end()) {
+        return;
+    }
+
+    auto node = std::move(it->second);
+    this->nodes.erase(it);
+
+    if(!node.frames.empty()) {
+        this->removePending(address);
+        this->fail(node);
+    }
+}
+
+/**
+ * @brief Hold a frame for a sleeping node
+ *
+ * If the node's queue is full, the oldest frame is discarded to make room.
+ *
+ * @param destination Short address of the node the frame is addressed to
+ * @param sequence MAC sequence number of the frame
+ * @param priority Priority to transmit the frame at, once released
+ * @param frame Full frame (including PHY header)
+ * @param callback Function to invoke once delivered or failed (may be empty)
+ */
+void IndirectQueue::enqueue(const uint16_t destination, const uint8_t sequence,
+        const Radio::PacketPriority priority, std::span<const std::byte> frame,
+        const CompletionCallback &callback) {
+    auto &node = this->nodes[destination];
+
+    if(node.frames.size() >= this->depth) {
+        auto old = std::move(node.frames.front());
+        node.frames.pop_front();
+
+        this->counters.overflows++;
+        if(old.callback) {
+            old.callback(false);
+        }
+    }
+
+    node.frames.emplace_back(Frame{
+        .queuedAt = std::chrono::steady_clock::now(),
+        .priority = priority,
+        .sequence = sequence,
+        .data = {frame.begin(), frame.end()},
+        .callback = callback,
+    });
+    this->counters.queued++;
+
+    if(node.frames.size() == 1) {
+        this->addPending(destination);
+    }
+}
+
+/**
+ * @brief Process a poll from a node
+ *
+ * Release all frames held for the node to the radio. This also marks the node as sleeping, if it
+ * wasn't already.
+ *
+ * @param source Short address of the node that polled
+ */
+void IndirectQueue::handlePoll(const uint16_t source) {
+    this->counters.polls++;
+
+    auto &node = this->nodes[source];
+    this->release(source, node);
+}
+
+
+
+/**
+ * @brief Transmit all frames held for a node
+ *
+ * Frames are submitted in the order they were queued, the same way as frames to awake nodes: real
+ * time frames for a node with a guaranteed time slot wait for its slot. They're tracked for
+ * acknowledgement from then on.
+ *
+ * @param address Short address of the node
+ * @param node Node state
+ */
+void IndirectQueue::release(const uint16_t address, Node &node) {
+    if(node.frames.empty()) {
+        return;
+    }
+
+    auto frames = std::move(node.frames);
+    node.frames.clear();
+    this->removePending(address);
+
+    for(auto &frame : frames) {
+        const auto holdoff = this->handler.transmit(address, frame.priority, frame.data);
+        this->handler.retransmitter->track(address, frame.sequence, frame.priority, frame.data,
+                frame.callback, holdoff);
+    }
+
+    this->counters.released += frames.size();
+}
+
+/**
+ * @brief Fail all frames held for a node
+ *
+ * @param node Node state
+ */
+void IndirectQueue::fail(Node &node) {
+    auto frames = std::move(node.frames);
+    node.frames.clear();
+
+    for(auto &frame : frames) {
+        if(frame.callback) {
+            frame.callback(false);
+        }
+    }
+}
+
+
+
+/**
+ * @brief Add a node to the pending traffic set
+ *
+ * @param address Short address of the node
+ */
+void IndirectQueue::addPending(const uint16_t address) {
+    auto it = std::lower_bound(this->pendingAddresses.begin(), this->pendingAddresses.end(),
+            address);
+    if(it != this->pendingAddresses.end() && *it == address) {
+        return;
+    }
+
+    this->pendingAddresses.insert(it, address);
+
+    if(this->pendingChangedCallback) {
+        this->pendingChangedCallback(this->pendingAddresses);
+    }
+}
+
+/**
+ * @brief Remove a node from the pending traffic set
+ *
+ * @param address Short address of the node
+ */
+void IndirectQueue::removePending(const uint16_t address) {
+    auto it = std::lower_bound(this->pendingAddresses.begin(), this->pendingAddresses.end(),
+            address);
+    if(it == this->pendingAddresses.end() || *it != address) {
+        return;
+    }
+
+    this->pendingAddresses.erase(it);
+
+    if(this->pendingChangedCallback) {
+        this->pendingChangedCallback(this->pendingAddresses);
+    }
+}
+
+/**
+ * @brief Discard stale frames
+ *
+ * Frames are queued in order, so only the oldest frames of each node with pending traffic need to
+ * be checked.
+ */
+void IndirectQueue::tick() {
+    const auto now = std::chrono::steady_clock::now();
+
+    // copy, since the pending set changes as queues drain
+    const std::vector<uint16_t> addresses(this->pendingAddresses);
+
+    for(const auto address : addresses) {
+        auto &node = this->nodes[address];
+
+        while(!node.frames.empty() && (now - node.frames.front().queuedAt) >= this->timeout) {
+            auto frame = std::move(node.frames.front());
+            node.frames.pop_front();
+
+            this->counters.expired++;
+            if(frame.callback) {
+                frame.callback(false);
+            }
+        }
+
+        if(node.frames.empty()) {
+            PLOG_VERBOSE << fmt::format("indirect frames for ${:04x} expired", address);
+            this->removePending(address);
+        }
+    }
+}
@@ -0,0 +1,181 @@
+#ifndef PROTOCOL_INDIRECTQUEUE_H
+#define PROTOCOL_INDIRECTQUEUE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Radio.h"
+
+namespace TristLib::Event {
+class Timer;
+}
+
+namespace Protocol {
+class Handler;
+
+/**
+ * @brief Indirect transmission queue
+ *
+ * Holds frames addressed to sleeping nodes until the node wakes up and polls for them. The set of
+ * nodes with frames waiting is advertised in the beacon, so nodes only need to stay awake (and
+ * poll) when there's actually something for them.
+ *
+ * A node is considered sleeping once it's polled the coordinator at least once, or it's been
+ * explicitly marked as such.
+ */
+class IndirectQueue {
+    private:
+        /// Config key for the maximum number of frames held per node
+        constexpr static const std::string_view kConfDepth{"protocol.indirect.depth"};
+        /// Config key for the time after which held frames are discarded (msec)
+        constexpr static const std::string_view kConfTimeout{"protocol.indirect.timeout"};
+
+        /// Default maximum number of frames held per node
+        constexpr static const size_t kDefaultDepth{8};
+        /// Default time frames are held for
+        constexpr static const std::chrono::milliseconds kDefaultTimeout{30'000};
+        /// Interval at which held frames are checked for expiration
+        constexpr static const std::chrono::milliseconds kTickInterval{500};
+
+    public:
+        /**
+         * @brief Completion callback
+         *
+         * @param success Whether the frame was delivered to the node
+         */
+        using CompletionCallback = std::function<void(const bool success)>;
+
+        /**
+         * @brief Pending traffic change callback
+         *
+         * Invoked whenever the set of nodes with pending frames changes.
+         *
+         * @param addresses Sorted list of addresses of nodes with pending frames
+         */
+        using PendingChangedCallback = std::function<void(std::span<const uint16_t> addresses)>;
+
+        /**
+         * @brief Indirect queue performance counters
+         */
+        struct Counters {
+            /// Frames placed in a node's queue
+            uint_least64_t queued{0};
+            /// Frames released to the radio after a poll
+            uint_least64_t released{0};
+            /// Frames discarded because they weren't polled for in time
+            uint_least64_t expired{0};
+            /// Frames discarded because the node's queue was full
+            uint_least64_t overflows{0};
+            /// Polls received
+            uint_least64_t polls{0};
+        };
+
+    private:
+        /**
+         * @brief A frame held for a node
+         */
+        struct Frame {
+            /// Time at which the frame was queued
+            std::chrono::steady_clock::time_point queuedAt;
+            /// Priority to transmit at
+            Radio::PacketPriority priority;
+            /// MAC sequence number of the frame
+            uint8_t sequence;
+
+            /// Full frame (including PHY header)
+            std::vector<std::byte> data;
+            /// Function to invoke when delivered or failed
+            CompletionCallback callback;
+        };
+
+        /**
+         * @brief State for a sleeping node
+         */
+        struct Node {
+            /// Frames waiting for the node, oldest first
+            std::deque<Frame> frames;
+        };
+
+    public:
+        IndirectQueue(Handler &handler);
+        ~IndirectQueue();
+
+        void reloadConfig();
+
+        /**
+         * @brief Determine whether frames to a node are held for polling
+         *
+         * @param address Short address of the node
+         */
+        inline bool isSleepy(const uint16_t address) const {
+            return this->nodes.contains(address);
+        }
+        void setSleepy(const uint16_t address, const bool sleepy);
+        void remove(const uint16_t address);
+
+        void enqueue(const uint16_t destination, const uint8_t sequence,
+                const Radio::PacketPriority priority, std::span<const std::byte> frame,
+                const CompletionCallback &callback);
+        void handlePoll(const uint16_t source);
+
+        /**
+         * @brief Set the callback invoked when the pending traffic set changes
+         */
+        inline void setPendingChangedCallback(const PendingChangedCallback &callback) {
+            this->pendingChangedCallback = callback;
+        }
+        /**
+         * @brief Get the sorted list of nodes with pending frames
+         */
+        inline std::span<const uint16_t> getPendingAddresses() const {
+            return this->pendingAddresses;
+        }
+        /**
+         * @brief Get the performance counters
+         */
+        inline const auto &getCounters() const {
+            return this->counters;
+        }
+
+    private:
+        void release(const uint16_t address, Node &node);
+        void fail(Node &node);
+
+        void addPending(const uint16_t address);
+        void removePending(const uint16_t address);
+
+        void tick();
+
+    private:
+        /// Handle to the protocol handler that owns us
+        Handler &handler;
+
+        /// Maximum number of frames held per node
+        size_t depth{kDefaultDepth};
+        /// Time after which a held frame is discarded
+        std::chrono::milliseconds timeout{kDefaultTimeout};
+
+        /// All sleeping nodes, keyed by short address
+        std::unordered_map<uint16_t, Node> nodes;
+        /// Addresses of all nodes that have frames waiting (sorted)
+        std::vector<uint16_t> pendingAddresses;
+        /// Invoked when the pending traffic set changes
+        PendingChangedCallback pendingChangedCallback;
+
+        /// Event loop timer to expire old frames
+        std::shared_ptr<TristLib::Event::Timer> tickTimer;
+
+        /// Performance counters
+        Counters counters{};
+};
+}
+
+#endif
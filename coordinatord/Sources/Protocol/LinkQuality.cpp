@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include <TristLib/Core.h>
+
+#include "Config/Reader.h"
+#include "LinkQuality.h"
+
+using namespace Protocol;
+
+/**
+ * @brief Initialize the link quality estimator
+ *
+ * @param handler Protocol handler that instantiated us
+ */
+LinkQuality::LinkQuality(Handler &handler) : handler(handler) {
+    this->reloadConfig();
+}
+
+/**
+ * @brief Read the link quality configuration
+ *
+ * All keys are optional, and live in the `protocol.linkQuality` table of the config file:
+ *
+ * - alpha: Smoothing factor of the moving average, in (0, 1]
+ * - weak: Average LQI below which a link is considered weak
+ * - poor: Average LQI below which a link is considered poor
+ */
+void LinkQuality::reloadConfig() {
+    const auto &root = Config::GetConfig();
+
+    auto alpha = root.at_path(kConfAlpha);
+    if(alpha && alpha.is_number()) {
+        this->alpha = alpha.value_or(kDefaultAlpha);
+    }
+    auto weak = root.at_path(kConfWeak);
+    if(weak && weak.is_number()) {
+        this->weakThreshold = weak.value_or(kDefaultWeak);
+    }
+    auto poor = root.at_path(kConfPoor);
+    if(poor && poor.is_number()) {
+        this->poorThreshold = poor.value_or(kDefaultPoor);
+    }
+
+    if(this->alpha <= 0.f || this->alpha > 1.f) {
+        throw std::runtime_error(fmt::format("invalid `{}`: must be in (0, 1]", kConfAlpha));
+    } else if(this->poorThreshold > this->weakThreshold) {
+        throw std::runtime_error(fmt::format("invalid `{}`: must not exceed `{}`", kConfPoor,
+                    kConfWeak));
+    }
+}
+
+
+
+/**
+ * @brief Record a received frame
+ *
+ * @param address Short address of the node the frame was received from
+ * @param lqi Link quality indicator of the frame
+ * @param rssi Received signal strength of the frame (dB)
+ */
+void LinkQuality::update(const uint16_t address, const uint8_t lqi, const int8_t rssi) {
+    size_t slot;
+
+    if(auto it = this->slots.find(address); it != this->slots.end()) {
+        slot = it->second;
+    } else {
+        if(this->addresses.size() >= kMaxNodes) {
+            return;
+        }
+
+        slot = this->addresses.size();
+        this->slots.emplace(address, slot);
+
+        this->addresses.push_back(address);
+        this->ewma.push_back(lqi);
+        this->window.resize(this->window.size() + kWindowSize, 0);
+        this->windowSum.push_back(0);
+        this->windowCount.push_back(0);
+        this->windowPos.push_back(0);
+        this->lastRssi.push_back(rssi);
+        this->numFrames.push_back(0);
+    }
+
+    // moving average
+    this->ewma[slot] += this->alpha * (static_cast<float>(lqi) - this->ewma[slot]);
+
+    // window (evicting the oldest sample once full)
+    auto &pos = this->windowPos[slot];
+    auto &sample = this->window[(slot * kWindowSize) + pos];
+
+    if(this->windowCount[slot] == kWindowSize) {
+        this->windowSum[slot] -= sample;
+    } else {
+        this->windowCount[slot]++;
+    }
+
+    sample = lqi;
+    this->windowSum[slot] += lqi;
+    pos = (pos + 1) % kWindowSize;
+
+    this->lastRssi[slot] = rssi;
+    this->numFrames[slot]++;
+}
+
+/**
+ * @brief Stop tracking a node
+ *
+ * @param address Short address of the node
+ */
+void LinkQuality::remove(const uint16_t address) {
+    auto it = this->slots.find(address);
+    if(it == this->slots.end()) {
+        return;
+    }
+
+    const auto slot = it->second, last = this->addresses.size() - 1;
+    this->slots.erase(it);
+
+    // move the last slot into the hole
+    if(slot != last) {
+        this->addresses[slot] = this->addresses[last];
+        this->ewma[slot] = this->ewma[last];
+        std::copy_n(this->window.begin() + (last * kWindowSize), kWindowSize,
+                this->window.begin() + (slot * kWindowSize));
+        this->windowSum[slot] = this->windowSum[last];
+        this->windowCount[slot] = this->windowCount[last];
+        this->windowPos[slot] = this->windowPos[last];
+        this->lastRssi[slot] = this->lastRssi[last];
+        this->numFrames[slot] = this->numFrames[last];
+
+        this->slots[this->addresses[slot]] = slot;
+    }
+
+    this->addresses.pop_back();
+    this->ewma.pop_back();
+    this->window.resize(last * kWindowSize);
+    this->windowSum.pop_back();
+    this->windowCount.pop_back();
+    this->windowPos.pop_back();
+    this->lastRssi.pop_back();
+    this->numFrames.pop_back();
+}
+
+
+
+/**
+ * @brief Classify the link to a node
+ *
+ * The link is rated by the lower of its moving and window averages, so that a sudden drop is
+ * noticed quickly, while a single good frame doesn't hide a bad link.
+ *
+ * @param address Short address of the node
+ */
+LinkQuality::Quality LinkQuality::getQuality(const uint16_t address) const {
+    auto it = this->slots.find(address);
+    if(it == this->slots.end()) {
+        return Quality::Unknown;
+    }
+
+    const auto slot = it->second;
+    const auto count = this->windowCount[slot];
+    if(count < kMinSamples) {
+        return Quality::Unknown;
+    }
+
+    const float average = std::min(this->ewma[slot],
+            static_cast<float>(this->windowSum[slot]) / count);
+
+    if(average < this->poorThreshold) {
+        return Quality::Poor;
+    } else if(average < this->weakThreshold) {
+        return Quality::Weak;
+    }
+    return Quality::Good;
+}
+
+/**
+ * @brief Count the nodes whose moving average is below a threshold
+ *
+ * @param threshold LQI threshold
+ */
+size_t LinkQuality::countBelow(const float threshold) const {
+    size_t count{0};
+    for(const auto value : this->ewma) {
+        count += (value < threshold);
+    }
+    return count;
+}
@@ -0,0 +1,165 @@
+#ifndef PROTOCOL_LINKQUALITY_H
+#define PROTOCOL_LINKQUALITY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Protocol {
+class Handler;
+
+/**
+ * @brief Per-node link quality estimator
+ *
+ * Tracks the link quality indicator (LQI) of frames received from each node, as both an
+ * exponentially weighted moving average and a plain average over the most recent frames.
+ *
+ * The table is stored as a struct of arrays, indexed by a dense slot number per node, so that
+ * scans over the entire table (and exporting it) touch only the fields they need. Removing a node
+ * moves the last slot into its place.
+ */
+class LinkQuality {
+    private:
+        /// Config key for the EWMA smoothing factor
+        constexpr static const std::string_view kConfAlpha{"protocol.linkQuality.alpha"};
+        /// Config key for the LQI below which a link is considered weak
+        constexpr static const std::string_view kConfWeak{"protocol.linkQuality.weak"};
+        /// Config key for the LQI below which a link is considered poor
+        constexpr static const std::string_view kConfPoor{"protocol.linkQuality.poor"};
+
+        /// Default EWMA smoothing factor
+        constexpr static const float kDefaultAlpha{0.125f};
+        /// Default threshold for weak links
+        constexpr static const float kDefaultWeak{128.f};
+        /// Default threshold for poor links
+        constexpr static const float kDefaultPoor{64.f};
+
+        /// Maximum number of nodes tracked
+        constexpr static const size_t kMaxNodes{4096};
+        /// Minimum number of samples before a link is classified
+        constexpr static const size_t kMinSamples{4};
+
+    public:
+        /// Number of frames in the averaging window
+        constexpr static const size_t kWindowSize{16};
+
+        /**
+         * @brief Link quality classification
+         */
+        enum class Quality: uint8_t {
+            /// Not enough frames have been received to tell
+            Unknown,
+            /// The link is reliable
+            Good,
+            /// Frames are likely to need retransmission
+            Weak,
+            /// Frames are likely to be lost regardless of retransmissions
+            Poor,
+        };
+
+    public:
+        LinkQuality(Handler &handler);
+
+        void reloadConfig();
+
+        void update(const uint16_t address, const uint8_t lqi, const int8_t rssi);
+        void remove(const uint16_t address);
+
+        Quality getQuality(const uint16_t address) const;
+        size_t countBelow(const float threshold) const;
+
+        /**
+         * @brief Get the number of nodes tracked
+         */
+        inline size_t size() const {
+            return this->addresses.size();
+        }
+        /**
+         * @brief Get the threshold below which links are weak
+         */
+        constexpr inline float getWeakThreshold() const {
+            return this->weakThreshold;
+        }
+        /**
+         * @brief Get the threshold below which links are poor
+         */
+        constexpr inline float getPoorThreshold() const {
+            return this->poorThreshold;
+        }
+
+        /**
+         * @brief Get the slot of a node
+         *
+         * @return Slot index, or nothing if the node isn't tracked
+         */
+        inline std::optional<size_t> getSlot(const uint16_t address) const {
+            auto it = this->slots.find(address);
+            if(it == this->slots.end()) {
+                return std::nullopt;
+            }
+            return it->second;
+        }
+
+        /// Get the address of each slot
+        inline std::span<const uint16_t> getAddresses() const {
+            return this->addresses;
+        }
+        /// Get the LQI moving average of each slot
+        inline std::span<const float> getEwma() const {
+            return this->ewma;
+        }
+        /// Get the sum of the LQI values in each slot's window
+        inline std::span<const uint16_t> getWindowSums() const {
+            return this->windowSum;
+        }
+        /// Get the number of samples in each slot's window
+        inline std::span<const uint8_t> getWindowCounts() const {
+            return this->windowCount;
+        }
+        /// Get the RSSI of the most recent frame of each slot
+        inline std::span<const int8_t> getLastRssi() const {
+            return this->lastRssi;
+        }
+        /// Get the number of frames received from each slot
+        inline std::span<const uint32_t> getNumFrames() const {
+            return this->numFrames;
+        }
+
+    private:
+        /// Handle to the protocol handler that owns us
+        Handler &handler;
+
+        /// EWMA smoothing factor
+        float alpha{kDefaultAlpha};
+        /// Average LQI below which a link is weak
+        float weakThreshold{kDefaultWeak};
+        /// Average LQI below which a link is poor
+        float poorThreshold{kDefaultPoor};
+
+        /// Slot index of each node, by address
+        std::unordered_map<uint16_t, size_t> slots;
+
+        /// Node address
+        std::vector<uint16_t> addresses;
+        /// Moving average of the LQI
+        std::vector<float> ewma;
+        /// Most recent LQI samples (kWindowSize per slot)
+        std::vector<uint8_t> window;
+        /// Sum of the samples in the window
+        std::vector<uint16_t> windowSum;
+        /// Number of valid samples in the window
+        std::vector<uint8_t> windowCount;
+        /// Index in the window to write the next sample to
+        std::vector<uint8_t> windowPos;
+        /// RSSI of the most recent frame
+        std::vector<int8_t> lastRssi;
+        /// Total frames received
+        std::vector<uint32_t> numFrames;
+};
+}
+
+#endif
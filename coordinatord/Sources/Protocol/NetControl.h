@@ -0,0 +1,444 @@
+/**
+ * @file
+ *
+ * @brief Network control message formats
+ *
+ * Defines the structure of messages sent to the network control endpoint. Each of these messages
+ * immediately follows the MAC header, and starts with a one byte message type.
+ *
+ * @remark All multibyte values are sent in little endian byte order
+ */
+#ifndef PROTOCOL_NETCONTROL_H
+#define PROTOCOL_NETCONTROL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Protocol::NetControl {
+/**
+ * @brief Mask for the endpoint field in the MAC header flags
+ *
+ * Used to decide which endpoint a received frame is addressed to.
+ */
+constexpr static const uint16_t kEndpointMask{0x000F};
+
+/**
+ * @brief Network control message types
+ */
+enum class MessageType: uint8_t {
+    /**
+     * @brief Acknowledgement
+     *
+     * Sent by a node to acknowledge receipt of one or more unicast frames.
+     *
+     * @seeAlso Ack
+     */
+    Ack                                         = 0x01,
+
+    /**
+     * @brief Message fragment
+     *
+     * Carries a part of a message that was too large to fit in a single frame.
+     *
+     * @seeAlso Fragment
+     */
+    Fragment                                    = 0x02,
+
+    /**
+     * @brief Data poll
+     *
+     * Sent by a sleeping node after it wakes up, to request any frames the coordinator is holding
+     * for it. The message has no payload.
+     */
+    Poll                                        = 0x03,
+
+    /**
+     * @brief Association request
+     *
+     * Sent by a node that wishes to join the network. Since it doesn't have a short address yet,
+     * the frame is sent from kUnassignedAddress.
+     *
+     * @seeAlso AssociationRequest
+     */
+    AssociationRequest                          = 0x04,
+
+    /**
+     * @brief Association response
+     *
+     * Sent by the coordinator (to the broadcast address) in reply to an association request. The
+     * node identifies it by its EUI-64.
+     *
+     * @seeAlso AssociationResponse
+     */
+    AssociationResponse                         = 0x05,
+
+    /**
+     * @brief Aggregated messages
+     *
+     * Carries several small messages to the same node in a single frame. Each message is prefixed
+     * with an AggregateEntry header.
+     *
+     * @seeAlso AggregateEntry
+     */
+    Aggregate                                   = 0x06,
+
+    /**
+     * @brief Link report
+     *
+     * Sent periodically by a node to report how well it receives the coordinator's beacons. Used
+     * to adjust the transmit power for frames sent to the node.
+     *
+     * @seeAlso LinkReport
+     */
+    LinkReport                                  = 0x07,
+
+    /**
+     * @brief Group membership change
+     *
+     * Sent by the coordinator to tell a node that it was added to, or removed from, a multicast
+     * group. Nodes accept frames sent to the address of any group they're a member of.
+     *
+     * @seeAlso GroupMembership
+     */
+    GroupMembership                             = 0x08,
+
+    /**
+     * @brief Firmware image announcement
+     *
+     * Sent by the coordinator (usually to a multicast group) to describe the firmware image that
+     * is being distributed, and optionally, to ask nodes to report which blocks they're missing.
+     *
+     * @seeAlso OtaAnnounce
+     */
+    OtaAnnounce                                 = 0x09,
+
+    /**
+     * @brief Firmware image block
+     *
+     * Carries a single block of a firmware image.
+     *
+     * @seeAlso OtaBlock
+     */
+    OtaBlock                                    = 0x0A,
+
+    /**
+     * @brief Firmware download status
+     *
+     * Sent by a node in response to an announcement that requests status, to report which blocks
+     * of the image it's still missing.
+     *
+     * @seeAlso OtaStatus
+     */
+    OtaStatus                                   = 0x0B,
+};
+
+/**
+ * @brief Source address used by nodes that haven't been assigned a short address
+ */
+constexpr static const uint16_t kUnassignedAddress{0xFFFE};
+
+/**
+ * @brief First short address reserved for multicast groups
+ */
+constexpr static const uint16_t kFirstGroupAddress{0xFF00};
+/**
+ * @brief Last short address reserved for multicast groups
+ */
+constexpr static const uint16_t kLastGroupAddress{0xFFFD};
+
+/**
+ * @brief Determine whether a short address is a multicast group address
+ */
+constexpr static inline bool IsGroupAddress(const uint16_t address) {
+    return address >= kFirstGroupAddress && address <= kLastGroupAddress;
+}
+
+/**
+ * @brief Node capabilities
+ *
+ * Sent as part of the association request.
+ */
+enum AssociationCapabilities: uint8_t {
+    /// The node sleeps, and will poll for frames
+    Sleepy                                      = (1 << 0),
+    /// The node carries real time traffic, and wants a guaranteed time slot
+    RealTime                                    = (1 << 1),
+};
+
+/**
+ * @brief Association status
+ */
+enum class AssociationStatus: uint8_t {
+    /// The node was associated, and assigned the short address in the response
+    Success                                     = 0x00,
+    /// New nodes may not currently join the network
+    PairingDisabled                             = 0x01,
+    /// No more short addresses are available
+    NetworkFull                                 = 0x02,
+};
+
+/**
+ * @brief Beacon extension types
+ *
+ * Beacon frames may carry any number of extensions after the beacon header. Each starts with a
+ * BeaconExtension header; nodes skip extensions they don't understand.
+ */
+enum class BeaconExtensionType: uint8_t {
+    /**
+     * @brief Pending traffic map
+     *
+     * Lists the short addresses of all sleeping nodes the coordinator is holding frames for. The
+     * extension payload is an array of 16-bit addresses, sorted in ascending order.
+     */
+    PendingTraffic                              = 0x01,
+
+    /**
+     * @brief Channel switch announcement
+     *
+     * Announces that the network is about to move to a different channel.
+     *
+     * @seeAlso ChannelSwitch
+     */
+    ChannelSwitch                               = 0x02,
+
+    /**
+     * @brief Superframe structure
+     *
+     * Describes how the beacon interval is divided into guaranteed time slots and the contention
+     * access period. Only present if superframe mode is enabled.
+     *
+     * @seeAlso Superframe
+     */
+    Superframe                                  = 0x03,
+};
+
+/**
+ * @brief Network control message header
+ */
+struct Header {
+    /// Message type
+    uint8_t type;
+
+    /// Message payload
+    uint8_t payload[];
+} __attribute__((packed));
+
+/**
+ * @brief Beacon extension header
+ */
+struct BeaconExtension {
+    /// Extension type
+    uint8_t type;
+    /// Length of the extension payload (bytes)
+    uint8_t length;
+
+    /// Extension payload
+    uint8_t payload[];
+} __attribute__((packed));
+
+/**
+ * @brief Channel switch announcement
+ *
+ * Payload of the channel switch beacon extension. The coordinator moves to the new channel the
+ * given number of beacon intervals after the beacon carrying the announcement; nodes should do the
+ * same.
+ */
+struct ChannelSwitch {
+    /// Channel the network is moving to
+    uint16_t channel;
+    /// Number of beacons remaining before the switch
+    uint8_t beaconsRemaining;
+} __attribute__((packed));
+
+/**
+ * @brief Superframe structure
+ *
+ * Payload of the superframe beacon extension. Each beacon interval starts with the beacon, and a
+ * guard time during which nothing else is transmitted. It's followed by the guaranteed time slots
+ * (one per node listed in this extension, in order), and then the contention access period. This
+ * lasts until one guard time before the next beacon.
+ *
+ * The coordinator transmits to a node only in its slot, as well as accepting frames from the node
+ * at any time in its slot. All other traffic must be sent in the contention access period.
+ */
+struct Superframe {
+    /// Guard time following (and preceding) the beacon (in ms)
+    uint8_t guardTime;
+    /// Duration of each guaranteed time slot (in ms)
+    uint8_t slotDuration;
+    /// Number of guaranteed time slots
+    uint8_t numSlots;
+
+    /// Short address of the node owning each slot
+    uint16_t slots[];
+} __attribute__((packed));
+
+/**
+ * @brief Acknowledgement message
+ *
+ * Acknowledges one or more frames previously sent by the coordinator. Each frame is identified by
+ * its MAC sequence number; the node is identified by the source address of the frame carrying
+ * the acknowledgement.
+ */
+struct Ack {
+    /// Number of sequence numbers that follow
+    uint8_t numSequences;
+
+    /// Sequence numbers of the acknowledged frames
+    uint8_t sequences[];
+} __attribute__((packed));
+
+/**
+ * @brief Association request message
+ */
+struct AssociationRequest {
+    /// EUI-64 of the node
+    uint8_t eui64[8];
+    /// Node capabilities (see AssociationCapabilities)
+    uint8_t capabilities;
+} __attribute__((packed));
+
+/**
+ * @brief Association response message
+ */
+struct AssociationResponse {
+    /// EUI-64 of the node this response is for
+    uint8_t eui64[8];
+    /// Association status (see AssociationStatus)
+    uint8_t status;
+    /// Short address assigned to the node (only valid if successful)
+    uint16_t address;
+} __attribute__((packed));
+
+/**
+ * @brief Aggregated message entry
+ *
+ * Precedes each message in an aggregate frame. Entries follow each other back to back until the
+ * end of the frame.
+ */
+struct AggregateEntry {
+    /// MAC header endpoint flags of the message
+    uint16_t endpoint;
+    /// Length of the message (bytes)
+    uint8_t length;
+
+    /// Message data
+    uint8_t data[];
+} __attribute__((packed));
+
+/**
+ * @brief Message fragment
+ *
+ * Messages too large to fit in a single frame are split into up to 64 fragments. All fragments of
+ * a message share the same message id, which is unique per source node. The receiver reassembles
+ * the message once all fragments have been received, then processes it as if it had been received
+ * in a single frame addressed to the original endpoint.
+ */
+struct Fragment {
+    /// Message identifier
+    uint16_t messageId;
+    /// Index of this fragment
+    uint8_t index;
+    /// Total number of fragments in the message
+    uint8_t count;
+    /// Total length of the message (bytes)
+    uint16_t totalLength;
+    /// MAC header endpoint flags of the original message
+    uint16_t endpoint;
+
+    /// Fragment data
+    uint8_t data[];
+} __attribute__((packed));
+
+/**
+ * @brief Link report
+ *
+ * Describes the most recent beacon received by the node. Since beacons are always sent at the
+ * configured (maximum) transmit power, this lets the coordinator estimate the path loss to the
+ * node.
+ */
+struct LinkReport {
+    /// Received signal strength of the beacon (dBm)
+    int8_t beaconRssi;
+    /// Link quality indicator of the beacon
+    uint8_t beaconLqi;
+} __attribute__((packed));
+
+/**
+ * @brief Group membership change
+ */
+struct GroupMembership {
+    /// Address of the multicast group
+    uint16_t group;
+    /// Whether the node is now a member of the group (1) or not (0)
+    uint8_t member;
+} __attribute__((packed));
+
+/**
+ * @brief Firmware announcement flags
+ */
+enum OtaAnnounceFlags: uint8_t {
+    /**
+     * @brief Nodes should report their status
+     *
+     * All nodes that received the announcement should reply with an OtaStatus message. Since
+     * this is sent to many nodes at once, each should delay its reply by a random time of up to
+     * the report window given in the announcement.
+     */
+    StatusRequest                               = (1 << 0),
+};
+
+/**
+ * @brief Firmware image announcement
+ *
+ * Describes a firmware image being distributed. All blocks except the last are `blockSize` bytes
+ * long.
+ */
+struct OtaAnnounce {
+    /// Identifier of this distribution session
+    uint16_t imageId;
+    /// Flags (see OtaAnnounceFlags)
+    uint8_t flags;
+    /// Size of each block (bytes)
+    uint8_t blockSize;
+    /// Total size of the image (bytes)
+    uint32_t imageSize;
+    /// Total number of blocks in the image
+    uint16_t numBlocks;
+    /// Time over which status replies should be spread (in 10ms units)
+    uint8_t reportWindow;
+} __attribute__((packed));
+
+/**
+ * @brief Firmware image block
+ */
+struct OtaBlock {
+    /// Identifier of the distribution session
+    uint16_t imageId;
+    /// Index of the block
+    uint16_t block;
+
+    /// Block data
+    uint8_t data[];
+} __attribute__((packed));
+
+/**
+ * @brief Firmware download status
+ *
+ * Reports the missing blocks in a window starting at the node's first missing block; all blocks
+ * before it have been received. Blocks past the end of the bitmap are assumed to be missing. A
+ * node that has received the entire image reports its first missing block as `numBlocks`, with no
+ * bitmap.
+ */
+struct OtaStatus {
+    /// Identifier of the distribution session
+    uint16_t imageId;
+    /// Index of the first block that wasn't received yet
+    uint16_t firstMissing;
+
+    /// Bitmap of missing blocks (LSB first), starting at `firstMissing`
+    uint8_t missing[];
+} __attribute__((packed));
+}
+
+#endif
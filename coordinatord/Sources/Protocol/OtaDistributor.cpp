@@ -0,0 +1,584 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <BlazeNet/Types.h>
+#include <fmt/format.h>
+
+#include <TristLib/Core.h>
+#include <TristLib/Event.h>
+
+#include "Config/Reader.h"
+#include "Support/MappedFile.h"
+#include "Radio.h"
+#include "GroupTable.h"
+#include "Handler.h"
+#include "NetControl.h"
+#include "OtaDistributor.h"
+
+using namespace Protocol;
+
+/// Number of blocks per bitmap word
+constexpr static const size_t kBitsPerWord{64};
+
+/**
+ * @brief Test a bit in a block bitmap
+ */
+static inline bool TestBit(const std::vector<uint64_t> &bitmap, const size_t bit) {
+    return bitmap[bit / kBitsPerWord] & (1ULL << (bit % kBitsPerWord));
+}
+
+/**
+ * @brief Initialize the firmware distributor
+ *
+ * @param handler Protocol handler that instantiated us
+ */
+OtaDistributor::OtaDistributor(Handler &handler) : handler(handler) {
+    static_assert(sizeof(NetControl::Header) + sizeof(NetControl::OtaBlock) + kBlockSize
+            <= Handler::kMaxPayloadSize, "OTA block does not fit in a frame");
+
+    this->txBuffer.reserve(Handler::kMaxPayloadSize);
+
+    this->reloadConfig();
+}
+
+/**
+ * @brief Clean up the firmware distributor
+ *
+ * Any distribution in progress is abandoned.
+ */
+OtaDistributor::~OtaDistributor() {
+    this->paceTimer.reset();
+}
+
+
+
+/**
+ * @brief Read the firmware distribution configuration
+ *
+ * All keys are optional, and live in the `protocol.ota` table of the config file:
+ *
+ * - imageDir: Directory from which firmware images are read
+ * - maxQueued: Blocks are only sent while fewer packets than this wait for transmission
+ * - burst: Maximum number of blocks sent every 20 ms
+ * - reportWindow: Time over which nodes spread their status reports (msec, max 2550)
+ * - maxRounds: Rounds after which the distribution is ended, even if nodes are incomplete
+ * - maxMissedReports: Consecutive missed status reports after which a node is given up on
+ */
+void OtaDistributor::reloadConfig() {
+    const auto &root = Config::GetConfig();
+
+    auto imageDir = root.at_path(kConfImageDir);
+    if(imageDir && imageDir.is_string()) {
+        this->imageDir = imageDir.value_or(std::string(kDefaultImageDir));
+    }
+
+    auto maxQueued = root.at_path(kConfMaxQueued);
+    if(maxQueued && maxQueued.is_integer()) {
+        this->maxQueued = std::max<int64_t>(1, maxQueued.value_or(kDefaultMaxQueued));
+    }
+    auto burst = root.at_path(kConfBurst);
+    if(burst && burst.is_integer()) {
+        this->burst = std::max<int64_t>(1, burst.value_or(kDefaultBurst));
+    }
+
+    auto window = root.at_path(kConfReportWindow);
+    if(window && window.is_integer()) {
+        this->reportWindow = std::chrono::milliseconds(window.value_or(
+                    kDefaultReportWindow.count()));
+    }
+    if(this->reportWindow.count() < 10 || this->reportWindow.count() > 2550) {
+        throw std::runtime_error(fmt::format("invalid `{}`: must be between 10 and 2550 ms",
+                    kConfReportWindow));
+    }
+
+    auto maxRounds = root.at_path(kConfMaxRounds);
+    if(maxRounds && maxRounds.is_integer()) {
+        this->maxRounds = std::max<int64_t>(1, maxRounds.value_or(kDefaultMaxRounds));
+    }
+    auto maxMissed = root.at_path(kConfMaxMissedReports);
+    if(maxMissed && maxMissed.is_integer()) {
+        this->maxMissedReports = std::max<int64_t>(1, maxMissed.value_or(
+                    kDefaultMaxMissedReports));
+    }
+
+    PLOG_DEBUG << fmt::format("ota: images from `{}`, burst {}, max queued {}, {} rounds",
+            this->imageDir.string(), this->burst, this->maxQueued, this->maxRounds);
+}
+
+
+
+/**
+ * @brief Start distributing a firmware image
+ *
+ * The image is mapped, and a multicast group created for the target nodes.
+ *
+ * @param name File name of the image (in the image directory)
+ * @param nodes Short addresses of the nodes to update
+ *
+ * @return Identifier of the distribution session
+ */
+uint16_t OtaDistributor::start(const std::string_view name, std::span<const uint16_t> nodes) {
+    if(this->isActive()) {
+        throw std::runtime_error("a firmware distribution is already in progress");
+    } else if(name.empty() || name.find('/') != std::string_view::npos || name.front() == '.') {
+        throw std::invalid_argument(fmt::format("invalid image name `{}`", name));
+    } else if(nodes.empty()) {
+        throw std::invalid_argument("no nodes to update");
+    }
+
+    auto image = std::make_unique<Support::MappedFile>(this->imageDir / name);
+    if(image->getSize() > kMaxImageSize) {
+        throw std::invalid_argument(fmt::format("image too large ({} bytes, max {})",
+                    image->getSize(), kMaxImageSize));
+    }
+
+    // set up a group containing all target nodes
+    auto &groups = this->handler.groups;
+    const auto group = groups->create();
+    if(!group) {
+        throw std::runtime_error("no free group addresses");
+    }
+
+    try {
+        for(const auto address : nodes) {
+            groups->add(*group, address);
+        }
+    } catch(const std::exception &) {
+        groups->destroy(*group);
+        throw;
+    }
+
+    // set up the session; initially, all nodes are missing all blocks
+    const size_t imageSize = image->getSize();
+    const size_t numBlocks = (imageSize + kBlockSize - 1) / kBlockSize;
+    const size_t numWords = (numBlocks + kBitsPerWord - 1) / kBitsPerWord;
+
+    Node node{
+        .missing = std::vector<uint64_t>(numWords, ~0ULL),
+        .numMissing = numBlocks,
+    };
+    if(numBlocks % kBitsPerWord) {
+        node.missing.back() = (1ULL << (numBlocks % kBitsPerWord)) - 1;
+    }
+
+    this->session.emplace(Session{
+        .imageId = this->nextImageId++,
+        .name = std::string(name),
+        .image = std::move(image),
+        .imageSize = imageSize,
+        .numBlocks = numBlocks,
+        .group = *group,
+        .started = std::chrono::steady_clock::now(),
+    });
+
+    auto &s = *this->session;
+    for(const auto address : nodes) {
+        s.nodes.emplace(address, node);
+    }
+
+    PLOG_INFO << fmt::format("ota: distributing `{}` ({} bytes, {} blocks) to {} nodes as ${:04x}",
+            s.name, s.imageSize, s.numBlocks, s.nodes.size(), s.imageId);
+
+    this->startRound();
+    this->armTimer();
+
+    return s.imageId;
+}
+
+/**
+ * @brief Abort the distribution in progress
+ */
+void OtaDistributor::abort() {
+    if(!this->isActive()) {
+        return;
+    }
+
+    for(auto &[address, node] : this->session->nodes) {
+        if(node.state == NodeState::Downloading) {
+            node.state = NodeState::Failed;
+        }
+    }
+
+    PLOG_INFO << fmt::format("ota: distribution ${:04x} aborted", this->session->imageId);
+    this->finish();
+}
+
+
+
+/**
+ * @brief Process a status report from a node
+ *
+ * Update the node's missing block bitmap. The window covered by the report is replaced with the
+ * node's view; all blocks before it are marked as received, and all blocks after it as missing.
+ * Once no node needs any more blocks, the distribution ends right away.
+ *
+ * @param source Address of the node that sent the report
+ * @param payload Status message (following the network control header)
+ */
+void OtaDistributor::handleStatus(const uint16_t source, std::span<const std::byte> payload) {
+    if(!this->isActive() || payload.size() < sizeof(NetControl::OtaStatus)) {
+        return;
+    }
+
+    auto &s = *this->session;
+    auto status = reinterpret_cast<const NetControl::OtaStatus *>(payload.data());
+    if(status->imageId != s.imageId) {
+        return;
+    }
+
+    auto it = s.nodes.find(source);
+    if(it == s.nodes.end() || it->second.state != NodeState::Downloading) {
+        return;
+    }
+    auto &node = it->second;
+
+    // blocks past the end of the bitmap haven't been received yet either
+    const size_t firstMissing = std::min<size_t>(status->firstMissing, s.numBlocks);
+    const auto bitmap = payload.subspan(sizeof(*status));
+    const size_t windowEnd = firstMissing + (bitmap.size() * 8);
+
+    for(size_t block = 0; block < s.numBlocks; block++) {
+        auto &word = node.missing[block / kBitsPerWord];
+        const auto mask = 1ULL << (block % kBitsPerWord);
+
+        bool missing{block >= windowEnd};
+        if(block >= firstMissing && block < windowEnd) {
+            const auto bit = block - firstMissing;
+            missing = (static_cast<uint8_t>(bitmap[bit / 8]) >> (bit % 8)) & 1;
+        }
+
+        if((word & mask) && !missing) {
+            word &= ~mask;
+            node.numMissing--;
+            s.blocksDelivered++;
+        } else if(!(word & mask) && missing) {
+            word |= mask;
+            node.numMissing++;
+        }
+    }
+
+    node.reported = true;
+    node.missedReports = 0;
+
+    if(!node.numMissing) {
+        node.state = NodeState::Complete;
+        PLOG_INFO << fmt::format("ota: node ${:04x} received image ${:04x}", source, s.imageId);
+
+        // no need to finish the round if nobody needs any more blocks
+        if(!this->isAnyDownloading()) {
+            this->finish();
+            return;
+        }
+    }
+
+    // end the round early if all nodes reported
+    if(s.phase == Phase::Collecting && std::none_of(s.nodes.begin(), s.nodes.end(),
+                [](const auto &entry) {
+        return entry.second.state == NodeState::Downloading && !entry.second.reported;
+    })) {
+        this->endRound();
+    }
+}
+
+/**
+ * @brief Remove a node from the distribution
+ *
+ * Invoked when the node leaves the network. It's considered to have failed; if it was the last node
+ * still downloading, the distribution ends.
+ *
+ * @param address Short address of the node
+ */
+void OtaDistributor::remove(const uint16_t address) {
+    if(!this->isActive()) {
+        return;
+    }
+
+    auto it = this->session->nodes.find(address);
+    if(it != this->session->nodes.end() && it->second.state == NodeState::Downloading) {
+        it->second.state = NodeState::Failed;
+
+        if(!this->isAnyDownloading()) {
+            this->finish();
+        }
+    }
+}
+
+/**
+ * @brief Determine whether any node of the session still needs blocks
+ */
+bool OtaDistributor::isAnyDownloading() const {
+    return std::any_of(this->session->nodes.begin(), this->session->nodes.end(),
+            [](const auto &entry) {
+        return entry.second.state == NodeState::Downloading;
+    });
+}
+
+
+
+/**
+ * @brief Get the progress of the current (or most recent) distribution
+ */
+OtaDistributor::Progress OtaDistributor::getProgress() const {
+    Progress progress;
+    if(!this->session) {
+        return progress;
+    }
+
+    const auto &s = *this->session;
+    progress.active = this->isActive();
+    progress.image = s.name;
+    progress.imageId = s.imageId;
+    progress.imageSize = s.imageSize;
+    progress.numBlocks = s.numBlocks;
+    progress.round = s.round;
+
+    for(const auto &[address, node] : s.nodes) {
+        progress.nodes.emplace_back(NodeProgress{
+            .address = address,
+            .state = node.state,
+            .blocksReceived = s.numBlocks - node.numMissing,
+        });
+    }
+    std::sort(progress.nodes.begin(), progress.nodes.end(), [](const auto &a, const auto &b) {
+        return a.address < b.address;
+    });
+
+    progress.blocksSent = s.blocksSent;
+    progress.blocksDelivered = s.blocksDelivered;
+
+    const auto end = progress.active ? std::chrono::steady_clock::now() : s.finished;
+    progress.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - s.started);
+
+    if(progress.elapsed.count()) {
+        progress.goodput = (static_cast<double>(s.blocksDelivered) * kBlockSize) /
+            std::chrono::duration<double>(progress.elapsed).count();
+    }
+
+    return progress;
+}
+
+
+
+/**
+ * @brief Arm the pacing timer
+ *
+ * If pacing the distribution fails, the error is logged, and the distribution carries on at the
+ * next tick; a block that couldn't be sent is retransmitted in a later round.
+ */
+void OtaDistributor::armTimer() {
+    this->paceTimer = std::make_shared<TristLib::Event::Timer>(
+            TristLib::Event::RunLoop::Current(), std::chrono::microseconds(kPaceInterval),
+            [this](auto) {
+        // keep the timer alive until its callback returns
+        auto timer = std::move(this->paceTimer);
+
+        try {
+            this->tick();
+        } catch(const std::exception &e) {
+            PLOG_ERROR << fmt::format("ota: failed to pace distribution: {}", e.what());
+
+            if(this->isActive() && !this->paceTimer) {
+                this->armTimer();
+            }
+        }
+    });
+}
+
+/**
+ * @brief Pace the distribution
+ *
+ * While sending, transmit the next few blocks of the round, as long as the transmit queue is
+ * (nearly) empty. Once all blocks were sent, request status from the nodes. While collecting, end
+ * the round once the report deadline passes.
+ */
+void OtaDistributor::tick() {
+    if(!this->isActive()) {
+        return;
+    }
+    auto &s = *this->session;
+
+    if(s.phase == Phase::Sending) {
+        for(size_t sent = 0; sent < this->burst; sent++) {
+            if(this->handler.radio->getTxQueueDepth() >= this->maxQueued) {
+                break;
+            }
+
+            // find the next block to send in this round
+            while(s.nextBlock < s.numBlocks && !TestBit(s.pending, s.nextBlock)) {
+                s.nextBlock++;
+            }
+            if(s.nextBlock == s.numBlocks) {
+                break;
+            }
+
+            this->sendBlock(s.nextBlock++);
+        }
+
+        if(s.nextBlock == s.numBlocks) {
+            for(auto &[address, node] : s.nodes) {
+                node.reported = false;
+            }
+
+            s.phase = Phase::Collecting;
+            s.reportDeadline = std::chrono::steady_clock::now() + this->reportWindow
+                + kReportGrace;
+            this->sendAnnounce(true);
+        }
+    } else if(s.phase == Phase::Collecting && std::chrono::steady_clock::now() >=
+            s.reportDeadline) {
+        this->endRound();
+    }
+
+    if(this->isActive()) {
+        this->armTimer();
+    }
+}
+
+/**
+ * @brief Start a new round
+ *
+ * Determine which blocks are missing from at least one node, and start transmitting them.
+ */
+void OtaDistributor::startRound() {
+    auto &s = *this->session;
+
+    s.round++;
+    s.pending.assign((s.numBlocks + kBitsPerWord - 1) / kBitsPerWord, 0);
+    s.nextBlock = 0;
+
+    size_t numPending{0};
+    for(const auto &[address, node] : s.nodes) {
+        if(node.state != NodeState::Downloading) {
+            continue;
+        }
+        for(size_t i = 0; i < s.pending.size(); i++) {
+            s.pending[i] |= node.missing[i];
+        }
+    }
+    for(const auto word : s.pending) {
+        numPending += __builtin_popcountll(word);
+    }
+
+    PLOG_DEBUG << fmt::format("ota: ${:04x} round {}: {} of {} blocks", s.imageId, s.round,
+            numPending, s.numBlocks);
+
+    s.phase = Phase::Sending;
+    this->sendAnnounce(false);
+}
+
+/**
+ * @brief End the current round
+ *
+ * Give up on nodes that didn't report for too long, then either start another round, or end the
+ * distribution if no nodes are left downloading (or we're out of rounds.)
+ */
+void OtaDistributor::endRound() {
+    auto &s = *this->session;
+    bool downloading{false};
+
+    for(auto &[address, node] : s.nodes) {
+        if(node.state != NodeState::Downloading) {
+            continue;
+        }
+
+        if(!node.reported && ++node.missedReports >= this->maxMissedReports) {
+            PLOG_WARNING << fmt::format("ota: node ${:04x} stopped responding", address);
+            node.state = NodeState::Failed;
+            continue;
+        }
+
+        if(s.round >= this->maxRounds) {
+            node.state = NodeState::Failed;
+        } else {
+            downloading = true;
+        }
+    }
+
+    if(downloading) {
+        this->startRound();
+    } else {
+        this->finish();
+    }
+}
+
+/**
+ * @brief End the distribution
+ *
+ * The image is unmapped and the group deleted, but the session is kept around so its results
+ * can still be queried.
+ */
+void OtaDistributor::finish() {
+    auto &s = *this->session;
+
+    s.phase = Phase::Done;
+    s.finished = std::chrono::steady_clock::now();
+    s.image.reset();
+    s.pending.clear();
+
+    this->handler.groups->destroy(s.group);
+
+    const auto complete = std::count_if(s.nodes.begin(), s.nodes.end(), [](const auto &entry) {
+        return entry.second.state == NodeState::Complete;
+    });
+    PLOG_INFO << fmt::format("ota: distribution ${:04x} done after {} rounds: {} of {} nodes "
+            "complete, {} blocks sent", s.imageId, s.round, complete, s.nodes.size(),
+            s.blocksSent);
+
+    this->paceTimer.reset();
+}
+
+
+
+/**
+ * @brief Transmit a block of the image to all nodes
+ *
+ * @param block Index of the block to send
+ */
+void OtaDistributor::sendBlock(const size_t block) {
+    auto &s = *this->session;
+
+    const auto data = s.image->getData().subspan(block * kBlockSize,
+            std::min(kBlockSize, s.imageSize - (block * kBlockSize)));
+
+    this->txBuffer.resize(sizeof(NetControl::Header) + sizeof(NetControl::OtaBlock)
+            + data.size());
+
+    auto ncHdr = reinterpret_cast<NetControl::Header *>(this->txBuffer.data());
+    ncHdr->type = static_cast<uint8_t>(NetControl::MessageType::OtaBlock);
+
+    auto msg = reinterpret_cast<NetControl::OtaBlock *>(ncHdr->payload);
+    msg->imageId = s.imageId;
+    msg->block = block;
+    memcpy(msg->data, data.data(), data.size());
+
+    this->handler.sendFrame(s.group, BlazeNet::Types::Mac::HeaderFlags::EndpointNetControl,
+            Radio::PacketPriority::Background, this->txBuffer);
+    s.blocksSent++;
+}
+
+/**
+ * @brief Announce the image to all nodes
+ *
+ * @param requestStatus Whether nodes should report their missing blocks
+ */
+void OtaDistributor::sendAnnounce(const bool requestStatus) {
+    auto &s = *this->session;
+
+    this->txBuffer.assign(sizeof(NetControl::Header) + sizeof(NetControl::OtaAnnounce),
+            std::byte(0));
+
+    auto ncHdr = reinterpret_cast<NetControl::Header *>(this->txBuffer.data());
+    ncHdr->type = static_cast<uint8_t>(NetControl::MessageType::OtaAnnounce);
+
+    auto msg = reinterpret_cast<NetControl::OtaAnnounce *>(ncHdr->payload);
+    msg->imageId = s.imageId;
+    msg->flags = requestStatus ? NetControl::OtaAnnounceFlags::StatusRequest : 0;
+    msg->blockSize = kBlockSize;
+    msg->imageSize = s.imageSize;
+    msg->numBlocks = s.numBlocks;
+    msg->reportWindow = this->reportWindow.count() / 10;
+
+    this->handler.sendFrame(s.group, BlazeNet::Types::Mac::HeaderFlags::EndpointNetControl,
+            Radio::PacketPriority::Normal, this->txBuffer);
+}
@@ -0,0 +1,274 @@
+#ifndef PROTOCOL_OTADISTRIBUTOR_H
+#define PROTOCOL_OTADISTRIBUTOR_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "NetControl.h"
+
+namespace Support {
+class MappedFile;
+}
+
+namespace TristLib::Event {
+class Timer;
+}
+
+namespace Protocol {
+class Handler;
+
+/**
+ * @brief Over-the-air firmware distribution
+ *
+ * Distributes a firmware image to many nodes at once. The image is memory mapped and split into
+ * fixed size blocks, which are sent to a multicast group containing all target nodes, so that
+ * each block only has to be transmitted once no matter how many nodes need it.
+ *
+ * Distribution proceeds in rounds. In each round, every block still missing from at least one node
+ * is transmitted; then all nodes are asked to report which blocks they're missing. The next round
+ * only sends the union of those. This repeats until all nodes have the complete image, or they
+ * stop responding, or the maximum number of rounds is reached.
+ *
+ * Blocks are sent at background priority, and only while the radio's transmit queue is (nearly)
+ * empty, so that regular traffic is barely delayed by a distribution in progress. Background
+ * traffic also leaves an airtime reserve in duty cycle limited regions.
+ *
+ * Only one distribution may be in progress at a time.
+ */
+class OtaDistributor {
+    private:
+        /// Config key for the directory firmware images are read from
+        constexpr static const std::string_view kConfImageDir{"protocol.ota.imageDir"};
+        /// Config key for the maximum number of packets in the transmit queue to send blocks
+        constexpr static const std::string_view kConfMaxQueued{"protocol.ota.maxQueued"};
+        /// Config key for the maximum number of blocks sent per pacing interval
+        constexpr static const std::string_view kConfBurst{"protocol.ota.burst"};
+        /// Config key for the time over which nodes spread their status reports (msec)
+        constexpr static const std::string_view kConfReportWindow{"protocol.ota.reportWindow"};
+        /// Config key for the maximum number of rounds
+        constexpr static const std::string_view kConfMaxRounds{"protocol.ota.maxRounds"};
+        /// Config key for the number of missed reports after which a node is given up on
+        constexpr static const std::string_view kConfMaxMissedReports{
+            "protocol.ota.maxMissedReports"};
+
+        /// Default directory for firmware images
+        constexpr static const std::string_view kDefaultImageDir{"/var/lib/blazed/firmware"};
+        /// Default maximum number of packets in the transmit queue to send blocks
+        constexpr static const size_t kDefaultMaxQueued{2};
+        /// Default maximum number of blocks sent per pacing interval
+        constexpr static const size_t kDefaultBurst{4};
+        /// Default time over which nodes spread their status reports
+        constexpr static const std::chrono::milliseconds kDefaultReportWindow{2'000};
+        /// Default maximum number of rounds
+        constexpr static const size_t kDefaultMaxRounds{10};
+        /// Default number of missed reports after which a node is given up on
+        constexpr static const size_t kDefaultMaxMissedReports{3};
+
+        /// Size of an image block (bytes)
+        constexpr static const size_t kBlockSize{128};
+        /// Largest image that can be distributed (bytes)
+        constexpr static const size_t kMaxImageSize{kBlockSize * 0xFFFF};
+        /// Interval at which blocks are sent
+        constexpr static const std::chrono::milliseconds kPaceInterval{20};
+        /// Time to wait for late status reports after the report window
+        constexpr static const std::chrono::milliseconds kReportGrace{500};
+
+    public:
+        /**
+         * @brief State of a node in a distribution
+         */
+        enum class NodeState: uint8_t {
+            /// The node is still missing blocks
+            Downloading,
+            /// The node received the entire image
+            Complete,
+            /// The node stopped responding, or left the network
+            Failed,
+        };
+
+        /**
+         * @brief Download progress of a single node
+         */
+        struct NodeProgress {
+            /// Short address of the node
+            uint16_t address;
+            /// Current state
+            NodeState state;
+            /// Number of blocks the node has received
+            size_t blocksReceived;
+        };
+
+        /**
+         * @brief Progress of the current (or most recent) distribution
+         */
+        struct Progress {
+            /// Whether the distribution is still in progress
+            bool active{false};
+            /// Name of the image
+            std::string image;
+            /// Identifier of the distribution session
+            uint16_t imageId{0};
+            /// Size of the image (bytes)
+            size_t imageSize{0};
+            /// Number of blocks in the image
+            size_t numBlocks{0};
+            /// Current round
+            size_t round{0};
+
+            /// Progress of each node
+            std::vector<NodeProgress> nodes;
+
+            /// Blocks transmitted (including retransmissions)
+            uint_least64_t blocksSent{0};
+            /// Blocks confirmed received by nodes (summed over all nodes)
+            uint_least64_t blocksDelivered{0};
+            /// Time since the distribution started (or its total duration, once done)
+            std::chrono::milliseconds elapsed{0};
+            /// Effective goodput: image bytes delivered to nodes per second
+            double goodput{0.};
+        };
+
+    private:
+        /**
+         * @brief Phase of a distribution round
+         */
+        enum class Phase: uint8_t {
+            /// Blocks are being transmitted
+            Sending,
+            /// Waiting for nodes to report their missing blocks
+            Collecting,
+            /// The distribution has ended
+            Done,
+        };
+
+        /**
+         * @brief Distribution state of a node
+         */
+        struct Node {
+            /// Bitmap of blocks the node is missing (set bits)
+            std::vector<uint64_t> missing;
+            /// Number of set bits in the missing bitmap
+            size_t numMissing{0};
+            /// Current state
+            NodeState state{NodeState::Downloading};
+            /// Whether the node reported its status in the current round
+            bool reported{false};
+            /// Number of consecutive rounds the node didn't report in
+            size_t missedReports{0};
+        };
+
+        /**
+         * @brief A distribution session
+         */
+        struct Session {
+            /// Session identifier
+            uint16_t imageId;
+            /// Name of the image file
+            std::string name;
+            /// Memory mapped image (released once the distribution ends)
+            std::unique_ptr<Support::MappedFile> image;
+            /// Size of the image (bytes)
+            size_t imageSize;
+            /// Number of blocks in the image
+            size_t numBlocks;
+            /// Multicast group all target nodes were added to
+            uint16_t group;
+
+            /// All target nodes
+            std::unordered_map<uint16_t, Node> nodes;
+
+            /// Current phase
+            Phase phase{Phase::Sending};
+            /// Current round (starting at 1)
+            size_t round{0};
+            /// Bitmap of blocks still to be sent in this round
+            std::vector<uint64_t> pending;
+            /// Index of the next block to consider sending
+            size_t nextBlock{0};
+            /// Time by which all status reports of this round must have arrived
+            std::chrono::steady_clock::time_point reportDeadline{};
+
+            /// Time at which the distribution started
+            std::chrono::steady_clock::time_point started;
+            /// Time at which the distribution ended
+            std::chrono::steady_clock::time_point finished{};
+
+            /// Blocks transmitted
+            uint_least64_t blocksSent{0};
+            /// Blocks confirmed received by nodes
+            uint_least64_t blocksDelivered{0};
+        };
+
+    public:
+        OtaDistributor(Handler &handler);
+        ~OtaDistributor();
+
+        void reloadConfig();
+
+        uint16_t start(const std::string_view name, std::span<const uint16_t> nodes);
+        void abort();
+
+        void handleStatus(const uint16_t source, std::span<const std::byte> payload);
+        void remove(const uint16_t address);
+
+        /**
+         * @brief Determine whether a distribution is in progress
+         */
+        inline bool isActive() const {
+            return this->session && this->session->phase != Phase::Done;
+        }
+
+        Progress getProgress() const;
+
+    private:
+        void armTimer();
+        void tick();
+
+        void startRound();
+        void endRound();
+        void finish();
+        bool isAnyDownloading() const;
+
+        void sendBlock(const size_t block);
+        void sendAnnounce(const bool requestStatus);
+
+    private:
+        /// Handle to the protocol handler that owns us
+        Handler &handler;
+
+        /// Directory firmware images are read from
+        std::filesystem::path imageDir{kDefaultImageDir};
+        /// Maximum number of packets in the transmit queue to send blocks
+        size_t maxQueued{kDefaultMaxQueued};
+        /// Maximum number of blocks sent per pacing interval
+        size_t burst{kDefaultBurst};
+        /// Time over which nodes spread their status reports
+        std::chrono::milliseconds reportWindow{kDefaultReportWindow};
+        /// Maximum number of rounds
+        size_t maxRounds{kDefaultMaxRounds};
+        /// Number of missed reports after which a node is given up on
+        size_t maxMissedReports{kDefaultMaxMissedReports};
+
+        /// Current (or most recent) distribution
+        std::optional<Session> session;
+        /// Identifier for the next distribution session
+        uint16_t nextImageId{1};
+
+        /// Buffer used to assemble messages
+        std::vector<std::byte> txBuffer;
+
+        /// Timer to send blocks and expire report windows (only exists while distributing)
+        std::shared_ptr<TristLib::Event::Timer> paceTimer;
+};
+}
+
+#endif
@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include <TristLib/Core.h>
+
+#include "Config/Reader.h"
+#include "Radio.h"
+#include "Handler.h"
+#include "NetControl.h"
+#include "PowerControl.h"
+
+using namespace Protocol;
+
+/**
+ * @brief Initialize power control
+ *
+ * @param handler Protocol handler that instantiated us
+ */
+PowerControl::PowerControl(Handler &handler) : handler(handler) {
+    this->reloadConfig();
+
+    if(this->enabled && !this->handler.radio->supportsTxPowerOverride()) {
+        PLOG_WARNING << "radio firmware lacks per-packet tx power; power control disabled";
+    }
+}
+
+/**
+ * @brief Read the power control configuration
+ *
+ * All keys are optional, and live in the `protocol.powerControl` table of the config file:
+ *
+ * - enabled: Whether per-node transmit power is used at all
+ * - targetRssi: Signal strength (dBm) frames should be received at by nodes
+ * - minPower: Lowest transmit power (dBm) to use
+ * - step: Margin (dB) added to a node's power for every frame that goes unacknowledged
+ */
+void PowerControl::reloadConfig() {
+    const auto &root = Config::GetConfig();
+
+    auto enabled = root.at_path(kConfEnabled);
+    if(enabled && enabled.is_boolean()) {
+        this->enabled = enabled.value_or(false);
+    }
+
+    auto target = root.at_path(kConfTargetRssi);
+    if(target && target.is_number()) {
+        this->targetRssi = target.value_or(kDefaultTargetRssi);
+    }
+    auto minPower = root.at_path(kConfMinPower);
+    if(minPower && minPower.is_number()) {
+        this->minPower = minPower.value_or(kDefaultMinPower);
+    }
+    auto step = root.at_path(kConfStep);
+    if(step && step.is_number()) {
+        this->step = step.value_or(kDefaultStep);
+    }
+
+    if(this->minPower < 0.f) {
+        throw std::runtime_error(fmt::format("invalid `{}`: must not be negative", kConfMinPower));
+    } else if(this->step <= 0.f) {
+        throw std::runtime_error(fmt::format("invalid `{}`: must be positive", kConfStep));
+    }
+
+    for(auto &[address, node] : this->nodes) {
+        this->update(address, node);
+    }
+
+    PLOG_DEBUG << fmt::format("power control: {}, target {} dBm, min {} dBm, step {} dB",
+            this->enabled ? "enabled" : "disabled", this->targetRssi, this->minPower, this->step);
+}
+
+
+
+/**
+ * @brief Determine whether per-node transmit power is in use
+ */
+bool PowerControl::isEnabled() const {
+    return this->enabled && this->handler.radio->supportsTxPowerOverride();
+}
+
+/**
+ * @brief Get the transmit power to use for frames to a node
+ *
+ * @param address Short address of the node
+ *
+ * @return Transmit power (in ⅒th dBm), or an empty value to use the configured transmit power
+ */
+std::optional<uint8_t> PowerControl::getTxPower(const uint16_t address) const {
+    if(!this->isEnabled()) {
+        return std::nullopt;
+    }
+
+    auto it = this->nodes.find(address);
+    if(it == this->nodes.end()) {
+        return std::nullopt;
+    }
+    return it->second.power;
+}
+
+
+
+/**
+ * @brief Process a link report from a node
+ *
+ * Update the path loss estimate, based on the signal strength the node received the most recent
+ * beacon with.
+ *
+ * @param source Address of the node that sent the report
+ * @param payload Link report message (following the network control header)
+ */
+void PowerControl::handleReport(const uint16_t source, std::span<const std::byte> payload) {
+    if(payload.size() < sizeof(NetControl::LinkReport)) {
+        this->counters.invalidReports++;
+        return;
+    }
+
+    auto report = reinterpret_cast<const NetControl::LinkReport *>(payload.data());
+    this->counters.reports++;
+
+    const float pathLoss = this->handler.radio->getTxPower() - report->beaconRssi;
+
+    auto it = this->nodes.find(source);
+    if(it == this->nodes.end()) {
+        if(this->nodes.size() >= kMaxNodes) {
+            return;
+        }
+        it = this->nodes.emplace(source, Node{.pathLoss = pathLoss}).first;
+    } else {
+        it->second.pathLoss += kAlpha * (pathLoss - it->second.pathLoss);
+    }
+
+    this->update(source, it->second);
+}
+
+/**
+ * @brief A frame to a node was acknowledged
+ *
+ * Frames acknowledged on the first attempt slowly reduce the margin.
+ *
+ * @param address Short address of the node
+ * @param attempts Number of retransmissions the frame needed
+ */
+void PowerControl::handleAck(const uint16_t address, const uint8_t attempts) {
+    auto it = this->nodes.find(address);
+    if(it == this->nodes.end() || attempts) {
+        return;
+    }
+
+    auto &node = it->second;
+    node.margin = std::max(0.f, node.margin - kMarginDecay);
+    this->update(address, node);
+}
+
+/**
+ * @brief A frame to a node went unacknowledged
+ *
+ * Raise the margin, so the retransmission (and subsequent frames) are sent at a higher power.
+ *
+ * @param address Short address of the node
+ */
+void PowerControl::handleTimeout(const uint16_t address) {
+    auto it = this->nodes.find(address);
+    if(it == this->nodes.end()) {
+        return;
+    }
+
+    auto &node = it->second;
+    node.margin = std::min(kMaxMargin, node.margin + this->step);
+    this->counters.marginIncreases++;
+    this->update(address, node);
+}
+
+/**
+ * @brief Stop tracking a node
+ *
+ * @param address Short address of the node
+ */
+void PowerControl::remove(const uint16_t address) {
+    this->nodes.erase(address);
+}
+
+
+
+/**
+ * @brief Recalculate the transmit power for a node
+ *
+ * The power is the target signal strength plus the estimated path loss and margin, limited to the
+ * range between the minimum power and the configured transmit power.
+ *
+ * @param address Short address of the node
+ * @param node Node state to update
+ */
+void PowerControl::update(const uint16_t address, Node &node) {
+    const float maxPower = this->handler.radio->getTxPower();
+    const float dBm = std::clamp(this->targetRssi + node.pathLoss + node.margin,
+            std::min(this->minPower, maxPower), maxPower);
+
+    const auto power = static_cast<uint8_t>(std::clamp(std::lround(dBm * 10.f), 0L,
+                static_cast<long>(UINT8_MAX)));
+    if(power == node.power) {
+        return;
+    }
+
+    PLOG_VERBOSE << fmt::format("tx power for ${:04x}: {:.1f} dBm (path loss {:.1f} dB, margin "
+            "{:.1f} dB)", address, power / 10., node.pathLoss, node.margin);
+    node.power = power;
+}
@@ -0,0 +1,134 @@
+#ifndef PROTOCOL_POWERCONTROL_H
+#define PROTOCOL_POWERCONTROL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+
+namespace Protocol {
+class Handler;
+
+/**
+ * @brief Per-node transmit power control
+ *
+ * Picks the transmit power for unicast frames to each node, such that they arrive with just
+ * enough signal strength to be received reliably. Transmitting at lower power to nearby nodes
+ * reduces interference with (and clear channel assessment failures of) other transmissions.
+ *
+ * The power is derived from two control loops:
+ *
+ * - An estimate of the path loss to the node, from the link reports in which nodes describe how
+ *   well they receive beacons (which are always sent at the configured transmit power.)
+ * - A margin on top of that, which grows whenever a frame goes unacknowledged, and slowly shrinks
+ *   again as frames are acknowledged on the first attempt.
+ *
+ * Nodes that never sent a link report are always sent to with the configured transmit power; the
+ * same applies to all nodes if the radio firmware doesn't support per-packet transmit power.
+ */
+class PowerControl {
+    private:
+        /// Config key for enabling power control
+        constexpr static const std::string_view kConfEnabled{"protocol.powerControl.enabled"};
+        /// Config key for the signal strength frames should arrive at nodes with (dBm)
+        constexpr static const std::string_view kConfTargetRssi{
+            "protocol.powerControl.targetRssi"};
+        /// Config key for the lowest transmit power to use (dBm)
+        constexpr static const std::string_view kConfMinPower{"protocol.powerControl.minPower"};
+        /// Config key for the margin added after a frame goes unacknowledged (dB)
+        constexpr static const std::string_view kConfStep{"protocol.powerControl.step"};
+
+        /// Default target signal strength
+        constexpr static const float kDefaultTargetRssi{-85.f};
+        /// Default minimum transmit power
+        constexpr static const float kDefaultMinPower{0.f};
+        /// Default margin step
+        constexpr static const float kDefaultStep{2.f};
+
+        /// Smoothing factor for the path loss estimate
+        constexpr static const float kAlpha{.25f};
+        /// Margin removed for every frame acknowledged on the first attempt (dB)
+        constexpr static const float kMarginDecay{.25f};
+        /// Maximum margin (dB)
+        constexpr static const float kMaxMargin{20.f};
+        /// Maximum number of nodes tracked
+        constexpr static const size_t kMaxNodes{4096};
+
+    public:
+        /**
+         * @brief Power control state of a single node
+         */
+        struct Node {
+            /// Estimated path loss to the node (dB)
+            float pathLoss;
+            /// Additional margin (dB)
+            float margin{0};
+            /// Transmit power currently used for the node (⅒th dBm)
+            uint8_t power{0};
+        };
+
+        /**
+         * @brief Power control counters
+         */
+        struct Counters {
+            /// Link reports received
+            uint_least64_t reports{0};
+            /// Malformed link reports received
+            uint_least64_t invalidReports{0};
+            /// Number of times the margin was raised due to a missing acknowledgement
+            uint_least64_t marginIncreases{0};
+        };
+
+    public:
+        PowerControl(Handler &handler);
+
+        void reloadConfig();
+
+        bool isEnabled() const;
+        std::optional<uint8_t> getTxPower(const uint16_t address) const;
+
+        void handleReport(const uint16_t source, std::span<const std::byte> payload);
+        void handleAck(const uint16_t address, const uint8_t attempts);
+        void handleTimeout(const uint16_t address);
+        void remove(const uint16_t address);
+
+        /**
+         * @brief Get the state of all nodes
+         */
+        inline const auto &getNodes() const {
+            return this->nodes;
+        }
+        /**
+         * @brief Get the performance counters
+         */
+        inline const auto &getCounters() const {
+            return this->counters;
+        }
+
+    private:
+        void update(const uint16_t address, Node &node);
+
+    private:
+        /// Handle to the protocol handler that owns us
+        Handler &handler;
+
+        /// Whether power control is enabled in the config
+        bool enabled{false};
+        /// Signal strength frames should be received with
+        float targetRssi{kDefaultTargetRssi};
+        /// Lowest transmit power to use
+        float minPower{kDefaultMinPower};
+        /// Margin added for each unacknowledged frame
+        float step{kDefaultStep};
+
+        /// Per-node state, keyed by short address
+        std::unordered_map<uint16_t, Node> nodes;
+
+        /// Performance counters
+        Counters counters{};
+};
+}
+
+#endif
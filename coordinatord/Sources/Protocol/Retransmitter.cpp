@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include <TristLib/Core.h>
+#include <TristLib/Event.h>
+
+#include "Config/Reader.h"
+#include "Radio.h"
+#include "Handler.h"
+#include "LinkQuality.h"
+#include "PowerControl.h"
+#include "Retransmitter.h"
+
+using namespace Protocol;
+
+/**
+ * @brief Initialize the retransmission engine
+ *
+ * Read the configuration. The timer used to advance the timeout wheel is only armed once there
+ * are frames waiting for acknowledgement.
+ *
+ * @param handler Protocol handler that instantiated us
+ */
+Retransmitter::Retransmitter(Handler &handler) : handler(handler) {
+    this->reloadConfig();
+}
+
+/**
+ * @brief Clean up the retransmission engine
+ *
+ * All pending frames are failed.
+ */
+Retransmitter::~Retransmitter() {
+    this->tickTimer.reset();
+    this->cancelAll();
+}
+
+
+
+/**
+ * @brief Read the retransmission configuration
+ *
+ * All keys are optional, and live in the `protocol.retransmit` table of the config file:
+ *
+ * - timeout: Initial acknowledgement timeout (msec)
+ * - maxTimeout: Upper bound for the acknowledgement timeout, after backoff (msec)
+ * - retries: Table of retry budgets, keyed by priority (background, normal, realtime, control)
+ */
+void Retransmitter::reloadConfig() {
+    const auto &root = Config::GetConfig();
+
+    auto timeout = root.at_path(kConfTimeout);
+    if(timeout && timeout.is_integer()) {
+        this->timeout = std::chrono::milliseconds(timeout.value_or(kDefaultTimeout.count()));
+    }
+    auto maxTimeout = root.at_path(kConfMaxTimeout);
+    if(maxTimeout && maxTimeout.is_integer()) {
+        this->maxTimeout = std::chrono::milliseconds(
+                maxTimeout.value_or(kDefaultMaxTimeout.count()));
+    }
+
+    if(this->timeout < kTickInterval) {
+        throw std::runtime_error(fmt::format("invalid `{}`: must be at least {} ms", kConfTimeout,
+                    kTickInterval.count()));
+    } else if(this->maxTimeout < this->timeout) {
+        throw std::runtime_error(fmt::format("invalid `{}`: must be at least `{}`",
+                    kConfMaxTimeout, kConfTimeout));
+    }
+
+    // retry budgets per priority level
+    constexpr static const std::array<std::string_view, kNumPriorities> kPriorityNames{{
+        "background", "normal", "realtime", "control"
+    }};
+
+    for(size_t i = 0; i < kNumPriorities; i++) {
+        auto item = root.at_path(fmt::format("{}.{}", kConfRetries, kPriorityNames[i]));
+        if(item && item.is_integer()) {
+            this->retries[i] = std::clamp<int64_t>(item.value_or(0), 0, UINT8_MAX);
+        }
+    }
+
+    PLOG_DEBUG << fmt::format("ack timeout: {} ms (max {} ms), retries: {}",
+            this->timeout.count(), this->maxTimeout.count(), fmt::join(this->retries, "/"));
+}
+
+
+
+/**
+ * @brief Start tracking a transmitted frame
+ *
+ * The frame should already have been submitted to the radio once; it will be retransmitted if no
+ * acknowledgement arrives within the timeout.
+ *
+ * @param destination Short address of the node the frame was sent to
+ * @param sequence MAC sequence number of the frame
+ * @param priority Priority the frame was transmitted at
+ * @param frame Full frame (including PHY header)
+ * @param callback Function to invoke once acknowledged or failed (may be empty)
+ * @param holdoff Time until the frame actually goes on air (if it's held for a time slot); the
+ *        timeout starts after it
+ */
+void Retransmitter::track(const uint16_t destination, const uint8_t sequence,
+        const Radio::PacketPriority priority, std::span<const std::byte> frame,
+        const CompletionCallback &callback, const std::chrono::milliseconds holdoff) {
+    const auto key = MakeKey(destination, sequence);
+
+    // sequence number wrapped around before the previous frame completed: fail that one
+    if(auto it = this->pending.find(key); it != this->pending.end()) {
+        auto old = std::move(it->second);
+        this->wheel.cancel(old.timer);
+        this->pending.erase(it);
+
+        this->counters.superseded++;
+        if(old.callback) {
+            old.callback(false);
+        }
+    }
+
+    // pick retry budget and priority based on link quality
+    auto budget = this->retries[static_cast<size_t>(priority)];
+    auto retryPriority = priority;
+
+    switch(this->handler.linkQuality->getQuality(destination)) {
+        case LinkQuality::Quality::Weak:
+            budget = std::min<size_t>(UINT8_MAX, budget + kWeakLinkExtraRetries);
+            if(priority < Radio::PacketPriority::RealTime) {
+                retryPriority = static_cast<Radio::PacketPriority>(
+                        static_cast<uint8_t>(priority) + 1);
+            }
+            break;
+        case LinkQuality::Quality::Poor:
+            budget = std::min(budget, kPoorLinkMaxRetries);
+            break;
+        default:
+            break;
+    }
+
+    // record it and start the timeout
+    Pending info;
+    info.priority = retryPriority;
+    info.budget = budget;
+    info.frame.assign(frame.begin(), frame.end());
+    info.callback = callback;
+    info.timer = this->wheel.schedule(this->timeoutFor(0) + holdoff, key);
+
+    this->pending.emplace(key, std::move(info));
+    this->armTimer();
+}
+
+/**
+ * @brief Process an acknowledgement
+ *
+ * Stop tracking the specified frame, and invoke its completion callback.
+ *
+ * @param source Address of the node that sent the acknowledgement
+ * @param sequence Sequence number being acknowledged
+ */
+void Retransmitter::handleAck(const uint16_t source, const uint8_t sequence) {
+    auto it = this->pending.find(MakeKey(source, sequence));
+    if(it == this->pending.end()) {
+        this->counters.spuriousAcks++;
+        return;
+    }
+
+    auto info = std::move(it->second);
+    this->pending.erase(it);
+    this->wheel.cancel(info.timer);
+
+    this->counters.acknowledged++;
+    this->handler.powerControl->handleAck(source, info.attempts);
+
+    if(info.callback) {
+        info.callback(true);
+    }
+}
+
+/**
+ * @brief Stop tracking all frames to a node
+ *
+ * Its pending frames are completed as failed. This is used when a node leaves the network, so
+ * that its frames aren't retransmitted to a different node that's assigned its address later.
+ *
+ * @param destination Short address of the node
+ */
+void Retransmitter::cancel(const uint16_t destination) {
+    std::vector<CompletionCallback> callbacks;
+
+    for(size_t sequence = 0; sequence <= UINT8_MAX; sequence++) {
+        auto it = this->pending.find(MakeKey(destination, sequence));
+        if(it == this->pending.end()) {
+            continue;
+        }
+
+        this->wheel.cancel(it->second.timer);
+        if(it->second.callback) {
+            callbacks.emplace_back(std::move(it->second.callback));
+        }
+        this->pending.erase(it);
+
+        this->counters.failures++;
+    }
+
+    for(const auto &callback : callbacks) {
+        callback(false);
+    }
+}
+
+/**
+ * @brief Stop tracking all frames
+ *
+ * All pending frames are completed as failed.
+ */
+void Retransmitter::cancelAll() {
+    auto temp = std::move(this->pending);
+    this->pending.clear();
+    this->wheel.clear();
+    this->tickTimer.reset();
+
+    for(auto &[key, info] : temp) {
+        this->counters.failures++;
+        if(info.callback) {
+            info.callback(false);
+        }
+    }
+}
+
+
+
+/**
+ * @brief Calculate the acknowledgement timeout
+ *
+ * The timeout doubles with every retransmission, up to the configured maximum.
+ *
+ * @param attempts Number of retransmissions performed so far
+ */
+std::chrono::milliseconds Retransmitter::timeoutFor(const uint8_t attempts) const {
+    const auto shift = std::min<size_t>(attempts, 16);
+    return std::min(this->timeout * (1U << shift), this->maxTimeout);
+}
+
+/**
+ * @brief Start the tick timer, if not already running
+ */
+void Retransmitter::armTimer() {
+    if(this->tickTimer) {
+        return;
+    }
+
+    this->tickTimer = std::make_shared<TristLib::Event::Timer>(
+            TristLib::Event::RunLoop::Current(), kTickInterval, [this](auto) {
+        // keep the timer alive until its callback returns
+        auto timer = std::move(this->tickTimer);
+
+        try {
+            this->tick();
+        } catch(const std::exception &e) {
+            PLOG_ERROR << fmt::format("failed to process ack timeouts: {}", e.what());
+        }
+
+        // keep ticking only while frames are waiting for acknowledgement
+        if(!this->wheel.empty()) {
+            this->armTimer();
+        }
+    });
+}
+
+/**
+ * @brief Advance the timeout wheel
+ *
+ * Invoked by the tick timer.
+ */
+void Retransmitter::tick() {
+    this->wheel.advance(std::chrono::steady_clock::now(), [this](auto, const uint64_t cookie) {
+        this->timeoutExpired(cookie);
+    });
+}
+
+/**
+ * @brief Handle an acknowledgement timeout
+ *
+ * Retransmit the frame if it has retries left; otherwise, fail it. Either way, the power
+ * controller is told, so that it may raise the transmit power for the destination.
+ *
+ * @param key Key of the pending frame in the map
+ */
+void Retransmitter::timeoutExpired(const uint32_t key) {
+    auto it = this->pending.find(key);
+    if(it == this->pending.end()) {
+        return;
+    }
+
+    auto &info = it->second;
+    const uint16_t destination = key >> 8;
+
+    this->handler.powerControl->handleTimeout(destination);
+
+    // retry budget exhausted
+    if(info.attempts >= info.budget) {
+        auto temp = std::move(info);
+        this->pending.erase(it);
+
+        PLOG_VERBOSE << fmt::format("frame ${:04x}:{} not acknowledged after {} retries",
+                key >> 8, key & 0xFF, temp.attempts);
+
+        this->counters.failures++;
+        if(temp.callback) {
+            temp.callback(false);
+        }
+        return;
+    }
+
+    // otherwise, retransmit the frame and wait again
+    info.attempts++;
+    this->counters.retransmits++;
+
+    auto holdoff = std::chrono::milliseconds(0);
+
+    try {
+        holdoff = this->handler.transmit(destination, info.priority, info.frame);
+    } catch(const std::exception &e) {
+        PLOG_WARNING << fmt::format("failed to retransmit frame ${:04x}:{}: {}", key >> 8,
+                key & 0xFF, e.what());
+    }
+
+    info.timer = this->wheel.schedule(this->timeoutFor(info.attempts) + holdoff, key);
+}
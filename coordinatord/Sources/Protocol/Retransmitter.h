@@ -0,0 +1,189 @@
+#ifndef PROTOCOL_RETRANSMITTER_H
+#define PROTOCOL_RETRANSMITTER_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Radio.h"
+#include "TimerWheel.h"
+
+namespace TristLib::Event {
+class Timer;
+}
+
+namespace Protocol {
+class Handler;
+
+/**
+ * @brief Acknowledgement and retransmission engine
+ *
+ * Keeps track of all unicast frames that are waiting to be acknowledged by their destination. If
+ * no acknowledgement arrives in time, the frame is sent again (with exponential backoff) until
+ * the retry budget for its priority level is exhausted.
+ *
+ * All retransmission timeouts live in a single timer wheel, which is advanced by one periodic
+ * event loop timer; so the cost of an outstanding frame is independent of the event loop. The
+ * timer only runs while there are frames waiting for acknowledgement.
+ *
+ * The retry budget is adjusted based on the quality of the link to the destination: frames over
+ * weak links get a few extra retries, and are retransmitted at a higher priority; while frames
+ * over poor links, which are unlikely to make it regardless, are only retried once.
+ */
+class Retransmitter {
+    private:
+        /// Config key for the initial acknowledgement timeout (msec)
+        constexpr static const std::string_view kConfTimeout{"protocol.retransmit.timeout"};
+        /// Config key for the maximum acknowledgement timeout (msec)
+        constexpr static const std::string_view kConfMaxTimeout{"protocol.retransmit.maxTimeout"};
+        /// Config key for the per-priority retry budgets
+        constexpr static const std::string_view kConfRetries{"protocol.retransmit.retries"};
+
+        /// Default initial acknowledgement timeout
+        constexpr static const std::chrono::milliseconds kDefaultTimeout{50};
+        /// Default maximum acknowledgement timeout
+        constexpr static const std::chrono::milliseconds kDefaultMaxTimeout{2'000};
+        /// Resolution of the retransmit timer wheel
+        constexpr static const std::chrono::milliseconds kTickInterval{10};
+        /// Additional retries granted to frames sent over weak links
+        constexpr static const uint8_t kWeakLinkExtraRetries{2};
+        /// Maximum retries for frames sent over poor links
+        constexpr static const uint8_t kPoorLinkMaxRetries{1};
+
+        /// Total number of priority levels
+        constexpr static const size_t kNumPriorities{
+            static_cast<size_t>(Radio::PacketPriority::NumLevels)
+        };
+
+        /**
+         * @brief Default number of retries, by priority level
+         *
+         * Indexed by the numeric value of the packet priority.
+         */
+        constexpr static const std::array<uint8_t, kNumPriorities> kDefaultRetries{{
+            // Background
+            1,
+            // Normal
+            3,
+            // RealTime
+            5,
+            // NetworkControl
+            7,
+        }};
+
+    public:
+        /**
+         * @brief Completion callback
+         *
+         * @param acknowledged Set if the frame was acknowledged; clear if it ran out of retries
+         */
+        using CompletionCallback = std::function<void(const bool acknowledged)>;
+
+        /**
+         * @brief Retransmission performance counters
+         */
+        struct Counters {
+            /// Frames that were acknowledged
+            uint_least64_t acknowledged{0};
+            /// Total retransmissions performed
+            uint_least64_t retransmits{0};
+            /// Frames that ran out of retries
+            uint_least64_t failures{0};
+            /// Acknowledgements for frames we weren't waiting for
+            uint_least64_t spuriousAcks{0};
+            /// Frames superseded before completion (sequence number reused)
+            uint_least64_t superseded{0};
+        };
+
+    private:
+        /**
+         * @brief Information on a frame waiting for acknowledgement
+         */
+        struct Pending {
+            /// Priority to retransmit at
+            Radio::PacketPriority priority;
+            /// Number of retransmissions performed so far
+            uint8_t attempts{0};
+            /// Maximum number of retransmissions
+            uint8_t budget{0};
+
+            /// Timer wheel handle for the acknowledgement timeout
+            TimerWheel::Handle timer{TimerWheel::kInvalidHandle};
+
+            /// Full frame (including PHY header) for retransmission
+            std::vector<std::byte> frame;
+            /// Function to invoke when completed
+            CompletionCallback callback;
+        };
+
+    public:
+        Retransmitter(Handler &handler);
+        ~Retransmitter();
+
+        void reloadConfig();
+
+        void track(const uint16_t destination, const uint8_t sequence,
+                const Radio::PacketPriority priority, std::span<const std::byte> frame,
+                const CompletionCallback &callback,
+                const std::chrono::milliseconds holdoff = std::chrono::milliseconds(0));
+        void handleAck(const uint16_t source, const uint8_t sequence);
+
+        void cancel(const uint16_t destination);
+        void cancelAll();
+
+        /**
+         * @brief Get the number of frames waiting for acknowledgement
+         */
+        inline size_t getNumPending() const {
+            return this->pending.size();
+        }
+        /**
+         * @brief Get the performance counters
+         */
+        inline const auto &getCounters() const {
+            return this->counters;
+        }
+
+    private:
+        /// Build the key for the pending frame map
+        constexpr static inline uint32_t MakeKey(const uint16_t address, const uint8_t sequence) {
+            return (static_cast<uint32_t>(address) << 8) | sequence;
+        }
+
+        std::chrono::milliseconds timeoutFor(const uint8_t attempts) const;
+
+        void armTimer();
+        void tick();
+        void timeoutExpired(const uint32_t key);
+
+    private:
+        /// Handle to the protocol handler that owns us
+        Handler &handler;
+
+        /// Initial acknowledgement timeout
+        std::chrono::milliseconds timeout{kDefaultTimeout};
+        /// Upper bound of the acknowledgement timeout, after backoff
+        std::chrono::milliseconds maxTimeout{kDefaultMaxTimeout};
+        /// Maximum number of retransmissions, by priority level
+        std::array<uint8_t, kNumPriorities> retries{kDefaultRetries};
+
+        /// All frames waiting for acknowledgement, keyed by destination and sequence number
+        std::unordered_map<uint32_t, Pending> pending;
+        /// Acknowledgement timeouts
+        TimerWheel wheel{kTickInterval};
+        /// Event loop timer to advance the wheel (only armed while frames are pending)
+        std::shared_ptr<TristLib::Event::Timer> tickTimer;
+
+        /// Performance counters
+        Counters counters{};
+};
+}
+
+#endif
@@ -0,0 +1,424 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <BlazeNet/Types.h>
+#include <fmt/format.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+
+#include <TristLib/Core.h>
+
+#include "Support/Confd.h"
+#include "Association.h"
+#include "Handler.h"
+#include "Security.h"
+
+using namespace Protocol;
+
+/**
+ * @brief Raise an exception for an OpenSSL error
+ *
+ * @param what Description of the operation that failed
+ */
+[[noreturn]] static void ThrowSslError(const std::string_view what) {
+    char buf[256]{};
+    ERR_error_string_n(ERR_get_error(), buf, sizeof(buf));
+
+    throw std::runtime_error(fmt::format("{} failed: {}", what, buf));
+}
+
+void Security::CipherCtxDeleter::operator()(EVP_CIPHER_CTX *ctx) const {
+    EVP_CIPHER_CTX_free(ctx);
+}
+
+/**
+ * @brief Initialize link layer security
+ *
+ * @param handler Protocol handler that instantiated us
+ */
+Security::Security(Handler &handler) : handler(handler) {
+    this->reloadConfig();
+}
+
+/**
+ * @brief Clean up security state
+ *
+ * Keys are wiped from memory.
+ */
+Security::~Security() {
+    this->peers.clear();
+    OPENSSL_cleanse(this->networkKey.data(), this->networkKey.size());
+}
+
+
+
+/**
+ * @brief Read the security configuration
+ *
+ * Load the network key from confd. If it's not set, security is disabled. Any cached peer state
+ * is discarded, and a new epoch is chosen for transmitted frames.
+ */
+void Security::reloadConfig() {
+    const auto keyBytesRead = Support::Confd::GetBlob(kConfNetworkKey, this->networkKey);
+
+    if(!keyBytesRead) {
+        this->enabled = false;
+    } else if(keyBytesRead != this->networkKey.size()) {
+        throw std::runtime_error(fmt::format("failed to read network key (`{}`): got {} bytes",
+                    kConfNetworkKey, keyBytesRead));
+    } else {
+        this->enabled = true;
+    }
+
+    this->peers.clear();
+    if(this->enabled) {
+        this->initPeer(this->networkPeer, this->networkKey);
+    }
+
+    if(RAND_bytes(reinterpret_cast<unsigned char *>(&this->txEpoch),
+                sizeof(this->txEpoch)) != 1) {
+        ThrowSslError("RAND_bytes");
+    }
+    this->txCounter = 0;
+
+    PLOG_DEBUG << "Link security: " << (this->enabled ? "enabled" : "disabled");
+}
+
+/**
+ * @brief Install a peer specific key
+ *
+ * @param address Short address of the peer
+ * @param key Key to use for all frames to and from this peer
+ */
+void Security::setPeerKey(const uint16_t address, const Key &key) {
+    auto &peer = this->peers[address];
+    this->initPeer(peer, key);
+
+    peer.rxValid = false;
+}
+
+/**
+ * @brief Discard all state for a peer
+ *
+ * @param address Short address of the peer
+ */
+void Security::removePeer(const uint16_t address) {
+    this->peers.erase(address);
+}
+
+/**
+ * @brief Allow a peer to start a new epoch
+ *
+ * Once a frame from a peer has been verified, it's bound to that epoch: frames with any other
+ * epoch are rejected, since otherwise they would reset the replay window. A peer only starts a
+ * new epoch when it restarts, which means it has to go through association again; this is called
+ * when it sends an association request.
+ *
+ * Association requests aren't authenticated, so this doesn't invalidate anything: the current
+ * epoch stays valid, and frames with a new epoch are merely accepted (if they're authentic) until
+ * the association is confirmed by confirmEpoch().
+ *
+ * @param address Short address of the peer
+ */
+void Security::allowNewEpoch(const uint16_t address) {
+    auto it = this->peers.find(address);
+    if(it == this->peers.end() || !it->second.rxValid) {
+        return;
+    }
+
+    it->second.newEpochAllowed = true;
+}
+
+/**
+ * @brief Complete a peer's change of epoch
+ *
+ * Called once a pending association was confirmed by an authentic frame from the peer. If that
+ * frame (or an earlier one since the association request) used a new epoch, the peer switches to
+ * it, and the epoch it used before may not be used again. Otherwise, the peer keeps its epoch.
+ *
+ * @param address Short address of the peer
+ */
+void Security::confirmEpoch(const uint16_t address) {
+    auto it = this->peers.find(address);
+    if(it == this->peers.end()) {
+        return;
+    }
+
+    auto &peer = it->second;
+
+    if(peer.hasNextEpoch) {
+        peer.hasRetiredEpoch = true;
+        peer.retiredEpoch = peer.rxEpoch;
+
+        peer.rxEpoch = peer.nextEpoch;
+        peer.rxCounter = peer.nextCounter;
+    }
+
+    peer.newEpochAllowed = false;
+    peer.hasNextEpoch = false;
+}
+
+/**
+ * @brief Get the state for a frame's destination
+ *
+ * If the destination is an associated node without any state yet, it's created with the network
+ * key. All other destinations share the network context.
+ *
+ * @param address Short address of the destination
+ */
+Security::Peer &Security::getPeer(const uint16_t address) {
+    if(auto peer = this->findRxPeer(address)) {
+        return *peer;
+    }
+
+    return this->networkPeer;
+}
+
+/**
+ * @brief Get the state for the source of a received frame
+ *
+ * State is only created (with the network key) for nodes in the association table, so that
+ * frames from made up addresses can't allocate anything.
+ *
+ * @param address Short address of the source
+ *
+ * @return Peer state, or `nullptr` if the source isn't associated
+ */
+Security::Peer *Security::findRxPeer(const uint16_t address) {
+    if(auto it = this->peers.find(address); it != this->peers.end()) {
+        return &it->second;
+    } else if(!this->handler.getAssociation()->isAssociated(address)) {
+        return nullptr;
+    }
+
+    auto &peer = this->peers[address];
+    this->initPeer(peer, this->networkKey);
+    return &peer;
+}
+
+/**
+ * @brief Set up the cipher contexts of a peer
+ *
+ * The key schedule, nonce length and tag length are all set up here; securing a frame then only
+ * needs to provide the nonce.
+ *
+ * @param peer Peer whose contexts to initialize
+ * @param key Key to use for this peer
+ */
+void Security::initPeer(Peer &peer, const Key &key) {
+    const auto keyPtr = reinterpret_cast<const unsigned char *>(key.data());
+
+    // encryption
+    peer.encrypt.reset(EVP_CIPHER_CTX_new());
+    if(!peer.encrypt) {
+        ThrowSslError("EVP_CIPHER_CTX_new");
+    }
+
+    if(EVP_EncryptInit_ex(peer.encrypt.get(), EVP_aes_128_ccm(), nullptr, nullptr, nullptr) != 1 ||
+            EVP_CIPHER_CTX_ctrl(peer.encrypt.get(), EVP_CTRL_CCM_SET_IVLEN, kNonceSize,
+                nullptr) != 1 ||
+            EVP_CIPHER_CTX_ctrl(peer.encrypt.get(), EVP_CTRL_CCM_SET_TAG, kMicSize,
+                nullptr) != 1 ||
+            EVP_EncryptInit_ex(peer.encrypt.get(), nullptr, nullptr, keyPtr, nullptr) != 1) {
+        ThrowSslError("init encrypt context");
+    }
+
+    // decryption
+    peer.decrypt.reset(EVP_CIPHER_CTX_new());
+    if(!peer.decrypt) {
+        ThrowSslError("EVP_CIPHER_CTX_new");
+    }
+
+    if(EVP_DecryptInit_ex(peer.decrypt.get(), EVP_aes_128_ccm(), nullptr, nullptr, nullptr) != 1 ||
+            EVP_CIPHER_CTX_ctrl(peer.decrypt.get(), EVP_CTRL_CCM_SET_IVLEN, kNonceSize,
+                nullptr) != 1 ||
+            EVP_CIPHER_CTX_ctrl(peer.decrypt.get(), EVP_CTRL_CCM_SET_TAG, kMicSize,
+                nullptr) != 1 ||
+            EVP_DecryptInit_ex(peer.decrypt.get(), nullptr, nullptr, keyPtr, nullptr) != 1) {
+        ThrowSslError("init decrypt context");
+    }
+}
+
+
+
+/**
+ * @brief Build the CCM nonce for a frame
+ *
+ * The nonce consists of the source address, the sender's epoch and frame counter, the MAC
+ * sequence number and the destination address.
+ */
+void Security::BuildNonce(std::span<uint8_t, kNonceSize> nonce, const uint16_t source,
+        const uint16_t destination, const uint8_t sequence, const SecurityHeader &secHdr) {
+    const uint32_t epoch = secHdr.epoch, counter = secHdr.counter;
+
+    memcpy(nonce.data(), &source, 2);
+    memcpy(nonce.data() + 2, &epoch, 4);
+    memcpy(nonce.data() + 6, &counter, 4);
+    nonce[10] = sequence;
+    memcpy(nonce.data() + 11, &destination, 2);
+}
+
+/**
+ * @brief Secure frames in place
+ *
+ * Each frame must have been built with the secured flag set in its MAC header, and with room for
+ * the security header after the MAC header as well as the integrity code at the end. The security
+ * header is filled in, the payload encrypted and the integrity code appended.
+ *
+ * All frames are processed in a single pass; consecutive frames to the same peer share the peer
+ * lookup.
+ *
+ * @param frames Frames to secure (including PHY header)
+ */
+void Security::protect(std::span<const std::span<std::byte>> frames) {
+    using namespace BlazeNet::Types;
+
+    Peer *peer{nullptr};
+    uint16_t peerAddress{0};
+
+    for(auto frame : frames) {
+        if(frame.size() < Handler::kFrameHeaderSize + kOverhead) {
+            throw std::invalid_argument(fmt::format("frame too small to secure ({})",
+                        frame.size()));
+        }
+
+        auto macHdr = reinterpret_cast<Mac::Header *>(frame.data() + sizeof(Phy::Header));
+        auto secHdr = reinterpret_cast<SecurityHeader *>(frame.data() + Handler::kFrameHeaderSize);
+
+        const uint16_t destination = macHdr->destination;
+        if(!peer || peerAddress != destination) {
+            peer = &this->getPeer(destination);
+            peerAddress = destination;
+        }
+
+        // allocate a frame counter
+        if(!++this->txCounter) {
+            if(RAND_bytes(reinterpret_cast<unsigned char *>(&this->txEpoch),
+                        sizeof(this->txEpoch)) != 1) {
+                ThrowSslError("RAND_bytes");
+            }
+            this->txCounter = 1;
+        }
+
+        secHdr->epoch = this->txEpoch;
+        secHdr->counter = this->txCounter;
+
+        std::array<uint8_t, kNonceSize> nonce;
+        BuildNonce(nonce, macHdr->source, destination, macHdr->sequence, *secHdr);
+
+        // encrypt payload in place (with MAC and security header as associated data)
+        auto aad = reinterpret_cast<const unsigned char *>(macHdr);
+        const int aadLen = sizeof(*macHdr) + sizeof(*secHdr);
+
+        auto payload = reinterpret_cast<unsigned char *>(frame.data()) + Handler::kFrameHeaderSize
+            + sizeof(*secHdr);
+        const int payloadLen = frame.size() - Handler::kFrameHeaderSize - kOverhead;
+
+        auto ctx = peer->encrypt.get();
+        int outLen;
+
+        if(EVP_EncryptInit_ex(ctx, nullptr, nullptr, nullptr, nonce.data()) != 1 ||
+                EVP_EncryptUpdate(ctx, nullptr, &outLen, nullptr, payloadLen) != 1 ||
+                EVP_EncryptUpdate(ctx, nullptr, &outLen, aad, aadLen) != 1 ||
+                EVP_EncryptUpdate(ctx, payload, &outLen, payload, payloadLen) != 1 ||
+                EVP_EncryptFinal_ex(ctx, payload + outLen, &outLen) != 1 ||
+                EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_CCM_GET_TAG, kMicSize,
+                    payload + payloadLen) != 1) {
+            ThrowSslError("encrypt frame");
+        }
+
+        this->counters.txProtected++;
+    }
+}
+
+/**
+ * @brief Authenticate and decrypt a received frame
+ *
+ * @param frame Received frame (including PHY header), with the secured flag set
+ * @param outPayload Buffer to receive the decrypted payload
+ *
+ * @return Whether the frame was authentic; the payload is only valid if so.
+ */
+bool Security::unprotect(std::span<const std::byte> frame, std::vector<std::byte> &outPayload) {
+    using namespace BlazeNet::Types;
+
+    if(frame.size() < Handler::kFrameHeaderSize + kOverhead) {
+        this->counters.rxInvalid++;
+        return false;
+    }
+
+    auto macHdr = reinterpret_cast<const Mac::Header *>(frame.data() + sizeof(Phy::Header));
+    auto secHdr = reinterpret_cast<const SecurityHeader *>(frame.data()
+            + Handler::kFrameHeaderSize);
+
+    auto peerPtr = this->findRxPeer(macHdr->source);
+    if(!peerPtr) {
+        this->counters.rxUnknownSource++;
+        return false;
+    }
+    auto &peer = *peerPtr;
+
+    // the epoch may only change when the peer (re)associates
+    const bool newEpoch = peer.rxValid && secHdr->epoch != peer.rxEpoch;
+
+    if((newEpoch && !peer.newEpochAllowed) ||
+            (peer.hasRetiredEpoch && secHdr->epoch == peer.retiredEpoch)) {
+        this->counters.rxBadEpoch++;
+        return false;
+    }
+    // reject replayed frames (a new epoch has its own window, until it replaces the current one)
+    if(!newEpoch && peer.rxValid && secHdr->counter <= peer.rxCounter) {
+        this->counters.rxReplays++;
+        return false;
+    } else if(newEpoch && peer.hasNextEpoch && secHdr->epoch == peer.nextEpoch &&
+            secHdr->counter <= peer.nextCounter) {
+        this->counters.rxReplays++;
+        return false;
+    }
+
+    std::array<uint8_t, kNonceSize> nonce;
+    BuildNonce(nonce, macHdr->source, macHdr->destination, macHdr->sequence, *secHdr);
+
+    auto aad = reinterpret_cast<const unsigned char *>(macHdr);
+    const int aadLen = sizeof(*macHdr) + sizeof(*secHdr);
+
+    auto payload = reinterpret_cast<const unsigned char *>(frame.data())
+        + Handler::kFrameHeaderSize + sizeof(*secHdr);
+    const int payloadLen = frame.size() - Handler::kFrameHeaderSize - kOverhead;
+    auto mic = const_cast<unsigned char *>(payload + payloadLen);
+
+    // the output pointer must be valid even without payload, else OpenSSL treats it as AAD
+    outPayload.resize(payloadLen);
+    unsigned char empty;
+    auto out = payloadLen ? reinterpret_cast<unsigned char *>(outPayload.data()) : &empty;
+
+    // CCM verifies the tag as part of the update call
+    auto ctx = peer.decrypt.get();
+    int outLen;
+
+    if(EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_CCM_SET_TAG, kMicSize, mic) != 1 ||
+            EVP_DecryptInit_ex(ctx, nullptr, nullptr, nullptr, nonce.data()) != 1 ||
+            EVP_DecryptUpdate(ctx, nullptr, &outLen, nullptr, payloadLen) != 1 ||
+            EVP_DecryptUpdate(ctx, nullptr, &outLen, aad, aadLen) != 1 ||
+            EVP_DecryptUpdate(ctx, out, &outLen, payload, payloadLen) != 1) {
+        ERR_clear_error();
+        this->counters.rxAuthFailures++;
+        return false;
+    }
+
+    // a new epoch is only switched to once the association is confirmed
+    if(newEpoch) {
+        peer.hasNextEpoch = true;
+        peer.nextEpoch = secHdr->epoch;
+        peer.nextCounter = secHdr->counter;
+    } else {
+        peer.rxValid = true;
+        peer.rxEpoch = secHdr->epoch;
+        peer.rxCounter = secHdr->counter;
+    }
+
+    this->counters.rxVerified++;
+    return true;
+}
@@ -0,0 +1,197 @@
+#ifndef PROTOCOL_SECURITY_H
+#define PROTOCOL_SECURITY_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct evp_cipher_ctx_st;
+
+namespace Protocol {
+class Handler;
+
+/**
+ * @brief Security header
+ *
+ * Follows the MAC header of secured frames. Together with the addresses and sequence number from
+ * the MAC header, it forms the CCM nonce of the frame.
+ */
+struct SecurityHeader {
+    /// Random value chosen by the sender at startup
+    uint32_t epoch;
+    /// Frame counter, incremented for every secured frame the sender transmits
+    uint32_t counter;
+} __attribute__((packed));
+
+/**
+ * @brief Link layer security
+ *
+ * Authenticates and encrypts frames with AES-128-CCM. The MAC and security headers are
+ * authenticated, the payload is encrypted, and an 8 byte message integrity code is appended to
+ * the frame.
+ *
+ * Each peer has its own pair of pre-initialized cipher contexts, so securing a frame only needs to
+ * load the nonce rather than set up the key schedule again. Peers use the network key, unless a
+ * peer specific key has been installed.
+ *
+ * Peer state only exists for nodes in the association table; it's never allocated on behalf of a
+ * received frame from an unknown source, which is rejected before any cryptographic work is done.
+ * Frames to any other destination (broadcasts, multicast groups) share a single context that
+ * uses the network key.
+ *
+ * Security is enabled when a network key is configured (the `protocol.security.key` confd blob.)
+ */
+class Security {
+    private:
+        /// Confd key for the network key
+        constexpr static const std::string_view kConfNetworkKey{"protocol.security.key"};
+
+        /// Size of the CCM nonce
+        constexpr static const size_t kNonceSize{13};
+
+    public:
+        /// Flag in the MAC header indicating a secured frame
+        constexpr static const uint16_t kFlagSecured{0x0080};
+        /// Size of the message integrity code
+        constexpr static const size_t kMicSize{8};
+        /// Number of bytes security adds to a frame
+        constexpr static const size_t kOverhead{sizeof(SecurityHeader) + kMicSize};
+
+        /// AES-128 key
+        using Key = std::array<std::byte, 16>;
+
+        /**
+         * @brief Security performance counters
+         */
+        struct Counters {
+            /// Frames secured for transmission
+            uint_least64_t txProtected{0};
+            /// Received frames that were successfully authenticated
+            uint_least64_t rxVerified{0};
+            /// Received frames that failed authentication
+            uint_least64_t rxAuthFailures{0};
+            /// Received frames with a stale frame counter
+            uint_least64_t rxReplays{0};
+            /// Received frames too short to be secured
+            uint_least64_t rxInvalid{0};
+            /// Received frames from sources that aren't associated
+            uint_least64_t rxUnknownSource{0};
+            /// Received frames with an epoch the peer isn't allowed to use
+            uint_least64_t rxBadEpoch{0};
+        };
+
+    private:
+        /// Deleter for OpenSSL cipher contexts
+        struct CipherCtxDeleter {
+            void operator()(struct evp_cipher_ctx_st *ctx) const;
+        };
+        using CipherCtx = std::unique_ptr<struct evp_cipher_ctx_st, CipherCtxDeleter>;
+
+        /**
+         * @brief Per-peer security state
+         */
+        struct Peer {
+            /// Context for securing frames to this peer
+            CipherCtx encrypt;
+            /// Context for verifying frames from this peer
+            CipherCtx decrypt;
+
+            /// Whether a frame has been received from this peer
+            bool rxValid{false};
+            /// Epoch of the last frame received from this peer
+            uint32_t rxEpoch{0};
+            /// Frame counter of the last frame received from this peer
+            uint32_t rxCounter{0};
+
+            /// Whether the peer may start a new epoch (it sent an association request)
+            bool newEpochAllowed{false};
+            /// Whether a frame with a new epoch has been verified, but not yet switched to
+            bool hasNextEpoch{false};
+            /// New epoch the peer started using
+            uint32_t nextEpoch{0};
+            /// Frame counter of the last frame received with the new epoch
+            uint32_t nextCounter{0};
+
+            /// Whether the peer used an epoch before its most recent association
+            bool hasRetiredEpoch{false};
+            /// Epoch the peer used before its most recent association
+            uint32_t retiredEpoch{0};
+        };
+
+    public:
+        Security(Handler &handler);
+        ~Security();
+
+        void reloadConfig();
+
+        /**
+         * @brief Determine whether frames are secured
+         */
+        constexpr inline bool isEnabled() const {
+            return this->enabled;
+        }
+
+        void setPeerKey(const uint16_t address, const Key &key);
+        void removePeer(const uint16_t address);
+        void allowNewEpoch(const uint16_t address);
+        void confirmEpoch(const uint16_t address);
+
+        void protect(std::span<const std::span<std::byte>> frames);
+        /**
+         * @brief Secure a single frame in place
+         *
+         * @param frame Frame to secure
+         *
+         * @seeAlso protect
+         */
+        inline void protect(std::span<std::byte> frame) {
+            this->protect(std::span<const std::span<std::byte>>(&frame, 1));
+        }
+        bool unprotect(std::span<const std::byte> frame, std::vector<std::byte> &outPayload);
+
+        /**
+         * @brief Get the performance counters
+         */
+        inline const auto &getCounters() const {
+            return this->counters;
+        }
+
+    private:
+        Peer &getPeer(const uint16_t address);
+        Peer *findRxPeer(const uint16_t address);
+        void initPeer(Peer &peer, const Key &key);
+
+        static void BuildNonce(std::span<uint8_t, kNonceSize> nonce, const uint16_t source,
+                const uint16_t destination, const uint8_t sequence,
+                const SecurityHeader &secHdr);
+
+    private:
+        /// Handle to the protocol handler that owns us
+        Handler &handler;
+
+        /// Whether frames are secured
+        bool enabled{false};
+        /// Key used for all peers without their own key
+        Key networkKey{};
+
+        /// Epoch value for our transmitted frames
+        uint32_t txEpoch{0};
+        /// Frame counter for the next secured frame
+        uint32_t txCounter{0};
+
+        /// Security state for each peer, keyed by short address
+        std::unordered_map<uint16_t, Peer> peers;
+        /// Transmit state for destinations that aren't nodes (uses the network key)
+        Peer networkPeer;
+
+        /// Performance counters
+        Counters counters{};
+};
+}
+
+#endif
@@ -0,0 +1,435 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include <TristLib/Core.h>
+#include <TristLib/Event.h>
+
+#include "Config/Reader.h"
+#include "Radio.h"
+#include "Handler.h"
+#include "Beaconator.h"
+#include "NetControl.h"
+#include "PowerControl.h"
+#include "Superframe.h"
+
+using namespace Protocol;
+
+/**
+ * @brief Initialize the superframe scheduler
+ *
+ * Read the configuration, advertise the superframe structure (if enabled) and start following the
+ * beacons transmitted by the radio.
+ *
+ * @param handler Protocol handler that instantiated us
+ */
+Superframe::Superframe(Handler &handler) : handler(handler) {
+    this->reloadConfig();
+
+    this->handler.radio->addBeaconHandler([this](auto when) {
+        this->beaconSent(when);
+    });
+}
+
+/**
+ * @brief Clean up the superframe scheduler
+ *
+ * Frames still held for their slot are discarded; the retransmission engine fails them.
+ */
+Superframe::~Superframe() {
+    this->slotTimer.reset();
+}
+
+
+
+/**
+ * @brief Read the superframe configuration
+ *
+ * All keys are optional, and live in the `protocol.superframe` table of the config file:
+ *
+ * - enabled: Whether superframe mode is enabled (default false)
+ * - guardTime: Time around each beacon during which nothing else is transmitted (msec)
+ * - slotDuration: Duration of a guaranteed time slot (msec)
+ * - maxSlots: Maximum number of guaranteed time slots
+ *
+ * The superframe (guard times and all slots) must fit in the beacon interval. If the radio doesn't
+ * report beacon timing, superframe mode can't be used, and is disabled with a warning.
+ */
+void Superframe::reloadConfig() {
+    const auto &root = Config::GetConfig();
+
+    this->enabled = root.at_path(kConfEnabled).value_or(false);
+
+    auto guard = root.at_path(kConfGuardTime);
+    if(guard && guard.is_integer()) {
+        this->guardTime = std::chrono::milliseconds(guard.value_or(kDefaultGuardTime.count()));
+    }
+    auto slot = root.at_path(kConfSlotDuration);
+    if(slot && slot.is_integer()) {
+        this->slotDuration = std::chrono::milliseconds(
+                slot.value_or(kDefaultSlotDuration.count()));
+    }
+    auto maxSlots = root.at_path(kConfMaxSlots);
+    if(maxSlots && maxSlots.is_integer()) {
+        this->maxSlots = maxSlots.value_or(kDefaultMaxSlots);
+    }
+
+    if(this->guardTime.count() < 1 || this->guardTime.count() > UINT8_MAX) {
+        throw std::runtime_error(fmt::format("invalid `{}`: must be in [1, {}]", kConfGuardTime,
+                    UINT8_MAX));
+    } else if(this->slotDuration.count() < 1 || this->slotDuration.count() > UINT8_MAX) {
+        throw std::runtime_error(fmt::format("invalid `{}`: must be in [1, {}]",
+                    kConfSlotDuration, UINT8_MAX));
+    } else if(this->maxSlots > kMaxSlots) {
+        throw std::runtime_error(fmt::format("invalid `{}`: must be at most {}", kConfMaxSlots,
+                    kMaxSlots));
+    }
+
+    const auto interval = this->handler.beaconator->getInterval();
+    if((this->guardTime * 2) + (this->slotDuration * this->maxSlots) >= interval) {
+        throw std::runtime_error(fmt::format("superframe ({} slots of {} ms) doesn't fit in the "
+                    "beacon interval ({} ms)", this->maxSlots, this->slotDuration.count(),
+                    interval.count()));
+    }
+
+    if(this->enabled && !this->handler.radio->supportsBeaconTiming()) {
+        PLOG_WARNING << "superframe mode requires beacon timing support from the radio; disabled";
+        this->enabled = false;
+    }
+
+    PLOG_DEBUG << fmt::format("superframe: {}, guard {} ms, {} slots of {} ms",
+            this->enabled ? "enabled" : "disabled", this->guardTime.count(), this->maxSlots,
+            this->slotDuration.count());
+
+    // slots beyond the new limit are taken away
+    if(this->slots.size() > this->maxSlots) {
+        std::vector<uint16_t> evicted(this->slots.begin() + this->maxSlots, this->slots.end());
+        for(const auto address : evicted) {
+            if(address != kFreeSlot) {
+                this->counters.unassigned++;
+                this->remove(address);
+            }
+        }
+    }
+
+    if(!this->enabled) {
+        this->flush();
+    }
+    this->updateStructure();
+}
+
+
+
+/**
+ * @brief Update whether a node carries real time traffic
+ *
+ * Real time nodes are assigned a guaranteed time slot (if one is available); the slot of other
+ * nodes is freed. Slots are assigned even if superframe mode is disabled, so that they're ready
+ * to use when it's enabled.
+ *
+ * @param address Short address of the node
+ * @param realTime Whether the node wants a guaranteed time slot
+ */
+void Superframe::setRealTime(const uint16_t address, const bool realTime) {
+    if(!realTime) {
+        this->remove(address);
+        return;
+    } else if(this->findSlot(address)) {
+        return;
+    }
+
+    // reuse a freed slot, or append a new one
+    auto it = std::find(this->slots.begin(), this->slots.end(), kFreeSlot);
+    if(it != this->slots.end()) {
+        *it = address;
+    } else if(this->slots.size() < this->maxSlots) {
+        this->slots.push_back(address);
+    } else {
+        PLOG_WARNING << fmt::format("no guaranteed time slot available for ${:04x}", address);
+        this->counters.unassigned++;
+        return;
+    }
+
+    PLOG_VERBOSE << fmt::format("assigned slot {} to ${:04x}", *this->findSlot(address), address);
+    this->updateStructure();
+}
+
+/**
+ * @brief Remove a node's guaranteed time slot
+ *
+ * Any frames held for the slot are discarded.
+ *
+ * @param address Short address of the node
+ */
+void Superframe::remove(const uint16_t address) {
+    const auto slot = this->findSlot(address);
+    if(!slot) {
+        return;
+    }
+
+    this->slots[*slot] = kFreeSlot;
+    this->queues.erase(address);
+
+    while(!this->slots.empty() && this->slots.back() == kFreeSlot) {
+        this->slots.pop_back();
+    }
+
+    this->updateStructure();
+}
+
+/**
+ * @brief Hold a frame for the destination's guaranteed time slot
+ *
+ * Only real time frames are eligible, and only if the destination owns a slot and the superframe
+ * timing is known (a beacon was seen recently.)
+ *
+ * @param destination Short address of the node the frame is for
+ * @param priority Priority to transmit the frame at
+ * @param frame Full frame (including PHY header)
+ *
+ * @return Approximate time until the frame is transmitted, if it was queued; or an empty value if
+ *         it should be transmitted immediately instead
+ */
+std::optional<std::chrono::milliseconds> Superframe::enqueue(const uint16_t destination,
+        const Radio::PacketPriority priority, std::span<const std::byte> frame) {
+    using namespace std::chrono;
+
+    if(!this->enabled || priority != Radio::PacketPriority::RealTime) {
+        return std::nullopt;
+    }
+
+    const auto now = steady_clock::now();
+    const auto interval = this->handler.beaconator->getInterval();
+    if(!this->frameStart.time_since_epoch().count() || (now - this->frameStart) > (interval * 2)) {
+        return std::nullopt;
+    }
+
+    const auto slot = this->findSlot(destination);
+    if(!slot) {
+        return std::nullopt;
+    }
+
+    auto &queue = this->queues[destination];
+    if(queue.size() >= kMaxQueuedFrames) {
+        this->counters.overflows++;
+        return std::nullopt;
+    }
+
+    queue.emplace_back(Frame{
+        .priority = priority,
+        .data = {frame.begin(), frame.end()},
+    });
+
+    // slot already passed in this superframe: it goes out in the next one
+    auto end = this->slotStart(*slot) + this->slotDuration;
+    if(*slot < this->nextSlot) {
+        end += interval;
+    }
+    // assume (pessimistically) that each slot fits only one frame
+    end += interval * (queue.size() - 1);
+
+    this->armSlotTimer();
+
+    return duration_cast<milliseconds>(end - now) + milliseconds(1);
+}
+
+
+
+/**
+ * @brief Advertise the current superframe structure
+ *
+ * The structure is placed in the beacon, and the radio is told to keep all other traffic in the
+ * contention access period. Both are cleared if superframe mode is disabled.
+ */
+void Superframe::updateStructure() {
+    auto &radio = this->handler.radio;
+    auto &beaconator = this->handler.beaconator;
+
+    if(!this->enabled) {
+        beaconator->setSuperframe({});
+        radio->setContentionPeriod(std::nullopt);
+        return;
+    }
+
+    std::vector<std::byte> buffer(sizeof(NetControl::Superframe)
+            + (this->slots.size() * sizeof(uint16_t)));
+
+    auto structure = reinterpret_cast<NetControl::Superframe *>(buffer.data());
+    structure->guardTime = this->guardTime.count();
+    structure->slotDuration = this->slotDuration.count();
+    structure->numSlots = this->slots.size();
+    memcpy(structure->slots, this->slots.data(), this->slots.size() * sizeof(uint16_t));
+
+    beaconator->setSuperframe(buffer);
+    radio->setContentionPeriod(Radio::ContentionPeriod{
+        .start = this->getCapStart(),
+        .end = beaconator->getInterval() - this->guardTime,
+    });
+}
+
+/**
+ * @brief Transmit all held frames right away
+ */
+void Superframe::flush() {
+    this->slotTimer.reset();
+
+    auto temp = std::move(this->queues);
+    this->queues.clear();
+
+    for(auto &[address, queue] : temp) {
+        for(auto &frame : queue) {
+            try {
+                this->handler.radio->queueTransmitPacket(frame.priority, frame.data,
+                        this->handler.powerControl->getTxPower(address));
+            } catch(const std::exception &e) {
+                PLOG_WARNING << fmt::format("failed to flush frame for ${:04x}: {}", address,
+                        e.what());
+            }
+        }
+    }
+}
+
+
+
+/**
+ * @brief Handle a beacon transmission
+ *
+ * This starts a new superframe; schedule the release of frames held for slots.
+ *
+ * @param when Time at which the beacon was transmitted
+ */
+void Superframe::beaconSent(const std::chrono::steady_clock::time_point when) {
+    this->frameStart = when;
+    this->nextSlot = 0;
+
+    if(this->enabled) {
+        this->armSlotTimer();
+    }
+}
+
+/**
+ * @brief Arm the release timer for the next slot with frames
+ *
+ * The timer is disarmed if no more slots in the current superframe have frames waiting.
+ */
+void Superframe::armSlotTimer() {
+    using namespace std::chrono;
+
+    for(size_t i = this->nextSlot; i < this->slots.size(); i++) {
+        auto it = this->queues.find(this->slots[i]);
+        if(it == this->queues.end() || it->second.empty()) {
+            continue;
+        }
+
+        const auto delay = std::max(microseconds(0),
+                duration_cast<microseconds>(this->slotStart(i) - steady_clock::now()));
+
+        this->slotTimer = std::make_shared<TristLib::Event::Timer>(
+                TristLib::Event::RunLoop::Current(), delay, [this](auto) {
+            // keep the timer alive until its callback returns
+            auto timer = std::move(this->slotTimer);
+
+            try {
+                this->slotTimerFired();
+            } catch(const std::exception &e) {
+                PLOG_ERROR << fmt::format("failed to release slot frames: {}", e.what());
+            }
+        });
+        return;
+    }
+
+    this->slotTimer.reset();
+}
+
+/**
+ * @brief Release timer expired
+ *
+ * Release frames for all slots that have started, then wait for the next one.
+ */
+void Superframe::slotTimerFired() {
+    const auto now = std::chrono::steady_clock::now();
+
+    while(this->nextSlot < this->slots.size() && this->slotStart(this->nextSlot) <= now) {
+        this->releaseSlot(this->nextSlot);
+        this->nextSlot++;
+    }
+
+    this->armSlotTimer();
+}
+
+/**
+ * @brief Release the frames held for a slot
+ *
+ * As many frames as fit in the remainder of the slot (leaving time for an acknowledgement) are
+ * submitted to the radio; the rest wait for the next superframe.
+ *
+ * @param slot Index of the slot to release
+ */
+void Superframe::releaseSlot(const size_t slot) {
+    const auto address = this->slots[slot];
+
+    auto it = this->queues.find(address);
+    if(it == this->queues.end() || it->second.empty()) {
+        return;
+    }
+
+    auto &queue = it->second;
+    const auto &channels = this->handler.radio->getRegion().channels;
+    const auto end = this->slotStart(slot) + this->slotDuration - kAckAllowance;
+
+    auto when = std::chrono::steady_clock::now();
+    size_t released{0};
+
+    while(!queue.empty()) {
+        auto &frame = queue.front();
+        const auto airtime = channels.airtime(frame.data.size());
+        if(when + airtime > end) {
+            break;
+        }
+
+        try {
+            this->handler.radio->queueTransmitPacket(frame.priority, frame.data,
+                    this->handler.powerControl->getTxPower(address), true);
+        } catch(const std::exception &e) {
+            PLOG_WARNING << fmt::format("failed to transmit slotted frame for ${:04x}: {}",
+                    address, e.what());
+        }
+
+        when += airtime;
+        released++;
+        queue.pop_front();
+    }
+
+    this->counters.slotted += released;
+    if(!released) {
+        this->counters.missedSlots++;
+    }
+}
+
+
+
+/**
+ * @brief Find the guaranteed time slot of a node
+ *
+ * @param address Short address of the node
+ *
+ * @return Slot index, or an empty value if the node has no slot
+ */
+std::optional<size_t> Superframe::findSlot(const uint16_t address) const {
+    auto it = std::find(this->slots.begin(), this->slots.end(), address);
+    if(it == this->slots.end()) {
+        return std::nullopt;
+    }
+    return std::distance(this->slots.begin(), it);
+}
+
+/**
+ * @brief Get the start time of a slot in the current superframe
+ *
+ * @param slot Slot index
+ */
+std::chrono::steady_clock::time_point Superframe::slotStart(const size_t slot) const {
+    return this->frameStart + this->guardTime + (this->slotDuration * slot);
+}
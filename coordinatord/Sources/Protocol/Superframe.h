@@ -0,0 +1,181 @@
+#ifndef PROTOCOL_SUPERFRAME_H
+#define PROTOCOL_SUPERFRAME_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Radio.h"
+
+namespace TristLib::Event {
+class Timer;
+}
+
+namespace Protocol {
+class Handler;
+
+/**
+ * @brief Superframe scheduler
+ *
+ * When enabled, each beacon interval is divided into a superframe: the beacon (surrounded by a
+ * guard time), followed by guaranteed time slots (GTS) for nodes that carry real time traffic, and
+ * finally the contention access period (CAP) for everything else. The structure is advertised in
+ * the beacon.
+ *
+ * Real time frames to a node that owns a slot are held here, and released to the radio at the
+ * start of the node's slot. The slot timing is derived from the beacon transmit times reported by
+ * the radio, so this requires firmware support for beacon timing. All other traffic is restricted
+ * to the CAP by the radio, so it can neither collide with the beacon nor with slotted frames.
+ *
+ * Slots are assigned when a node that requested one associates, and keep their position until the
+ * node leaves; nodes that can't get a slot fall back to contending in the CAP.
+ */
+class Superframe {
+    private:
+        /// Config key for whether superframe mode is enabled
+        constexpr static const std::string_view kConfEnabled{"protocol.superframe.enabled"};
+        /// Config key for the guard time around beacons (msec)
+        constexpr static const std::string_view kConfGuardTime{"protocol.superframe.guardTime"};
+        /// Config key for the duration of a guaranteed time slot (msec)
+        constexpr static const std::string_view kConfSlotDuration{
+            "protocol.superframe.slotDuration"};
+        /// Config key for the maximum number of guaranteed time slots
+        constexpr static const std::string_view kConfMaxSlots{"protocol.superframe.maxSlots"};
+
+        /// Default guard time around beacons
+        constexpr static const std::chrono::milliseconds kDefaultGuardTime{5};
+        /// Default duration of a guaranteed time slot
+        constexpr static const std::chrono::milliseconds kDefaultSlotDuration{10};
+        /// Default maximum number of guaranteed time slots
+        constexpr static const size_t kDefaultMaxSlots{16};
+
+        /**
+         * @brief Upper bound for the number of guaranteed time slots
+         *
+         * Limited by the space in the beacon frame, which must also fit the pending traffic map.
+         */
+        constexpr static const size_t kMaxSlots{48};
+        /// Maximum number of frames held for a single slot; more are sent in the CAP
+        constexpr static const size_t kMaxQueuedFrames{8};
+        /// Time reserved in a slot for the acknowledgement of the last frame
+        constexpr static const std::chrono::microseconds kAckAllowance{1'000};
+
+        /// Marker for a slot that's not assigned to any node
+        constexpr static const uint16_t kFreeSlot{0xFFFF};
+
+    public:
+        /**
+         * @brief Superframe counters
+         */
+        struct Counters {
+            /// Frames transmitted in a guaranteed time slot
+            uint_least64_t slotted{0};
+            /// Frames sent in the CAP because their slot's queue was full
+            uint_least64_t overflows{0};
+            /// Slots that were missed because the release timer fired too late
+            uint_least64_t missedSlots{0};
+            /// Nodes that requested a slot but couldn't get one
+            uint_least64_t unassigned{0};
+        };
+
+    private:
+        /**
+         * @brief A frame held for a guaranteed time slot
+         */
+        struct Frame {
+            /// Priority to transmit the frame at
+            Radio::PacketPriority priority;
+            /// Frame data (including PHY header)
+            std::vector<std::byte> data;
+        };
+
+    public:
+        Superframe(Handler &handler);
+        ~Superframe();
+
+        void reloadConfig();
+
+        /**
+         * @brief Determine whether superframe mode is enabled
+         */
+        constexpr inline bool isEnabled() const {
+            return this->enabled;
+        }
+
+        void setRealTime(const uint16_t address, const bool realTime);
+        void remove(const uint16_t address);
+
+        std::optional<std::chrono::milliseconds> enqueue(const uint16_t destination,
+                const Radio::PacketPriority priority, std::span<const std::byte> frame);
+
+        /**
+         * @brief Get the owners of all guaranteed time slots
+         *
+         * Unassigned slots are marked with 0xFFFF.
+         */
+        inline const auto &getSlots() const {
+            return this->slots;
+        }
+        /**
+         * @brief Get the start of the contention access period (relative to the beacon)
+         */
+        inline auto getCapStart() const {
+            return this->guardTime + (this->slotDuration * this->slots.size());
+        }
+        /**
+         * @brief Get the performance counters
+         */
+        inline const auto &getCounters() const {
+            return this->counters;
+        }
+
+    private:
+        void updateStructure();
+        void flush();
+
+        void beaconSent(const std::chrono::steady_clock::time_point when);
+        void armSlotTimer();
+        void slotTimerFired();
+        void releaseSlot(const size_t slot);
+
+        std::optional<size_t> findSlot(const uint16_t address) const;
+        std::chrono::steady_clock::time_point slotStart(const size_t slot) const;
+
+    private:
+        /// Handle to the protocol handler that owns us
+        Handler &handler;
+
+        /// Whether superframe mode is enabled
+        bool enabled{false};
+        /// Guard time around beacons
+        std::chrono::milliseconds guardTime{kDefaultGuardTime};
+        /// Duration of a guaranteed time slot
+        std::chrono::milliseconds slotDuration{kDefaultSlotDuration};
+        /// Maximum number of guaranteed time slots
+        size_t maxSlots{kDefaultMaxSlots};
+
+        /// Owner of each guaranteed time slot (trailing free slots are removed)
+        std::vector<uint16_t> slots;
+        /// Frames held for each node with a slot
+        std::unordered_map<uint16_t, std::deque<Frame>> queues;
+
+        /// Start time of the current superframe (when its beacon was transmitted)
+        std::chrono::steady_clock::time_point frameStart{};
+        /// Next slot in the current superframe the release timer considers
+        size_t nextSlot{0};
+        /// Timer to release frames at the start of their slot (only exists while armed)
+        std::shared_ptr<TristLib::Event::Timer> slotTimer;
+
+        /// Performance counters
+        Counters counters{};
+};
+}
+
+#endif
@@ -0,0 +1,256 @@
+#include <algorithm>
+
+#include "TimerWheel.h"
+
+using namespace Protocol;
+
+/**
+ * @brief Initialize the timer wheel
+ *
+ * @param resolution Duration of a single tick of the wheel; timeouts are rounded up to it
+ */
+TimerWheel::TimerWheel(const std::chrono::milliseconds _resolution) :
+    resolution(std::max(_resolution, std::chrono::milliseconds(1))),
+    epoch(std::chrono::steady_clock::now()) {
+    std::fill(this->slots.begin(), this->slots.end(), kNil);
+}
+
+
+
+/**
+ * @brief Schedule a new timer
+ *
+ * @param timeout Time from now after which the timer expires
+ * @param cookie Arbitrary value passed to the expiry callback
+ *
+ * @return Handle to the timer, which can be used to cancel it
+ */
+TimerWheel::Handle TimerWheel::schedule(const std::chrono::milliseconds timeout,
+        const uint64_t cookie) {
+    const auto now = this->ticksFor(std::chrono::steady_clock::now());
+
+    // if idle, the wheel may have fallen behind: catch up (nothing to expire anyways)
+    if(!this->numActive) {
+        this->currentTick = std::max(this->currentTick, now);
+    }
+
+    // get an entry (either from the free list, or by growing the slab)
+    uint32_t index;
+    if(this->freeHead != kNil) {
+        index = this->freeHead;
+        this->freeHead = this->entries[index].next;
+    } else {
+        index = this->entries.size();
+        this->entries.emplace_back();
+    }
+
+    // calculate expiration (rounded up to the next tick)
+    const uint64_t ticks = (timeout.count() + this->resolution.count() - 1)
+        / this->resolution.count();
+
+    auto &entry = this->entries[index];
+    entry.cookie = cookie;
+    entry.expires = std::max(this->currentTick + 1, now + std::min(ticks, kMaxTicks));
+    entry.expires = std::min(entry.expires, this->currentTick + kMaxTicks);
+
+    this->link(index);
+    this->numActive++;
+
+    return (static_cast<uint64_t>(entry.generation) << 32) | index;
+}
+
+/**
+ * @brief Cancel a previously scheduled timer
+ *
+ * @param handle Timer handle as returned by schedule()
+ *
+ * @return Whether the timer was cancelled; false if it already expired or the handle is invalid
+ */
+bool TimerWheel::cancel(const Handle handle) {
+    const uint32_t index = handle & 0xFFFFFFFF;
+    const uint32_t generation = handle >> 32;
+
+    if(index >= this->entries.size()) {
+        return false;
+    }
+
+    const auto &entry = this->entries[index];
+    if(entry.generation != generation || entry.slot == kNil) {
+        return false;
+    }
+
+    this->unlink(index);
+    this->release(index);
+    this->numActive--;
+
+    return true;
+}
+
+/**
+ * @brief Advance the wheel
+ *
+ * Process all ticks between the last invocation and the given time, and invoke the callback for
+ * each timer that expired. The callback may schedule or cancel timers.
+ *
+ * @param now Current time
+ * @param callback Function to invoke for each expired timer
+ *
+ * @return Number of timers that expired
+ */
+size_t TimerWheel::advance(const std::chrono::steady_clock::time_point now,
+        const ExpiryCallback &callback) {
+    const auto target = this->ticksFor(now);
+    size_t expired{0};
+
+    // fast path: nothing scheduled, so just catch up
+    if(!this->numActive) {
+        this->currentTick = std::max(this->currentTick, target);
+        return 0;
+    }
+
+    while(this->currentTick < target) {
+        this->currentTick++;
+
+        // cascade higher levels, whenever the lower level wraps around
+        for(size_t level = 1; level < kLevels; level++) {
+            if((this->currentTick >> (kSlotBits * (level - 1))) & kSlotMask) {
+                break;
+            }
+            this->cascade(level);
+        }
+
+        // then expire everything in the current slot
+        auto &head = this->slots[this->currentTick & kSlotMask];
+        while(head != kNil) {
+            const auto index = head;
+            const auto cookie = this->entries[index].cookie;
+            const Handle handle = (static_cast<uint64_t>(this->entries[index].generation) << 32)
+                | index;
+
+            this->unlink(index);
+            this->release(index);
+            this->numActive--;
+            expired++;
+
+            callback(handle, cookie);
+        }
+
+        if(!this->numActive) {
+            this->currentTick = target;
+            break;
+        }
+    }
+
+    return expired;
+}
+
+/**
+ * @brief Remove all timers
+ *
+ * None of the timers' callbacks are invoked. The slab is retained.
+ */
+void TimerWheel::clear() {
+    std::fill(this->slots.begin(), this->slots.end(), kNil);
+
+    this->freeHead = kNil;
+    for(size_t i = 0; i < this->entries.size(); i++) {
+        auto &entry = this->entries[i];
+        if(entry.slot != kNil) {
+            entry.slot = kNil;
+            entry.generation = std::max(entry.generation + 1, 1U);
+        }
+
+        entry.next = this->freeHead;
+        this->freeHead = i;
+    }
+
+    this->numActive = 0;
+}
+
+
+
+/**
+ * @brief Convert a time point to a tick index
+ */
+uint64_t TimerWheel::ticksFor(const std::chrono::steady_clock::time_point when) const {
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(when - this->epoch);
+    return std::max<int64_t>(0, elapsed.count()) / this->resolution.count();
+}
+
+/**
+ * @brief Insert an entry into the appropriate slot
+ *
+ * The level is determined based on how far in the future the entry expires, relative to the
+ * current tick.
+ */
+void TimerWheel::link(const uint32_t index) {
+    auto &entry = this->entries[index];
+    const uint64_t delta = entry.expires - std::min(entry.expires, this->currentTick);
+
+    size_t level{0};
+    while(level < (kLevels - 1) && delta >= (1ULL << (kSlotBits * (level + 1)))) {
+        level++;
+    }
+
+    const uint32_t slot = (level * kSlots) + ((entry.expires >> (kSlotBits * level)) & kSlotMask);
+
+    entry.slot = slot;
+    entry.prev = kNil;
+    entry.next = this->slots[slot];
+
+    if(entry.next != kNil) {
+        this->entries[entry.next].prev = index;
+    }
+    this->slots[slot] = index;
+}
+
+/**
+ * @brief Remove an entry from the slot it's in
+ */
+void TimerWheel::unlink(const uint32_t index) {
+    auto &entry = this->entries[index];
+
+    if(entry.prev != kNil) {
+        this->entries[entry.prev].next = entry.next;
+    } else {
+        this->slots[entry.slot] = entry.next;
+    }
+    if(entry.next != kNil) {
+        this->entries[entry.next].prev = entry.prev;
+    }
+
+    entry.slot = entry.next = entry.prev = kNil;
+}
+
+/**
+ * @brief Return an (unlinked) entry to the free list
+ *
+ * Its generation counter is incremented, which invalidates all outstanding handles to it.
+ */
+void TimerWheel::release(const uint32_t index) {
+    auto &entry = this->entries[index];
+
+    entry.generation = std::max(entry.generation + 1, 1U);
+    entry.next = this->freeHead;
+    this->freeHead = index;
+}
+
+/**
+ * @brief Redistribute the current slot of the given level
+ *
+ * All entries in the slot are moved down into lower levels, based on their expiration relative
+ * to the current tick.
+ */
+void TimerWheel::cascade(const size_t level) {
+    const auto slot = (level * kSlots)
+        + ((this->currentTick >> (kSlotBits * level)) & kSlotMask);
+
+    auto index = this->slots[slot];
+    this->slots[slot] = kNil;
+
+    while(index != kNil) {
+        const auto next = this->entries[index].next;
+        this->link(index);
+        index = next;
+    }
+}
@@ -0,0 +1,137 @@
+#ifndef PROTOCOL_TIMERWHEEL_H
+#define PROTOCOL_TIMERWHEEL_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace Protocol {
+/**
+ * @brief Hierarchical timer wheel
+ *
+ * Manages a large number of (mostly short lived) timeouts, without requiring a separate event loop
+ * timer for each of them. The wheel is advanced by its owner (usually from a single periodic
+ * timer) and invokes a callback for every timeout that has expired since the last advance.
+ *
+ * Timers are stored in a slab of entries, linked into the slots of the wheel by index, so that
+ * scheduling and cancelling a timer are both constant time operations that don't allocate once
+ * the slab has grown to its working size.
+ *
+ * There are four levels with 64 slots each; with the default 10ms resolution, this covers
+ * timeouts of up to about 46 hours. Longer timeouts are clamped.
+ */
+class TimerWheel {
+    public:
+        /**
+         * @brief Timer handle
+         *
+         * Uniquely identifies a scheduled timer. The low 32 bits are the index into the entry
+         * slab, while the high 32 bits are a generation counter to detect stale handles.
+         */
+        using Handle = uint64_t;
+        /// Handle value that never refers to a valid timer
+        constexpr static const Handle kInvalidHandle{0};
+
+        /**
+         * @brief Callback invoked for expired timers
+         *
+         * @param handle Handle of the timer that expired (it's no longer valid when invoked)
+         * @param cookie Caller-defined value specified when the timer was scheduled
+         */
+        using ExpiryCallback = std::function<void(const Handle handle, const uint64_t cookie)>;
+
+    private:
+        /// Number of bits of the tick index used per level
+        constexpr static const size_t kSlotBits{6};
+        /// Number of slots per level
+        constexpr static const size_t kSlots{1U << kSlotBits};
+        /// Mask for a slot index
+        constexpr static const uint64_t kSlotMask{kSlots - 1};
+        /// Number of levels in the wheel
+        constexpr static const size_t kLevels{4};
+        /// Maximum timeout (in ticks) that can be represented
+        constexpr static const uint64_t kMaxTicks{(1ULL << (kSlotBits * kLevels)) - 1};
+
+        /// Index value used to indicate the end of a slot's list
+        constexpr static const uint32_t kNil{UINT32_MAX};
+
+        /**
+         * @brief A single timer entry
+         */
+        struct Entry {
+            /// Absolute tick at which the timer expires
+            uint64_t expires{0};
+            /// Caller-provided value
+            uint64_t cookie{0};
+
+            /// Next entry in the same slot (or free list)
+            uint32_t next{kNil};
+            /// Previous entry in the same slot
+            uint32_t prev{kNil};
+            /// Generation counter, incremented every time the entry is released
+            uint32_t generation{1};
+            /// Slot the entry is linked into (kNil if not scheduled)
+            uint32_t slot{kNil};
+        };
+
+    public:
+        TimerWheel(const std::chrono::milliseconds resolution = std::chrono::milliseconds(10));
+
+        Handle schedule(const std::chrono::milliseconds timeout, const uint64_t cookie);
+        bool cancel(const Handle handle);
+        size_t advance(const std::chrono::steady_clock::time_point now,
+                const ExpiryCallback &callback);
+        void clear();
+
+        /**
+         * @brief Get the number of timers currently scheduled
+         */
+        constexpr inline size_t size() const {
+            return this->numActive;
+        }
+        /**
+         * @brief Check whether there are any scheduled timers
+         */
+        constexpr inline bool empty() const {
+            return !this->numActive;
+        }
+
+        /**
+         * @brief Get the tick resolution of the wheel
+         */
+        constexpr inline auto getResolution() const {
+            return this->resolution;
+        }
+
+    private:
+        uint64_t ticksFor(const std::chrono::steady_clock::time_point) const;
+
+        void link(const uint32_t index);
+        void unlink(const uint32_t index);
+        void release(const uint32_t index);
+        void cascade(const size_t level);
+
+    private:
+        /// Duration of a single tick
+        std::chrono::milliseconds resolution;
+        /// Reference point for tick calculation
+        std::chrono::steady_clock::time_point epoch;
+        /// Tick up to (and including) which all timers have been processed
+        uint64_t currentTick{0};
+
+        /// Entry slab
+        std::vector<Entry> entries;
+        /// Head of the free entry list
+        uint32_t freeHead{kNil};
+        /// Number of currently scheduled timers
+        size_t numActive{0};
+
+        /// Head of each slot's entry list, for all levels
+        std::array<uint32_t, kLevels * kSlots> slots;
+};
+}
+
+#endif
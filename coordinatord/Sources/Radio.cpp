@@ -2,7 +2,6 @@
 #include <cstring>
 #include <functional>
 #include <stdexcept>
-#include <event2/event.h>
 #include <fmt/format.h>
 
 #include <TristLib/Core.h>
@@ -10,10 +9,12 @@
 
 #include "Config/Reader.h"
 #include "Support/Confd.h"
+#include "Support/Crc32.h"
 #include "Transports/Base.h"
 #include "Transports/Commands.h"
 
 #include "Radio.h"
+#include "RadioUpdater.h"
 
 /**
  * @brief Initialize the radio handler
@@ -39,38 +40,14 @@ Radio::Radio(const std::shared_ptr<Transports::TransportBase> &_transport) : tra
         }
     }
 
-    /*
-     * Read out general information about the radio, to ensure that we can successfully
-     * communicate with it, and store it for later.
-     */
-    Transports::Response::GetInfo info;
-    this->queryRadioInfo(info);
-
-    if(info.fw.protocolVersion != kProtocolVersion) {
-        throw std::runtime_error(fmt::format("incompatible radio protocol version ${:02x}",
-                    info.fw.protocolVersion));
-    }
-
-    memcpy(this->eui64.data(), info.hw.eui64, sizeof(info.hw.eui64));
-    this->serial = std::string(info.hw.serial, strnlen(info.hw.serial, sizeof(info.hw.serial)));
-    this->fwVersion = std::string(info.fw.build, strnlen(info.fw.build, sizeof(info.fw.build)));
-
-    PLOG_INFO << "Radio s/n: " << this->serial << ", EUI64: " <<
-        fmt::format("{:02x}:{:02x}:{:02x}:{:02x}:{:02x}:{:02x}:{:02x}:{:02x}", this->eui64[0],
-                this->eui64[1], this->eui64[2], this->eui64[3], this->eui64[4], this->eui64[5],
-                this->eui64[6], this->eui64[7]);
-
-    this->maxTxPower = this->currentTxPower = info.radio.maxTxPower;
+    // make sure we can talk to the radio, and find out what it supports
+    this->identify();
+    this->currentTxPower = this->maxTxPower;
 
     /*
      * Do initial setup: configure interrupts and set up performance counter stuff
      */
-    Transports::Request::IrqConfig irqConf{};
-    irqConf.rxQueueNotEmpty = true;
-    irqConf.txQueueEmpty = true;
-
-    this->setIrqConfig(irqConf);
-
+    this->configureIrqs();
     this->initCounterReader();
 
     /*
@@ -79,6 +56,8 @@ Radio::Radio(const std::shared_ptr<Transports::TransportBase> &_transport) : tra
      * refresh the radio config at runtime.
      */
     this->reloadConfig(true);
+
+    this->updater = std::make_unique<RadioUpdater>(*this);
 }
 
 /**
@@ -88,9 +67,11 @@ Radio::Radio(const std::shared_ptr<Transports::TransportBase> &_transport) : tra
  */
 Radio::~Radio() {
     // reset background timers
+    this->updater.reset();
     this->counterReader.reset();
     this->irqWatchdog.reset();
     this->pollTimer.reset();
+    this->txHoldoffTimer.reset();
 }
 
 
@@ -118,14 +99,26 @@ void Radio::reloadConfig(const bool upload) {
         throw std::runtime_error("failed to read `radio.phy.txPower`");
     }
 
-    const size_t deciDbmTx = std::max(0., *txPower * 10.);
+    size_t deciDbmTx = std::max(0., *txPower * 10.);
+
+    // apply the limits of the regulatory domain
+    const auto &region = Config::GetRegion();
+    if(deciDbmTx > region.maxTxPower) {
+        PLOG_WARNING << fmt::format("tx power {} dBm exceeds limit for region {}; using {} dBm",
+                deciDbmTx / 10., region.name, region.maxTxPower / 10.);
+        deciDbmTx = region.maxTxPower;
+    }
+
     this->setTxPower(deciDbmTx);
 
+    {
+        std::lock_guard lg(this->txQueueLock);
+        this->airtime.setRegion(region);
+    }
+
     PLOG_VERBOSE << "Read radio config: channel=" << *channel << ", tx power="
         << (deciDbmTx / 10.) << " dBm";
 
-    // TODO: set regulatory domain
-
     // radio short address (from config file)
     auto item = Config::GetConfig().at_path("network.addresses.mine");
     if(!item || !item.is_number()) {
@@ -151,6 +144,12 @@ void Radio::uploadConfig() {
     // build the command
     Transports::Request::RadioConfig conf{};
 
+    const auto &region = this->airtime.getRegion();
+    if(!region.channels.contains(this->currentChannel)) {
+        throw std::invalid_argument(fmt::format("channel {} is not permitted in region {}",
+                    this->currentChannel, region.name));
+    }
+
     conf.channel = this->currentChannel;
     conf.txPower = this->currentTxPower;
     conf.myAddress = this->currentShortAddress;
@@ -165,6 +164,47 @@ void Radio::uploadConfig() {
     this->isConfigDirty = false;
 }
 
+/**
+ * @brief Restart the radio
+ *
+ * Reset the radio (booting any newly committed firmware) and restore its entire configuration:
+ * interrupts, PHY configuration and beacons. The radio's information is read out again, since
+ * its firmware (and thus its features) may have changed.
+ *
+ * Packets still in the radio's transmit queue are lost, while those in our queue are kept, and
+ * sent once the radio is back up.
+ */
+void Radio::restart() {
+    {
+        std::lock_guard lg(this->transportLock);
+
+        // don't lose the counts accumulated since they were last read
+        this->queryCounters();
+
+        this->transport->reset();
+        this->identify();
+        this->configureIrqs();
+    }
+
+    {
+        std::lock_guard lg(this->txQueueLock);
+        this->beaconCount = 0;
+    }
+
+    this->uploadConfig();
+
+    const auto interval = this->beaconInterval;
+    if(interval.count()) {
+        this->setBeaconConfig(true, interval, this->beaconFrame, true);
+    }
+
+    // resume transmitting whatever piled up in the meantime
+    {
+        std::lock_guard lg(this->transportLock);
+        this->drainTxQueue();
+    }
+}
+
 /**
  * @brief Inscrete a packet for transmission
  *
@@ -176,33 +216,59 @@ void Radio::uploadConfig() {
  *
  * @param priority Priority level of the packet (for queuing)
  * @param payload Packet data to transmit (including PHY and MAC headers)
+ * @param txPower Transmit power for this packet (in ⅒th dBm); ignored if the radio doesn't support
+ *        per-packet transmit power
+ * @param inSlot Whether the packet is sent in a guaranteed time slot; it's not held until the
+ *        contention access period, even if it has to be queued
  */
 void Radio::queueTransmitPacket(const PacketPriority priority,
-        std::span<const std::byte> payload) {
-    // if queue is empty, transmit the packet right away
+        std::span<const std::byte> payload, const std::optional<uint8_t> txPower,
+        const bool inSlot) {
+    // refuse packets that could never be sent legally
+    const auto &region = this->airtime.getRegion();
+    const auto length = this->airtime.airtimeFor(payload.size());
+
+    if(region.maxDwell.count() && length > region.maxDwell) {
+        throw std::invalid_argument(fmt::format("packet airtime ({} µs) exceeds dwell limit",
+                    length.count()));
+    }
+
+    // if queue is empty, transmit the packet right away (if there's airtime for it)
     std::lock_guard lg(this->txQueueLock);
+    bool deferred{false};
+
     if(std::all_of(this->txQueues.begin(), this->txQueues.end(),
                 std::bind(&TxQueue::empty, std::placeholders::_1))) {
-        // build the request header
-        Transports::Request::TransmitPacket header{};
-        header.priority = static_cast<uint8_t>(priority);
+        const auto delay = this->getTxDelay(priority, length, inSlot, deferred);
 
-        // transmit to radio
-        std::lock_guard lg(this->transportLock);
+        if(!delay.count()) {
+            // build the request header
+            Transports::Request::TransmitPacket header{};
+            header.priority = static_cast<uint8_t>(priority);
 
-        try {
-            this->transmitPacket(header, payload);
+            // transmit to radio
+            std::lock_guard lg(this->transportLock);
 
-            // on success, we're done
-            return;
-        } catch(const std::exception &e) {
-            PLOG_WARNING << "failed to direct tx packet: " << e.what();
+            try {
+                this->transmitPacket(header, payload, txPower);
+                this->airtime.consume(this->currentChannel, length);
+
+                // on success, we're done
+                return;
+            } catch(const std::exception &e) {
+                PLOG_WARNING << "failed to direct tx packet: " << e.what();
+            }
+        } else {
+            this->armTxHoldoff(delay);
         }
     }
 
     // otherwise (on error or stuff in queue,) queue the packet as normal for later
     auto pbuf = std::make_unique<TxPacket>();
     pbuf->priority = priority;
+    pbuf->txPower = txPower;
+    pbuf->inSlot = inSlot;
+    pbuf->deferred = deferred;
     pbuf->payload.resize(payload.size());
     std::copy(payload.begin(), payload.end(), pbuf->payload.begin());
 
@@ -215,6 +281,8 @@ void Radio::queueTransmitPacket(const PacketPriority priority,
  * Transmit the packet to the radio for transmission over the air.
  *
  * @param packet Packet buffer previously queued
+ *
+ * @remark The caller must hold the transport lock.
  */
 void Radio::transmitPacket(const std::unique_ptr<TxPacket> &packet) {
     // build the request header
@@ -222,8 +290,7 @@ void Radio::transmitPacket(const std::unique_ptr<TxPacket> &packet) {
     header.priority = static_cast<uint8_t>(packet->priority);
 
     // perform the command
-    std::lock_guard lg(this->transportLock);
-    this->transmitPacket(header, packet->payload);
+    this->transmitPacket(header, packet->payload, packet->txPower);
 }
 
 /**
@@ -234,17 +301,20 @@ void Radio::transmitPacket(const std::unique_ptr<TxPacket> &packet) {
  */
 void Radio::setBeaconConfig(const bool enabled, const std::chrono::milliseconds interval,
         std::span<const std::byte> payload, const bool updateConfig) {
-    // validate inputs
-    if(interval.count() < kMinBeaconInterval) {
-        throw std::invalid_argument(fmt::format("interval too small (min {} msec)",
-                    kMinBeaconInterval));
-    } else if(interval.count() > UINT16_MAX) {
-        throw std::invalid_argument(fmt::format("interval too large (max {} msec)", UINT16_MAX));
+    // validate inputs (the interval is ignored if only the payload is updated)
+    if(updateConfig) {
+        if(interval.count() < kMinBeaconInterval) {
+            throw std::invalid_argument(fmt::format("interval too small (min {} msec)",
+                        kMinBeaconInterval));
+        } else if(interval.count() > UINT16_MAX) {
+            throw std::invalid_argument(fmt::format("interval too large (max {} msec)",
+                        UINT16_MAX));
+        }
     }
 
-    // prepare a buffer of the appropriate size
-    std::vector<std::byte> buf;
-    buf.resize(sizeof(Transports::Request::BeaconConfig) + payload.size());
+    // prepare the command buffer (reused between calls, to avoid reallocating)
+    auto &buf = this->beaconCmdBuffer;
+    buf.assign(sizeof(Transports::Request::BeaconConfig) + payload.size(), std::byte(0));
 
     auto cmd = reinterpret_cast<Transports::Request::BeaconConfig *>(buf.data());
     new(cmd) Transports::Request::BeaconConfig;
@@ -255,10 +325,14 @@ void Radio::setBeaconConfig(const bool enabled, const std::chrono::milliseconds
     if(updateConfig) {
         cmd->enabled = enabled;
         cmd->interval = interval.count();
+
+        std::lock_guard lg(this->txQueueLock);
+        this->beaconInterval = enabled ? interval : std::chrono::milliseconds(0);
     }
 
     if(!payload.empty()) {
         memcpy(cmd->data, payload.data(), payload.size());
+        this->beaconFrame.assign(payload.begin(), payload.end());
     }
 
     // transmit the command
@@ -396,10 +470,14 @@ void Radio::initPolling(const std::chrono::milliseconds interval) {
 void Radio::pollTimerFired() {
     Transports::Response::IrqStatus irq{};
 
-    std::lock_guard lg(this->transportLock);
-    this->getPendingInterrupts(irq);
+    {
+        std::lock_guard lg(this->transportLock);
+        this->getPendingInterrupts(irq);
+
+        this->irqHandlerCommon(irq);
+    }
 
-    this->irqHandlerCommon(irq);
+    this->dispatchReceivedPackets();
 }
 
 
@@ -447,18 +525,22 @@ void Radio::irqWatchdogFired() {
     double msec = std::chrono::duration_cast<std::chrono::milliseconds>(now - this->lastIrq).count();
 
     if(msec > kIrqWatchdogThreshold) {
-        std::lock_guard lg(this->transportLock);
-        this->getPendingInterrupts(irq);
+        {
+            std::lock_guard lg(this->transportLock);
+            this->getPendingInterrupts(irq);
 
-        if(*((uint8_t *) &irq)) {
-            this->numLostIrqs++;
+            if(*((uint8_t *) &irq)) {
+                this->numLostIrqs++;
 
-            if(kIrqWatchdogLogging) {
-                PLOG_WARNING << fmt::format("Lost IRQ: 0b{:08b}", *((uint8_t *) &irq));
+                if(kIrqWatchdogLogging) {
+                    PLOG_WARNING << fmt::format("Lost IRQ: 0b{:08b}", *((uint8_t *) &irq));
+                }
             }
+
+            this->irqHandlerCommon(irq);
         }
 
-        this->irqHandlerCommon(irq);
+        this->dispatchReceivedPackets();
     }
 }
 
@@ -473,10 +555,14 @@ void Radio::irqHandler() {
     this->irqCounter++;
 
     // get the pending interrupts flag
-    std::lock_guard lg(this->transportLock);
+    {
+        std::lock_guard lg(this->transportLock);
+
+        this->getPendingInterrupts(irq);
+        this->irqHandlerCommon(irq);
+    }
 
-    this->getPendingInterrupts(irq);
-    this->irqHandlerCommon(irq);
+    this->dispatchReceivedPackets();
 }
 
 /**
@@ -493,6 +579,9 @@ void Radio::irqHandlerCommon(const Transports::Response::IrqStatus &irq) {
                 this->readPacket(keepReading);
             }
         }
+        if(irq.beaconSent && this->hasBeaconTiming) {
+            this->readBeaconTiming();
+        }
         if(irq.txQueueEmpty) {
             this->drainTxQueue();
         }
@@ -531,13 +620,49 @@ void Radio::readPacket(bool &outRead) {
     packetData.resize(status.rxPacketSize);
     this->readPacket(packet, packetData);
     outRead = true;
+
+    // stash it until the radio is released
+    this->rxPending.emplace_back(RxPacket{packet.rssi, packet.lqi, std::move(packetData)});
+}
+
+/**
+ * @brief Invoke receive handlers for all previously read packets
+ *
+ * Beacon handlers are invoked first, if a beacon was transmitted since the last call.
+ *
+ * This must be called without the transport lock held, since receive handlers may want to submit
+ * packets for transmission.
+ */
+void Radio::dispatchReceivedPackets() {
+    if(this->beaconPending) {
+        this->beaconPending = false;
+
+        for(const auto &handler : this->beaconHandlers) {
+            handler(this->lastBeacon);
+        }
+    }
+
+    if(this->rxPending.empty()) {
+        return;
+    }
+
+    auto packets = std::move(this->rxPending);
+    this->rxPending.clear();
+
+    for(const auto &packet : packets) {
+        for(const auto &handler : this->rxHandlers) {
+            handler(packet.payload, packet.rssi, packet.lqi);
+        }
+    }
 }
 
 /**
  * @brief Read packets out of our internal queue until the radio says "no more"
  *
- * This will write packets to the radio until a transmit command fails, or all buffered packets
- * have been dealt with.
+ * This will write packets to the radio until a transmit command fails, the next packet may not be
+ * transmitted yet (due to the airtime allowance or contention access period), or all buffered
+ * packets have been dealt with. In the second case, a timer is armed to resume draining once the
+ * packet may be transmitted.
  *
  * @return Whether any packets were sent to the radio
  */
@@ -555,8 +680,24 @@ bool Radio::drainTxQueue() {
 
         // pop a packet buffer to read
         auto &packet = queue.front();
+
+        /*
+         * Hold off if there's not enough airtime for the packet, or it may not be sent at this
+         * point in the superframe. Lower priorities are held to stricter limits, so there's no
+         * point in trying their queues either.
+         */
+        const auto length = this->airtime.airtimeFor(packet->payload.size());
+        const auto delay = this->getTxDelay(packet->priority, length, packet->inSlot,
+                packet->deferred);
+
+        if(delay.count()) {
+            this->armTxHoldoff(delay);
+            return sent;
+        }
+
         try {
             this->transmitPacket(packet);
+            this->airtime.consume(this->currentChannel, length);
             sent = true;
         }
         // if this fails, abort the drainage process
@@ -572,6 +713,181 @@ bool Radio::drainTxQueue() {
     return sent;
 }
 
+/**
+ * @brief Determine how long a packet must be held
+ *
+ * Packets are held until there's enough airtime for them, and (unless they are network control
+ * packets or sent in a guaranteed time slot) until they fit in the contention access period.
+ * Packets held for lack of airtime are counted as deferred, once per packet: this is checked again
+ * every time the queue is drained.
+ *
+ * @param priority Priority of the packet
+ * @param length Time on air of the packet
+ * @param inSlot Whether the packet is sent in a guaranteed time slot
+ * @param deferred Whether the packet was already counted as deferred; set once it is
+ *
+ * @return Time until the packet may be transmitted, or zero if it may be transmitted now
+ *
+ * @remark The transmit queue lock must be held.
+ */
+std::chrono::microseconds Radio::getTxDelay(const PacketPriority priority,
+        const std::chrono::microseconds length, const bool inSlot, bool &deferred) {
+    const auto airtimeDelay = this->airtime.delayFor(this->currentChannel, length,
+            kAirtimeFloor.at(static_cast<size_t>(priority)));
+    if(airtimeDelay.count() && !deferred) {
+        this->airtime.deferred(this->currentChannel);
+        deferred = true;
+    }
+
+    if(inSlot || priority == PacketPriority::NetworkControl) {
+        return airtimeDelay;
+    }
+    return std::max(airtimeDelay, this->getContentionDelay(length));
+}
+
+/**
+ * @brief Determine how long until a packet fits in the contention access period
+ *
+ * The position in the superframe is extrapolated from the most recent beacon, so this works even
+ * if a few beacon notifications were missed.
+ *
+ * @param length Time on air of the packet
+ *
+ * @return Time until the packet may be transmitted, or zero if it may be transmitted now
+ */
+std::chrono::microseconds Radio::getContentionDelay(const std::chrono::microseconds length) {
+    using namespace std::chrono;
+
+    if(!this->contention || !this->beaconInterval.count() ||
+            !this->lastBeacon.time_since_epoch().count()) {
+        return microseconds(0);
+    }
+
+    const auto interval = duration_cast<microseconds>(this->beaconInterval);
+    const auto &period = *this->contention;
+
+    const auto elapsed = duration_cast<microseconds>(steady_clock::now() - this->lastBeacon);
+    const auto offset = (elapsed.count() >= 0) ? (elapsed % interval) : microseconds(0);
+
+    if(offset < period.start) {
+        return period.start - offset;
+    } else if(offset + length > period.end) {
+        return interval - offset + period.start;
+    }
+    return microseconds(0);
+}
+
+/**
+ * @brief Schedule the transmit queue to be drained later
+ *
+ * This replaces any previously scheduled drain.
+ *
+ * @param delay Time until the packet at the head of the queue may be transmitted
+ */
+void Radio::armTxHoldoff(const std::chrono::microseconds delay) {
+    this->txHoldoffTimer = std::make_shared<TristLib::Event::Timer>(
+            TristLib::Event::RunLoop::Current(), delay, [this](auto) {
+        // keep the timer alive until its callback returns
+        auto timer = std::move(this->txHoldoffTimer);
+
+        try {
+            std::lock_guard lg(this->transportLock);
+            this->drainTxQueue();
+        } catch(const std::exception &e) {
+            PLOG_ERROR << "failed to drain tx queue: " << e.what();
+        }
+    });
+}
+
+/**
+ * @brief Get airtime usage of all channels
+ *
+ * Returns the airtime statistics for each channel that was transmitted on.
+ */
+std::vector<Radio::ChannelAirtime> Radio::getAirtime() {
+    std::vector<ChannelAirtime> out;
+    std::lock_guard lg(this->txQueueLock);
+
+    for(const auto &[channel, bucket] : this->airtime.getChannels()) {
+        out.emplace_back(ChannelAirtime{
+            .channel = channel,
+            .utilization = this->airtime.getUtilization(channel),
+            .balance = this->airtime.getBalance(channel),
+            .stats = bucket.stats,
+        });
+    }
+
+    return out;
+}
+
+/**
+ * @brief Get the number of packets waiting in the transmit queues
+ *
+ * This only counts packets held on the host; not any that were already handed to the radio.
+ */
+size_t Radio::getTxQueueDepth() {
+    std::lock_guard lg(this->txQueueLock);
+
+    size_t depth{0};
+    for(const auto &queue : this->txQueues) {
+        depth += queue.size();
+    }
+    return depth;
+}
+
+
+
+/**
+ * @brief Identify the radio
+ *
+ * Read out general information about the radio, to ensure that we can successfully communicate
+ * with it, and store it for later.
+ */
+void Radio::identify() {
+    Transports::Response::GetInfo info;
+    this->queryRadioInfo(info);
+
+    if(info.fw.protocolVersion != kProtocolVersion) {
+        throw std::runtime_error(fmt::format("incompatible radio protocol version ${:02x}",
+                    info.fw.protocolVersion));
+    }
+
+    memcpy(this->eui64.data(), info.hw.eui64, sizeof(info.hw.eui64));
+    this->serial = std::string(info.hw.serial, strnlen(info.hw.serial, sizeof(info.hw.serial)));
+    this->fwVersion = std::string(info.fw.build, strnlen(info.fw.build, sizeof(info.fw.build)));
+
+    PLOG_INFO << "Radio s/n: " << this->serial << ", EUI64: " <<
+        fmt::format("{:02x}:{:02x}:{:02x}:{:02x}:{:02x}:{:02x}:{:02x}:{:02x}", this->eui64[0],
+                this->eui64[1], this->eui64[2], this->eui64[3], this->eui64[4], this->eui64[5],
+                this->eui64[6], this->eui64[7]) << ", firmware: " << this->fwVersion;
+
+    this->maxTxPower = info.radio.maxTxPower;
+    this->hasTxPowerOverride = (info.hw.features &
+            Transports::Response::GetInfo::HwFeatures::TxPowerOverride);
+    this->hasBeaconTiming = (info.hw.features &
+            Transports::Response::GetInfo::HwFeatures::BeaconTiming);
+    this->hasDfu = (info.hw.features & Transports::Response::GetInfo::HwFeatures::Dfu);
+
+    PLOG_DEBUG << "Radio per-packet tx power: " << (this->hasTxPowerOverride ? "yes" : "no")
+        << ", beacon timing: " << (this->hasBeaconTiming ? "yes" : "no")
+        << ", firmware update: " << (this->hasDfu ? "yes" : "no");
+}
+
+/**
+ * @brief Configure the radio's interrupts
+ *
+ * Interrupts are requested for received packets and an empty transmit queue, as well as for
+ * transmitted beacons (if the radio reports beacon timing.)
+ */
+void Radio::configureIrqs() {
+    Transports::Request::IrqConfig irqConf{};
+    irqConf.rxQueueNotEmpty = true;
+    irqConf.txQueueEmpty = true;
+    irqConf.beaconSent = this->hasBeaconTiming;
+
+    this->setIrqConfig(irqConf);
+}
+
 
 
 /**
@@ -588,6 +904,37 @@ void Radio::queryRadioInfo(Transports::Response::GetInfo &outInfo) {
     }
 }
 
+/**
+ * @brief Read the beacon timing from the radio
+ *
+ * Convert the time the most recent beacon was transmitted to the host clock, and mark it as
+ * pending for dispatch to the beacon handlers. The transfer latency of the command is not
+ * compensated; it's small compared to the guard times around beacons.
+ */
+void Radio::readBeaconTiming() {
+    Transports::Response::GetBeaconTiming timing{};
+
+    this->transport->sendCommandWithResponse(Transports::CommandId::GetBeaconTiming,
+            {reinterpret_cast<std::byte *>(&timing), sizeof(timing)});
+    this->ensureCmdSuccess("GetBeaconTiming");
+
+    if(timing.beaconCount == this->beaconCount) {
+        return;
+    }
+
+    // the subtraction takes care of timebase wraparound
+    const uint32_t age = timing.currentTime - timing.lastBeacon;
+    const auto when = std::chrono::steady_clock::now() - std::chrono::microseconds(age);
+
+    {
+        std::lock_guard lg(this->txQueueLock);
+        this->lastBeacon = when;
+        this->beaconCount = timing.beaconCount;
+    }
+
+    this->beaconPending = true;
+}
+
 /**
  * @brief Execute the "get status" command
  *
@@ -651,15 +998,28 @@ void Radio::readPacket(Transports::Response::ReadPacket &outHeader,
  * The packet will be queued for transmission in the radio's internal buffer, and then secreted
  * on to the air… eventually.
  *
+ * If a transmit power is specified, and the radio supports it, it's inserted between the header
+ * and the payload; otherwise, the packet is sent at the configured transmit power.
+ *
  * @param header General information about the packet to transmit
  * @param payload Packet payload (including PHY and MAC headers)
+ * @param txPower Transmit power override for the packet (in ⅒th dBm)
  */
 void Radio::transmitPacket(const Transports::Request::TransmitPacket &header,
-        std::span<const std::byte> payload) {
+        std::span<const std::byte> payload, const std::optional<uint8_t> txPower) {
+    const bool withPower = txPower && this->hasTxPowerOverride;
+    const size_t payloadOffset = sizeof(header) + (withPower ? 1 : 0);
+
     // prepare the transmit buffer
-    this->txBuffer.resize(sizeof(header) + payload.size());
+    this->txBuffer.resize(payloadOffset + payload.size());
     memcpy(this->txBuffer.data(), &header, sizeof(header));
-    memcpy(this->txBuffer.data() + sizeof(header), payload.data(), payload.size());
+    memcpy(this->txBuffer.data() + payloadOffset, payload.data(), payload.size());
+
+    if(withPower) {
+        auto cmd = reinterpret_cast<Transports::Request::TransmitPacket *>(this->txBuffer.data());
+        cmd->hasTxPower = true;
+        this->txBuffer[sizeof(header)] = std::byte(*txPower);
+    }
 
     // perform request
     this->transport->sendCommandWithPayload(Transports::CommandId::TransmitPacket, this->txBuffer);
@@ -692,6 +1052,86 @@ void Radio::acknowledgeInterrupts(const Transports::Request::IrqStatus &irqs) {
 
 
 
+/**
+ * @brief Read the firmware update status
+ *
+ * @param outStatus Update status structure to fill
+ */
+void Radio::queryDfuStatus(Transports::Response::DfuStatus &outStatus) {
+    std::lock_guard lg(this->transportLock);
+
+    this->transport->sendCommandWithResponse(Transports::CommandId::DfuStatus,
+            {reinterpret_cast<std::byte *>(&outStatus), sizeof(outStatus)});
+    this->ensureCmdSuccess("DfuStatus");
+}
+
+/**
+ * @brief Begin a firmware update
+ *
+ * The radio erases its inactive firmware slot; any update in progress is abandoned.
+ *
+ * @param imageSize Size of the image (bytes)
+ * @param imageCrc CRC-32 of the entire image
+ */
+void Radio::beginDfu(const uint32_t imageSize, const uint32_t imageCrc) {
+    Transports::Request::DfuBegin cmd{
+        .imageSize = imageSize,
+        .imageCrc = imageCrc,
+    };
+
+    std::lock_guard lg(this->transportLock);
+    this->transport->sendCommandWithPayload(Transports::CommandId::DfuBegin,
+            {reinterpret_cast<const std::byte *>(&cmd), sizeof(cmd)});
+    this->ensureCmdSuccess("DfuBegin");
+}
+
+/**
+ * @brief Write a block of the firmware image
+ *
+ * The block is buffered by the radio, and programmed in the background.
+ *
+ * @param offset Offset of the block in the image (must be the offset the radio expects)
+ * @param data Block data
+ */
+void Radio::writeDfuBlock(const uint32_t offset, std::span<const std::byte> data) {
+    if(sizeof(Transports::Request::DfuWrite) + data.size() > UINT8_MAX) {
+        throw std::invalid_argument(fmt::format("dfu block too large ({} bytes)", data.size()));
+    }
+
+    std::lock_guard lg(this->transportLock);
+
+    // reuse the transmit buffer; it's only used while the transport is locked
+    this->txBuffer.resize(sizeof(Transports::Request::DfuWrite) + data.size());
+
+    auto cmd = reinterpret_cast<Transports::Request::DfuWrite *>(this->txBuffer.data());
+    cmd->offset = offset;
+    cmd->crc = Support::Crc32(data);
+    memcpy(cmd->data, data.data(), data.size());
+
+    this->transport->sendCommandWithPayload(Transports::CommandId::DfuWrite, this->txBuffer);
+    this->ensureCmdSuccess("DfuWrite");
+}
+
+/**
+ * @brief Commit the firmware update
+ *
+ * The radio verifies the image, and boots it the next time it's reset.
+ *
+ * @param imageCrc CRC-32 of the entire image
+ */
+void Radio::commitDfu(const uint32_t imageCrc) {
+    Transports::Request::DfuCommit cmd{
+        .imageCrc = imageCrc,
+    };
+
+    std::lock_guard lg(this->transportLock);
+    this->transport->sendCommandWithPayload(Transports::CommandId::DfuCommit,
+            {reinterpret_cast<const std::byte *>(&cmd), sizeof(cmd)});
+    this->ensureCmdSuccess("DfuCommit");
+}
+
+
+
 /**
  * @brief Read s tatus register and ensure last command succeeded
  *
@@ -5,14 +5,21 @@
 #include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <span>
 #include <vector>
 #include <queue>
 
+#include "AirtimeLimiter.h"
+
+class RadioUpdater;
+
 namespace TristLib::Event {
 class Timer;
 }
@@ -27,6 +34,7 @@ struct GetPacketQueueStatus;
 struct ReadPacket;
 struct IrqConfig;
 struct IrqStatus;
+struct DfuStatus;
 }
 
 namespace Request {
@@ -149,6 +157,55 @@ class Radio {
             }
         };
 
+        /**
+         * @brief Receive callback
+         *
+         * Invoked for every packet received from the radio.
+         *
+         * @param packet Packet data (including PHY header)
+         * @param rssi Received signal strength (in dB)
+         * @param lqi Link quality (relative scale, 0 is worst and 255 is best)
+         */
+        using ReceiveHandler = std::function<void(std::span<const std::byte> packet,
+                const int8_t rssi, const uint8_t lqi)>;
+
+        /**
+         * @brief Beacon callback
+         *
+         * Invoked for every automatic beacon the radio transmits (if the radio reports beacon
+         * timing.)
+         *
+         * @param when Time at which the beacon was transmitted (on the host clock)
+         */
+        using BeaconHandler = std::function<void(const std::chrono::steady_clock::time_point when)>;
+
+        /**
+         * @brief Contention access period
+         *
+         * Part of each beacon interval in which packets may be transmitted at will. Both times are
+         * offsets from the start of the beacon.
+         */
+        struct ContentionPeriod {
+            /// Start of the period
+            std::chrono::microseconds start;
+            /// End of the period; transmissions must complete before this time
+            std::chrono::microseconds end;
+        };
+
+        /**
+         * @brief Airtime usage of a single channel
+         */
+        struct ChannelAirtime {
+            /// Channel number
+            uint16_t channel;
+            /// Fraction of time spent transmitting, averaged over the duty cycle window
+            double utilization;
+            /// Remaining airtime allowance (µs); negative if borrowed
+            double balance;
+            /// Accumulated counters
+            AirtimeLimiter::ChannelStats stats;
+        };
+
     private:
         /**
          * @brief Structure representing a packet pending transmission
@@ -156,6 +213,12 @@ class Radio {
         struct TxPacket {
             /// Transmission priority
             PacketPriority priority;
+            /// Transmit power override (in ⅒th dBm), if any
+            std::optional<uint8_t> txPower;
+            /// Whether the packet is sent in a guaranteed time slot
+            bool inSlot{false};
+            /// Whether the packet was already counted as deferred for lack of airtime
+            bool deferred{false};
 
             /**
              * @brief Packet data
@@ -168,6 +231,19 @@ class Radio {
 
         using TxQueue = std::queue<std::unique_ptr<TxPacket>>;
 
+        /**
+         * @brief A received packet waiting to be dispatched to the receive handlers
+         */
+        struct RxPacket {
+            /// Received signal strength (dB)
+            int8_t rssi;
+            /// Link quality indicator
+            uint8_t lqi;
+
+            /// Packet data (including PHY header)
+            std::vector<std::byte> payload;
+        };
+
         /// Supported protocol version
         constexpr static const uint8_t kProtocolVersion{0x01};
 
@@ -176,6 +252,18 @@ class Radio {
         /// Performance counter read interval (sec)
         constexpr static const std::chrono::seconds kPerfCounterReadInterval{30};
 
+        /**
+         * @brief Airtime reserve per priority
+         *
+         * Lowest airtime balance (as a fraction of the duty cycle allowance) a packet of each
+         * priority may leave behind. Background traffic leaves a reserve for everything else,
+         * real time traffic may borrow against future allowance, and network control traffic is
+         * never held back.
+         */
+        constexpr static const std::array<float, 4> kAirtimeFloor{{
+            .25f, 0.f, -.25f, -std::numeric_limits<float>::infinity(),
+        }};
+
         /// Interrupt watchdog interval (msec)
         constexpr static const size_t kIrqWatchdogInterval{50};
         /// How long we can go without an irq (msec)
@@ -267,7 +355,60 @@ class Radio {
         void uploadConfig();
 
         void queueTransmitPacket(const PacketPriority priority,
-                std::span<const std::byte> payload);
+                std::span<const std::byte> payload,
+                const std::optional<uint8_t> txPower = std::nullopt, const bool inSlot = false);
+
+        /**
+         * @brief Determine whether the radio supports per-packet transmit power
+         *
+         * If not, the transmit power specified for individual packets is ignored, and all packets
+         * are transmitted with the configured transmit power.
+         */
+        constexpr inline bool supportsTxPowerOverride() const {
+            return this->hasTxPowerOverride;
+        }
+        /**
+         * @brief Determine whether the radio reports when beacons are transmitted
+         *
+         * This is required to synchronize transmissions to the beacon.
+         */
+        constexpr inline bool supportsBeaconTiming() const {
+            return this->hasBeaconTiming;
+        }
+        /**
+         * @brief Determine whether the radio firmware can be updated by us
+         */
+        constexpr inline bool supportsDfu() const {
+            return this->hasDfu;
+        }
+
+        /**
+         * @brief Get the radio firmware updater
+         */
+        inline auto &getUpdater() {
+            return this->updater;
+        }
+
+        void restart();
+
+        void queryDfuStatus(Transports::Response::DfuStatus &);
+        void beginDfu(const uint32_t imageSize, const uint32_t imageCrc);
+        void writeDfuBlock(const uint32_t offset, std::span<const std::byte> data);
+        void commitDfu(const uint32_t imageCrc);
+
+        /**
+         * @brief Restrict transmissions to the contention access period
+         *
+         * When set, packets (other than network control packets, and those sent in a guaranteed
+         * time slot) are held until they can be transmitted in the contention access period of a
+         * beacon interval. This requires beacon timing support.
+         *
+         * @param period Contention access period, or an empty value to transmit at any time
+         */
+        inline void setContentionPeriod(const std::optional<ContentionPeriod> &period) {
+            std::lock_guard lg(this->txQueueLock);
+            this->contention = period;
+        }
 
         /**
          * @brief Update the beacon configuration (without changing the packet)
@@ -301,6 +442,29 @@ class Radio {
             this->setBeaconConfig(false, 0ms, payload, false);
         }
 
+        /**
+         * @brief Register a receive handler
+         *
+         * Handlers are invoked from the event loop, once the radio has been released; so they
+         * may submit packets for transmission.
+         *
+         * @param handler Function to invoke for every received packet
+         */
+        inline void addReceiveHandler(const ReceiveHandler &handler) {
+            this->rxHandlers.emplace_back(handler);
+        }
+        /**
+         * @brief Register a beacon handler
+         *
+         * Like receive handlers, these are invoked from the event loop once the radio has been
+         * released.
+         *
+         * @param handler Function to invoke for every transmitted beacon
+         */
+        inline void addBeaconHandler(const BeaconHandler &handler) {
+            this->beaconHandlers.emplace_back(handler);
+        }
+
         void resetCounters(const bool remote = false);
 
         /**
@@ -326,7 +490,19 @@ class Radio {
             return this->numLostIrqs;
         }
 
+        /**
+         * @brief Get the regulatory region the radio operates in
+         */
+        constexpr inline auto &getRegion() const {
+            return this->airtime.getRegion();
+        }
+        std::vector<ChannelAirtime> getAirtime();
+        size_t getTxQueueDepth();
+
     private:
+        void identify();
+        void configureIrqs();
+
         void transmitPacket(const std::unique_ptr<TxPacket> &);
         void setBeaconConfig(const bool enabled, const std::chrono::milliseconds interval,
                 std::span<const std::byte> payload, const bool updateConfig);
@@ -343,7 +519,13 @@ class Radio {
         void irqHandler();
         void irqHandlerCommon(const Transports::Response::IrqStatus &);
         void readPacket(bool &);
+        void dispatchReceivedPackets();
         bool drainTxQueue();
+        void readBeaconTiming();
+        std::chrono::microseconds getTxDelay(const PacketPriority,
+                const std::chrono::microseconds, const bool, bool &);
+        std::chrono::microseconds getContentionDelay(const std::chrono::microseconds);
+        void armTxHoldoff(const std::chrono::microseconds);
 
         void queryRadioInfo(Transports::Response::GetInfo &);
         void queryStatus(Transports::Response::GetStatus &);
@@ -351,7 +533,7 @@ class Radio {
         void queryPacketQueueStatus(Transports::Response::GetPacketQueueStatus &);
         void readPacket(Transports::Response::ReadPacket &, std::span<std::byte>);
         void transmitPacket(const Transports::Request::TransmitPacket &,
-                std::span<const std::byte>);
+                std::span<const std::byte>, const std::optional<uint8_t>);
 
         void getPendingInterrupts(Transports::Response::IrqStatus &);
         void acknowledgeInterrupts(const Transports::Request::IrqStatus &);
@@ -372,6 +554,14 @@ class Radio {
         std::vector<std::byte> txBuffer;
         /// Buffer used for receiving packets
         std::vector<std::byte> rxBuffer;
+        /// Buffer used to build beacon configuration commands
+        std::vector<std::byte> beaconCmdBuffer;
+        /// Packets read from the radio that have yet to be dispatched
+        std::vector<RxPacket> rxPending;
+        /// Handlers to invoke for received packets
+        std::vector<ReceiveHandler> rxHandlers;
+        /// Handlers to invoke for transmitted beacons
+        std::vector<BeaconHandler> beaconHandlers;
 
         /// EUI-64 address of the radio
         std::array<std::byte, 8> eui64;
@@ -380,6 +570,13 @@ class Radio {
         /// Firmware version of the radio
         std::string fwVersion;
 
+        /// Does the firmware support per-packet transmit power?
+        bool hasTxPowerOverride{false};
+        /// Does the firmware report beacon transmit times?
+        bool hasBeaconTiming{false};
+        /// Can the firmware be updated by the host?
+        bool hasDfu{false};
+
         /// Is the radio configuration dirty?
         bool isConfigDirty{true};
 
@@ -411,6 +608,27 @@ class Radio {
 
         /// Radio status polling timer
         std::shared_ptr<TristLib::Event::Timer> pollTimer;
+
+        /// Airtime accounting (protected by the transmit queue lock)
+        AirtimeLimiter airtime;
+        /// Timer to resume draining the transmit queue once packets may be transmitted again
+        std::shared_ptr<TristLib::Event::Timer> txHoldoffTimer;
+
+        /// Beacon interval (as last configured)
+        std::chrono::milliseconds beaconInterval{0};
+        /// Beacon frame (as last configured; restored when the radio is restarted)
+        std::vector<std::byte> beaconFrame;
+        /// Time at which the most recent beacon was transmitted (host clock)
+        std::chrono::steady_clock::time_point lastBeacon{};
+        /// Number of beacons transmitted, as reported by the radio
+        uint32_t beaconCount{0};
+        /// Whether a beacon was transmitted but beacon handlers haven't been invoked yet
+        bool beaconPending{false};
+        /// Contention access period, if transmissions are restricted to it
+        std::optional<ContentionPeriod> contention;
+
+        /// Firmware updater
+        std::unique_ptr<RadioUpdater> updater;
 };
 
 #endif
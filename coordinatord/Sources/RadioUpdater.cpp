@@ -0,0 +1,314 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include <TristLib/Core.h>
+#include <TristLib/Event.h>
+
+#include "Config/Reader.h"
+#include "Support/Crc32.h"
+#include "Support/MappedFile.h"
+#include "Transports/Commands.h"
+
+#include "Radio.h"
+#include "RadioUpdater.h"
+
+/**
+ * @brief Initialize the radio firmware updater
+ *
+ * @param radio Radio to update
+ */
+RadioUpdater::RadioUpdater(Radio &radio) : radio(radio) {
+    this->reloadConfig();
+}
+
+/**
+ * @brief Clean up the updater
+ *
+ * An update in progress is abandoned; the radio keeps the blocks it received, so it can be
+ * resumed later.
+ */
+RadioUpdater::~RadioUpdater() {
+    this->writeTimer.reset();
+}
+
+/**
+ * @brief Read the updater configuration
+ *
+ * All keys are optional, and live in the `radio.dfu` table of the config file:
+ *
+ * - imageDir: Directory from which radio firmware images are read
+ * - interval: Interval between block writes (msec); each write fills all free block buffers
+ */
+void RadioUpdater::reloadConfig() {
+    const auto &root = Config::GetConfig();
+
+    auto imageDir = root.at_path(kConfImageDir);
+    if(imageDir && imageDir.is_string()) {
+        this->imageDir = imageDir.value_or(std::string(kDefaultImageDir));
+    }
+
+    auto interval = root.at_path(kConfInterval);
+    if(interval && interval.is_integer()) {
+        this->interval = std::chrono::milliseconds(std::max<int64_t>(1,
+                    interval.value_or(kDefaultInterval.count())));
+    }
+}
+
+
+
+/**
+ * @brief Start a radio firmware update
+ *
+ * If the radio already received part (or all) of this image, the update resumes where it left
+ * off; otherwise, the radio is told to begin receiving a new image.
+ *
+ * @param name Name of the image file (in the image directory)
+ */
+void RadioUpdater::start(const std::string_view name) {
+    if(this->isActive()) {
+        throw std::runtime_error("a radio firmware update is already in progress");
+    } else if(name.empty() || name.find('/') != std::string_view::npos || name.front() == '.') {
+        throw std::invalid_argument(fmt::format("invalid image name `{}`", name));
+    } else if(!this->radio.supportsDfu()) {
+        throw std::runtime_error("radio firmware does not support updates");
+    }
+
+    auto image = std::make_unique<Support::MappedFile>(this->imageDir / name);
+    const size_t imageSize = image->getSize();
+    if(!imageSize || imageSize > UINT32_MAX) {
+        throw std::invalid_argument(fmt::format("invalid image size ({} bytes)", imageSize));
+    }
+
+    const auto crc = Support::Crc32(image->getData());
+
+    // resume if the radio was already receiving this image
+    Transports::Response::DfuStatus status{};
+    this->radio.queryDfuStatus(status);
+
+    size_t offset{0};
+    const bool resumable = (status.state == Transports::Response::DfuStatus::Receiving ||
+            status.state == Transports::Response::DfuStatus::Committed);
+
+    if(resumable && status.imageSize == imageSize && status.imageCrc == crc &&
+            status.offset <= imageSize) {
+        offset = status.offset;
+    } else {
+        this->radio.beginDfu(imageSize, crc);
+    }
+
+    this->image = std::move(image);
+    this->imageCrc = crc;
+    this->retries = 0;
+
+    this->progress = Progress{
+        .state = State::Writing,
+        .image = std::string(name),
+        .imageSize = imageSize,
+        .offset = offset,
+        .resumedFrom = offset,
+    };
+    this->started = std::chrono::steady_clock::now();
+
+    if(offset) {
+        PLOG_INFO << fmt::format("radio dfu: resuming `{}` at {} of {} bytes", name, offset,
+                imageSize);
+    } else {
+        PLOG_INFO << fmt::format("radio dfu: writing `{}` ({} bytes, crc {:08x})", name,
+                imageSize, crc);
+    }
+
+    this->armTimer();
+}
+
+/**
+ * @brief Abort the update in progress
+ *
+ * The radio keeps running its current firmware. It retains the blocks it already received, so
+ * starting the same update again resumes it.
+ */
+void RadioUpdater::abort() {
+    if(!this->isActive()) {
+        return;
+    }
+
+    this->finish(State::Aborted);
+}
+
+/**
+ * @brief Get the progress of the current (or most recent) update
+ */
+RadioUpdater::Progress RadioUpdater::getProgress() const {
+    auto out = this->progress;
+
+    if(out.state != State::Idle) {
+        const auto end = this->isActive() ? std::chrono::steady_clock::now() : this->finished;
+        out.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - this->started);
+    }
+
+    return out;
+}
+
+
+
+/**
+ * @brief Schedule the next block writes
+ *
+ * Errors that escape the write step fail the update, rather than leaving it stuck.
+ */
+void RadioUpdater::armTimer() {
+    this->writeTimer = std::make_shared<TristLib::Event::Timer>(
+            TristLib::Event::RunLoop::Current(), std::chrono::microseconds(this->interval),
+            [this](auto) {
+        // keep the timer alive until its callback returns
+        auto timer = std::move(this->writeTimer);
+
+        try {
+            this->tick();
+        } catch(const std::exception &e) {
+            PLOG_ERROR << "radio dfu: update step failed: " << e.what();
+
+            if(this->isActive()) {
+                this->finish(State::Failed, e.what());
+            }
+        }
+    });
+}
+
+/**
+ * @brief Write the next blocks
+ *
+ * Read the update status from the radio, then write a block into each of its free block buffers.
+ * Writing always continues at the offset the radio expects, so a block that failed to write is
+ * simply written again.
+ *
+ * Once the entire image was written and programmed, it's committed, and the radio is reset into
+ * the new firmware.
+ */
+void RadioUpdater::tick() {
+    using DfuStatus = Transports::Response::DfuStatus;
+
+    if(!this->isActive()) {
+        return;
+    }
+
+    const auto data = this->image->getData();
+    DfuStatus status{};
+
+    try {
+        this->radio.queryDfuStatus(status);
+
+        if(status.state == DfuStatus::Committed && status.imageCrc == this->imageCrc) {
+            this->install();
+            return;
+        } else if(status.state == DfuStatus::Error) {
+            throw std::runtime_error("radio failed to program image");
+        } else if(status.state != DfuStatus::Receiving || status.imageCrc != this->imageCrc ||
+                status.offset > data.size()) {
+            this->finish(State::Failed, "radio abandoned the update");
+            return;
+        }
+
+        this->progress.offset = status.offset;
+
+        // once everything was received and programmed, verify the image
+        if(status.offset == data.size()) {
+            if(status.freeBuffers == status.numBuffers) {
+                this->radio.commitDfu(this->imageCrc);
+                this->install();
+                return;
+            }
+        }
+        // otherwise, fill all free buffers (the radio programs them in the background)
+        else {
+            const size_t blockSize = std::min<size_t>(kMaxBlockSize, status.maxBlockSize);
+            if(!blockSize) {
+                throw std::runtime_error("radio reported invalid block size");
+            }
+
+            for(size_t i = 0; i < status.freeBuffers && this->progress.offset < data.size(); i++) {
+                const auto offset = this->progress.offset;
+                const auto length = std::min(blockSize, data.size() - offset);
+
+                this->radio.writeDfuBlock(offset, data.subspan(offset, length));
+
+                this->progress.offset += length;
+                this->progress.blocksWritten++;
+            }
+        }
+
+        this->retries = 0;
+    } catch(const std::exception &e) {
+        this->progress.failedWrites++;
+
+        if(++this->retries > kMaxRetries) {
+            this->finish(State::Failed, e.what());
+            return;
+        }
+
+        PLOG_WARNING << "radio dfu: write failed (will retry): " << e.what();
+    }
+
+    this->armTimer();
+}
+
+/**
+ * @brief Reset the radio into the new firmware
+ *
+ * The radio is reconfigured right away; the time it took is recorded as the update's downtime.
+ */
+void RadioUpdater::install() {
+    const auto start = std::chrono::steady_clock::now();
+
+    try {
+        this->radio.restart();
+    } catch(const std::exception &e) {
+        this->finish(State::Failed, fmt::format("failed to restart radio: {}", e.what()));
+        return;
+    }
+
+    this->progress.offset = this->progress.imageSize;
+    this->progress.downtime = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+
+    this->finish(State::Complete);
+}
+
+/**
+ * @brief End the update
+ *
+ * The image is unmapped, but the progress is kept around so it can still be queried.
+ *
+ * @param state Final state of the update
+ * @param error Reason the update failed (if it did)
+ */
+void RadioUpdater::finish(const State state, const std::string_view error) {
+    this->writeTimer.reset();
+
+    this->progress.state = state;
+    this->progress.error = error;
+    this->finished = std::chrono::steady_clock::now();
+    this->image.reset();
+
+    const auto secs = std::chrono::duration_cast<std::chrono::duration<double>>(
+            this->finished - this->started).count();
+
+    switch(state) {
+        case State::Complete:
+            PLOG_INFO << fmt::format("radio dfu: now running firmware `{}` ({:.1f} s, down for "
+                    "{} ms)", this->radio.getFwVersion(), secs, this->progress.downtime.count());
+            break;
+        case State::Aborted:
+            PLOG_INFO << fmt::format("radio dfu: aborted at {} of {} bytes",
+                    this->progress.offset, this->progress.imageSize);
+            break;
+        case State::Failed:
+            PLOG_ERROR << fmt::format("radio dfu: failed at {} of {} bytes: {}",
+                    this->progress.offset, this->progress.imageSize, error);
+            break;
+
+        default:
+            break;
+    }
+}
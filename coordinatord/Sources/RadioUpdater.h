@@ -0,0 +1,154 @@
+#ifndef RADIOUPDATER_H
+#define RADIOUPDATER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+
+class Radio;
+
+namespace Support {
+class MappedFile;
+}
+
+namespace TristLib::Event {
+class Timer;
+}
+
+/**
+ * @brief Radio firmware updater
+ *
+ * Writes a new firmware image to the radio controller over the regular transport, then resets the
+ * radio into it.
+ *
+ * The controller receives the image into its inactive firmware slot, while it keeps operating
+ * from the active one; so the radio remains fully usable while the image is written. Blocks are
+ * written from the event loop a few at a time, and the transport is released between them, so
+ * regular traffic is only delayed by a few block writes at a time. The only downtime is the
+ * reset into the new image, after which the radio is reconfigured right away.
+ *
+ * Writes are pipelined: the controller has (at least) two block buffers, so the next block can
+ * be written while the previous one is being programmed. Each block carries a CRC, and the
+ * entire image is verified against its CRC before it's committed.
+ *
+ * The controller keeps track of how much of the image it received, so an update that was
+ * aborted (or interrupted by a restart of the daemon) resumes where it left off when the same
+ * image is written again.
+ */
+class RadioUpdater {
+    private:
+        /// Config key for the directory radio firmware images are read from
+        constexpr static const std::string_view kConfImageDir{"radio.dfu.imageDir"};
+        /// Config key for the interval between block writes (msec)
+        constexpr static const std::string_view kConfInterval{"radio.dfu.interval"};
+
+        /// Default directory for radio firmware images
+        constexpr static const std::string_view kDefaultImageDir{
+            "/var/lib/blazed/firmware/radio"};
+        /// Default interval between block writes
+        constexpr static const std::chrono::milliseconds kDefaultInterval{5};
+
+        /// Largest block written at once (bytes)
+        constexpr static const size_t kMaxBlockSize{128};
+        /// Number of consecutive failed writes after which the update is given up on
+        constexpr static const size_t kMaxRetries{5};
+
+    public:
+        /**
+         * @brief State of an update
+         */
+        enum class State: uint8_t {
+            /// No update was started
+            Idle,
+            /// The image is being written to the radio
+            Writing,
+            /// The radio was reset into the new image
+            Complete,
+            /// The update was aborted; it can be resumed by starting it again
+            Aborted,
+            /// The update failed
+            Failed,
+        };
+
+        /**
+         * @brief Progress of the current (or most recent) update
+         */
+        struct Progress {
+            /// Current state
+            State state{State::Idle};
+            /// Name of the image
+            std::string image;
+            /// Size of the image (bytes)
+            size_t imageSize{0};
+            /// Number of bytes the radio has received
+            size_t offset{0};
+            /// Offset the update was resumed from (0 if it was started from scratch)
+            size_t resumedFrom{0};
+            /// Number of blocks written
+            uint_least64_t blocksWritten{0};
+            /// Number of failed writes (each of which was retried)
+            uint_least64_t failedWrites{0};
+            /// Time since the update started (or its total duration, once done)
+            std::chrono::milliseconds elapsed{0};
+            /// Time the radio was unavailable while it was reset into the new image
+            std::chrono::milliseconds downtime{0};
+            /// Reason the update failed
+            std::string error;
+        };
+
+    public:
+        RadioUpdater(Radio &radio);
+        ~RadioUpdater();
+
+        void reloadConfig();
+
+        void start(const std::string_view name);
+        void abort();
+
+        /**
+         * @brief Determine whether an update is in progress
+         */
+        constexpr inline bool isActive() const {
+            return this->progress.state == State::Writing;
+        }
+
+        Progress getProgress() const;
+
+    private:
+        void armTimer();
+        void tick();
+        void install();
+        void finish(const State state, const std::string_view error = {});
+
+    private:
+        /// Radio that's being updated
+        Radio &radio;
+
+        /// Directory radio firmware images are read from
+        std::filesystem::path imageDir{kDefaultImageDir};
+        /// Interval between block writes
+        std::chrono::milliseconds interval{kDefaultInterval};
+
+        /// Memory mapped image (only while an update is in progress)
+        std::unique_ptr<Support::MappedFile> image;
+        /// CRC-32 of the image
+        uint32_t imageCrc{0};
+        /// Number of consecutive failed writes
+        size_t retries{0};
+
+        /// Progress of the current (or most recent) update
+        Progress progress;
+        /// Time at which the update started
+        std::chrono::steady_clock::time_point started;
+        /// Time at which the update ended
+        std::chrono::steady_clock::time_point finished;
+
+        /// Timer to write the next blocks (only exists while updating)
+        std::shared_ptr<TristLib::Event::Timer> writeTimer;
+};
+
+#endif
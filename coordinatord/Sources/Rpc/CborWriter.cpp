@@ -0,0 +1,96 @@
+#include <bit>
+#include <cstring>
+
+#include "Rpc/CborWriter.h"
+
+using namespace Rpc;
+
+/**
+ * @brief Write a text string
+ *
+ * @param string UTF-8 string to write
+ */
+void CborWriter::putString(const std::string_view string) {
+    this->putHead(kMajorString, string.size());
+
+    const auto offset = this->buffer.size();
+    this->buffer.resize(offset + string.size());
+    memcpy(this->buffer.data() + offset, string.data(), string.size());
+}
+
+/**
+ * @brief Write a byte string
+ *
+ * @param bytes Data to write
+ */
+void CborWriter::putBytes(std::span<const std::byte> bytes) {
+    this->putHead(kMajorBytes, bytes.size());
+    this->buffer.insert(this->buffer.end(), bytes.begin(), bytes.end());
+}
+
+/**
+ * @brief Write a boolean
+ */
+void CborWriter::putBool(const bool value) {
+    this->buffer.push_back(std::byte((kMajorSimple << 5) | (value ? 21 : 20)));
+}
+
+/**
+ * @brief Write a single precision float
+ */
+void CborWriter::putFloat4(const float value) {
+    this->putFixed((kMajorSimple << 5) | 26, std::bit_cast<uint32_t>(value), 4);
+}
+
+/**
+ * @brief Write a double precision float
+ */
+void CborWriter::putFloat8(const double value) {
+    this->putFixed((kMajorSimple << 5) | 27, std::bit_cast<uint64_t>(value), 8);
+}
+
+
+
+/**
+ * @brief Write an item header
+ *
+ * The value (an integer, or the length of a string, array or map) is encoded in the fewest bytes
+ * possible.
+ *
+ * @param major Major type of the item
+ * @param value Argument of the item
+ */
+void CborWriter::putHead(const uint8_t major, const uint64_t value) {
+    const uint8_t type = major << 5;
+
+    if(value < 24) {
+        this->buffer.push_back(std::byte(type | value));
+    } else if(value <= UINT8_MAX) {
+        this->putFixed(type | 24, value, 1);
+    } else if(value <= UINT16_MAX) {
+        this->putFixed(type | 25, value, 2);
+    } else if(value <= UINT32_MAX) {
+        this->putFixed(type | 26, value, 4);
+    } else {
+        this->putFixed(type | 27, value, 8);
+    }
+}
+
+/**
+ * @brief Write an initial byte, followed by a big endian value
+ *
+ * @param initial Initial byte (major type and additional information)
+ * @param value Value to write
+ * @param bytes Number of bytes to write the value as
+ */
+void CborWriter::putFixed(const uint8_t initial, const uint64_t value, const size_t bytes) {
+    const auto offset = this->buffer.size();
+    this->buffer.resize(offset + 1 + bytes);
+
+    auto out = this->buffer.data() + offset;
+    out[0] = std::byte(initial);
+
+    for(size_t i = 0; i < bytes; i++) {
+        out[bytes - i] = std::byte((value >> (i * 8)) & 0xFF);
+    }
+}
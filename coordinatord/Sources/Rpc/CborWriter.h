@@ -0,0 +1,120 @@
+#ifndef RPC_CBORWRITER_H
+#define RPC_CBORWRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace Rpc {
+/**
+ * @brief Streaming CBOR encoder
+ *
+ * Encodes CBOR items directly into a byte buffer, as they are written; unlike building a libcbor
+ * item tree, this doesn't allocate anything (once the buffer has grown to fit the largest
+ * message.)
+ *
+ * Maps and arrays are usually of definite length: write the header with the number of entries,
+ * then that many items (or key/value pairs.) If the number of items isn't known up front, an array
+ * can be started with beginArray() instead, and terminated with endArray() after its last item.
+ * Integers are encoded in their shortest form.
+ *
+ * @remark There's no validation of the structure; it's up to the caller to write the number of
+ *         items they announced.
+ */
+class CborWriter {
+    public:
+        /**
+         * @brief Create a writer that appends to the given buffer
+         *
+         * @param buffer Buffer to append encoded items to
+         */
+        CborWriter(std::vector<std::byte> &buffer) : buffer(buffer) {}
+
+        /**
+         * @brief Begin a map with the given number of key/value pairs
+         */
+        inline void putMap(const size_t numPairs) {
+            this->putHead(kMajorMap, numPairs);
+        }
+        /**
+         * @brief Begin an array with the given number of items
+         */
+        inline void putArray(const size_t numItems) {
+            this->putHead(kMajorArray, numItems);
+        }
+        /**
+         * @brief Begin an array of indefinite length
+         *
+         * Write any number of items, then terminate the array with endArray().
+         */
+        inline void beginArray() {
+            this->buffer.push_back(std::byte((kMajorArray << 5) | kIndefinite));
+        }
+        /**
+         * @brief Terminate an array started with beginArray()
+         */
+        inline void endArray() {
+            this->buffer.push_back(std::byte((kMajorSimple << 5) | kIndefinite));
+        }
+
+        void putString(const std::string_view string);
+        void putBytes(std::span<const std::byte> bytes);
+
+        /**
+         * @brief Write an unsigned integer
+         */
+        inline void putUint(const uint64_t value) {
+            this->putHead(kMajorUint, value);
+        }
+        /**
+         * @brief Write a signed integer
+         */
+        inline void putInt(const int64_t value) {
+            if(value < 0) {
+                this->putHead(kMajorNegInt, static_cast<uint64_t>(-1 - value));
+            } else {
+                this->putHead(kMajorUint, static_cast<uint64_t>(value));
+            }
+        }
+
+        void putBool(const bool value);
+        void putFloat4(const float value);
+        void putFloat8(const double value);
+
+        /**
+         * @brief Get the number of bytes in the underlying buffer
+         */
+        inline size_t size() const {
+            return this->buffer.size();
+        }
+
+    private:
+        /// Major type: unsigned integer
+        constexpr static const uint8_t kMajorUint{0};
+        /// Major type: negative integer
+        constexpr static const uint8_t kMajorNegInt{1};
+        /// Major type: byte string
+        constexpr static const uint8_t kMajorBytes{2};
+        /// Major type: text string
+        constexpr static const uint8_t kMajorString{3};
+        /// Major type: array
+        constexpr static const uint8_t kMajorArray{4};
+        /// Major type: map
+        constexpr static const uint8_t kMajorMap{5};
+        /// Major type: simple values and floats
+        constexpr static const uint8_t kMajorSimple{7};
+        /// Additional information: indefinite length (or "break", for simple values)
+        constexpr static const uint8_t kIndefinite{31};
+
+        void putHead(const uint8_t major, const uint64_t value);
+        void putFixed(const uint8_t initial, const uint64_t value, const size_t bytes);
+
+    private:
+        /// Buffer that encoded items are appended to
+        std::vector<std::byte> &buffer;
+};
+}
+
+#endif
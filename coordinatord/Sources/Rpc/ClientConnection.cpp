@@ -1,18 +1,32 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 
 #include <cbor.h>
 #include <fmt/format.h>
 #include <TristLib/Core.h>
 #include <TristLib/Event.h>
 
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <memory>
 #include <span>
 #include <stdexcept>
+#include <system_error>
 
 #include "Endpoints/Config.h"
+#include "Endpoints/Groups.h"
+#include "Endpoints/Ota.h"
 #include "Endpoints/Status.h"
+#include "Endpoints/Stream.h"
+#include "Endpoints/Subscribe.h"
+#include "Endpoints/Tx.h"
 #include "Server.h"
+#include "ResultStream.h"
+#include "Subscriptions.h"
 #include "Types.h"
 #include "ClientConnection.h"
 
@@ -24,13 +38,19 @@ using namespace Rpc;
  * We'll create a libevent "buffer event" to handle asynchronously pushing data into the
  * connection, and being notified when events take place on the connection. These events will
  * call back into the client connection instance.
+ *
+ * The write callback is invoked when the output drains below the low watermark, which resumes
+ * reading from the client if it was paused.
  */
-ClientConnection::ClientConnection(Server *parent, const int socketFd) : server(parent) {
+ClientConnection::ClientConnection(Server *parent, const int socketFd) : server(parent),
+    outputHighWatermark(parent->getOutputHighWatermark()),
+    outputLowWatermark(parent->getOutputLowWatermark()) {
     // set up the socket event
-    this->socket = std::make_shared<TristLib::Event::Socket>(TristLib::Event::RunLoop::Current(),
-            socketFd, true);
+    this->socket = std::make_shared<Support::BufferedSocket>(
+            TristLib::Event::RunLoop::Current(), socketFd, true);
 
     this->socket->setReadWatermark({sizeof(Rpc::RequestHeader), SIZE_MAX});
+    this->socket->setWriteWatermark({this->outputLowWatermark, SIZE_MAX});
 
     // install callbacks
     this->socket->setReadCallback([this](auto sock) {
@@ -43,6 +63,16 @@ ClientConnection::ClientConnection(Server *parent, const int socketFd) : server(
         }
     });
 
+    this->socket->setWriteCallback([this](auto sock) {
+        try {
+            this->handleWrite();
+        } catch(const std::exception &e) {
+            PLOG_ERROR << fmt::format("client {} write failed: {}", static_cast<void *>(this),
+                    e.what());
+            this->abort();
+        }
+    });
+
     this->socket->setEventCallback([this](auto sock, auto events) {
         try {
             this->handleEvents(events);
@@ -63,6 +93,8 @@ ClientConnection::ClientConnection(Server *parent, const int socketFd) : server(
  * Close the socket (if not already done) and release the libevent resources.
  */
 ClientConnection::~ClientConnection() {
+    this->subscriptions.reset();
+    this->streams.clear();
     this->socket.reset();
 }
 
@@ -78,38 +110,92 @@ void ClientConnection::abort() {
     // set error flags
     this->deadFlag = true;
 
+    // stop pushing updates
+    this->subscriptions.reset();
+    this->streams.clear();
+
     // delete the buffer event: this will close the socket as well
     this->socket.reset();
 }
 
+/**
+ * @brief Get the number of bytes of output waiting to be sent
+ */
+size_t ClientConnection::getOutputSize() const {
+    if(!this->socket) {
+        return 0;
+    }
+    return this->socket->getOutputSize();
+}
+
 
 
 /**
- * @brief Read packet from connection
+ * @brief Read packets from connection
  *
- * Attempt to read a full packet from the connection. Due to the watermark config, it's guaranteed
- * that when invoked, we have at least an RPC connection header waiting to be read out.
+ * Read out all data waiting on the connection, and handle every complete packet in it. Due to the
+ * watermark config, it's guaranteed that when invoked, we have at least an RPC connection header
+ * waiting to be read out.
  *
- * If the packet is valid, we'll attempt to CBOR decode the payload (if any.)
+ * Clients may send several requests without waiting for their replies, so there may be more than
+ * one packet waiting; if the last one doesn't fit in the buffer, its start is kept around until
+ * the rest of it is read.
  */
 void ClientConnection::handleRead() {
-    // read out the packet
-    const auto read = this->socket->read(this->rxBuffer);
+    bool filled;
+
+    do {
+        // read behind the partial packet from the last read, if any
+        const auto space = std::span(this->rxBuffer).subspan(this->rxPending);
+        const size_t read = this->socket->read(space);
+        filled = (read == space.size());
+
+        const size_t available = this->rxPending + read;
+        size_t offset{0};
+
+        // handle all complete packets
+        while(available - offset >= sizeof(RequestHeader)) {
+            auto hdr = reinterpret_cast<const RequestHeader *>(this->rxBuffer.data() + offset);
+
+            if(hdr->version != kCurrentVersion) {
+                throw std::runtime_error(fmt::format("invalid rpc version: ${:04x}",
+                            hdr->version));
+            } else if(hdr->length < sizeof(*hdr) || hdr->length > kMaxPacketSize) {
+                throw std::runtime_error(fmt::format("invalid header size ({})", hdr->length));
+            } else if(hdr->length > available - offset) {
+                break;
+            }
 
-    // validate the header
-    if(read < sizeof(RequestHeader)) {
-        // should never happen…
-        throw std::runtime_error(fmt::format("insufficient RPC read: {}", read));
-    }
+            this->handlePacket(std::span(this->rxBuffer).subspan(offset, hdr->length));
+            offset += hdr->length;
+        }
 
-    auto hdr = reinterpret_cast<const RequestHeader *>(this->rxBuffer.data());
+        // move the start of an incomplete packet to the front of the buffer
+        this->rxPending = available - offset;
+        if(this->rxPending && offset) {
+            memmove(this->rxBuffer.data(), this->rxBuffer.data() + offset, this->rxPending);
+        }
 
-    if(hdr->version != kCurrentVersion) {
-        throw std::runtime_error(fmt::format("invalid rpc version: ${:04x}", hdr->version));
-    } else if(hdr->length < sizeof(*hdr) || hdr->length > read) {
-        throw std::runtime_error(fmt::format("invalid header size ({}, have {})", hdr->length,
-                    read));
-    }
+        // buffer was filled, so there may be more data waiting (unless we stopped reading)
+    } while(this->socket && filled && !this->throttled);
+}
+
+/**
+ * @brief Handle a single request packet
+ *
+ * The payload (if any) is decoded as CBOR, then passed to the handler of the endpoint the packet
+ * is addressed to. Replies sent while the handler runs are addressed to this request.
+ *
+ * @param packet Full packet (including its header); its length was already validated
+ */
+void ClientConnection::handlePacket(std::span<const std::byte> packet) {
+    auto hdr = reinterpret_cast<const RequestHeader *>(packet.data());
+    this->counters.requests++;
+
+    this->current = ReplyTarget{
+        .endpoint = hdr->endpoint,
+        .tag = hdr->tag,
+    };
 
     // get payload
     std::span<const std::byte> payload(reinterpret_cast<const std::byte *>(hdr->payload),
@@ -140,6 +226,26 @@ void ClientConnection::handleRead() {
                 Endpoints::Status::Handle(this, cborItem);
                 break;
 
+            case RequestEndpoint::Groups:
+                Endpoints::Groups::Handle(this, cborItem);
+                break;
+
+            case RequestEndpoint::Ota:
+                Endpoints::Ota::Handle(this, cborItem);
+                break;
+
+            case RequestEndpoint::Subscribe:
+                Endpoints::Subscribe::Handle(this, cborItem);
+                break;
+
+            case RequestEndpoint::Stream:
+                Endpoints::Stream::Handle(this, cborItem);
+                break;
+
+            case RequestEndpoint::Tx:
+                Endpoints::Tx::Handle(this, cborItem);
+                break;
+
             // unimplemented endpoint
             default:
                 throw std::runtime_error(fmt::format("unknown rpc endpoint ${:02x}",
@@ -158,13 +264,41 @@ void ClientConnection::handleRead() {
     }
 }
 
+/**
+ * @brief Handle the output draining below the low watermark
+ *
+ * If reading from the client was paused, it's resumed: streams that were paused send their next
+ * chunks, and requests that arrived in the meantime are handled right away.
+ */
+void ClientConnection::handleWrite() {
+    if(!this->throttled) {
+        return;
+    }
+
+    this->throttled = false;
+    this->socket->enableEvents(true, false);
+
+    PLOG_DEBUG << fmt::format("client {}: output drained, resuming reads",
+            static_cast<void *>(this));
+
+    this->pumpStreams();
+    if(this->throttled) {
+        return;
+    }
+
+    // the read callback won't fire for data that was already buffered
+    if(this->socket->getInputSize() >= sizeof(RequestHeader)) {
+        this->handleRead();
+    }
+}
+
 /**
  * @brief Handle a client connection event
  *
  * This likely corresponds to the connection being closed, or an IO error.
  */
-void ClientConnection::handleEvents(const TristLib::Event::Socket::Event flags) {
-    using Flags = TristLib::Event::Socket::Event;
+void ClientConnection::handleEvents(const Support::BufferedSocket::Event flags) {
+    using Flags = Support::BufferedSocket::Event;
 
     // events that will close the connection
     if((flags & (Flags::EndOfFile | Flags::UnrecoverableError)) != 0) {
@@ -178,62 +312,277 @@ void ClientConnection::handleEvents(const TristLib::Event::Socket::Event flags)
 
 
 /**
- * @brief Slap an RPC header in front of the payload and send it
+ * @brief Begin building a reply to the request currently being handled
  *
- * @param payload Data to transmit
+ * Space for the RPC header is reserved at the start of the reply buffer, and the returned writer
+ * appends the payload directly after it. Send the reply with endReply() once the payload has been
+ * written.
+ *
+ * @return Writer to encode the reply payload with
  */
-void ClientConnection::reply(std::span<const std::byte> payload) {
-    std::vector<std::byte> buffer;
-    buffer.resize(sizeof(struct RequestHeader) + payload.size(), std::byte{0});
+CborWriter &ClientConnection::beginReply() {
+    this->replyTarget = this->current;
+    this->txBuffer.resize(sizeof(struct RequestHeader));
+    return this->writer;
+}
 
-    // get last header
-    // TODO: check that the last packet was valid?
-    auto lastHdr = reinterpret_cast<const RequestHeader *>(this->rxBuffer.data());
+/**
+ * @brief Begin building a deferred reply
+ *
+ * Works the same as beginReply(), but the reply is addressed to the request the pending reply was
+ * created for.
+ *
+ * @param pending Pending reply, as returned by deferReply()
+ *
+ * @return Writer to encode the reply payload with
+ */
+CborWriter &ClientConnection::beginReply(const PendingReply &pending) {
+    this->replyTarget = pending.target;
+    this->txBuffer.resize(sizeof(struct RequestHeader));
+    return this->writer;
+}
+
+/**
+ * @brief Begin building a message pushed to the client
+ *
+ * Works the same as beginReply(), but the message isn't a reply to any request; it's sent with
+ * the push tag instead.
+ *
+ * @param endpoint Endpoint the message originates from
+ *
+ * @return Writer to encode the message payload with
+ */
+CborWriter &ClientConnection::beginPush(const uint8_t endpoint) {
+    this->replyTarget = ReplyTarget{
+        .endpoint = endpoint,
+        .tag = kPushTag,
+    };
+    this->txBuffer.resize(sizeof(struct RequestHeader));
+    return this->writer;
+}
+
+/**
+ * @brief Send the reply in the reply buffer
+ *
+ * Fill in the RPC header reserved at the start of the reply buffer, then send it. If it has to be
+ * queued and is large, the buffer itself is handed over to the socket rather than copying it;
+ * the next reply is built in a spare buffer the socket is done with.
+ *
+ * Replies larger than the client's maximum packet size are replaced by an error reply (a map with
+ * a single `error` key) to the same request.
+ */
+void ClientConnection::endReply() {
+    // the client can't receive it: fail the request instead
+    if(this->txBuffer.size() > kMaxPacketSize) {
+        const auto size = this->txBuffer.size();
+        PLOG_WARNING << fmt::format("client {}: reply to ${:02x} too large ({} bytes)",
+                static_cast<void *>(this), this->replyTarget.endpoint, size);
+
+        this->txBuffer.resize(sizeof(struct RequestHeader));
+        this->writer.putMap(1);
+        this->writer.putString("error");
+        this->writer.putString(fmt::format("reply too large ({} bytes)", size));
+    }
 
     // build up the header
-    auto hdr = reinterpret_cast<struct RequestHeader *>(buffer.data());
+    auto hdr = reinterpret_cast<struct RequestHeader *>(this->txBuffer.data());
     hdr->version = kCurrentVersion;
-    hdr->length = sizeof(*hdr) + payload.size();
-    hdr->endpoint = lastHdr->endpoint;
-    hdr->tag = lastHdr->tag;
+    hdr->length = this->txBuffer.size();
+    hdr->endpoint = this->replyTarget.endpoint;
+    hdr->tag = this->replyTarget.tag;
 
-    // copy payload
-    if(!payload.empty()) {
-        std::copy(payload.begin(), payload.end(), buffer.begin() + sizeof(*hdr));
+    const auto size = this->txBuffer.size();
+    const std::array<Slice, 1> slices{this->txBuffer};
+
+    if(!this->trySend(slices)) {
+        if(auto buffer = (size >= kMinReferenceSize) ? this->getSpareBuffer() : nullptr) {
+            std::swap(*buffer, this->txBuffer);
+
+            const std::array<Slice, 1> moved{*buffer};
+            this->enqueue(moved, buffer);
+        } else {
+            this->enqueue(slices, {});
+        }
     }
 
-    // send and return tag
-    this->sendRaw(buffer);
+    this->didSend(size);
 }
 
 /**
- * @brief Serialize CBOR item and send as reply
+ * @brief Get a buffer to hand a queued reply to the socket in
  *
- * @param root CBOR item to serialize
+ * Buffers are reused once the socket has sent the reply they held (and released them), so they
+ * keep the capacity they've grown to. New ones are only allocated while all existing buffers are
+ * still queued, up to a limit.
  *
- * @remark This method will decrement a reference on the CBOR item, meaning that if the caller
- *         does not increment the refcount beforehand, will lead to it being deallocated.
+ * @return A buffer the socket doesn't reference, or `nullptr` if they're all in use
  */
-void ClientConnection::reply(cbor_item_t* &root) {
-    size_t rootBufLen;
-    unsigned char *rootBuf{nullptr};
-    const size_t serializedBytes = cbor_serialize_alloc(root, &rootBuf, &rootBufLen);
-    cbor_decref(&root);
+std::shared_ptr<std::vector<std::byte>> ClientConnection::getSpareBuffer() {
+    for(const auto &buffer : this->spareBuffers) {
+        if(buffer.use_count() == 1) {
+            return buffer;
+        }
+    }
 
-    try {
-        this->reply({reinterpret_cast<std::byte *>(rootBuf), serializedBytes});
-        free(rootBuf);
-    } catch(const std::exception &) {
-        free(rootBuf);
-        throw;
+    if(this->spareBuffers.size() >= kMaxSpareBuffers) {
+        return nullptr;
     }
+    return this->spareBuffers.emplace_back(std::make_shared<std::vector<std::byte>>());
 }
 
 /**
- * @brief Send a raw packet to the remote
+ * @brief Defer the reply to the request currently being handled
  *
- * This assumes the packet already has a `struct RpcHeader` prepended.
+ * The endpoint handler may return without replying; the reply is sent later by passing the
+ * returned handle to beginReply(). Other requests on the connection are handled (and answered)
+ * in the meantime.
+ *
+ * @return Handle identifying the request to reply to
  */
-void ClientConnection::sendRaw(std::span<const std::byte> payload) {
-    this->socket->write(payload);
+ClientConnection::PendingReply ClientConnection::deferReply() {
+    return PendingReply{
+        .client = this->weak_from_this(),
+        .target = this->current,
+    };
+}
+
+/**
+ * @brief Open a result stream
+ *
+ * The stream is addressed to the request currently being handled; its first chunks are sent
+ * right away (as far as its credits allow.)
+ *
+ * @param stream Stream to open
+ */
+void ClientConnection::openStream(std::unique_ptr<ResultStream> stream) {
+    if(this->streams.contains(this->current.tag)) {
+        throw std::runtime_error(fmt::format("stream with tag ${:02x} already open",
+                    this->current.tag));
+    } else if(this->streams.size() >= kMaxStreams) {
+        throw std::runtime_error("too many open streams");
+    }
+
+    if(!stream->pump()) {
+        this->streams.emplace(this->current.tag, std::move(stream));
+    }
+}
+
+/**
+ * @brief Get the stream opened by a request with the same tag as the current request
+ *
+ * @return Stream in progress, or `nullptr` if there is none (or it already finished)
+ */
+ResultStream *ClientConnection::getStream() {
+    auto it = this->streams.find(this->current.tag);
+    return (it != this->streams.end()) ? it->second.get() : nullptr;
+}
+
+/**
+ * @brief Close the stream opened by a request with the same tag as the current request
+ */
+void ClientConnection::closeStream() {
+    this->streams.erase(this->current.tag);
+}
+
+/**
+ * @brief Send as many chunks as possible for all streams
+ *
+ * Streams that sent their final chunk are closed.
+ */
+void ClientConnection::pumpStreams() {
+    std::erase_if(this->streams, [](const auto &entry) {
+        return entry.second->pump();
+    });
+}
+
+/**
+ * @brief Try to send a message directly
+ *
+ * The slices are written to the socket as a single packet, with one `sendmsg()` call, if nothing
+ * else is waiting to be sent.
+ *
+ * @param slices Slices (including the header) that make up the message
+ *
+ * @return Whether the message was sent; if not, it must be queued
+ */
+bool ClientConnection::trySend(std::span<const Slice> slices) {
+    if(!this->socket) {
+        throw std::runtime_error("connection is closed");
+    }
+
+    if(slices.size() > kMaxSlices) {
+        throw std::invalid_argument(fmt::format("too many message slices ({})", slices.size()));
+    }
+
+    // keep messages in order
+    if(this->socket->getOutputSize()) {
+        return false;
+    }
+
+    std::array<struct iovec, kMaxSlices> iov;
+    size_t length{0};
+
+    for(size_t i = 0; i < slices.size(); i++) {
+        iov[i].iov_base = const_cast<std::byte *>(slices[i].data());
+        iov[i].iov_len = slices[i].size();
+        length += slices[i].size();
+    }
+
+    struct msghdr msg{};
+    msg.msg_iov = iov.data();
+    msg.msg_iovlen = slices.size();
+
+    const auto sent = sendmsg(this->socket->getFd(), &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if(sent == -1) {
+        if(errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+            return false;
+        }
+        throw std::system_error(errno, std::generic_category(), "send rpc reply");
+    }
+    // packets are sent atomically, so this should never happen…
+    else if(static_cast<size_t>(sent) != length) {
+        throw std::runtime_error(fmt::format("short rpc send ({} of {} bytes)", sent, length));
+    }
+
+    return true;
+}
+
+/**
+ * @brief Queue message slices to be sent once the socket is writable
+ *
+ * @param slices Slices to queue
+ * @param owner If specified, the slices are queued by reference, and this object is kept alive
+ *        until they've been sent; otherwise, they're copied
+ */
+void ClientConnection::enqueue(std::span<const Slice> slices,
+        const std::shared_ptr<const void> &owner) {
+    for(const auto &slice : slices) {
+        if(owner) {
+            this->socket->writeReference(slice, owner);
+        } else {
+            this->socket->write(slice);
+        }
+    }
+}
+
+/**
+ * @brief Account for a sent (or queued) message
+ *
+ * Update counters, and stop reading further requests if too much output is waiting.
+ *
+ * @param bytes Size of the message
+ */
+void ClientConnection::didSend(const size_t bytes) {
+    this->counters.messages++;
+    this->counters.bytesSent += bytes;
+
+    // stop reading further requests until the client caught up
+    if(!this->throttled && this->getOutputSize() > this->outputHighWatermark) {
+        this->throttled = true;
+        this->counters.throttled++;
+        this->socket->disableEvents(true, false);
+
+        PLOG_DEBUG << fmt::format("client {}: {} bytes of output waiting, pausing reads",
+                static_cast<void *>(this), this->getOutputSize());
+    }
 }
@@ -6,11 +6,16 @@
 #include <cstdint>
 #include <memory>
 #include <span>
+#include <unordered_map>
+#include <vector>
 
-#include <TristLib/Event.h>
+#include "Support/BufferedSocket.h"
+#include "CborWriter.h"
 
 namespace Rpc {
 class Server;
+class ResultStream;
+class Subscriptions;
 
 /**
  * @brief Local RPC client instance
@@ -21,11 +26,37 @@ class Server;
  * Client connections stay around until the RPC server is shut down, or until the underlying
  * socket is closed; they are subsequently garbage collected by the local RPC interface in a
  * periodic background task.
+ *
+ * Any number of requests may be in flight on a connection at once. Each reply carries the tag
+ * (and endpoint) of the request it answers, so they may be sent in any order: an endpoint that
+ * can't answer right away defers its reply with deferReply(), and sends it whenever the result is
+ * available.
+ *
+ * Output is buffered, but bounded: once more than the high watermark of output is waiting to be
+ * sent to the client, no more requests are read from it (and no more updates are pushed to it)
+ * until its output drained below the low watermark.
+ *
+ * Replies are written to the socket directly from the buffer they were built in (with a single
+ * `sendmsg()` call) whenever nothing else is waiting to be sent. Only if the reply can't be sent
+ * right away is it queued; large replies are then queued by reference, so their payload is never
+ * copied, and the buffers they're handed over in are recycled once sent. No message may be larger
+ * than the maximum packet size: that's all the client accepts.
+ *
+ * Results too large for a single packet are streamed to the client in chunks (see ResultStream);
+ * any number of streams, up to a small limit, may be in progress at once.
  */
-class ClientConnection {
+class ClientConnection: public std::enable_shared_from_this<ClientConnection> {
     private:
-        /// Maximum receive packet size
+        /// Maximum packet size, in either direction
         constexpr static const size_t kMaxPacketSize{4096};
+        /// Maximum number of slices in a message
+        constexpr static const size_t kMaxSlices{8};
+        /// Replies at least this large are queued by reference rather than copied (bytes)
+        constexpr static const size_t kMinReferenceSize{1024};
+        /// Maximum number of reply buffers that may be queued by reference at once
+        constexpr static const size_t kMaxSpareBuffers{4};
+        /// Maximum number of result streams in progress at once
+        constexpr static const size_t kMaxStreams{4};
 
         /**
          * @brief Client state machine states
@@ -34,6 +65,54 @@ class ClientConnection {
             Idle,
         };
 
+    public:
+        /**
+         * @brief Request a reply is addressed to
+         */
+        struct ReplyTarget {
+            /// Endpoint the request was sent to
+            uint8_t endpoint{0};
+            /// Tag of the request
+            uint8_t tag{0};
+        };
+
+        /**
+         * @brief Handle to a reply that will be sent later
+         *
+         * Returned by deferReply(); it identifies the request, and holds a weak reference to the
+         * connection it arrived on (so it can outlive the connection.)
+         */
+        struct PendingReply {
+            /// Connection the request was received on
+            std::weak_ptr<ClientConnection> client;
+            /// Request to reply to
+            ReplyTarget target;
+
+            /**
+             * @brief Get the connection to reply on, if it's still open
+             */
+            inline std::shared_ptr<ClientConnection> lock() const {
+                auto ptr = this->client.lock();
+                return (ptr && !ptr->isDead()) ? ptr : nullptr;
+            }
+        };
+
+        /**
+         * @brief Connection counters
+         */
+        struct Counters {
+            /// Requests received
+            uint_least64_t requests{0};
+            /// Replies (and pushed messages) sent
+            uint_least64_t messages{0};
+            /// Bytes sent
+            uint_least64_t bytesSent{0};
+            /// Number of times reading was paused, because too much output was waiting
+            uint_least64_t throttled{0};
+            /// Frames submitted through the tx endpoint that failed to be queued
+            uint_least64_t txFailed{0};
+        };
+
     public:
         ClientConnection(Server *parent, const int socketFd);
         ~ClientConnection();
@@ -48,6 +127,31 @@ class ClientConnection {
             return this->deadFlag;
         }
 
+        /**
+         * @brief Check whether reading from the client is paused
+         *
+         * This is the case while the output waiting to be sent is above the high watermark, and
+         * until it drains below the low watermark.
+         */
+        constexpr inline bool isThrottled() const {
+            return this->throttled;
+        }
+
+        size_t getOutputSize() const;
+
+        /**
+         * @brief Get the connection counters
+         */
+        constexpr inline const auto &getCounters() const {
+            return this->counters;
+        }
+        /**
+         * @brief Account for frames submitted by the client that failed to be queued
+         */
+        constexpr inline void countTxFailures(const size_t frames) {
+            this->counters.txFailed += frames;
+        }
+
         /**
          * @brief Get the RPC server this client belongs to
          */
@@ -55,16 +159,45 @@ class ClientConnection {
             return this->server;
         }
 
-        void reply(std::span<const std::byte> payload);
-        void reply(struct cbor_item_t* &root);
+        /// A slice of a message
+        using Slice = std::span<const std::byte>;
+
+        CborWriter &beginReply();
+        CborWriter &beginReply(const PendingReply &pending);
+        CborWriter &beginPush(const uint8_t endpoint);
+        void endReply();
+
+        PendingReply deferReply();
+
+        /**
+         * @brief Get the client's topic subscriptions
+         *
+         * @remark This is only allocated once the client subscribes to something.
+         */
+        inline auto &getSubscriptions() {
+            return this->subscriptions;
+        }
+        inline const auto &getSubscriptions() const {
+            return this->subscriptions;
+        }
+
+        void openStream(std::unique_ptr<ResultStream> stream);
+        ResultStream *getStream();
+        void closeStream();
+        void pumpStreams();
 
     private:
         void abort();
 
         void handleRead();
-        void handleEvents(const TristLib::Event::Socket::Event);
+        void handlePacket(std::span<const std::byte> packet);
+        void handleWrite();
+        void handleEvents(const Support::BufferedSocket::Event flags);
 
-        void sendRaw(std::span<const std::byte> payload);
+        std::shared_ptr<std::vector<std::byte>> getSpareBuffer();
+        bool trySend(std::span<const Slice> slices);
+        void enqueue(std::span<const Slice> slices, const std::shared_ptr<const void> &owner);
+        void didSend(const size_t bytes);
 
     private:
         /// RPC server that we belong to
@@ -74,10 +207,39 @@ class ClientConnection {
         bool deadFlag{false};
 
         /// Socket connection event
-        std::shared_ptr<TristLib::Event::Socket> socket;
+        std::shared_ptr<Support::BufferedSocket> socket;
+
+        /// Output size above which we stop reading from the client
+        size_t outputHighWatermark;
+        /// Output size below which reading from the client is resumed
+        size_t outputLowWatermark;
+        /// Whether reading is paused, because too much output is waiting
+        bool throttled{false};
+
+        /// Connection counters
+        Counters counters{};
 
         /// Packet read buffer
         std::array<std::byte, kMaxPacketSize> rxBuffer;
+        /// Number of bytes of an incomplete packet at the start of the read buffer
+        size_t rxPending{0};
+
+        /// Request currently being handled
+        ReplyTarget current;
+        /// Request the reply being built (with beginReply()) is addressed to
+        ReplyTarget replyTarget;
+
+        /// Reply buffer (reused for all replies, so it's only allocated once)
+        std::vector<std::byte> txBuffer;
+        /// Encoder for replies built with beginReply()
+        CborWriter writer{txBuffer};
+        /// Buffers that queued replies were handed to the socket in (reused once it's done)
+        std::vector<std::shared_ptr<std::vector<std::byte>>> spareBuffers;
+
+        /// Topics the client is subscribed to
+        std::unique_ptr<Subscriptions> subscriptions;
+        /// Result streams in progress, by the tag of the request that opened them
+        std::unordered_map<uint8_t, std::unique_ptr<ResultStream>> streams;
 };
 }
 
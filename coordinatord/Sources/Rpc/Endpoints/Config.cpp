@@ -5,14 +5,14 @@
 #include <TristLib/Core/Cbor.h>
 #include <TristLib/Event.h>
 
-#include <algorithm>
-#include <cctype>
 #include <stdexcept>
-#include <string>
+#include <string_view>
 
 #include "Radio.h"
 #include "version.h"
 #include "Rpc/ClientConnection.h"
+#include "Rpc/KeyMap.h"
+#include "Rpc/CborWriter.h"
 #include "Rpc/Server.h"
 
 #include "Config.h"
@@ -22,43 +22,84 @@ using namespace Rpc::Endpoints;
 /**
  * @brief Process the config request
  *
- * The payload should be a CBOR map, which hasa get" key, which is equal to the name of the
- * configuration item to work on.
+ * The payload should be a CBOR map, which has a `get` key. It's either the name of the
+ * configuration item to read, in which case the reply is that item; or an array of names, in
+ * which case the reply is a map of the items, keyed by the names as requested. Each name should
+ * only be requested once.
+ *
+ * - radio: Radio configuration (channel, transmit power, address)
+ * - version: Software and radio firmware versions
  *
  * @remark Currently, the configuration is read-only. In the future, it may support writing; though
  *         most changeable config is stored in confd, which can easily be updated.
  */
 void Config::Handle(ClientConnection *client, const cbor_item_t *payload) {
-    if(auto get = TristLib::Core::CborMapGet(payload, "get")) {
-        if(cbor_isa_string(get)) {
-            std::string key(reinterpret_cast<char *>(cbor_string_handle(get)),
-                    cbor_string_length(get));
-            std::transform(key.begin(), key.end(), key.begin(),
-                    [](unsigned char c){ return std::tolower(c); });
-
-            if(key == "radio") {
-                GetRadioCfg(client, payload);
-            } else if(key == "version") {
-                GetVersion(client, payload);
-            } else {
-                throw std::runtime_error(fmt::format("unknown config key `{}`", key));
+    auto get = TristLib::Core::CborMapGet(payload, "get");
+    if(!get) {
+        throw std::runtime_error("invalid config request (missing `get` key)");
+    }
+
+    // single key: reply with just that item
+    if(cbor_isa_string(get)) {
+        auto &writer = client->beginReply();
+        GetItem(client, writer, get);
+        client->endReply();
+    }
+    // multiple keys: reply with a map of all items, keyed by the requested key
+    else if(cbor_isa_array(get)) {
+        const auto numKeys = cbor_array_size(get);
+        const auto keys = cbor_array_handle(get);
+
+        auto &writer = client->beginReply();
+        writer.putMap(numKeys);
+
+        for(size_t i = 0; i < numKeys; i++) {
+            if(!cbor_isa_string(keys[i])) {
+                throw std::runtime_error("invalid config request (expected strings in `get`)");
             }
-        } else {
-            throw std::runtime_error("invalid config request (expected string for `get`)");
+
+            writer.putString({reinterpret_cast<char *>(cbor_string_handle(keys[i])),
+                    cbor_string_length(keys[i])});
+            GetItem(client, writer, keys[i]);
         }
+
+        client->endReply();
+    } else {
+        throw std::runtime_error("invalid config request (expected string or array for `get`)");
     }
-    // neither a get nor a set request
-    else {
-        throw std::runtime_error("invalid config request (missing `get` key)");
+}
+
+/**
+ * @brief Write a single config item
+ *
+ * @param writer Writer to encode the item with
+ * @param name CBOR string with the (case insensitive) name of the item
+ */
+void Config::GetItem(ClientConnection *client, CborWriter &writer, const cbor_item_t *name) {
+    const std::string_view key(reinterpret_cast<const char *>(cbor_string_handle(name)),
+            cbor_string_length(name));
+
+    if(auto getter = gItems.find(key)) {
+        (*getter)(client, writer);
+    } else {
+        throw std::runtime_error(fmt::format("unknown config key `{}`", key));
     }
 }
 
+/**
+ * @brief Items that can be read, by name
+ */
+const Rpc::KeyMap<Config::Getter, 2> Config::gItems{{
+    {"radio",   &Config::GetRadioCfg},
+    {"version", &Config::GetVersion},
+}};
+
 
 
 /**
  * @brief Read the radio configuration
  */
-void Config::GetRadioCfg(ClientConnection *client, const cbor_item_t *) {
+void Config::GetRadioCfg(ClientConnection *client, CborWriter &writer) {
     // get the radio
     auto radio = client->getServer()->getRadio();
     if(!radio) {
@@ -66,32 +107,22 @@ void Config::GetRadioCfg(ClientConnection *client, const cbor_item_t *) {
     }
 
     // build response
-    auto root = cbor_new_definite_map(4);
-
-    cbor_map_add(root, (struct cbor_pair) {
-        .key = cbor_move(cbor_build_string("txPower")),
-        .value = cbor_move(cbor_build_float4(radio->getTxPower())),
-    });
-    cbor_map_add(root, (struct cbor_pair) {
-        .key = cbor_move(cbor_build_string("channel")),
-        .value = cbor_move(cbor_build_uint32(radio->getChannel())),
-    });
-    cbor_map_add(root, (struct cbor_pair) {
-        .key = cbor_move(cbor_build_string("shortAddress")),
-        .value = cbor_move(cbor_build_uint16(radio->getAddress())),
-    });
-    cbor_map_add(root, (struct cbor_pair) {
-        .key = cbor_move(cbor_build_string("sn")),
-        .value = cbor_move(cbor_build_string(radio->getSerial().c_str())),
-    });
-
-    client->reply(root);
+    writer.putMap(4);
+
+    writer.putString("txPower");
+    writer.putFloat4(radio->getTxPower());
+    writer.putString("channel");
+    writer.putUint(radio->getChannel());
+    writer.putString("shortAddress");
+    writer.putUint(radio->getAddress());
+    writer.putString("sn");
+    writer.putString(radio->getSerial());
 }
 
 /**
  * @brief Get the software version
  */
-void Config::GetVersion(ClientConnection *client, const cbor_item_t *) {
+void Config::GetVersion(ClientConnection *client, CborWriter &writer) {
     // get the radio
     auto radio = client->getServer()->getRadio();
     if(!radio) {
@@ -99,21 +130,13 @@ void Config::GetVersion(ClientConnection *client, const cbor_item_t *) {
     }
 
     // build response
-    auto root = cbor_new_definite_map(3);
-
-    cbor_map_add(root, (struct cbor_pair) {
-        .key = cbor_move(cbor_build_string("version")),
-        .value = cbor_move(cbor_build_string(kVersion)),
-    });
-    cbor_map_add(root, (struct cbor_pair) {
-        .key = cbor_move(cbor_build_string("build")),
-        .value = cbor_move(cbor_build_string(kVersionGitHash)),
-    });
-
-    cbor_map_add(root, (struct cbor_pair) {
-        .key = cbor_move(cbor_build_string("radioVersion")),
-        .value = cbor_move(cbor_build_string(radio->getFwVersion().c_str())),
-    });
-
-    client->reply(root);
+    writer.putMap(3);
+
+    writer.putString("version");
+    writer.putString(kVersion);
+    writer.putString("build");
+    writer.putString(kVersionGitHash);
+
+    writer.putString("radioVersion");
+    writer.putString(radio->getFwVersion());
 }
@@ -1,7 +1,10 @@
 #ifndef RPC_ENDPOINTS_CONFIG_H
 #define RPC_ENDPOINTS_CONFIG_H
 
+#include "Rpc/KeyMap.h"
+
 namespace Rpc {
+class CborWriter;
 class ClientConnection;
 }
 
@@ -16,8 +19,15 @@ class Config {
         static void Handle(ClientConnection *client, const struct cbor_item_t *payload);
 
     private:
-        static void GetRadioCfg(ClientConnection *, const struct cbor_item_t *);
-        static void GetVersion(ClientConnection *, const struct cbor_item_t *);
+        /// Handler that writes an item
+        using Getter = void(*)(ClientConnection *, CborWriter &);
+
+        static const KeyMap<Getter, 2> gItems;
+
+        static void GetItem(ClientConnection *, CborWriter &, const struct cbor_item_t *);
+
+        static void GetRadioCfg(ClientConnection *, CborWriter &);
+        static void GetVersion(ClientConnection *, CborWriter &);
 };
 }
 
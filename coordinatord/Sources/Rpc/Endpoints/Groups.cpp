@@ -0,0 +1,207 @@
+#include <cbor.h>
+#include <fmt/format.h>
+
+#include <TristLib/Core.h>
+#include <TristLib/Core/Cbor.h>
+#include <TristLib/Event.h>
+
+#include <stdexcept>
+#include <string_view>
+
+#include "Protocol/GroupTable.h"
+#include "Protocol/Handler.h"
+#include "Rpc/ClientConnection.h"
+#include "Rpc/KeyMap.h"
+#include "Rpc/Server.h"
+
+#include "Groups.h"
+
+using namespace Rpc::Endpoints;
+
+/**
+ * @brief Read a short address from a CBOR item
+ *
+ * @param item CBOR item to read (should be an unsigned integer)
+ * @param what Name of the field, for error messages
+ */
+static uint16_t GetAddress(const cbor_item_t *item, const std::string_view what) {
+    if(!item || !cbor_isa_uint(item)) {
+        throw std::runtime_error(fmt::format("invalid group request (expected uint for `{}`)",
+                    what));
+    }
+
+    const auto value = cbor_get_int(item);
+    if(value > 0xFFFF) {
+        throw std::runtime_error(fmt::format("invalid group request (`{}` out of range)", what));
+    }
+    return static_cast<uint16_t>(value);
+}
+
+/**
+ * @brief Process a group request
+ *
+ * The payload should be a CBOR map, with an `op` key that indicates what to do:
+ *
+ * - list: Get all groups and their members
+ * - create: Create a new group; its address is returned under the `group` key
+ * - delete: Delete the group specified by the `group` key
+ * - add: Add the nodes (short addresses) in the `members` array to the `group`
+ * - remove: Remove the nodes in the `members` array from the `group`
+ */
+void Groups::Handle(ClientConnection *client, const cbor_item_t *payload) {
+    if(auto op = TristLib::Core::CborMapGet(payload, "op")) {
+        if(cbor_isa_string(op)) {
+            const std::string_view key(reinterpret_cast<const char *>(cbor_string_handle(op)),
+                    cbor_string_length(op));
+
+            if(auto handler = gOperations.find(key)) {
+                (*handler)(client, payload);
+            } else {
+                throw std::runtime_error(fmt::format("unknown group operation `{}`", key));
+            }
+        } else {
+            throw std::runtime_error("invalid group request (expected string for `op`)");
+        }
+    }
+    else {
+        throw std::runtime_error("invalid group request (missing `op` key)");
+    }
+}
+
+/**
+ * @brief Operations, by name
+ */
+const Rpc::KeyMap<Groups::Operation, 5> Groups::gOperations{{
+    {"list",   &Groups::List},
+    {"create", &Groups::Create},
+    {"delete", &Groups::Delete},
+    {"add",    [](auto client, auto payload) { UpdateMembers(client, payload, true); }},
+    {"remove", [](auto client, auto payload) { UpdateMembers(client, payload, false); }},
+}};
+
+
+
+/**
+ * @brief List all groups
+ *
+ * Returns the group addresses and an array of the members of each, as parallel arrays.
+ */
+void Groups::List(ClientConnection *client, const cbor_item_t *) {
+    auto protocol = client->getServer()->getProtocol();
+    if(!protocol) {
+        throw std::runtime_error("failed to get protocol handler instance");
+    }
+
+    const auto &groups = protocol->getGroups();
+    const auto addresses = groups->getGroups();
+
+    auto &writer = client->beginReply();
+    writer.putMap(2);
+
+    writer.putString("groups");
+    writer.putArray(addresses.size());
+    for(const auto group : addresses) {
+        writer.putUint(group);
+    }
+
+    writer.putString("members");
+    writer.putArray(addresses.size());
+    for(const auto group : addresses) {
+        const auto members = groups->getMembers(group);
+
+        writer.putArray(members.size());
+        for(const auto address : members) {
+            writer.putUint(address);
+        }
+    }
+
+    client->endReply();
+}
+
+/**
+ * @brief Create a new group
+ */
+void Groups::Create(ClientConnection *client, const cbor_item_t *) {
+    auto protocol = client->getServer()->getProtocol();
+    if(!protocol) {
+        throw std::runtime_error("failed to get protocol handler instance");
+    }
+
+    const auto group = protocol->getGroups()->create();
+    if(!group) {
+        throw std::runtime_error("no free group addresses");
+    }
+
+    auto &writer = client->beginReply();
+    writer.putMap(1);
+    writer.putString("group");
+    writer.putUint(*group);
+
+    client->endReply();
+}
+
+/**
+ * @brief Delete a group
+ */
+void Groups::Delete(ClientConnection *client, const cbor_item_t *payload) {
+    auto protocol = client->getServer()->getProtocol();
+    if(!protocol) {
+        throw std::runtime_error("failed to get protocol handler instance");
+    }
+
+    const auto group = GetAddress(TristLib::Core::CborMapGet(payload, "group"), "group");
+
+    const bool deleted = protocol->getGroups()->destroy(group);
+
+    auto &writer = client->beginReply();
+    writer.putMap(1);
+    writer.putString("deleted");
+    writer.putBool(deleted);
+
+    client->endReply();
+}
+
+/**
+ * @brief Add nodes to, or remove them from, a group
+ *
+ * Returns the number of nodes whose membership actually changed.
+ *
+ * @param add Whether nodes are added (or removed)
+ */
+void Groups::UpdateMembers(ClientConnection *client, const cbor_item_t *payload, const bool add) {
+    auto protocol = client->getServer()->getProtocol();
+    if(!protocol) {
+        throw std::runtime_error("failed to get protocol handler instance");
+    }
+
+    const auto group = GetAddress(TristLib::Core::CborMapGet(payload, "group"), "group");
+
+    auto members = TristLib::Core::CborMapGet(payload, "members");
+    if(!members || !cbor_isa_array(members)) {
+        throw std::runtime_error("invalid group request (expected array for `members`)");
+    }
+
+    auto &groups = protocol->getGroups();
+    size_t changed{0};
+
+    for(size_t i = 0; i < cbor_array_size(members); i++) {
+        auto item = cbor_array_get(members, i);
+        try {
+            const auto address = GetAddress(item, "members");
+            if(add ? groups->add(group, address) : groups->remove(group, address)) {
+                changed++;
+            }
+        } catch(const std::exception &) {
+            cbor_decref(&item);
+            throw;
+        }
+        cbor_decref(&item);
+    }
+
+    auto &writer = client->beginReply();
+    writer.putMap(1);
+    writer.putString("changed");
+    writer.putUint(changed);
+
+    client->endReply();
+}
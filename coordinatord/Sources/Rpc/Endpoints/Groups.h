@@ -0,0 +1,33 @@
+#ifndef RPC_ENDPOINTS_GROUPS_H
+#define RPC_ENDPOINTS_GROUPS_H
+
+#include "Rpc/KeyMap.h"
+
+namespace Rpc {
+class ClientConnection;
+}
+
+namespace Rpc::Endpoints {
+/**
+ * @brief Multicast group endpoint
+ *
+ * Manages multicast groups and their membership.
+ */
+class Groups {
+    public:
+        static void Handle(ClientConnection *client, const struct cbor_item_t *payload);
+
+    private:
+        /// Handler for an operation
+        using Operation = void(*)(ClientConnection *, const struct cbor_item_t *);
+
+        static const KeyMap<Operation, 5> gOperations;
+
+        static void List(ClientConnection *, const struct cbor_item_t *);
+        static void Create(ClientConnection *, const struct cbor_item_t *);
+        static void Delete(ClientConnection *, const struct cbor_item_t *);
+        static void UpdateMembers(ClientConnection *, const struct cbor_item_t *, const bool add);
+};
+}
+
+#endif
@@ -0,0 +1,302 @@
+#include <cbor.h>
+#include <fmt/format.h>
+
+#include <TristLib/Core.h>
+#include <TristLib/Core/Cbor.h>
+#include <TristLib/Event.h>
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Protocol/Handler.h"
+#include "Protocol/OtaDistributor.h"
+#include "Radio.h"
+#include "RadioUpdater.h"
+#include "Rpc/ClientConnection.h"
+#include "Rpc/KeyMap.h"
+#include "Rpc/Server.h"
+
+#include "Ota.h"
+
+using namespace Rpc::Endpoints;
+
+/**
+ * @brief Process a firmware update request
+ *
+ * The payload should be a CBOR map, with an `op` key that indicates what to do:
+ *
+ * - start: Distribute the image named by the `image` key (a file name in the image directory) to
+ *   the nodes in the `nodes` array; the session id is returned under the `id` key
+ * - abort: Stop the distribution in progress
+ * - progress: Get the progress of the current (or most recent) distribution
+ * - radio.update: Update the radio's firmware to the image named by the `image` key (a file name
+ *   in the radio image directory)
+ * - radio.abort: Stop the radio firmware update in progress (it resumes when started again)
+ * - radio.progress: Get the progress of the current (or most recent) radio firmware update
+ */
+void Ota::Handle(ClientConnection *client, const cbor_item_t *payload) {
+    if(auto op = TristLib::Core::CborMapGet(payload, "op")) {
+        if(cbor_isa_string(op)) {
+            const std::string_view key(reinterpret_cast<const char *>(cbor_string_handle(op)),
+                    cbor_string_length(op));
+
+            if(auto handler = gOperations.find(key)) {
+                (*handler)(client, payload);
+            } else {
+                throw std::runtime_error(fmt::format("unknown ota operation `{}`", key));
+            }
+        } else {
+            throw std::runtime_error("invalid ota request (expected string for `op`)");
+        }
+    }
+    else {
+        throw std::runtime_error("invalid ota request (missing `op` key)");
+    }
+}
+
+/**
+ * @brief Operations, by name
+ */
+const Rpc::KeyMap<Ota::Operation, 6> Ota::gOperations{{
+    {"start",          &Ota::Start},
+    {"abort",          &Ota::Abort},
+    {"progress",       &Ota::GetProgress},
+    {"radio.update",   &Ota::StartRadio},
+    {"radio.abort",    &Ota::AbortRadio},
+    {"radio.progress", &Ota::GetRadioProgress},
+}};
+
+
+
+/**
+ * @brief Start a firmware distribution
+ */
+void Ota::Start(ClientConnection *client, const cbor_item_t *payload) {
+    auto protocol = client->getServer()->getProtocol();
+    if(!protocol) {
+        throw std::runtime_error("failed to get protocol handler instance");
+    }
+
+    auto image = TristLib::Core::CborMapGet(payload, "image");
+    if(!image || !cbor_isa_string(image)) {
+        throw std::runtime_error("invalid ota request (expected string for `image`)");
+    }
+    const std::string name(reinterpret_cast<char *>(cbor_string_handle(image)),
+            cbor_string_length(image));
+
+    auto nodes = TristLib::Core::CborMapGet(payload, "nodes");
+    if(!nodes || !cbor_isa_array(nodes)) {
+        throw std::runtime_error("invalid ota request (expected array for `nodes`)");
+    }
+
+    std::vector<uint16_t> addresses;
+    addresses.reserve(cbor_array_size(nodes));
+
+    for(size_t i = 0; i < cbor_array_size(nodes); i++) {
+        auto item = cbor_array_get(nodes, i);
+        const bool valid = cbor_isa_uint(item) && cbor_get_int(item) <= 0xFFFF;
+        if(valid) {
+            addresses.push_back(cbor_get_int(item));
+        }
+        cbor_decref(&item);
+
+        if(!valid) {
+            throw std::runtime_error("invalid ota request (expected addresses in `nodes`)");
+        }
+    }
+
+    const auto id = protocol->getOtaDistributor()->start(name, addresses);
+
+    auto &writer = client->beginReply();
+    writer.putMap(1);
+    writer.putString("id");
+    writer.putUint(id);
+
+    client->endReply();
+}
+
+/**
+ * @brief Abort the firmware distribution in progress
+ */
+void Ota::Abort(ClientConnection *client, const cbor_item_t *) {
+    auto protocol = client->getServer()->getProtocol();
+    if(!protocol) {
+        throw std::runtime_error("failed to get protocol handler instance");
+    }
+
+    auto &ota = protocol->getOtaDistributor();
+    const bool wasActive = ota->isActive();
+    ota->abort();
+
+    auto &writer = client->beginReply();
+    writer.putMap(1);
+    writer.putString("aborted");
+    writer.putBool(wasActive);
+
+    client->endReply();
+}
+
+/**
+ * @brief Get the progress of the current (or most recent) firmware distribution
+ *
+ * Returns the overall state and throughput, as well as the state and number of received blocks
+ * of every target node (as parallel arrays.) Node states are 0 (downloading), 1 (complete) or 2
+ * (failed.)
+ */
+void Ota::GetProgress(ClientConnection *client, const cbor_item_t *) {
+    auto protocol = client->getServer()->getProtocol();
+    if(!protocol) {
+        throw std::runtime_error("failed to get protocol handler instance");
+    }
+
+    const auto progress = protocol->getOtaDistributor()->getProgress();
+
+    size_t numComplete{0};
+    for(const auto &node : progress.nodes) {
+        if(node.state == Protocol::OtaDistributor::NodeState::Complete) {
+            numComplete++;
+        }
+    }
+
+    auto &writer = client->beginReply();
+    writer.putMap(11);
+
+    writer.putString("active");
+    writer.putBool(progress.active);
+    writer.putString("image");
+    writer.putString(progress.image);
+    writer.putString("id");
+    writer.putUint(progress.imageId);
+    writer.putString("numBlocks");
+    writer.putUint(progress.numBlocks);
+    writer.putString("round");
+    writer.putUint(progress.round);
+    writer.putString("complete");
+    writer.putUint(numComplete);
+    writer.putString("blocksSent");
+    writer.putUint(progress.blocksSent);
+    writer.putString("blocksDelivered");
+    writer.putUint(progress.blocksDelivered);
+    writer.putString("elapsed");
+    writer.putUint(progress.elapsed.count());
+    writer.putString("goodput");
+    writer.putFloat4(progress.goodput);
+
+    writer.putString("nodes");
+    writer.putMap(3);
+    writer.putString("address");
+    writer.putArray(progress.nodes.size());
+    for(const auto &node : progress.nodes) {
+        writer.putUint(node.address);
+    }
+    writer.putString("state");
+    writer.putArray(progress.nodes.size());
+    for(const auto &node : progress.nodes) {
+        writer.putUint(static_cast<uint8_t>(node.state));
+    }
+    writer.putString("blocksReceived");
+    writer.putArray(progress.nodes.size());
+    for(const auto &node : progress.nodes) {
+        writer.putUint(node.blocksReceived);
+    }
+
+    client->endReply();
+}
+
+
+
+/**
+ * @brief Start (or resume) a radio firmware update
+ */
+void Ota::StartRadio(ClientConnection *client, const cbor_item_t *payload) {
+    auto radio = client->getServer()->getRadio();
+    if(!radio) {
+        throw std::runtime_error("failed to get radio instance");
+    }
+
+    auto image = TristLib::Core::CborMapGet(payload, "image");
+    if(!image || !cbor_isa_string(image)) {
+        throw std::runtime_error("invalid ota request (expected string for `image`)");
+    }
+    const std::string name(reinterpret_cast<char *>(cbor_string_handle(image)),
+            cbor_string_length(image));
+
+    auto &updater = radio->getUpdater();
+    updater->start(name);
+
+    auto &writer = client->beginReply();
+    writer.putMap(1);
+    writer.putString("resumedFrom");
+    writer.putUint(updater->getProgress().resumedFrom);
+
+    client->endReply();
+}
+
+/**
+ * @brief Abort the radio firmware update in progress
+ */
+void Ota::AbortRadio(ClientConnection *client, const cbor_item_t *) {
+    auto radio = client->getServer()->getRadio();
+    if(!radio) {
+        throw std::runtime_error("failed to get radio instance");
+    }
+
+    auto &updater = radio->getUpdater();
+    const bool wasActive = updater->isActive();
+    updater->abort();
+
+    auto &writer = client->beginReply();
+    writer.putMap(1);
+    writer.putString("aborted");
+    writer.putBool(wasActive);
+
+    client->endReply();
+}
+
+/**
+ * @brief Get the progress of the current (or most recent) radio firmware update
+ *
+ * The state is 0 (idle), 1 (writing), 2 (complete), 3 (aborted) or 4 (failed.) The firmware
+ * version the radio is currently running is included as well, and the reason an update failed.
+ */
+void Ota::GetRadioProgress(ClientConnection *client, const cbor_item_t *) {
+    auto radio = client->getServer()->getRadio();
+    if(!radio) {
+        throw std::runtime_error("failed to get radio instance");
+    }
+
+    const auto progress = radio->getUpdater()->getProgress();
+
+    auto &writer = client->beginReply();
+    writer.putMap(progress.error.empty() ? 10 : 11);
+
+    writer.putString("state");
+    writer.putUint(static_cast<uint8_t>(progress.state));
+    writer.putString("image");
+    writer.putString(progress.image);
+    writer.putString("imageSize");
+    writer.putUint(progress.imageSize);
+    writer.putString("offset");
+    writer.putUint(progress.offset);
+    writer.putString("resumedFrom");
+    writer.putUint(progress.resumedFrom);
+    writer.putString("blocksWritten");
+    writer.putUint(progress.blocksWritten);
+    writer.putString("failedWrites");
+    writer.putUint(progress.failedWrites);
+    writer.putString("elapsed");
+    writer.putUint(progress.elapsed.count());
+    writer.putString("downtime");
+    writer.putUint(progress.downtime.count());
+    writer.putString("firmware");
+    writer.putString(radio->getFwVersion());
+
+    if(!progress.error.empty()) {
+        writer.putString("error");
+        writer.putString(progress.error);
+    }
+
+    client->endReply();
+}
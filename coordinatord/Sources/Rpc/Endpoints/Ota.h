@@ -0,0 +1,37 @@
+#ifndef RPC_ENDPOINTS_OTA_H
+#define RPC_ENDPOINTS_OTA_H
+
+#include "Rpc/KeyMap.h"
+
+namespace Rpc {
+class ClientConnection;
+}
+
+namespace Rpc::Endpoints {
+/**
+ * @brief Firmware update endpoint
+ *
+ * Starts and monitors over-the-air firmware distribution to nodes, as well as updates of the
+ * radio's own firmware.
+ */
+class Ota {
+    public:
+        static void Handle(ClientConnection *client, const struct cbor_item_t *payload);
+
+    private:
+        /// Handler for an operation
+        using Operation = void(*)(ClientConnection *, const struct cbor_item_t *);
+
+        static const KeyMap<Operation, 6> gOperations;
+
+        static void Start(ClientConnection *, const struct cbor_item_t *);
+        static void Abort(ClientConnection *, const struct cbor_item_t *);
+        static void GetProgress(ClientConnection *, const struct cbor_item_t *);
+
+        static void StartRadio(ClientConnection *, const struct cbor_item_t *);
+        static void AbortRadio(ClientConnection *, const struct cbor_item_t *);
+        static void GetRadioProgress(ClientConnection *, const struct cbor_item_t *);
+};
+}
+
+#endif
@@ -5,13 +5,21 @@
 #include <TristLib/Core/Cbor.h>
 #include <TristLib/Event.h>
 
-#include <algorithm>
-#include <cctype>
 #include <stdexcept>
-#include <string>
+#include <string_view>
 
+#include "Protocol/Aggregator.h"
+#include "Protocol/ChannelMonitor.h"
+#include "Protocol/Fragmenter.h"
+#include "Protocol/GroupTable.h"
+#include "Protocol/Handler.h"
+#include "Protocol/LinkQuality.h"
+#include "Protocol/PowerControl.h"
+#include "Protocol/Superframe.h"
 #include "Radio.h"
 #include "Rpc/ClientConnection.h"
+#include "Rpc/KeyMap.h"
+#include "Rpc/CborWriter.h"
 #include "Rpc/Server.h"
 
 #include "Status.h"
@@ -22,32 +30,92 @@ using namespace Rpc::Endpoints;
  * @brief Process the status request
  *
  * The payload should be a CBOR map with a single key called `get` that contains the status item
- * that you wish to read:
+ * that you wish to read; or an array of items, in which case the reply is a map of the items,
+ * keyed by the names as requested (each name should only be requested once):
  *
- * - radio.packet: Packet statistics (rx/tx performance counters)
+ * - radio.counters: Packet statistics (rx/tx performance counters)
+ * - radio.airtime: Airtime utilization and duty cycle limiter state, per channel
+ * - protocol.fragmentation: Message fragmentation and reassembly counters
+ * - protocol.aggregation: Downlink aggregation counters and ratio
+ * - protocol.linkquality: Number of nodes with weak and poor links
+ * - protocol.channel: Channel quality and migration state
+ * - protocol.powercontrol: Transmit power control counters
+ * - protocol.superframe: Guaranteed time slot assignments and counters
+ * - protocol.groups: Multicast group counters
+ * - rpc.clients: Number of connected (and throttled) RPC clients
+ *
+ * Per-node and per-client tables aren't included in any of these, since they can grow larger
+ * than a single reply; they're read through the stream endpoint instead.
  */
 void Status::Handle(ClientConnection *client, const cbor_item_t *payload) {
-    if(auto get = TristLib::Core::CborMapGet(payload, "get")) {
-        if(cbor_isa_string(get)) {
-            std::string key(reinterpret_cast<char *>(cbor_string_handle(get)),
-                    cbor_string_length(get));
-            std::transform(key.begin(), key.end(), key.begin(),
-                    [](unsigned char c){ return std::tolower(c); });
-
-            if(key == "radio.counters") {
-                GetRadioCounters(client, payload);
-            } else {
-                throw std::runtime_error(fmt::format("unknown status key `{}`", key));
+    auto get = TristLib::Core::CborMapGet(payload, "get");
+    if(!get) {
+        throw std::runtime_error("invalid status request (missing `get` key)");
+    }
+
+    // single key: reply with just that item
+    if(cbor_isa_string(get)) {
+        auto &writer = client->beginReply();
+        GetItem(client, writer, get);
+        client->endReply();
+    }
+    // multiple keys: reply with a map of all items, keyed by the requested key
+    else if(cbor_isa_array(get)) {
+        const auto numKeys = cbor_array_size(get);
+        const auto keys = cbor_array_handle(get);
+
+        auto &writer = client->beginReply();
+        writer.putMap(numKeys);
+
+        for(size_t i = 0; i < numKeys; i++) {
+            if(!cbor_isa_string(keys[i])) {
+                throw std::runtime_error("invalid status request (expected strings in `get`)");
             }
-        } else {
-            throw std::runtime_error("invalid status request (expected string for `get`)");
+
+            writer.putString({reinterpret_cast<char *>(cbor_string_handle(keys[i])),
+                    cbor_string_length(keys[i])});
+            GetItem(client, writer, keys[i]);
         }
+
+        client->endReply();
+    } else {
+        throw std::runtime_error("invalid status request (expected string or array for `get`)");
     }
-    else {
-        throw std::runtime_error("invalid status request (missing `get` key)");
+}
+
+/**
+ * @brief Write a single status item
+ *
+ * @param writer Writer to encode the item with
+ * @param name CBOR string with the (case insensitive) name of the item
+ */
+void Status::GetItem(ClientConnection *client, CborWriter &writer, const cbor_item_t *name) {
+    const std::string_view key(reinterpret_cast<const char *>(cbor_string_handle(name)),
+            cbor_string_length(name));
+
+    if(auto getter = gItems.find(key)) {
+        (*getter)(client, writer);
+    } else {
+        throw std::runtime_error(fmt::format("unknown status key `{}`", key));
     }
 }
 
+/**
+ * @brief Items that can be read, by name
+ */
+const Rpc::KeyMap<Status::Getter, 10> Status::gItems{{
+    {"radio.counters",         &Status::GetRadioCounters},
+    {"radio.airtime",          &Status::GetRadioAirtime},
+    {"protocol.fragmentation", &Status::GetFragmentationCounters},
+    {"protocol.aggregation",   &Status::GetAggregationCounters},
+    {"protocol.linkquality",   &Status::GetLinkQuality},
+    {"protocol.channel",       &Status::GetChannelStatus},
+    {"protocol.powercontrol",  &Status::GetPowerControl},
+    {"protocol.superframe",    &Status::GetSuperframe},
+    {"protocol.groups",        &Status::GetGroupCounters},
+    {"rpc.clients",            &Status::GetRpcClients},
+}};
+
 
 
 /**
@@ -56,73 +124,374 @@ void Status::Handle(ClientConnection *client, const cbor_item_t *payload) {
  * Read out the performance counters for the radio, and output relevant receive and transmit
  * counter values.
  */
-void Status::GetRadioCounters(ClientConnection *client, const cbor_item_t *) {
+void Status::GetRadioCounters(ClientConnection *client, CborWriter &writer) {
     // get the radio
     auto radio = client->getServer()->getRadio();
     if(!radio) {
         throw std::runtime_error("failed to get radio instance");
     }
 
-    // receive counters
     const auto &rxCounters = radio->getRxCounters();
-    auto rxMap = cbor_new_definite_map(4);
-
-    cbor_map_add(rxMap, (struct cbor_pair) {
-        .key = cbor_move(cbor_build_string("good")),
-        .value = cbor_move(cbor_build_uint64(rxCounters.goodFrames)),
-    });
-    cbor_map_add(rxMap, (struct cbor_pair) {
-        .key = cbor_move(cbor_build_string("errors")),
-        .value = cbor_move(cbor_build_uint64(rxCounters.frameErrors)),
-    });
-    cbor_map_add(rxMap, (struct cbor_pair) {
-        .key = cbor_move(cbor_build_string("fifoOverflows")),
-        .value = cbor_move(cbor_build_uint64(rxCounters.fifoOverflows)),
-    });
-    cbor_map_add(rxMap, (struct cbor_pair) {
-        .key = cbor_move(cbor_build_string("queueDiscards")),
-        .value = cbor_move(cbor_build_uint64(rxCounters.queueDiscards + rxCounters.allocDiscards
-                    + rxCounters.bufferDiscards)),
-    });
+    const auto &txCounters = radio->getTxCounters();
+
+    writer.putMap(3);
 
     // transmit counters
-    const auto &txCounters = radio->getTxCounters();
-    auto txMap = cbor_new_definite_map(4);
-
-    cbor_map_add(txMap, (struct cbor_pair) {
-        .key = cbor_move(cbor_build_string("good")),
-        .value = cbor_move(cbor_build_uint64(txCounters.goodFrames)),
-    });
-    cbor_map_add(txMap, (struct cbor_pair) {
-        .key = cbor_move(cbor_build_string("ccaFails")),
-        .value = cbor_move(cbor_build_uint64(txCounters.ccaFails)),
-    });
-    cbor_map_add(txMap, (struct cbor_pair) {
-        .key = cbor_move(cbor_build_string("fifoUnderruns")),
-        .value = cbor_move(cbor_build_uint64(txCounters.fifoDrops)),
-    });
-    cbor_map_add(txMap, (struct cbor_pair) {
-        .key = cbor_move(cbor_build_string("queueDiscards")),
-        .value = cbor_move(cbor_build_uint64(txCounters.queueDiscards + txCounters.allocDiscards
-                    + txCounters.bufferDiscards)),
-    });
-
-    // build response (root)
-    auto root = cbor_new_definite_map(3);
-    cbor_map_add(root, (struct cbor_pair) {
-        .key = cbor_move(cbor_build_string("tx")),
-        .value = cbor_move(txMap),
-    });
-    cbor_map_add(root, (struct cbor_pair) {
-        .key = cbor_move(cbor_build_string("rx")),
-        .value = cbor_move(rxMap),
-    });
+    writer.putString("tx");
+    writer.putMap(4);
+    writer.putString("good");
+    writer.putUint(txCounters.goodFrames);
+    writer.putString("ccaFails");
+    writer.putUint(txCounters.ccaFails);
+    writer.putString("fifoUnderruns");
+    writer.putUint(txCounters.fifoDrops);
+    writer.putString("queueDiscards");
+    writer.putUint(txCounters.queueDiscards + txCounters.allocDiscards
+            + txCounters.bufferDiscards);
+
+    // receive counters
+    writer.putString("rx");
+    writer.putMap(4);
+    writer.putString("good");
+    writer.putUint(rxCounters.goodFrames);
+    writer.putString("errors");
+    writer.putUint(rxCounters.frameErrors);
+    writer.putString("fifoOverflows");
+    writer.putUint(rxCounters.fifoOverflows);
+    writer.putString("queueDiscards");
+    writer.putUint(rxCounters.queueDiscards + rxCounters.allocDiscards
+            + rxCounters.bufferDiscards);
 
     // TODO: timestamp the counters were last read
-    cbor_map_add(root, (struct cbor_pair) {
-        .key = cbor_move(cbor_build_string("readAt")),
-        .value = cbor_move(cbor_build_uint64(UINT64_MAX)),
-    });
+    writer.putString("readAt");
+    writer.putUint(UINT64_MAX);
+}
+
+/**
+ * @brief Get radio airtime usage
+ *
+ * Output the regulatory region and its duty cycle limit, followed by the airtime state of each
+ * channel that was transmitted on. Each per-channel field is an array with one entry per channel:
+ *
+ * - channel: Channel number
+ * - utilization: Fraction of time spent transmitting, averaged over the duty cycle window
+ * - balance: Remaining airtime allowance (µs); negative if borrowed
+ * - airtime: Total time spent transmitting (µs)
+ * - frames: Number of frames transmitted
+ * - deferrals: Number of times a transmission was held back for lack of airtime
+ * - borrowed: Total airtime borrowed against future allowance (µs)
+ */
+void Status::GetRadioAirtime(ClientConnection *client, CborWriter &writer) {
+    auto radio = client->getServer()->getRadio();
+    if(!radio) {
+        throw std::runtime_error("failed to get radio instance");
+    }
+
+    const auto &region = radio->getRegion();
+    const auto channels = radio->getAirtime();
+
+    writer.putMap(9);
+
+    writer.putString("region");
+    writer.putString(region.name);
+    writer.putString("dutyCycle");
+    writer.putFloat4(region.dutyCycle);
+
+    writer.putString("channel");
+    writer.putArray(channels.size());
+    for(const auto &info : channels) {
+        writer.putUint(info.channel);
+    }
+    writer.putString("utilization");
+    writer.putArray(channels.size());
+    for(const auto &info : channels) {
+        writer.putFloat4(info.utilization);
+    }
+    writer.putString("balance");
+    writer.putArray(channels.size());
+    for(const auto &info : channels) {
+        writer.putFloat4(info.balance);
+    }
+    writer.putString("airtime");
+    writer.putArray(channels.size());
+    for(const auto &info : channels) {
+        writer.putUint(info.stats.airtime);
+    }
+    writer.putString("frames");
+    writer.putArray(channels.size());
+    for(const auto &info : channels) {
+        writer.putUint(info.stats.frames);
+    }
+    writer.putString("deferrals");
+    writer.putArray(channels.size());
+    for(const auto &info : channels) {
+        writer.putUint(info.stats.deferrals);
+    }
+    writer.putString("borrowed");
+    writer.putArray(channels.size());
+    for(const auto &info : channels) {
+        writer.putUint(info.stats.borrowed);
+    }
+}
+
+/**
+ * @brief Get fragmentation status
+ *
+ * Output the counters of the fragmentation layer, as well as the number of messages currently
+ * being reassembled.
+ */
+void Status::GetFragmentationCounters(ClientConnection *client, CborWriter &writer) {
+    auto protocol = client->getServer()->getProtocol();
+    if(!protocol) {
+        throw std::runtime_error("failed to get protocol handler instance");
+    }
+
+    const auto &fragmenter = protocol->getFragmenter();
+    const auto &counters = fragmenter->getCounters();
+
+    writer.putMap(2);
+
+    // transmit counters
+    writer.putString("tx");
+    writer.putMap(2);
+    writer.putString("messages");
+    writer.putUint(counters.txMessages);
+    writer.putString("fragments");
+    writer.putUint(counters.txFragments);
+
+    // receive counters
+    writer.putString("rx");
+    writer.putMap(6);
+    writer.putString("reassembled");
+    writer.putUint(counters.rxReassembled);
+    writer.putString("timeouts");
+    writer.putUint(counters.rxTimeouts);
+    writer.putString("noBuffer");
+    writer.putUint(counters.rxNoBuffer);
+    writer.putString("invalid");
+    writer.putUint(counters.rxInvalid);
+    writer.putString("duplicates");
+    writer.putUint(counters.rxDuplicates);
+    writer.putString("inProgress");
+    writer.putUint(fragmenter->getNumReassembling());
+}
+
+/**
+ * @brief Get aggregation status
+ *
+ * Output the counters of the downlink aggregator, as well as the aggregation ratio (the average
+ * number of messages per transmitted frame.)
+ */
+void Status::GetAggregationCounters(ClientConnection *client, CborWriter &writer) {
+    auto protocol = client->getServer()->getProtocol();
+    if(!protocol) {
+        throw std::runtime_error("failed to get protocol handler instance");
+    }
+
+    const auto &aggregator = protocol->getAggregator();
+    const auto &counters = aggregator->getCounters();
+
+    writer.putMap(3);
+
+    writer.putString("enabled");
+    writer.putBool(aggregator->isEnabled());
+
+    // transmit counters
+    writer.putString("tx");
+    writer.putMap(4);
+    writer.putString("messages");
+    writer.putUint(counters.messages);
+    writer.putString("frames");
+    writer.putUint(counters.frames);
+    writer.putString("aggregated");
+    writer.putUint(counters.aggregated);
+    writer.putString("ratio");
+    writer.putFloat8(aggregator->getRatio());
+
+    // receive counters
+    writer.putString("rx");
+    writer.putMap(3);
+    writer.putString("frames");
+    writer.putUint(counters.rxFrames);
+    writer.putString("messages");
+    writer.putUint(counters.rxMessages);
+    writer.putString("invalid");
+    writer.putUint(counters.rxInvalid);
+}
+
+/**
+ * @brief Get a summary of link quality estimates
+ *
+ * Output the number of nodes in the link quality table, and how many of them have weak or poor
+ * links. The estimates of each node are read through the `linkquality` stream source, since the
+ * table may be too large for a single reply.
+ */
+void Status::GetLinkQuality(ClientConnection *client, CborWriter &writer) {
+    auto protocol = client->getServer()->getProtocol();
+    if(!protocol) {
+        throw std::runtime_error("failed to get protocol handler instance");
+    }
+
+    const auto &lq = protocol->getLinkQuality();
+
+    writer.putMap(3);
+    writer.putString("numNodes");
+    writer.putUint(lq->size());
+    writer.putString("numWeak");
+    writer.putUint(lq->countBelow(lq->getWeakThreshold()));
+    writer.putString("numPoor");
+    writer.putUint(lq->countBelow(lq->getPoorThreshold()));
+}
+
+/**
+ * @brief Get channel quality
+ *
+ * Output the current radio channel, the smoothed channel failure rates used to decide whether to
+ * migrate to a different channel, and whether such a migration is in progress.
+ */
+void Status::GetChannelStatus(ClientConnection *client, CborWriter &writer) {
+    auto radio = client->getServer()->getRadio();
+    if(!radio) {
+        throw std::runtime_error("failed to get radio instance");
+    }
+    auto protocol = client->getServer()->getProtocol();
+    if(!protocol) {
+        throw std::runtime_error("failed to get protocol handler instance");
+    }
+
+    const auto &monitor = protocol->getChannelMonitor();
+    const auto &counters = monitor->getCounters();
+
+    writer.putMap(5);
+
+    writer.putString("channel");
+    writer.putUint(radio->getChannel());
+    writer.putString("ccaRate");
+    writer.putFloat8(counters.ccaRate);
+    writer.putString("ferRate");
+    writer.putFloat8(counters.ferRate);
+    writer.putString("migrations");
+    writer.putUint(counters.migrations);
+    writer.putString("migrating");
+    writer.putBool(monitor->isMigrating());
+}
+
+/**
+ * @brief Get the transmit power control state
+ *
+ * Output whether power control is enabled, its counters and the number of nodes that have sent
+ * link reports. The state of each node is read through the `powercontrol` stream source.
+ */
+void Status::GetPowerControl(ClientConnection *client, CborWriter &writer) {
+    auto protocol = client->getServer()->getProtocol();
+    if(!protocol) {
+        throw std::runtime_error("failed to get protocol handler instance");
+    }
+
+    const auto &pc = protocol->getPowerControl();
+    const auto &counters = pc->getCounters();
+
+    writer.putMap(4);
+
+    writer.putString("enabled");
+    writer.putBool(pc->isEnabled());
+    writer.putString("reports");
+    writer.putUint(counters.reports);
+    writer.putString("marginIncreases");
+    writer.putUint(counters.marginIncreases);
+    writer.putString("numNodes");
+    writer.putUint(pc->getNodes().size());
+}
+
+/**
+ * @brief Get superframe state
+ *
+ * Output whether superframe mode is enabled, the start of the contention access period (in ms
+ * after the beacon), the owner of each guaranteed time slot (0xFFFF if unassigned), and the
+ * scheduler's counters.
+ */
+void Status::GetSuperframe(ClientConnection *client, CborWriter &writer) {
+    auto protocol = client->getServer()->getProtocol();
+    if(!protocol) {
+        throw std::runtime_error("failed to get protocol handler instance");
+    }
+
+    const auto &sf = protocol->getSuperframe();
+    const auto &slots = sf->getSlots();
+    const auto &counters = sf->getCounters();
+
+    writer.putMap(7);
+
+    writer.putString("enabled");
+    writer.putBool(sf->isEnabled());
+    writer.putString("capStart");
+    writer.putUint(sf->getCapStart().count());
+
+    writer.putString("slots");
+    writer.putArray(slots.size());
+    for(const auto address : slots) {
+        writer.putUint(address);
+    }
+
+    writer.putString("slotted");
+    writer.putUint(counters.slotted);
+    writer.putString("overflows");
+    writer.putUint(counters.overflows);
+    writer.putString("missedSlots");
+    writer.putUint(counters.missedSlots);
+    writer.putString("unassigned");
+    writer.putUint(counters.unassigned);
+}
+
+/**
+ * @brief Get multicast group counters
+ *
+ * Besides the number of frames sent to groups, this reports how many unicast frames it would have
+ * taken to deliver them to each member individually.
+ */
+void Status::GetGroupCounters(ClientConnection *client, CborWriter &writer) {
+    auto protocol = client->getServer()->getProtocol();
+    if(!protocol) {
+        throw std::runtime_error("failed to get protocol handler instance");
+    }
+
+    const auto &groups = protocol->getGroups();
+    const auto &counters = groups->getCounters();
+
+    writer.putMap(4);
+
+    writer.putString("groups");
+    writer.putUint(groups->getGroups().size());
+    writer.putString("frames");
+    writer.putUint(counters.frames);
+    writer.putString("unicastEquivalent");
+    writer.putUint(counters.unicastEquivalent);
+    writer.putString("emptyGroups");
+    writer.putUint(counters.emptyGroups);
+}
+
+/**
+ * @brief Get RPC client status
+ *
+ * Output the output high watermark, the number of connected clients and how many of them are
+ * throttled. The queue sizes and counters of each client are read through the `clients` stream
+ * source.
+ */
+void Status::GetRpcClients(ClientConnection *client, CborWriter &writer) {
+    size_t numClients{0}, numThrottled{0};
+    for(const auto &conn : client->getServer()->getClients()) {
+        if(!conn->isDead()) {
+            numClients++;
+            numThrottled += conn->isThrottled();
+        }
+    }
+
+    writer.putMap(3);
 
-    client->reply(root);
+    writer.putString("highWatermark");
+    writer.putUint(client->getServer()->getOutputHighWatermark());
+    writer.putString("numClients");
+    writer.putUint(numClients);
+    writer.putString("numThrottled");
+    writer.putUint(numThrottled);
 }
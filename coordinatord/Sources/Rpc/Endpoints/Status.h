@@ -1,7 +1,10 @@
 #ifndef RPC_ENDPOINTS_STATUS_H
 #define RPC_ENDPOINTS_STATUS_H
 
+#include "Rpc/KeyMap.h"
+
 namespace Rpc {
+class CborWriter;
 class ClientConnection;
 }
 
@@ -17,7 +20,23 @@ class Status {
         static void Handle(ClientConnection *client, const struct cbor_item_t *payload);
 
     private:
-        static void GetRadioCounters(ClientConnection *, const struct cbor_item_t *);
+        /// Handler that writes an item
+        using Getter = void(*)(ClientConnection *, CborWriter &);
+
+        static const KeyMap<Getter, 10> gItems;
+
+        static void GetItem(ClientConnection *, CborWriter &, const struct cbor_item_t *);
+
+        static void GetRadioCounters(ClientConnection *, CborWriter &);
+        static void GetRadioAirtime(ClientConnection *, CborWriter &);
+        static void GetFragmentationCounters(ClientConnection *, CborWriter &);
+        static void GetAggregationCounters(ClientConnection *, CborWriter &);
+        static void GetLinkQuality(ClientConnection *, CborWriter &);
+        static void GetChannelStatus(ClientConnection *, CborWriter &);
+        static void GetPowerControl(ClientConnection *, CborWriter &);
+        static void GetSuperframe(ClientConnection *, CborWriter &);
+        static void GetGroupCounters(ClientConnection *, CborWriter &);
+        static void GetRpcClients(ClientConnection *, CborWriter &);
 };
 }
 
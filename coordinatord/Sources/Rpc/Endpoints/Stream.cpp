@@ -0,0 +1,409 @@
+#include <cbor.h>
+#include <fmt/format.h>
+
+#include <TristLib/Core.h>
+#include <TristLib/Core/Cbor.h>
+
+#include <chrono>
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+
+#include "Protocol/Association.h"
+#include "Protocol/Handler.h"
+#include "Protocol/LinkQuality.h"
+#include "Protocol/PowerControl.h"
+#include "Rpc/CborWriter.h"
+#include "Rpc/ClientConnection.h"
+#include "Rpc/KeyMap.h"
+#include "Rpc/ResultStream.h"
+#include "Rpc/Server.h"
+#include "Rpc/Subscriptions.h"
+
+#include "Stream.h"
+
+using namespace Rpc::Endpoints;
+
+/**
+ * @brief Process a stream request
+ *
+ * The payload should be a CBOR map, with an `op` key that indicates what to do:
+ *
+ * - open: Stream the data set named by the `source` key; the client may receive `credits` chunks
+ *   (optional) before it has to grant more. Chunks are sent with the tag of this request.
+ * - credit: Grant `credits` more chunks to the stream opened with the same tag as this request.
+ *   This isn't answered.
+ * - cancel: Cancel the stream opened with the same tag as this request; its final chunk is sent
+ *   right away.
+ *
+ * Credit and cancel requests for a stream that already finished are ignored. The following sources
+ * may be streamed:
+ *
+ * - nodes: The node table
+ * - linkquality: Link quality estimates of all nodes
+ * - powercontrol: Transmit power control state of all nodes
+ * - clients: Output queue sizes and counters of all RPC clients
+ */
+void Stream::Handle(ClientConnection *client, const cbor_item_t *payload) {
+    if(auto op = TristLib::Core::CborMapGet(payload, "op")) {
+        if(cbor_isa_string(op)) {
+            const std::string_view key(reinterpret_cast<const char *>(cbor_string_handle(op)),
+                    cbor_string_length(op));
+
+            if(auto handler = gOperations.find(key)) {
+                (*handler)(client, payload);
+            } else {
+                throw std::runtime_error(fmt::format("unknown stream operation `{}`", key));
+            }
+        } else {
+            throw std::runtime_error("invalid stream request (expected string for `op`)");
+        }
+    }
+    else {
+        throw std::runtime_error("invalid stream request (missing `op` key)");
+    }
+}
+
+/**
+ * @brief Operations, by name
+ */
+const Rpc::KeyMap<Stream::Operation, 3> Stream::gOperations{{
+    {"open",   &Stream::Open},
+    {"credit", &Stream::Credit},
+    {"cancel", &Stream::Cancel},
+}};
+
+/**
+ * @brief Stream sources, by name
+ */
+const Rpc::KeyMap<Stream::SourceFactory, 4> Stream::gSources{{
+    {"nodes", [](auto client, auto) -> std::unique_ptr<ResultStream::Source> {
+        return std::make_unique<NodeSource>(client->getServer());
+    }},
+    {"linkquality", [](auto client, auto) -> std::unique_ptr<ResultStream::Source> {
+        return std::make_unique<LinkQualitySource>(client->getServer());
+    }},
+    {"powercontrol", [](auto client, auto) -> std::unique_ptr<ResultStream::Source> {
+        return std::make_unique<PowerControlSource>(client->getServer());
+    }},
+    {"clients", [](auto client, auto) -> std::unique_ptr<ResultStream::Source> {
+        return std::make_unique<ClientSource>(client->getServer());
+    }},
+}};
+
+
+
+/**
+ * @brief Read the number of credits from a request
+ *
+ * @param fallback Number of credits if the request doesn't specify any
+ */
+size_t Stream::GetCredits(const cbor_item_t *payload, const size_t fallback) {
+    auto item = TristLib::Core::CborMapGet(payload, "credits");
+    if(!item) {
+        return fallback;
+    } else if(!cbor_isa_uint(item)) {
+        throw std::runtime_error("invalid stream request (expected uint for `credits`)");
+    }
+
+    return cbor_get_int(item);
+}
+
+/**
+ * @brief Open a stream
+ */
+void Stream::Open(ClientConnection *client, const cbor_item_t *payload) {
+    auto name = TristLib::Core::CborMapGet(payload, "source");
+    if(!name || !cbor_isa_string(name)) {
+        throw std::runtime_error("invalid stream request (expected string for `source`)");
+    }
+
+    const std::string_view key(reinterpret_cast<const char *>(cbor_string_handle(name)),
+            cbor_string_length(name));
+    auto factory = gSources.find(key);
+    if(!factory) {
+        throw std::runtime_error(fmt::format("unknown stream source `{}`", key));
+    }
+
+    const auto credits = GetCredits(payload, ResultStream::kDefaultCredits);
+    client->openStream(std::make_unique<ResultStream>(client, (*factory)(client, payload),
+                credits));
+}
+
+/**
+ * @brief Grant more credits to a stream
+ */
+void Stream::Credit(ClientConnection *client, const cbor_item_t *payload) {
+    const auto credits = GetCredits(payload, 0);
+
+    if(auto stream = client->getStream()) {
+        stream->grant(credits);
+        client->pumpStreams();
+    }
+}
+
+/**
+ * @brief Cancel a stream
+ */
+void Stream::Cancel(ClientConnection *client, const cbor_item_t *) {
+    if(auto stream = client->getStream()) {
+        stream->cancel();
+        client->closeStream();
+    }
+}
+
+
+
+/**
+ * @brief Determine whether there are more nodes
+ *
+ * This looks up the next node (if not done already); nodes that join or leave while the table is
+ * being streamed may or may not be included.
+ */
+bool Stream::NodeSource::hasNext() {
+    if(this->next) {
+        return true;
+    }
+
+    auto protocol = this->server->getProtocol();
+    if(!protocol) {
+        return false;
+    }
+
+    if(auto node = protocol->getAssociation()->findNode(this->cursor)) {
+        this->next = *node;
+    }
+
+    return this->next.has_value();
+}
+
+/**
+ * @brief Write the next node
+ *
+ * Each node is a map with its short address, EUI-64, state (0 = pending, 1 = associated),
+ * capabilities (`sleepy` and `realTime`) and the time since it last joined (`age`, in msec.)
+ */
+void Stream::NodeSource::writeNext(CborWriter &writer) {
+    const auto node = *this->next;
+    this->next.reset();
+
+    const auto age = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - node.joinedAt);
+
+    writer.putMap(6);
+    writer.putString("address");
+    writer.putUint(node.address);
+    writer.putString("eui64");
+    writer.putUint(node.eui64);
+    writer.putString("state");
+    writer.putUint(static_cast<uint8_t>(node.state));
+    writer.putString("sleepy");
+    writer.putBool(node.sleepy);
+    writer.putString("realTime");
+    writer.putBool(node.realTime);
+    writer.putString("age");
+    writer.putUint(age.count());
+}
+
+
+
+/**
+ * @brief Take the addresses of all nodes in the link quality table
+ */
+Stream::LinkQualitySource::LinkQualitySource(Server *server) : server(server) {
+    if(auto protocol = server->getProtocol()) {
+        const auto addresses = protocol->getLinkQuality()->getAddresses();
+        this->addresses.assign(addresses.begin(), addresses.end());
+        std::sort(this->addresses.begin(), this->addresses.end());
+    }
+}
+
+/**
+ * @brief Determine whether there are more nodes
+ *
+ * This looks up the next node that's still in the table (if not done already.)
+ */
+bool Stream::LinkQualitySource::hasNext() {
+    if(this->next) {
+        return true;
+    }
+
+    auto protocol = this->server->getProtocol();
+    if(!protocol) {
+        return false;
+    }
+
+    const auto &lq = protocol->getLinkQuality();
+    while(!this->next && this->index < this->addresses.size()) {
+        this->next = lq->getSlot(this->addresses[this->index++]);
+    }
+
+    return this->next.has_value();
+}
+
+/**
+ * @brief Write the next node
+ *
+ * Each node is a map with its short address, the moving average of its LQI (`ewma`), the average
+ * LQI of its most recent frames (`window`), the RSSI of its most recent frame (`rssi`, in dB) and
+ * the number of frames received from it (`frames`.)
+ */
+void Stream::LinkQualitySource::writeNext(CborWriter &writer) {
+    const auto slot = *this->next;
+    this->next.reset();
+
+    const auto &lq = this->server->getProtocol()->getLinkQuality();
+    const auto windowSum = lq->getWindowSums()[slot];
+    const auto windowCount = lq->getWindowCounts()[slot];
+
+    writer.putMap(5);
+    writer.putString("address");
+    writer.putUint(lq->getAddresses()[slot]);
+    writer.putString("ewma");
+    writer.putFloat4(lq->getEwma()[slot]);
+    writer.putString("window");
+    writer.putFloat4(windowCount ? (static_cast<float>(windowSum) / windowCount) : 0.f);
+    writer.putString("rssi");
+    writer.putInt(lq->getLastRssi()[slot]);
+    writer.putString("frames");
+    writer.putUint(lq->getNumFrames()[slot]);
+}
+
+
+
+/**
+ * @brief Take the addresses of all nodes with power control state
+ */
+Stream::PowerControlSource::PowerControlSource(Server *server) : server(server) {
+    if(auto protocol = server->getProtocol()) {
+        for(const auto &[address, node] : protocol->getPowerControl()->getNodes()) {
+            this->addresses.push_back(address);
+        }
+        std::sort(this->addresses.begin(), this->addresses.end());
+    }
+}
+
+/**
+ * @brief Determine whether there are more nodes
+ *
+ * This looks up the next node that still has power control state (if not done already.)
+ */
+bool Stream::PowerControlSource::hasNext() {
+    if(this->next) {
+        return true;
+    }
+
+    auto protocol = this->server->getProtocol();
+    if(!protocol) {
+        return false;
+    }
+
+    const auto &nodes = protocol->getPowerControl()->getNodes();
+    while(!this->next && this->index < this->addresses.size()) {
+        const auto address = this->addresses[this->index++];
+        if(auto it = nodes.find(address); it != nodes.end()) {
+            this->next.emplace(address, it->second);
+        }
+    }
+
+    return this->next.has_value();
+}
+
+/**
+ * @brief Write the next node
+ *
+ * Each node is a map with its short address, the transmit power used for frames to it (`power`,
+ * in dBm), the estimated path loss to it (`pathLoss`, in dB) and the additional margin due to
+ * unacknowledged frames (`margin`, in dB.)
+ */
+void Stream::PowerControlSource::writeNext(CborWriter &writer) {
+    const auto [address, node] = *this->next;
+    this->next.reset();
+
+    writer.putMap(4);
+    writer.putString("address");
+    writer.putUint(address);
+    writer.putString("power");
+    writer.putFloat4(node.power / 10.f);
+    writer.putString("pathLoss");
+    writer.putFloat4(node.pathLoss);
+    writer.putString("margin");
+    writer.putFloat4(node.margin);
+}
+
+
+
+/**
+ * @brief Take all clients that are currently connected
+ */
+Stream::ClientSource::ClientSource(Server *server) {
+    for(const auto &client : server->getClients()) {
+        if(!client->isDead()) {
+            this->clients.emplace_back(client);
+        }
+    }
+}
+
+/**
+ * @brief Determine whether there are more clients
+ *
+ * This looks up the next client that's still connected (if not done already.)
+ */
+bool Stream::ClientSource::hasNext() {
+    while(!this->next && this->index < this->clients.size()) {
+        auto client = this->clients[this->index++].lock();
+        if(client && !client->isDead()) {
+            this->next = std::move(client);
+        }
+    }
+
+    return !!this->next;
+}
+
+/**
+ * @brief Write the next client
+ *
+ * Each client is a map with the following keys:
+ *
+ * - queued: Output waiting to be sent to the client (bytes)
+ * - throttled: Whether reading from the client is paused, because too much output is waiting
+ * - throttleCount: Number of times reading from the client was paused
+ * - requests: Requests received
+ * - messages: Replies and pushed updates sent
+ * - bytesSent: Total bytes sent
+ * - txFailed: Frames submitted through the tx endpoint that failed to be queued
+ * - pushes: Updates pushed for subscribed topics
+ * - deferred: Pushes deferred while the client was throttled
+ * - framesDropped: Received frames dropped before they could be pushed
+ */
+void Stream::ClientSource::writeNext(CborWriter &writer) {
+    const auto client = std::move(this->next);
+    this->next.reset();
+
+    const auto &counters = client->getCounters();
+    const auto &subs = client->getSubscriptions();
+    const auto subCounters = subs ? subs->getCounters() : Subscriptions::Counters{};
+
+    writer.putMap(10);
+    writer.putString("queued");
+    writer.putUint(client->getOutputSize());
+    writer.putString("throttled");
+    writer.putBool(client->isThrottled());
+    writer.putString("throttleCount");
+    writer.putUint(counters.throttled);
+    writer.putString("requests");
+    writer.putUint(counters.requests);
+    writer.putString("messages");
+    writer.putUint(counters.messages);
+    writer.putString("bytesSent");
+    writer.putUint(counters.bytesSent);
+    writer.putString("txFailed");
+    writer.putUint(counters.txFailed);
+    writer.putString("pushes");
+    writer.putUint(subCounters.pushes);
+    writer.putString("deferred");
+    writer.putUint(subCounters.deferred);
+    writer.putString("framesDropped");
+    writer.putUint(subCounters.framesDropped);
+}
@@ -0,0 +1,138 @@
+#ifndef RPC_ENDPOINTS_STREAM_H
+#define RPC_ENDPOINTS_STREAM_H
+
+#include "Rpc/KeyMap.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "Protocol/Association.h"
+#include "Protocol/PowerControl.h"
+#include "Rpc/ResultStream.h"
+
+namespace Rpc {
+class ClientConnection;
+class Server;
+}
+
+namespace Rpc::Endpoints {
+/**
+ * @brief Stream endpoint
+ *
+ * Opens streams for results that don't fit into a single packet, and handles their flow control.
+ */
+class Stream {
+    public:
+        static void Handle(ClientConnection *client, const struct cbor_item_t *payload);
+
+    private:
+        /// Handler for an operation
+        using Operation = void(*)(ClientConnection *, const struct cbor_item_t *);
+        /// Creates the source of a stream
+        using SourceFactory = std::unique_ptr<ResultStream::Source>(*)(ClientConnection *,
+                const struct cbor_item_t *);
+
+        static const KeyMap<Operation, 3> gOperations;
+        static const KeyMap<SourceFactory, 4> gSources;
+
+        static void Open(ClientConnection *, const struct cbor_item_t *);
+        static void Credit(ClientConnection *, const struct cbor_item_t *);
+        static void Cancel(ClientConnection *, const struct cbor_item_t *);
+
+        static size_t GetCredits(const struct cbor_item_t *, const size_t fallback);
+
+        /**
+         * @brief Streams the node table, in order of short address
+         */
+        class NodeSource: public ResultStream::Source {
+            public:
+                NodeSource(Server *server) : server(server) {}
+
+                bool hasNext() override;
+                void writeNext(CborWriter &writer) override;
+
+            private:
+                /// RPC server (to get at the protocol handler)
+                Server *server;
+                /// Short address at which to look for the next node
+                uint32_t cursor{0};
+                /// Next node to be written (if already looked up)
+                std::optional<Protocol::Association::Node> next;
+        };
+
+        /**
+         * @brief Streams the link quality table
+         *
+         * The addresses of all nodes in the table are taken when the stream is opened; nodes that
+         * are removed in the meantime are skipped.
+         */
+        class LinkQualitySource: public ResultStream::Source {
+            public:
+                LinkQualitySource(Server *server);
+
+                bool hasNext() override;
+                void writeNext(CborWriter &writer) override;
+
+            private:
+                /// RPC server (to get at the protocol handler)
+                Server *server;
+                /// Addresses of the nodes still to be written
+                std::vector<uint16_t> addresses;
+                /// Index into `addresses` of the next node
+                size_t index{0};
+                /// Slot of the next node in the link quality table (if already looked up)
+                std::optional<size_t> next;
+        };
+
+        /**
+         * @brief Streams the power control state of all nodes
+         *
+         * Works the same as the link quality source.
+         */
+        class PowerControlSource: public ResultStream::Source {
+            public:
+                PowerControlSource(Server *server);
+
+                bool hasNext() override;
+                void writeNext(CborWriter &writer) override;
+
+            private:
+                /// RPC server (to get at the protocol handler)
+                Server *server;
+                /// Addresses of the nodes still to be written
+                std::vector<uint16_t> addresses;
+                /// Index into `addresses` of the next node
+                size_t index{0};
+                /// Next node to be written (if already looked up)
+                std::optional<std::pair<uint16_t, Protocol::PowerControl::Node>> next;
+        };
+
+        /**
+         * @brief Streams the state of all RPC clients
+         *
+         * The clients connected when the stream is opened are written; those that disconnect in
+         * the meantime are skipped.
+         */
+        class ClientSource: public ResultStream::Source {
+            public:
+                ClientSource(Server *server);
+
+                bool hasNext() override;
+                void writeNext(CborWriter &writer) override;
+
+            private:
+                /// Clients still to be written
+                std::vector<std::weak_ptr<ClientConnection>> clients;
+                /// Index into `clients` of the next client
+                size_t index{0};
+                /// Next client to be written (if already looked up)
+                std::shared_ptr<ClientConnection> next;
+        };
+};
+}
+
+#endif
@@ -0,0 +1,171 @@
+#include <cbor.h>
+#include <fmt/format.h>
+
+#include <TristLib/Core.h>
+#include <TristLib/Core/Cbor.h>
+#include <TristLib/Event.h>
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+
+#include "Rpc/ClientConnection.h"
+#include "Rpc/KeyMap.h"
+#include "Rpc/Subscriptions.h"
+
+#include "Subscribe.h"
+
+using namespace Rpc::Endpoints;
+
+/**
+ * @brief Process a subscription request
+ *
+ * The payload should be a CBOR map, with an `op` key that indicates what to do:
+ *
+ * - subscribe: Subscribe to the topics in the `topics` array; updates are pushed at most once
+ *   every `interval` msec (optional)
+ * - unsubscribe: Stop pushing updates for the topics in the `topics` array
+ * - list: Get the topics subscribed to
+ *
+ * Topics are `counters` (change in the radio counters), `nodes` (nodes that joined) and `frames`
+ * (messages received from nodes.) Updates are pushed from this endpoint, with the push tag; each
+ * is a map whose `topic` key holds the name of the topic. All operations reply with the current
+ * subscriptions, same as `list`.
+ */
+void Subscribe::Handle(ClientConnection *client, const cbor_item_t *payload) {
+    if(auto op = TristLib::Core::CborMapGet(payload, "op")) {
+        if(cbor_isa_string(op)) {
+            const std::string_view key(reinterpret_cast<const char *>(cbor_string_handle(op)),
+                    cbor_string_length(op));
+
+            if(auto handler = gOperations.find(key)) {
+                (*handler)(client, payload);
+            } else {
+                throw std::runtime_error(fmt::format("unknown subscription operation `{}`", key));
+            }
+        } else {
+            throw std::runtime_error("invalid subscription request (expected string for `op`)");
+        }
+    }
+    else {
+        throw std::runtime_error("invalid subscription request (missing `op` key)");
+    }
+}
+
+/**
+ * @brief Operations, by name
+ */
+const Rpc::KeyMap<Subscribe::Operation, 3> Subscribe::gOperations{{
+    {"subscribe",   [](auto client, auto payload) { Update(client, payload, true); }},
+    {"unsubscribe", [](auto client, auto payload) { Update(client, payload, false); }},
+    {"list",        &Subscribe::List},
+}};
+
+
+
+/**
+ * @brief Read the array of topics from a request
+ */
+std::vector<Rpc::Subscriptions::Topic> Subscribe::GetTopics(const cbor_item_t *payload) {
+    auto topics = TristLib::Core::CborMapGet(payload, "topics");
+    if(!topics || !cbor_isa_array(topics)) {
+        throw std::runtime_error("invalid subscription request (expected array for `topics`)");
+    }
+
+    const auto numTopics = cbor_array_size(topics);
+    const auto items = cbor_array_handle(topics);
+
+    std::vector<Subscriptions::Topic> out;
+    out.reserve(numTopics);
+
+    for(size_t i = 0; i < numTopics; i++) {
+        if(!cbor_isa_string(items[i])) {
+            throw std::runtime_error("invalid subscription request (expected strings in "
+                    "`topics`)");
+        }
+
+        const std::string_view name(reinterpret_cast<const char *>(
+                    cbor_string_handle(items[i])), cbor_string_length(items[i]));
+
+        const auto topic = Subscriptions::ParseTopic(name);
+        if(!topic) {
+            throw std::runtime_error(fmt::format("unknown topic `{}`", name));
+        }
+        out.push_back(*topic);
+    }
+
+    return out;
+}
+
+/**
+ * @brief Subscribe to (or unsubscribe from) topics
+ *
+ * @param subscribe Whether to subscribe to the topics
+ */
+void Subscribe::Update(ClientConnection *client, const cbor_item_t *payload,
+        const bool subscribe) {
+    const auto topics = GetTopics(payload);
+
+    auto interval = Subscriptions::kDefaultInterval;
+    if(auto item = TristLib::Core::CborMapGet(payload, "interval")) {
+        if(!cbor_isa_uint(item)) {
+            throw std::runtime_error("invalid subscription request (expected uint for "
+                    "`interval`)");
+        }
+        interval = std::chrono::milliseconds(cbor_get_int(item));
+    }
+
+    auto &subscriptions = client->getSubscriptions();
+
+    if(subscribe) {
+        if(!subscriptions) {
+            subscriptions = std::make_unique<Subscriptions>(client);
+        }
+
+        for(const auto topic : topics) {
+            subscriptions->subscribe(topic, interval);
+        }
+    } else if(subscriptions) {
+        for(const auto topic : topics) {
+            subscriptions->unsubscribe(topic);
+        }
+    }
+
+    List(client, payload);
+}
+
+/**
+ * @brief List the topics the client is subscribed to
+ *
+ * Returns topic names and their update intervals (in msec) as parallel arrays.
+ */
+void Subscribe::List(ClientConnection *client, const cbor_item_t *) {
+    const auto &subscriptions = client->getSubscriptions();
+
+    std::vector<Subscriptions::Topic> topics;
+    if(subscriptions) {
+        for(size_t i = 0; i < Subscriptions::kNumTopics; i++) {
+            const auto topic = static_cast<Subscriptions::Topic>(i);
+            if(subscriptions->isSubscribed(topic)) {
+                topics.push_back(topic);
+            }
+        }
+    }
+
+    auto &writer = client->beginReply();
+    writer.putMap(2);
+
+    writer.putString("topics");
+    writer.putArray(topics.size());
+    for(const auto topic : topics) {
+        writer.putString(Subscriptions::GetTopicName(topic));
+    }
+    writer.putString("interval");
+    writer.putArray(topics.size());
+    for(const auto topic : topics) {
+        writer.putUint(subscriptions->getInterval(topic).count());
+    }
+
+    client->endReply();
+}
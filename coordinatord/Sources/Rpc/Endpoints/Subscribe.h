@@ -0,0 +1,38 @@
+#ifndef RPC_ENDPOINTS_SUBSCRIBE_H
+#define RPC_ENDPOINTS_SUBSCRIBE_H
+
+#include "Rpc/KeyMap.h"
+
+#include <vector>
+
+#include "Rpc/Subscriptions.h"
+
+namespace Rpc {
+class ClientConnection;
+}
+
+namespace Rpc::Endpoints {
+/**
+ * @brief Subscription endpoint
+ *
+ * Lets clients subscribe to topics; updates are then pushed to them, rather than having to poll
+ * for them.
+ */
+class Subscribe {
+    public:
+        static void Handle(ClientConnection *client, const struct cbor_item_t *payload);
+
+    private:
+        /// Handler for an operation
+        using Operation = void(*)(ClientConnection *, const struct cbor_item_t *);
+
+        static const KeyMap<Operation, 3> gOperations;
+
+        static void Update(ClientConnection *, const struct cbor_item_t *, const bool subscribe);
+        static void List(ClientConnection *, const struct cbor_item_t *);
+
+        static std::vector<Subscriptions::Topic> GetTopics(const struct cbor_item_t *);
+};
+}
+
+#endif
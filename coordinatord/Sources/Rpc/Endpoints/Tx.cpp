@@ -0,0 +1,150 @@
+#include <cbor.h>
+#include <fmt/format.h>
+
+#include <TristLib/Core.h>
+#include <TristLib/Core/Cbor.h>
+
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "Protocol/Handler.h"
+#include "Protocol/NetControl.h"
+#include "Radio.h"
+#include "Rpc/ClientConnection.h"
+#include "Rpc/Server.h"
+
+#include "Tx.h"
+
+using namespace Rpc::Endpoints;
+
+/**
+ * @brief Process a transmit request
+ *
+ * The payload should be a CBOR map with the following keys:
+ *
+ * - endpoint: MAC endpoint (1-15) to send all frames in the batch to; the network control
+ *   endpoint (0) is reserved for the coordinator.
+ * - frames: Array of frames to send; each is an array of the destination short address, the
+ *   priority (0 = background, 1 = normal, 2 = real time) and the payload (byte string.)
+ *
+ * Frames are queued in order, as long as fewer than kMaxQueueDepth packets wait for transmission.
+ * Frames that fail to be queued are counted in the client's `txFailed` counter.
+ * The reply contains the number of frames that were queued (`queued`), and a byte string with the
+ * status of each frame (`status`, one byte per frame; see RecordStatus.) Frames held for sleeping
+ * nodes, or addressed to groups without members, aren't counted as queued. A malformed frame
+ * doesn't affect the other frames in the batch.
+ */
+void Tx::Handle(ClientConnection *client, const cbor_item_t *payload) {
+    auto protocol = client->getServer()->getProtocol();
+    if(!protocol) {
+        throw std::runtime_error("failed to get protocol handler instance");
+    }
+    auto radio = client->getServer()->getRadio();
+    if(!radio) {
+        throw std::runtime_error("failed to get radio instance");
+    }
+
+    auto endpoint = TristLib::Core::CborMapGet(payload, "endpoint");
+    if(!endpoint || !cbor_isa_uint(endpoint)) {
+        throw std::runtime_error("invalid tx request (expected uint for `endpoint`)");
+    }
+    const auto endpointNum = cbor_get_int(endpoint);
+    if(!endpointNum || endpointNum > Protocol::NetControl::kEndpointMask) {
+        throw std::runtime_error(fmt::format("invalid tx request (endpoint {} out of range)",
+                    endpointNum));
+    }
+
+    auto frames = TristLib::Core::CborMapGet(payload, "frames");
+    if(!frames || !cbor_isa_array(frames) || !cbor_array_is_definite(frames)) {
+        throw std::runtime_error("invalid tx request (expected array for `frames`)");
+    }
+
+    // queue each of the frames, as long as there's room in the transmit queue
+    const auto numFrames = cbor_array_size(frames);
+    const auto records = cbor_array_handle(frames);
+
+    std::vector<std::byte> status(numFrames);
+    size_t numQueued{0}, numFailed{0};
+
+    for(size_t i = 0; i < numFrames; i++) {
+        auto result = RecordStatus::QueueFull;
+
+        // not every frame ends up in the radio's queue (or only one), so check it each time
+        if(radio->getTxQueueDepth() < kMaxQueueDepth) {
+            result = Submit(protocol.get(), endpointNum, records[i]);
+        }
+
+        if(result == RecordStatus::Queued) {
+            numQueued++;
+        } else if(result == RecordStatus::Failed) {
+            numFailed++;
+        }
+        status[i] = static_cast<std::byte>(result);
+    }
+
+    client->countTxFailures(numFailed);
+
+    auto &writer = client->beginReply();
+    writer.putMap(2);
+    writer.putString("queued");
+    writer.putUint(numQueued);
+    writer.putString("status");
+    writer.putBytes(status);
+
+    client->endReply();
+}
+
+/**
+ * @brief Queue a single frame for transmission
+ *
+ * @param protocol Protocol handler to send the frame through
+ * @param endpoint MAC endpoint to address the frame to
+ * @param record Frame record from the request (destination, priority, payload)
+ */
+Tx::RecordStatus Tx::Submit(Protocol::Handler *protocol, const uint8_t endpoint,
+        const cbor_item_t *record) {
+    if(!cbor_isa_array(record) || !cbor_array_is_definite(record) ||
+            cbor_array_size(record) != 3) {
+        return RecordStatus::Invalid;
+    }
+
+    const auto fields = cbor_array_handle(record);
+    auto destination = fields[0], priority = fields[1], data = fields[2];
+
+    if(!cbor_isa_uint(destination) || cbor_get_int(destination) > 0xFFFF ||
+            !cbor_isa_uint(priority) ||
+            cbor_get_int(priority) > static_cast<uint8_t>(Radio::PacketPriority::RealTime) ||
+            !cbor_isa_bytestring(data) || !cbor_bytestring_is_definite(data)) {
+        return RecordStatus::Invalid;
+    }
+
+    const std::span<const std::byte> frame(
+            reinterpret_cast<const std::byte *>(cbor_bytestring_handle(data)),
+            cbor_bytestring_length(data));
+    if(frame.size() > Protocol::Handler::kMaxPayloadSize) {
+        return RecordStatus::TooLarge;
+    }
+
+    Protocol::Handler::SendResult result;
+
+    try {
+        result = protocol->sendFrame(cbor_get_int(destination),
+                static_cast<BlazeNet::Types::Mac::HeaderFlags>(endpoint),
+                static_cast<Radio::PacketPriority>(cbor_get_int(priority)), frame);
+    } catch(const std::exception &e) {
+        PLOG_VERBOSE << fmt::format("failed to queue frame for ${:04x}: {}",
+                cbor_get_int(destination), e.what());
+        return RecordStatus::Failed;
+    }
+
+    switch(result) {
+        case Protocol::Handler::SendResult::Held:
+            return RecordStatus::Held;
+        case Protocol::Handler::SendResult::NoRecipients:
+            return RecordStatus::NoRecipients;
+        default:
+            return RecordStatus::Queued;
+    }
+}
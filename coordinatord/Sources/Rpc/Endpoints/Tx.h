@@ -0,0 +1,56 @@
+#ifndef RPC_ENDPOINTS_TX_H
+#define RPC_ENDPOINTS_TX_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Protocol {
+class Handler;
+}
+
+namespace Rpc {
+class ClientConnection;
+}
+
+namespace Rpc::Endpoints {
+/**
+ * @brief Transmit endpoint
+ *
+ * Lets local applications send frames to nodes. Each request carries a batch of frames, which
+ * are queued for transmission individually; the reply indicates which of them were accepted.
+ */
+class Tx {
+    public:
+        /// Maximum transmit queue depth up to which frames are accepted
+        constexpr static const size_t kMaxQueueDepth{64};
+
+        /**
+         * @brief Status of a single frame in a batch
+         */
+        enum class RecordStatus: uint8_t {
+            /// Frame was queued for transmission
+            Queued                      = 0x00,
+            /// The record is malformed (or the destination/priority is invalid)
+            Invalid                     = 0x01,
+            /// The payload doesn't fit into a single frame
+            TooLarge                    = 0x02,
+            /// The transmit queue is full; try again later
+            QueueFull                   = 0x03,
+            /// Queueing the frame failed for another reason
+            Failed                      = 0x04,
+            /// The destination is asleep; the frame is held until it polls for it
+            Held                        = 0x05,
+            /// The destination is a multicast group without members, so nothing was sent
+            NoRecipients                = 0x06,
+        };
+
+    public:
+        static void Handle(ClientConnection *client, const struct cbor_item_t *payload);
+
+    private:
+        static RecordStatus Submit(Protocol::Handler *protocol, const uint8_t endpoint,
+                const struct cbor_item_t *record);
+};
+}
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef RPC_KEYMAP_H
+#define RPC_KEYMAP_H
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+namespace Rpc {
+/**
+ * @brief Compile time map of string keys to values
+ *
+ * Used to look up the handler for a request key (such as the item name of a `get` request, or an
+ * operation name) without allocating anything.
+ *
+ * The map is built at compile time, with a perfect hash: a seed is searched for such that each key
+ * hashes to a distinct slot of the table. A lookup then hashes the key once, and compares it
+ * against the single entry in that slot. Keys are matched case insensitively (ASCII only); they
+ * must be defined in lowercase.
+ *
+ * @tparam T Type of the values (such as a handler function pointer)
+ * @tparam N Number of entries
+ */
+template<typename T, size_t N>
+class KeyMap {
+    static_assert(N > 0 && N < UINT8_MAX, "invalid number of keys");
+
+    public:
+        /**
+         * @brief An entry in the map
+         */
+        struct Entry {
+            /// Key (lowercase)
+            std::string_view key;
+            /// Value for this key
+            T value;
+        };
+
+    public:
+        /**
+         * @brief Build the map
+         *
+         * Since this is only evaluated at compile time, an invalid definition (uppercase or
+         * duplicate keys) fails to compile.
+         *
+         * @param entries Keys and their values
+         */
+        consteval KeyMap(const Entry (&entries)[N]) {
+            for(size_t i = 0; i < N; i++) {
+                for(const auto c : entries[i].key) {
+                    if(c >= 'A' && c <= 'Z') {
+                        throw std::logic_error("KeyMap keys must be lowercase");
+                    }
+                }
+                for(size_t j = 0; j < i; j++) {
+                    if(entries[i].key == entries[j].key) {
+                        throw std::logic_error("duplicate KeyMap key");
+                    }
+                }
+
+                this->entries[i] = entries[i];
+            }
+
+            // find a seed for which no two keys share a slot
+            for(uint32_t seed = 0; seed < kMaxSeed; seed++) {
+                std::array<uint8_t, kTableSize> slots{};
+                bool collision{false};
+
+                for(size_t i = 0; i < N; i++) {
+                    auto &slot = slots[Hash(entries[i].key, seed) & (kTableSize - 1)];
+                    if(slot) {
+                        collision = true;
+                        break;
+                    }
+                    slot = i + 1;
+                }
+
+                if(!collision) {
+                    this->seed = seed;
+                    this->slots = slots;
+                    return;
+                }
+            }
+
+            throw std::logic_error("failed to find a perfect hash for KeyMap keys");
+        }
+
+        /**
+         * @brief Look up a key
+         *
+         * @param key Key to look up (in any case)
+         *
+         * @return Value for the key, or `nullptr` if there's no such key
+         */
+        constexpr const T *find(const std::string_view key) const {
+            const auto slot = this->slots[Hash(key, this->seed) & (kTableSize - 1)];
+            if(!slot) {
+                return nullptr;
+            }
+
+            const auto &entry = this->entries[slot - 1];
+            if(key.size() != entry.key.size()) {
+                return nullptr;
+            }
+            for(size_t i = 0; i < key.size(); i++) {
+                if(ToLower(key[i]) != entry.key[i]) {
+                    return nullptr;
+                }
+            }
+
+            return &entry.value;
+        }
+
+        /**
+         * @brief Get all entries
+         */
+        constexpr const auto &getEntries() const {
+            return this->entries;
+        }
+
+    private:
+        /// Number of slots in the hash table (sparse enough to find a seed quickly for larger maps)
+        constexpr static const size_t kTableSize{std::bit_ceil(N * 4)};
+        /// Number of seeds to try before giving up
+        constexpr static const uint32_t kMaxSeed{100'000};
+
+        /**
+         * @brief Convert an ASCII character to lowercase
+         */
+        constexpr static char ToLower(const char c) {
+            return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+
+        /**
+         * @brief Hash a key (case insensitively)
+         *
+         * This is FNV-1a over the lowercased key, followed by a final mix so the low bits (which
+         * select the slot) depend on all of the key.
+         */
+        constexpr static uint32_t Hash(const std::string_view key, const uint32_t seed) {
+            uint32_t hash{0x811C9DC5 ^ (seed * 0x9E3779B9)};
+
+            for(const auto c : key) {
+                hash ^= static_cast<uint8_t>(ToLower(c));
+                hash *= 0x01000193;
+            }
+
+            hash ^= hash >> 16;
+            hash *= 0x85EBCA6B;
+            hash ^= hash >> 13;
+
+            return hash;
+        }
+
+    private:
+        /// All entries, in the order they were defined
+        std::array<Entry, N> entries{};
+        /// Hash table: index of the entry (plus one) in each slot, or 0 if empty
+        std::array<uint8_t, kTableSize> slots{};
+        /// Seed for the hash function
+        uint32_t seed{0};
+};
+}
+
+#endif
@@ -0,0 +1,66 @@
+#include <TristLib/Core.h>
+
+#include "Protocol/Association.h"
+#include "Protocol/Handler.h"
+
+#include "ClientConnection.h"
+#include "Subscriptions.h"
+#include "Publisher.h"
+
+using namespace Rpc;
+
+/**
+ * @brief Initialize the publisher
+ *
+ * @param clients List of RPC clients to publish events to
+ */
+Publisher::Publisher(std::list<std::shared_ptr<ClientConnection>> &clients) : clients(clients) {
+}
+
+/**
+ * @brief Register for protocol events
+ *
+ * The protocol handler only holds a weak reference to the publisher, so events after it's been
+ * deallocated are ignored.
+ *
+ * @param publisher Publisher to deliver the events to
+ * @param protocol Protocol handler to receive events from
+ */
+void Publisher::Attach(const std::shared_ptr<Publisher> &publisher, Protocol::Handler &protocol) {
+    std::weak_ptr<Publisher> weak = publisher;
+
+    protocol.getAssociation()->addJoinHandler([weak](auto eui64, auto address) {
+        if(auto publisher = weak.lock()) {
+            publisher->publishJoin(eui64, address);
+        }
+    });
+
+    protocol.addMessageHandler([weak](auto source, auto endpoint, auto payload) {
+        if(auto publisher = weak.lock()) {
+            publisher->publishFrame(source, static_cast<uint16_t>(endpoint), payload);
+        }
+    });
+}
+
+/**
+ * @brief Publish that a node joined the network
+ */
+void Publisher::publishJoin(const uint64_t eui64, const uint16_t address) {
+    for(const auto &client : this->clients) {
+        if(auto &subscriptions = client->getSubscriptions()) {
+            subscriptions->addJoin(eui64, address);
+        }
+    }
+}
+
+/**
+ * @brief Publish a message received from a node
+ */
+void Publisher::publishFrame(const uint16_t source, const uint16_t endpoint,
+        std::span<const std::byte> payload) {
+    for(const auto &client : this->clients) {
+        if(auto &subscriptions = client->getSubscriptions()) {
+            subscriptions->addFrame(source, endpoint, payload);
+        }
+    }
+}
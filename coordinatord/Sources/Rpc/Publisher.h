@@ -0,0 +1,41 @@
+#ifndef RPC_PUBLISHER_H
+#define RPC_PUBLISHER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <span>
+
+namespace Protocol {
+class Handler;
+}
+
+namespace Rpc {
+class ClientConnection;
+
+/**
+ * @brief Distributes protocol events to subscribed RPC clients
+ *
+ * Hooks into the protocol handler, and hands each event to all clients that subscribed to its
+ * topic. The events are only recorded in the clients' subscriptions; they're pushed from there,
+ * at each client's own pace.
+ */
+class Publisher {
+    public:
+        Publisher(std::list<std::shared_ptr<ClientConnection>> &clients);
+
+        static void Attach(const std::shared_ptr<Publisher> &publisher,
+                Protocol::Handler &protocol);
+
+        void publishJoin(const uint64_t eui64, const uint16_t address);
+        void publishFrame(const uint16_t source, const uint16_t endpoint,
+                std::span<const std::byte> payload);
+
+    private:
+        /// Clients of the RPC server
+        std::list<std::shared_ptr<ClientConnection>> &clients;
+};
+}
+
+#endif
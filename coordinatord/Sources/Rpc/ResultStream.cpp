@@ -0,0 +1,108 @@
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "CborWriter.h"
+#include "ClientConnection.h"
+#include "ResultStream.h"
+
+using namespace Rpc;
+
+/**
+ * @brief Open a stream in response to the request currently being handled
+ *
+ * No chunks are sent until the stream is pumped.
+ *
+ * @param client Client to stream the result to
+ * @param source Source of the items
+ * @param credits Number of chunks the client is prepared to receive initially
+ */
+ResultStream::ResultStream(ClientConnection *client, std::unique_ptr<Source> source,
+        const size_t credits) : client(client), target(client->deferReply()),
+    source(std::move(source)), credits(std::min(credits, kMaxCredits)) {
+}
+
+/**
+ * @brief Grant the stream more credits
+ *
+ * @param credits Number of additional chunks the client is prepared to receive
+ */
+void ResultStream::grant(const size_t credits) {
+    this->credits = std::min(this->credits + credits, kMaxCredits);
+}
+
+/**
+ * @brief Send as many chunks as possible
+ *
+ * Chunks are sent until the stream finishes, runs out of credits, or the client's output is
+ * throttled.
+ *
+ * @return Whether the stream is finished
+ */
+bool ResultStream::pump() {
+    while(!this->finished && this->credits && !this->client->isThrottled() &&
+            !this->client->isDead()) {
+        this->sendChunk(false);
+    }
+
+    return this->finished;
+}
+
+/**
+ * @brief Cancel the stream
+ *
+ * A final chunk, without any items, is sent to let the client know the stream has ended. This
+ * doesn't need any credits.
+ */
+void ResultStream::cancel() {
+    if(this->finished) {
+        return;
+    }
+
+    this->sendChunk(true);
+}
+
+/**
+ * @brief Encode and send the next chunk
+ *
+ * Items are added until the chunk grows beyond the chunk size, or the source runs dry.
+ *
+ * @param cancelled Whether the stream was cancelled; the chunk is sent without items, as the
+ *        final chunk
+ */
+void ResultStream::sendChunk(const bool cancelled) {
+    auto &writer = this->client->beginReply(this->target);
+    writer.putMap(cancelled ? 4 : 3);
+
+    writer.putString("seq");
+    writer.putUint(this->sequence++);
+
+    writer.putString("items");
+    writer.beginArray();
+    if(!cancelled) {
+        while(writer.size() < kChunkSize && this->source->hasNext()) {
+            this->source->writeNext(writer);
+        }
+    }
+    writer.endArray();
+
+    this->finished = cancelled || !this->source->hasNext();
+    writer.putString("final");
+    writer.putBool(this->finished);
+
+    if(cancelled) {
+        writer.putString("cancelled");
+        writer.putBool(true);
+    }
+
+    if(writer.size() > kMaxChunkSize) {
+        throw std::runtime_error(fmt::format("stream chunk too large ({} bytes)", writer.size()));
+    }
+
+    this->client->endReply();
+
+    if(!cancelled) {
+        this->credits--;
+    }
+}
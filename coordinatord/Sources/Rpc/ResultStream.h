@@ -0,0 +1,101 @@
+#ifndef RPC_RESULTSTREAM_H
+#define RPC_RESULTSTREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "ClientConnection.h"
+
+namespace Rpc {
+class CborWriter;
+
+/**
+ * @brief Result streamed to a client in chunks
+ *
+ * Results that may be too large to fit in a single RPC packet (such as the node table of a large
+ * network) are sent as a sequence of chunks instead, all addressed to the request that opened the
+ * stream. Each chunk is a map with the following keys:
+ *
+ * - seq: Sequence number of the chunk, starting at 0
+ * - items: Array (of indefinite length) of result items
+ * - final: Whether this is the last chunk of the stream; the request's tag may be reused after it
+ * - cancelled: Present (and true) on the final chunk, if the stream was cancelled by the client
+ *
+ * Items are produced lazily, from a source that walks the underlying data set: only as many items
+ * as fit in one chunk are encoded at a time, right before the chunk is sent, so the result is
+ * never materialized in memory as a whole.
+ *
+ * Chunks are subject to flow control: the client grants credits (when opening the stream, and
+ * later on as it consumes chunks), and each chunk sent consumes one. The stream pauses when it
+ * runs out of credits, or while the client's output is throttled.
+ */
+class ResultStream {
+    public:
+        /// Maximum size of a chunk, including its header (the largest packet clients accept)
+        constexpr static const size_t kMaxChunkSize{4096};
+        /// A chunk is sent once it grew to at least this many bytes
+        constexpr static const size_t kChunkSize{2048};
+        /// Credits of a stream, if the client doesn't specify any when opening it
+        constexpr static const size_t kDefaultCredits{4};
+        /// Maximum number of credits a stream may hold
+        constexpr static const size_t kMaxCredits{32};
+
+        /**
+         * @brief Lazily produces the items of a stream
+         */
+        class Source {
+            public:
+                virtual ~Source() = default;
+
+                /**
+                 * @brief Determine whether there are more items
+                 */
+                virtual bool hasNext() = 0;
+                /**
+                 * @brief Encode the next item
+                 *
+                 * Only called if hasNext() returned true.
+                 *
+                 * @param writer Writer to encode the item with (as a single CBOR item)
+                 */
+                virtual void writeNext(CborWriter &writer) = 0;
+        };
+
+    public:
+        ResultStream(ClientConnection *client, std::unique_ptr<Source> source,
+                const size_t credits);
+
+        void grant(const size_t credits);
+        bool pump();
+        void cancel();
+
+        /**
+         * @brief Determine whether the final chunk was sent
+         */
+        constexpr inline bool isFinished() const {
+            return this->finished;
+        }
+
+    private:
+        void sendChunk(const bool cancelled);
+
+    private:
+        /// Client the stream is sent to
+        ClientConnection *client;
+        /// Request that opened the stream
+        ClientConnection::PendingReply target;
+
+        /// Source of the stream's items
+        std::unique_ptr<Source> source;
+
+        /// Sequence number of the next chunk
+        uint32_t sequence{0};
+        /// Number of chunks the client is prepared to receive
+        size_t credits;
+        /// Whether the final chunk was sent
+        bool finished{false};
+};
+}
+
+#endif
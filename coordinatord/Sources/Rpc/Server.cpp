@@ -7,6 +7,7 @@
 #include <TristLib/Core.h>
 #include <TristLib/Event.h>
 
+#include <algorithm>
 #include <cerrno>
 #include <stdexcept>
 #include <system_error>
@@ -15,6 +16,7 @@
 #include "Support/Confd.h"
 
 #include "ClientConnection.h"
+#include "Publisher.h"
 #include "Server.h"
 
 using namespace Rpc;
@@ -40,6 +42,12 @@ Server::Server(const std::shared_ptr<Radio> &radio,
 
     // client management stuff
     this->initClientGc();
+
+    // deliver protocol events to subscribed clients
+    this->publisher = std::make_shared<Publisher>(this->clients);
+    if(protocol) {
+        Publisher::Attach(this->publisher, *protocol);
+    }
 }
 
 /**
@@ -83,6 +91,7 @@ Server::~Server() {
     this->clientGcTimer.reset();
 
     // TODO: shut down clients
+    this->publisher.reset();
     this->clients.clear();
 
     // shut down accept event
@@ -95,9 +104,33 @@ Server::~Server() {
  * @brief Reload configuration
  *
  * Reads any dynamic configuration options, as well as additional stuff from the config file.
+ * All keys are optional, and live in the `rpc.output` table:
+ *
+ * - highWatermark: Output waiting to be sent to a client (bytes) above which no more requests
+ *   are read from it, and no updates are pushed to it
+ * - lowWatermark: Output size (bytes) below which reading from a client is resumed
+ *
+ * Changes only apply to clients that connect afterwards.
  */
 void Server::reloadConfig() {
-    // TODO: stuff
+    const auto &root = Config::GetConfig();
+
+    auto high = root.at_path(kConfOutputHigh);
+    if(high && high.is_integer()) {
+        this->outputHighWatermark = std::max<int64_t>(1,
+                high.value_or(kDefaultOutputHigh));
+    }
+
+    auto low = root.at_path(kConfOutputLow);
+    if(low && low.is_integer()) {
+        this->outputLowWatermark = std::max<int64_t>(0,
+                low.value_or(kDefaultOutputLow));
+    }
+
+    if(this->outputLowWatermark >= this->outputHighWatermark) {
+        throw std::runtime_error(fmt::format("invalid rpc output watermarks: low ({}) must be "
+                    "below high ({})", this->outputLowWatermark, this->outputHighWatermark));
+    }
 }
 
 
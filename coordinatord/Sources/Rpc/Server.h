@@ -2,8 +2,10 @@
 #define RPC_SERVER_H
 
 #include <chrono>
+#include <cstddef>
 #include <list>
 #include <memory>
+#include <string_view>
 
 namespace TristLib::Event {
 class ListenSocket;
@@ -17,6 +19,7 @@ class Handler;
 
 namespace Rpc {
 class ClientConnection;
+class Publisher;
 
 /**
  * @brief Local RPC server
@@ -46,6 +49,26 @@ class Server {
             return this->protocol.lock();
         }
 
+        /**
+         * @brief Get all connected clients
+         */
+        constexpr inline const auto &getClients() const {
+            return this->clients;
+        }
+
+        /**
+         * @brief Get the per-client output size above which reading from it is paused
+         */
+        constexpr inline size_t getOutputHighWatermark() const {
+            return this->outputHighWatermark;
+        }
+        /**
+         * @brief Get the per-client output size below which reading from it is resumed
+         */
+        constexpr inline size_t getOutputLowWatermark() const {
+            return this->outputLowWatermark;
+        }
+
     private:
         void initSocket(const std::string_view &listenPath);
 
@@ -55,6 +78,16 @@ class Server {
         void acceptClient();
 
     private:
+        /// Config key for the output high watermark (bytes)
+        constexpr static const std::string_view kConfOutputHigh{"rpc.output.highWatermark"};
+        /// Config key for the output low watermark (bytes)
+        constexpr static const std::string_view kConfOutputLow{"rpc.output.lowWatermark"};
+
+        /// Default output high watermark (bytes)
+        constexpr static const size_t kDefaultOutputHigh{256 * 1024};
+        /// Default output low watermark (bytes)
+        constexpr static const size_t kDefaultOutputLow{64 * 1024};
+
         /// Maximum amount of clients that may be waiting to be accepted at once
         constexpr static const size_t kListenBacklog{5};
         /// Maximum number of simultaneous connected clients
@@ -76,6 +109,13 @@ class Server {
         std::shared_ptr<TristLib::Event::Timer> clientGcTimer;
         /// List containing all connected clients
         std::list<std::shared_ptr<ClientConnection>> clients;
+        /// Distributes protocol events to clients' subscriptions
+        std::shared_ptr<Publisher> publisher;
+
+        /// Per-client output size above which reading from the client is paused
+        size_t outputHighWatermark{kDefaultOutputHigh};
+        /// Per-client output size below which reading from the client is resumed
+        size_t outputLowWatermark{kDefaultOutputLow};
 
         /// Number of times garbage collection has ran since the last timer event
         size_t numOffCycleGc{0};
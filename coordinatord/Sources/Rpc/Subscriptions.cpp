@@ -0,0 +1,393 @@
+#include <fmt/format.h>
+#include <TristLib/Core.h>
+#include <TristLib/Event.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "ClientConnection.h"
+#include "CborWriter.h"
+#include "KeyMap.h"
+#include "Server.h"
+#include "Types.h"
+#include "Subscriptions.h"
+
+using namespace Rpc;
+
+/// Topics, by name
+static const KeyMap<Subscriptions::Topic, Subscriptions::kNumTopics> gTopics{{
+    {"counters", Subscriptions::Topic::Counters},
+    {"nodes",    Subscriptions::Topic::Nodes},
+    {"frames",   Subscriptions::Topic::Frames},
+}};
+
+/**
+ * @brief Initialize the subscriptions of a client
+ *
+ * The client isn't subscribed to any topics yet.
+ */
+Subscriptions::Subscriptions(ClientConnection *client) : client(client) {
+}
+
+/**
+ * @brief Clean up subscriptions
+ *
+ * All update timers are released, so nothing is pushed to the client anymore.
+ */
+Subscriptions::~Subscriptions() {
+    for(auto &topic : this->topics) {
+        topic.timer.reset();
+    }
+}
+
+/**
+ * @brief Look up a topic by name
+ *
+ * @param name Topic name (case insensitive)
+ *
+ * @return Topic, or nothing if there's no topic with this name
+ */
+std::optional<Subscriptions::Topic> Subscriptions::ParseTopic(const std::string_view name) {
+    if(auto topic = gTopics.find(name)) {
+        return *topic;
+    }
+
+    return std::nullopt;
+}
+
+/**
+ * @brief Get the name of a topic
+ */
+std::string_view Subscriptions::GetTopicName(const Topic topic) {
+    switch(topic) {
+        case Topic::Counters:
+            return "counters";
+        case Topic::Nodes:
+            return "nodes";
+        case Topic::Frames:
+            return "frames";
+    }
+
+    return "";
+}
+
+
+
+/**
+ * @brief Subscribe to a topic
+ *
+ * If the client was already subscribed, only its interval is updated. Pending updates are kept.
+ *
+ * @param topic Topic to subscribe to
+ * @param interval Minimum interval between updates (clamped to the shortest allowed interval)
+ */
+void Subscriptions::subscribe(const Topic topic, const std::chrono::milliseconds interval) {
+    auto &state = this->topics[static_cast<size_t>(topic)];
+    state.interval = std::max(interval, kMinInterval);
+
+    // counter deltas start at the time of subscription
+    if(topic == Topic::Counters && !state.timer) {
+        if(auto radio = this->client->getServer()->getRadio()) {
+            this->lastRxCounters = radio->getRxCounters();
+            this->lastTxCounters = radio->getTxCounters();
+        }
+        this->lastCountersPush = std::chrono::steady_clock::now();
+    }
+
+    state.timer = std::make_shared<TristLib::Event::Timer>(TristLib::Event::RunLoop::Current(),
+            std::chrono::microseconds(state.interval), [this, topic](auto) {
+        this->push(topic);
+    }, true);
+}
+
+/**
+ * @brief Unsubscribe from a topic
+ *
+ * Any updates that weren't pushed yet are discarded.
+ */
+void Subscriptions::unsubscribe(const Topic topic) {
+    this->topics[static_cast<size_t>(topic)].timer.reset();
+
+    switch(topic) {
+        case Topic::Nodes:
+            this->joins.clear();
+            break;
+        case Topic::Frames:
+            this->frames.clear();
+            this->framesOverflowed = 0;
+            break;
+
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Record that a node joined the network
+ *
+ * @param eui64 EUI-64 of the node
+ * @param address Short address assigned to the node
+ */
+void Subscriptions::addJoin(const uint64_t eui64, const uint16_t address) {
+    if(!this->isSubscribed(Topic::Nodes)) {
+        return;
+    }
+
+    this->joins[address] = eui64;
+}
+
+/**
+ * @brief Record a message received from a node
+ *
+ * It replaces any message from the same node that wasn't pushed yet. If messages from too many
+ * nodes are waiting already, or it's too large to fit in a push, it's dropped instead.
+ *
+ * @param source Short address of the node that sent the message
+ * @param endpoint Endpoint flags of the message
+ * @param payload Message payload
+ */
+void Subscriptions::addFrame(const uint16_t source, const uint16_t endpoint,
+        std::span<const std::byte> payload) {
+    if(!this->isSubscribed(Topic::Frames)) {
+        return;
+    } else if(payload.size() > kMaxFramePayload) {
+        this->framesOverflowed++;
+        this->counters.framesDropped++;
+        return;
+    }
+
+    auto it = this->frames.find(source);
+    if(it == this->frames.end()) {
+        if(this->frames.size() >= kMaxFrameSources) {
+            this->framesOverflowed++;
+            this->counters.framesDropped++;
+            return;
+        }
+
+        it = this->frames.emplace(source, Frame{}).first;
+    } else {
+        it->second.dropped++;
+        this->counters.framesDropped++;
+    }
+
+    it->second.endpoint = endpoint;
+    it->second.payload.assign(payload.begin(), payload.end());
+}
+
+
+
+/**
+ * @brief Push an update for a topic to the client
+ *
+ * Invoked periodically (at the topic's interval) while subscribed.
+ */
+void Subscriptions::push(const Topic topic) {
+    if(this->client->isDead()) {
+        return;
+    }
+    // keep coalescing until the client caught up
+    else if(this->client->isThrottled()) {
+        this->counters.deferred++;
+        return;
+    }
+
+    try {
+        switch(topic) {
+            case Topic::Counters:
+                this->pushCounters();
+                break;
+            case Topic::Nodes:
+                this->pushNodes();
+                break;
+            case Topic::Frames:
+                this->pushFrames();
+                break;
+        }
+    } catch(const std::exception &e) {
+        PLOG_WARNING << fmt::format("client {}: failed to push `{}`: {}",
+                static_cast<void *>(this->client), GetTopicName(topic), e.what());
+    }
+}
+
+/**
+ * @brief Push the change in radio counters since the last push
+ *
+ * The counter names are the same as in the `radio.counters` status item; `elapsed` is the time
+ * since the last push, in msec.
+ */
+void Subscriptions::pushCounters() {
+    auto radio = this->client->getServer()->getRadio();
+    if(!radio) {
+        return;
+    }
+
+    const auto rx = radio->getRxCounters();
+    const auto tx = radio->getTxCounters();
+
+    // counters are reset when the radio is restarted, so don't go backwards
+    auto delta = [](const uint_least64_t now, const uint_least64_t last) -> uint_least64_t {
+        return (now >= last) ? (now - last) : now;
+    };
+
+    const auto rxGood = delta(rx.goodFrames, this->lastRxCounters.goodFrames);
+    const auto rxErrors = delta(rx.frameErrors, this->lastRxCounters.frameErrors);
+    const auto rxOverflows = delta(rx.fifoOverflows, this->lastRxCounters.fifoOverflows);
+    const auto rxDiscards = delta(rx.queueDiscards + rx.allocDiscards + rx.bufferDiscards,
+            this->lastRxCounters.queueDiscards + this->lastRxCounters.allocDiscards
+            + this->lastRxCounters.bufferDiscards);
+
+    const auto txGood = delta(tx.goodFrames, this->lastTxCounters.goodFrames);
+    const auto txCcaFails = delta(tx.ccaFails, this->lastTxCounters.ccaFails);
+    const auto txUnderruns = delta(tx.fifoDrops, this->lastTxCounters.fifoDrops);
+    const auto txDiscards = delta(tx.queueDiscards + tx.allocDiscards + tx.bufferDiscards,
+            this->lastTxCounters.queueDiscards + this->lastTxCounters.allocDiscards
+            + this->lastTxCounters.bufferDiscards);
+
+    if(!rxGood && !rxErrors && !rxOverflows && !rxDiscards && !txGood && !txCcaFails &&
+            !txUnderruns && !txDiscards) {
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            now - this->lastCountersPush);
+
+    auto &writer = this->client->beginPush(RequestEndpoint::Subscribe);
+    writer.putMap(4);
+
+    writer.putString("topic");
+    writer.putString(GetTopicName(Topic::Counters));
+    writer.putString("elapsed");
+    writer.putUint(elapsed.count());
+
+    writer.putString("tx");
+    writer.putMap(4);
+    writer.putString("good");
+    writer.putUint(txGood);
+    writer.putString("ccaFails");
+    writer.putUint(txCcaFails);
+    writer.putString("fifoUnderruns");
+    writer.putUint(txUnderruns);
+    writer.putString("queueDiscards");
+    writer.putUint(txDiscards);
+
+    writer.putString("rx");
+    writer.putMap(4);
+    writer.putString("good");
+    writer.putUint(rxGood);
+    writer.putString("errors");
+    writer.putUint(rxErrors);
+    writer.putString("fifoOverflows");
+    writer.putUint(rxOverflows);
+    writer.putString("queueDiscards");
+    writer.putUint(rxDiscards);
+
+    this->client->endReply();
+
+    this->lastRxCounters = rx;
+    this->lastTxCounters = tx;
+    this->lastCountersPush = now;
+
+    this->counters.pushes++;
+}
+
+/**
+ * @brief Push the nodes that joined since the last push
+ *
+ * The short addresses and EUI-64s of the nodes are pushed as parallel arrays. If too many nodes
+ * joined to fit in one push, they're split across several; any left over once the client's output
+ * is throttled are pushed next time.
+ */
+void Subscriptions::pushNodes() {
+    constexpr static const size_t kMaxNodes{(kMaxPushSize - kPushOverhead) / kNodeEntrySize};
+
+    std::vector<std::pair<uint16_t, uint64_t>> batch;
+    batch.reserve(std::min(kMaxNodes, this->joins.size()));
+
+    while(!this->joins.empty() && !this->client->isThrottled()) {
+        batch.clear();
+        for(auto it = this->joins.begin(); it != this->joins.end() && batch.size() < kMaxNodes;) {
+            batch.emplace_back(*it);
+            it = this->joins.erase(it);
+        }
+
+        auto &writer = this->client->beginPush(RequestEndpoint::Subscribe);
+        writer.putMap(3);
+
+        writer.putString("topic");
+        writer.putString(GetTopicName(Topic::Nodes));
+
+        writer.putString("address");
+        writer.putArray(batch.size());
+        for(const auto &[address, eui64] : batch) {
+            writer.putUint(address);
+        }
+        writer.putString("eui64");
+        writer.putArray(batch.size());
+        for(const auto &[address, eui64] : batch) {
+            writer.putUint(eui64);
+        }
+
+        this->client->endReply();
+        this->counters.pushes++;
+    }
+}
+
+/**
+ * @brief Push the most recent message of each node since the last push
+ *
+ * Source addresses, endpoint flags and payloads are pushed as parallel arrays; `dropped` is the
+ * number of messages that were replaced (or didn't fit) before they could be pushed. If the
+ * messages don't fit in one push, they're split across several, the same way as joined nodes.
+ */
+void Subscriptions::pushFrames() {
+    std::vector<std::pair<uint16_t, Frame>> batch;
+
+    while(!this->frames.empty() && !this->client->isThrottled()) {
+        // take as many messages as fit (each one fits on its own)
+        size_t dropped{this->framesOverflowed}, size{kPushOverhead};
+        this->framesOverflowed = 0;
+
+        batch.clear();
+        for(auto it = this->frames.begin(); it != this->frames.end();) {
+            const auto entrySize = kFrameEntrySize + it->second.payload.size();
+            if(size + entrySize > kMaxPushSize) {
+                break;
+            }
+
+            size += entrySize;
+            dropped += it->second.dropped;
+            batch.emplace_back(it->first, std::move(it->second));
+            it = this->frames.erase(it);
+        }
+
+        auto &writer = this->client->beginPush(RequestEndpoint::Subscribe);
+        writer.putMap(5);
+
+        writer.putString("topic");
+        writer.putString(GetTopicName(Topic::Frames));
+        writer.putString("dropped");
+        writer.putUint(dropped);
+
+        writer.putString("source");
+        writer.putArray(batch.size());
+        for(const auto &[source, frame] : batch) {
+            writer.putUint(source);
+        }
+        writer.putString("endpoint");
+        writer.putArray(batch.size());
+        for(const auto &[source, frame] : batch) {
+            writer.putUint(frame.endpoint);
+        }
+        writer.putString("payload");
+        writer.putArray(batch.size());
+        for(const auto &[source, frame] : batch) {
+            writer.putBytes(frame.payload);
+        }
+
+        this->client->endReply();
+        this->counters.pushes++;
+    }
+}
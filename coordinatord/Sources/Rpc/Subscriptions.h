@@ -0,0 +1,185 @@
+#ifndef RPC_SUBSCRIPTIONS_H
+#define RPC_SUBSCRIPTIONS_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Radio.h"
+
+namespace TristLib::Event {
+class Timer;
+}
+
+namespace Rpc {
+class ClientConnection;
+
+/**
+ * @brief Topic subscriptions of a single RPC client
+ *
+ * Keeps track of the topics a client subscribed to, and pushes updates for them to the client at
+ * most once per the interval it requested. Updates are coalesced until they're pushed, so the
+ * amount of state kept per client is bounded no matter how slowly it consumes updates:
+ *
+ * - Counters: Only a snapshot of the counters at the last push is kept; each push contains the
+ *   change since then.
+ * - Nodes: Nodes that joined since the last push, by short address; a node that rejoined several
+ *   times is reported once.
+ * - Frames: The most recent frame received from each node since the last push. Older frames from
+ *   the same node are replaced (and counted as dropped.)
+ *
+ * Nothing is pushed for a topic if nothing changed since its last push. While the client's
+ * output is throttled (because it's not reading fast enough) pushes are deferred, and updates keep
+ * being coalesced until the client catches up.
+ *
+ * No push is larger than the largest packet clients accept: if the pending updates don't fit in a
+ * single push, they're split across several. Messages too large to ever fit are dropped.
+ */
+class Subscriptions {
+    public:
+        /**
+         * @brief Topics that can be subscribed to
+         */
+        enum class Topic: uint8_t {
+            /// Radio performance counters (as deltas)
+            Counters,
+            /// Nodes that joined the network
+            Nodes,
+            /// Application messages received from nodes
+            Frames,
+        };
+        /// Number of topics
+        constexpr static const size_t kNumTopics{3};
+
+        /// Shortest update interval a client may request
+        constexpr static const std::chrono::milliseconds kMinInterval{100};
+        /// Update interval, if the client doesn't specify one
+        constexpr static const std::chrono::milliseconds kDefaultInterval{1'000};
+
+        /**
+         * @brief Subscription counters
+         */
+        struct Counters {
+            /// Updates pushed to the client
+            uint_least64_t pushes{0};
+            /// Pushes deferred because the client's output was throttled
+            uint_least64_t deferred{0};
+            /// Frames that were dropped (replaced by a newer one, or didn't fit) before a push
+            uint_least64_t framesDropped{0};
+        };
+
+    private:
+        /// Maximum number of nodes whose most recent frame is held for the next push
+        constexpr static const size_t kMaxFrameSources{16};
+
+        /// Maximum size of a push, including its header (the largest packet clients accept)
+        constexpr static const size_t kMaxPushSize{4096};
+        /// Room reserved in each push for the header, and the keys and array heads of the map
+        constexpr static const size_t kPushOverhead{128};
+        /// Largest encoded size of a joined node (its short address and EUI-64)
+        constexpr static const size_t kNodeEntrySize{3 + 9};
+        /// Largest encoded size of a message, not counting its payload (source, endpoint, length)
+        constexpr static const size_t kFrameEntrySize{3 + 3 + 3};
+        /// Largest message payload that fits in a push; larger messages are dropped
+        constexpr static const size_t kMaxFramePayload{
+            kMaxPushSize - kPushOverhead - kFrameEntrySize
+        };
+
+        /**
+         * @brief State of a single topic
+         */
+        struct TopicState {
+            /// Timer that pushes updates (only allocated while subscribed)
+            std::shared_ptr<TristLib::Event::Timer> timer;
+            /// Minimum interval between updates
+            std::chrono::milliseconds interval{kDefaultInterval};
+        };
+
+        /**
+         * @brief Most recent frame received from a node
+         */
+        struct Frame {
+            /// Endpoint flags from the MAC header
+            uint16_t endpoint;
+            /// Message payload
+            std::vector<std::byte> payload;
+            /// Number of frames from this node that were replaced before being pushed
+            size_t dropped{0};
+        };
+
+    public:
+        Subscriptions(ClientConnection *client);
+        ~Subscriptions();
+
+        static std::optional<Topic> ParseTopic(const std::string_view name);
+        static std::string_view GetTopicName(const Topic topic);
+
+        void subscribe(const Topic topic, const std::chrono::milliseconds interval);
+        void unsubscribe(const Topic topic);
+
+        /**
+         * @brief Determine whether the client is subscribed to a topic
+         */
+        inline bool isSubscribed(const Topic topic) const {
+            return !!this->topics[static_cast<size_t>(topic)].timer;
+        }
+        /**
+         * @brief Get the update interval of a topic
+         */
+        inline auto getInterval(const Topic topic) const {
+            return this->topics[static_cast<size_t>(topic)].interval;
+        }
+
+        /**
+         * @brief Get the subscription counters
+         */
+        constexpr inline const auto &getCounters() const {
+            return this->counters;
+        }
+
+        void addJoin(const uint64_t eui64, const uint16_t address);
+        void addFrame(const uint16_t source, const uint16_t endpoint,
+                std::span<const std::byte> payload);
+
+    private:
+        void push(const Topic topic);
+
+        void pushCounters();
+        void pushNodes();
+        void pushFrames();
+
+    private:
+        /// Client the updates are pushed to
+        ClientConnection *client;
+
+        /// State of each topic
+        std::array<TopicState, kNumTopics> topics;
+
+        /// Receive counters at the last push
+        Radio::RxCounters lastRxCounters;
+        /// Transmit counters at the last push
+        Radio::TxCounters lastTxCounters;
+        /// Time at which the counters were last pushed
+        std::chrono::steady_clock::time_point lastCountersPush;
+
+        /// Nodes that joined since the last push (short address to EUI-64)
+        std::unordered_map<uint16_t, uint64_t> joins;
+
+        /// Most recent frame from each node since the last push, by short address
+        std::unordered_map<uint16_t, Frame> frames;
+        /// Frames dropped because too many nodes had frames waiting, or they were too large
+        size_t framesOverflowed{0};
+
+        /// Subscription counters
+        Counters counters{};
+};
+}
+
+#endif
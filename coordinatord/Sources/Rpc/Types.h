@@ -41,6 +41,11 @@ struct RequestHeader {
      *
      * An arbitrary integer value that can be used to correlate the requests and their responses
      * on the caller's side.
+     *
+     * Tag 0 is reserved for messages pushed by the server without a request (such as updates for
+     * subscribed topics), so requests should use nonzero tags.
+     *
+     * @seeAlso kPushTag
      */
     uint8_t tag;
 
@@ -53,6 +58,11 @@ struct RequestHeader {
     uint8_t payload[];
 } __attribute__((packed));
 
+/**
+ * @brief Tag of messages pushed by the server
+ */
+constexpr static const uint8_t kPushTag{0x00};
+
 /**
  * @brief Request RPC endpoints
  */
@@ -70,6 +80,43 @@ enum RequestEndpoint: uint8_t {
      * Read out the current status of various components.
      */
     Status                              = 0x02,
+
+    /**
+     * @brief Multicast group endpoint
+     *
+     * Create and delete multicast groups, and manage their membership.
+     */
+    Groups                              = 0x03,
+
+    /**
+     * @brief Firmware update endpoint
+     *
+     * Distribute firmware images to nodes over the air, and monitor their progress.
+     */
+    Ota                                 = 0x04,
+
+    /**
+     * @brief Subscription endpoint
+     *
+     * Subscribe to topics, updates for which are then pushed to the client (with the push tag)
+     * from this endpoint.
+     */
+    Subscribe                           = 0x05,
+
+    /**
+     * @brief Stream endpoint
+     *
+     * Request results that are too large for a single packet, which are then sent as a stream of
+     * chunks (with the tag of the request that opened the stream.)
+     */
+    Stream                              = 0x06,
+
+    /**
+     * @brief Transmit endpoint
+     *
+     * Queue batches of frames from local applications for transmission to nodes.
+     */
+    Tx                                  = 0x07,
 };
 }
 
@@ -0,0 +1,203 @@
+#include <cstdint>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+
+#include <TristLib/Event.h>
+
+#include "Support/BufferedSocket.h"
+
+using namespace Support;
+
+/**
+ * @brief Wrap a socket
+ *
+ * A buffer event is created for the socket on the given run loop; no events are enabled until
+ * enableEvents() is called.
+ *
+ * @param runLoop Run loop to process socket events on
+ * @param fd Socket to wrap (it should be non-blocking)
+ * @param closeOnFree Whether the socket is closed when the wrapper is destroyed (or if creating
+ *        the wrapper fails)
+ */
+BufferedSocket::BufferedSocket(const std::shared_ptr<TristLib::Event::RunLoop> &runLoop,
+        const int fd, const bool closeOnFree) {
+    this->event = bufferevent_socket_new(runLoop->getEvBase(), fd,
+            closeOnFree ? BEV_OPT_CLOSE_ON_FREE : 0);
+    if(!this->event) {
+        if(closeOnFree) {
+            close(fd);
+        }
+        throw std::runtime_error("failed to allocate buffer event");
+    }
+
+    bufferevent_setcb(this->event, [](auto, auto ctx) {
+        auto socket = reinterpret_cast<BufferedSocket *>(ctx);
+        if(socket->readCallback) {
+            socket->readCallback(socket);
+        }
+    }, [](auto, auto ctx) {
+        auto socket = reinterpret_cast<BufferedSocket *>(ctx);
+        if(socket->writeCallback) {
+            socket->writeCallback(socket);
+        }
+    }, [](auto, auto what, auto ctx) {
+        auto socket = reinterpret_cast<BufferedSocket *>(ctx);
+        if(!socket->eventCallback) {
+            return;
+        }
+
+        uintptr_t events{0};
+        if(what & BEV_EVENT_READING) {
+            events |= Event::Reading;
+        }
+        if(what & BEV_EVENT_WRITING) {
+            events |= Event::Writing;
+        }
+        if(what & BEV_EVENT_EOF) {
+            events |= Event::EndOfFile;
+        }
+        if(what & BEV_EVENT_ERROR) {
+            events |= Event::UnrecoverableError;
+        }
+        if(what & BEV_EVENT_TIMEOUT) {
+            events |= Event::Timeout;
+        }
+        if(what & BEV_EVENT_CONNECTED) {
+            events |= Event::Connected;
+        }
+
+        socket->eventCallback(socket, static_cast<Event>(events));
+    }, this);
+}
+
+/**
+ * @brief Release the buffer event
+ *
+ * Any output that wasn't sent yet is discarded.
+ */
+BufferedSocket::~BufferedSocket() {
+    if(this->event) {
+        bufferevent_free(this->event);
+    }
+}
+
+
+
+/**
+ * @brief Set the read watermark
+ *
+ * @param watermark Low and high watermark: the read callback is only invoked once the low
+ *        watermark of data is waiting, and no more data is read once the high watermark is
+ *        reached (`SIZE_MAX` for no limit)
+ */
+void BufferedSocket::setReadWatermark(const std::pair<size_t, size_t> watermark) {
+    bufferevent_setwatermark(this->event, EV_READ, watermark.first,
+            (watermark.second == SIZE_MAX) ? 0 : watermark.second);
+}
+
+/**
+ * @brief Set the write watermark
+ *
+ * @param watermark Low and high watermark: the write callback is invoked once the output drained
+ *        to the low watermark; the high watermark is unused (pass `SIZE_MAX`)
+ */
+void BufferedSocket::setWriteWatermark(const std::pair<size_t, size_t> watermark) {
+    bufferevent_setwatermark(this->event, EV_WRITE, watermark.first,
+            (watermark.second == SIZE_MAX) ? 0 : watermark.second);
+}
+
+/**
+ * @brief Enable reading and/or writing
+ *
+ * @param read Whether to enable reading (if not, it's left as is)
+ * @param write Whether to enable writing (if not, it's left as is)
+ */
+void BufferedSocket::enableEvents(const bool read, const bool write) {
+    const short what = (read ? EV_READ : 0) | (write ? EV_WRITE : 0);
+    if(what && bufferevent_enable(this->event, what)) {
+        throw std::runtime_error("failed to enable socket events");
+    }
+}
+
+/**
+ * @brief Disable reading and/or writing
+ *
+ * @param read Whether to disable reading (if not, it's left as is)
+ * @param write Whether to disable writing (if not, it's left as is)
+ */
+void BufferedSocket::disableEvents(const bool read, const bool write) {
+    const short what = (read ? EV_READ : 0) | (write ? EV_WRITE : 0);
+    if(what && bufferevent_disable(this->event, what)) {
+        throw std::runtime_error("failed to disable socket events");
+    }
+}
+
+
+
+/**
+ * @brief Read data from the input buffer
+ *
+ * @param buffer Buffer to read into
+ *
+ * @return Number of bytes read
+ */
+size_t BufferedSocket::read(std::span<std::byte> buffer) {
+    return bufferevent_read(this->event, buffer.data(), buffer.size());
+}
+
+/**
+ * @brief Queue data to be sent
+ *
+ * @param data Data to send; it's copied into the output buffer
+ */
+void BufferedSocket::write(std::span<const std::byte> data) {
+    if(bufferevent_write(this->event, data.data(), data.size())) {
+        throw std::runtime_error("failed to queue socket output");
+    }
+}
+
+/**
+ * @brief Queue data to be sent, without copying it
+ *
+ * @param data Data to send
+ * @param owner Object that owns the data; it's kept alive until the data was sent (or the output
+ *        is discarded)
+ */
+void BufferedSocket::writeReference(std::span<const std::byte> data,
+        const std::shared_ptr<const void> &owner) {
+    auto ref = new std::shared_ptr<const void>(owner);
+
+    if(evbuffer_add_reference(bufferevent_get_output(this->event), data.data(), data.size(),
+                [](const void *, size_t, void *ctx) {
+        delete reinterpret_cast<std::shared_ptr<const void> *>(ctx);
+    }, ref)) {
+        delete ref;
+        throw std::runtime_error("failed to queue socket output");
+    }
+}
+
+/**
+ * @brief Get the number of bytes waiting to be read
+ */
+size_t BufferedSocket::getInputSize() const {
+    return evbuffer_get_length(bufferevent_get_input(this->event));
+}
+
+/**
+ * @brief Get the number of bytes waiting to be sent
+ */
+size_t BufferedSocket::getOutputSize() const {
+    return evbuffer_get_length(bufferevent_get_output(this->event));
+}
+
+/**
+ * @brief Get the underlying socket
+ */
+int BufferedSocket::getFd() const {
+    return bufferevent_getfd(this->event);
+}
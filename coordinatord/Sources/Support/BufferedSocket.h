@@ -0,0 +1,115 @@
+#ifndef SUPPORT_BUFFEREDSOCKET_H
+#define SUPPORT_BUFFEREDSOCKET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <utility>
+
+struct bufferevent;
+
+namespace TristLib::Event {
+class RunLoop;
+}
+
+namespace Support {
+/**
+ * @brief Buffered socket with bounded output
+ *
+ * Works like the TristLib socket wrapper (and has the same interface for reading and events), but
+ * additionally exposes the output side of the buffer: the number of bytes waiting to be sent, a
+ * write watermark (with a callback invoked when the output drains below it), and queueing data by
+ * reference rather than copying it.
+ *
+ * The underlying buffer event (and, if requested, the socket) is released when the wrapper is
+ * destroyed.
+ */
+class BufferedSocket {
+    public:
+        /**
+         * @brief Socket events
+         *
+         * Passed to the event callback; multiple may be set at once.
+         */
+        enum Event: uintptr_t {
+            /// The event occurred while reading
+            Reading = (1 << 0),
+            /// The event occurred while writing
+            Writing = (1 << 1),
+            /// The remote end closed the connection
+            EndOfFile = (1 << 2),
+            /// An unrecoverable error occurred; check `errno`
+            UnrecoverableError = (1 << 3),
+            /// A read or write timed out
+            Timeout = (1 << 4),
+            /// An outgoing connection was established
+            Connected = (1 << 5),
+        };
+
+        /// Callback invoked when data was read, or output drained
+        using IoCallback = std::function<void(BufferedSocket *)>;
+        /// Callback invoked for socket events
+        using EventCallback = std::function<void(BufferedSocket *, const Event)>;
+
+    public:
+        BufferedSocket(const std::shared_ptr<TristLib::Event::RunLoop> &runLoop, const int fd,
+                const bool closeOnFree);
+        ~BufferedSocket();
+
+        BufferedSocket(const BufferedSocket &) = delete;
+        BufferedSocket &operator=(const BufferedSocket &) = delete;
+
+        void setReadWatermark(const std::pair<size_t, size_t> watermark);
+        void setWriteWatermark(const std::pair<size_t, size_t> watermark);
+
+        /**
+         * @brief Set the callback for data being read
+         *
+         * It's invoked once at least the low read watermark of data is waiting to be read.
+         */
+        inline void setReadCallback(const IoCallback &callback) {
+            this->readCallback = callback;
+        }
+        /**
+         * @brief Set the callback for output draining
+         *
+         * It's invoked once the output waiting to be sent drained to the low write watermark.
+         */
+        inline void setWriteCallback(const IoCallback &callback) {
+            this->writeCallback = callback;
+        }
+        /**
+         * @brief Set the callback for socket events
+         */
+        inline void setEventCallback(const EventCallback &callback) {
+            this->eventCallback = callback;
+        }
+
+        void enableEvents(const bool read, const bool write);
+        void disableEvents(const bool read, const bool write);
+
+        size_t read(std::span<std::byte> buffer);
+        void write(std::span<const std::byte> data);
+        void writeReference(std::span<const std::byte> data,
+                const std::shared_ptr<const void> &owner);
+
+        size_t getInputSize() const;
+        size_t getOutputSize() const;
+        int getFd() const;
+
+    private:
+        /// Buffer event wrapping the socket
+        struct bufferevent *event{nullptr};
+
+        /// Invoked when data was read
+        IoCallback readCallback;
+        /// Invoked when the output drained
+        IoCallback writeCallback;
+        /// Invoked for socket events
+        EventCallback eventCallback;
+};
+}
+
+#endif
@@ -0,0 +1,33 @@
+#include <array>
+
+#include "Support/Crc32.h"
+
+/**
+ * @brief Build the CRC lookup table (one entry per byte value)
+ */
+static constexpr std::array<uint32_t, 256> MakeTable() {
+    std::array<uint32_t, 256> table{};
+
+    for(uint32_t i = 0; i < table.size(); i++) {
+        uint32_t value = i;
+        for(size_t bit = 0; bit < 8; bit++) {
+            value = (value & 1) ? (0xEDB88320 ^ (value >> 1)) : (value >> 1);
+        }
+        table[i] = value;
+    }
+
+    return table;
+}
+
+/// CRC lookup table
+static constexpr const auto kTable{MakeTable()};
+
+uint32_t Support::Crc32(std::span<const std::byte> data, const uint32_t crc) {
+    uint32_t value = ~crc;
+
+    for(const auto byte : data) {
+        value = kTable[(value ^ static_cast<uint8_t>(byte)) & 0xFF] ^ (value >> 8);
+    }
+
+    return ~value;
+}
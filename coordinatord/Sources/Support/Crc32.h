@@ -0,0 +1,21 @@
+#ifndef SUPPORT_CRC32_H
+#define SUPPORT_CRC32_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace Support {
+/**
+ * @brief Compute a CRC-32
+ *
+ * This is the IEEE 802.3 CRC (reflected polynomial 0xEDB88320, as used by zlib.) It can be
+ * computed incrementally, by passing the result for the preceding data as the initial value.
+ *
+ * @param data Data to checksum
+ * @param crc Checksum of any preceding data
+ */
+uint32_t Crc32(std::span<const std::byte> data, const uint32_t crc = 0);
+}
+
+#endif
@@ -0,0 +1,63 @@
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fmt/format.h>
+
+#include "Support/MappedFile.h"
+
+using namespace Support;
+
+/**
+ * @brief Map a file
+ *
+ * @param path Path of the file to map
+ *
+ * @throw std::system_error If the file couldn't be opened or mapped
+ */
+MappedFile::MappedFile(const std::filesystem::path &path) {
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd == -1) {
+        throw std::system_error(errno, std::generic_category(),
+                fmt::format("open `{}`", path.string()));
+    }
+
+    struct stat info{};
+    if(fstat(fd, &info) == -1) {
+        const auto err = errno;
+        close(fd);
+        throw std::system_error(err, std::generic_category(), "fstat");
+    } else if(!S_ISREG(info.st_mode) || !info.st_size) {
+        close(fd);
+        throw std::runtime_error(fmt::format("`{}` is not a regular file, or empty",
+                    path.string()));
+    }
+
+    void *mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    const auto err = errno;
+    close(fd);
+
+    if(mapping == MAP_FAILED) {
+        throw std::system_error(err, std::generic_category(), "mmap");
+    }
+
+    // the file is read sequentially (more or less)
+    madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+
+    this->base = reinterpret_cast<const std::byte *>(mapping);
+    this->length = info.st_size;
+}
+
+/**
+ * @brief Unmap the file
+ */
+MappedFile::~MappedFile() {
+    if(this->base) {
+        munmap(const_cast<std::byte *>(this->base), this->length);
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef SUPPORT_MAPPEDFILE_H
+#define SUPPORT_MAPPEDFILE_H
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+
+namespace Support {
+/**
+ * @brief Read-only memory mapped file
+ *
+ * Maps the entire contents of a file into memory, so that arbitrary parts of it can be accessed
+ * without reading (or buffering) the whole thing; the kernel pages it in as needed.
+ */
+class MappedFile {
+    public:
+        MappedFile(const std::filesystem::path &path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        /**
+         * @brief Get the contents of the file
+         */
+        inline std::span<const std::byte> getData() const {
+            return {this->base, this->length};
+        }
+        /**
+         * @brief Get the size of the file (bytes)
+         */
+        constexpr inline size_t getSize() const {
+            return this->length;
+        }
+
+    private:
+        /// Start of the mapping
+        const std::byte *base{nullptr};
+        /// Length of the mapping (bytes)
+        size_t length{0};
+};
+}
+
+#endif
@@ -1,6 +1,7 @@
 #include <toml++/toml.h>
 
 #include "Base.h"
+#include "Transports/Simulated.h"
 
 #ifdef WITH_TRANSPORT_SPIDEV
 #include "Transports/Spidev.h"
@@ -18,6 +19,9 @@ std::shared_ptr<TransportBase> TransportBase::Make(const toml::table &root) {
     const std::string typeStr = root["type"].value_or("");
 
     // invoke initializer
+    if(typeStr == "simulated") {
+        return std::make_shared<Transports::Simulated>(root);
+    }
 #if WITH_TRANSPORT_SPIDEV
     if(typeStr == "spidev") {
         return std::make_shared<Transports::Spidev>(root);
@@ -126,6 +126,59 @@ enum class CommandId: uint8_t {
      * Reads and writes are supported.
      */
     IrqStatus                                   = 0x0A,
+
+    /**
+     * @brief Get beacon timing
+     *
+     * Read the controller's timebase, and the time at which the most recent automatic beacon was
+     * transmitted. Only supported if the controller indicates the `BeaconTiming` feature.
+     *
+     * Reads are supported.
+     */
+    GetBeaconTiming                             = 0x0B,
+
+    /**
+     * @brief Get firmware update status
+     *
+     * Read the state of the firmware update in progress (if any), including the offset at which
+     * the next block is expected, and how many block buffers are available. Only supported if the
+     * controller indicates the `Dfu` feature.
+     *
+     * Reads are supported.
+     */
+    DfuStatus                                   = 0x0C,
+
+    /**
+     * @brief Begin firmware update
+     *
+     * Erase the inactive firmware slot, and prepare to receive an image of the given size. Any
+     * update in progress is abandoned.
+     *
+     * Writes are supported.
+     */
+    DfuBegin                                    = 0x0D,
+
+    /**
+     * @brief Write firmware block
+     *
+     * Write the next block of the firmware image. The block is copied into one of the controller's
+     * block buffers, and programmed in the background; so the host may write the next block while
+     * the previous one is still being programmed. The command fails if no buffer is available,
+     * the block's checksum is incorrect, or it's not the next block expected.
+     *
+     * Writes are supported.
+     */
+    DfuWrite                                    = 0x0E,
+
+    /**
+     * @brief Commit firmware update
+     *
+     * Verify the checksum of the entire image, and if it matches, mark it to be booted on the next
+     * reset. Fails if the image is incomplete or corrupted.
+     *
+     * Writes are supported.
+     */
+    DfuCommit                                   = 0x0F,
 };
 
 /**
@@ -152,6 +205,12 @@ struct GetInfo {
     enum HwFeatures: uint8_t {
         /// Controller has dedicated, private storage
         PrivateStorage                          = (1 << 0),
+        /// Firmware accepts a per-packet transmit power (see Request::TransmitPacket)
+        TxPowerOverride                         = (1 << 1),
+        /// Firmware reports beacon transmit times (see CommandId::GetBeaconTiming)
+        BeaconTiming                            = (1 << 2),
+        /// Firmware can be updated by the host (see CommandId::DfuBegin)
+        Dfu                                     = (1 << 3),
     };
 
     /// Status (1 = success)
@@ -259,7 +318,16 @@ struct IrqConfig {
      */
     uint8_t txQueueEmpty                        :1;
 
-    uint8_t reserved                            :4;
+    /**
+     * @brief Beacon transmitted
+     *
+     * Set: An automatic beacon frame was transmitted
+     *
+     * Clear: Read status register
+     */
+    uint8_t beaconSent                          :1;
+
+    uint8_t reserved                            :3;
 } __attribute__((packed));
 
 /**
@@ -355,6 +423,59 @@ struct GetCounters {
     } rxRadio;
 } __attribute__((packed));
 
+/**
+ * @brief "GetBeaconTiming" command response
+ *
+ * All times are in µs, on a free-running 32-bit timebase that wraps around. The beacon time is
+ * captured when the start of frame delimiter of the beacon is sent.
+ */
+struct GetBeaconTiming {
+    /// Current timebase value
+    uint32_t currentTime;
+    /// Timebase value at which the most recent beacon was transmitted
+    uint32_t lastBeacon;
+    /// Number of beacons transmitted since beaconing was enabled
+    uint32_t beaconCount;
+} __attribute__((packed));
+
+/**
+ * @brief "DfuStatus" command response
+ *
+ * Progress is retained across host disconnects, so an interrupted update can be resumed by writing
+ * blocks from `offset` onwards, as long as the image size and checksum match. Blocks that were
+ * buffered but not yet programmed when the controller is reset are lost; `offset` is rewound
+ * accordingly.
+ */
+struct DfuStatus {
+    /// Update states
+    enum State: uint8_t {
+        /// No update in progress
+        Idle                                    = 0x00,
+        /// Receiving image blocks
+        Receiving                               = 0x01,
+        /// Image was verified, and will be booted on the next reset
+        Committed                               = 0x02,
+        /// Programming failed; the update must be restarted
+        Error                                   = 0x03,
+    };
+
+    /// Current state
+    uint8_t state;
+    /// Number of block buffers currently available
+    uint8_t freeBuffers;
+    /// Total number of block buffers
+    uint8_t numBuffers;
+    /// Largest block that may be written (bytes)
+    uint8_t maxBlockSize;
+
+    /// Size of the image being received (bytes)
+    uint32_t imageSize;
+    /// CRC-32 of the image being received
+    uint32_t imageCrc;
+    /// Offset of the next block expected (all data before it was received)
+    uint32_t offset;
+} __attribute__((packed));
+
 /**
  * @brief Response to an "IRQ Status" command
  *
@@ -389,7 +510,14 @@ struct IrqStatus {
      */
     uint8_t txQueueEmpty                        :1{0};
 
-    uint8_t reserved                            :4{};
+    /**
+     * @brief Beacon transmitted
+     *
+     * Set: An automatic beacon frame was transmitted
+     */
+    uint8_t beaconSent                          :1{0};
+
+    uint8_t reserved                            :3{};
 } __attribute__((packed));
 }
 
@@ -439,9 +567,22 @@ struct TransmitPacket {
      * @remark Numerically _low_ values correspond to _low_ priorities, e.g. 0 is lowest.
      */
     uint8_t priority                            :2;
-    uint8_t reserved                            :6;
 
-    /// Packet payload data (including MAC headers)
+    /**
+     * @brief Transmit power override present
+     *
+     * When set, the packet payload is preceded by a single byte specifying the transmit power
+     * (in ⅒th of dBm) for this packet only, instead of the configured transmit power. It is
+     * clamped to the configured transmit power by the controller.
+     *
+     * @remark This may only be set if the controller indicates support for it (the
+     *         `TxPowerOverride` feature in the "Get Info" response.) Older firmware ignores this
+     *         bit, and would transmit the power byte as part of the packet.
+     */
+    uint8_t hasTxPower                          :1;
+    uint8_t reserved                            :5;
+
+    /// Packet payload data (including MAC headers), optionally preceded by the transmit power
     uint8_t data[];
 } __attribute__((packed));
 
@@ -493,6 +634,39 @@ struct BeaconConfig {
  * This is used to clear pending interrupts, and thus release the interrupt line state.
  */
 using IrqStatus = Response::IrqStatus;
+
+/**
+ * @brief "DfuBegin" command
+ */
+struct DfuBegin {
+    /// Total size of the image (bytes)
+    uint32_t imageSize;
+    /// CRC-32 of the entire image
+    uint32_t imageCrc;
+} __attribute__((packed));
+
+/**
+ * @brief "DfuWrite" command
+ *
+ * The block length is implied by the command length.
+ */
+struct DfuWrite {
+    /// Offset of the block in the image; must match the offset expected by the controller
+    uint32_t offset;
+    /// CRC-32 of the block data
+    uint32_t crc;
+
+    /// Block data
+    uint8_t data[];
+} __attribute__((packed));
+
+/**
+ * @brief "DfuCommit" command
+ */
+struct DfuCommit {
+    /// CRC-32 of the entire image (must match the value it was begun with)
+    uint32_t imageCrc;
+} __attribute__((packed));
 }
 }
 
@@ -0,0 +1,732 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <BlazeNet/Types.h>
+#include <event2/event.h>
+#include <fmt/format.h>
+
+#include <TristLib/Core.h>
+#include <TristLib/Event.h>
+
+#include "Protocol/NetControl.h"
+#include "Support/Crc32.h"
+#include "Transports/Simulated.h"
+
+using namespace Transports;
+
+/**
+ * @brief Initialize the simulated transport
+ *
+ * The following keys are supported (all optional):
+ *
+ * - mode: Simulation mode (`none` or `powerControl`)
+ * - txPowerOverride: Whether the emulated firmware supports per-packet transmit power
+ * - beaconTiming: Whether the emulated firmware reports beacon transmit times
+ * - dfu: Whether the emulated firmware can be updated
+ * - maxTxPower: Maximum transmit power reported by the radio (dBm)
+ * - sensitivity: Receiver sensitivity of all radios (dBm)
+ * - fading: Standard deviation of the random fading applied to every frame (dB)
+ * - logInterval: Interval between statistics logs (msec)
+ * - nodes: Array of simulated nodes (see readNodes)
+ *
+ * @param config Contents of the `radio.transport` table in the config
+ */
+Simulated::Simulated(const toml::table &config) {
+    // simulation mode
+    const std::string mode = config["mode"].value_or("none");
+    if(mode == "none") {
+        this->mode = Mode::None;
+    } else if(mode == "powerControl") {
+        this->mode = Mode::PowerControl;
+    } else {
+        throw std::runtime_error(fmt::format("invalid `radio.transport.mode` ({})", mode));
+    }
+
+    // emulated firmware and radio characteristics
+    auto txPowerOverride = config["txPowerOverride"];
+    if(txPowerOverride && txPowerOverride.is_boolean()) {
+        this->txPowerOverride = txPowerOverride.value_or(true);
+    }
+    auto beaconTiming = config["beaconTiming"];
+    if(beaconTiming && beaconTiming.is_boolean()) {
+        this->beaconTiming = beaconTiming.value_or(true);
+    }
+    auto dfu = config["dfu"];
+    if(dfu && dfu.is_boolean()) {
+        this->dfuSupported = dfu.value_or(true);
+    }
+
+    const double maxTxPower = config["maxTxPower"].value_or(kDefaultMaxTxPower);
+    this->maxTxPower = std::clamp(std::lround(maxTxPower * 10.), 0L, long{UINT8_MAX});
+
+    this->sensitivity = config["sensitivity"].value_or(kDefaultSensitivity);
+    this->fading = std::max(0., config["fading"].value_or(kDefaultFading));
+    this->logInterval = std::chrono::milliseconds(std::max<int64_t>(1,
+                config["logInterval"].value_or(kDefaultLogInterval.count())));
+
+    if(this->mode != Mode::None) {
+        this->readNodes(config);
+    }
+
+    PLOG_INFO << fmt::format("Simulated radio: mode {}, {} node(s), per-packet tx power {}", mode,
+            this->nodes.size(), this->txPowerOverride ? "supported" : "unsupported");
+
+    // set up the simulation timer and interrupt event
+    auto evbase = TristLib::Event::RunLoop::Current()->getEvBase();
+    this->irqEvent = event_new(evbase, -1, 0, [](auto, auto, auto ctx) {
+        reinterpret_cast<Simulated *>(ctx)->invokeIrqHandlers();
+    }, this);
+
+    if(!this->irqEvent) {
+        throw std::runtime_error("failed to allocate simulated irq event");
+    }
+
+    this->tickTimer = std::make_shared<TristLib::Event::Timer>(
+            TristLib::Event::RunLoop::Current(), kTickInterval, [this](auto timer) {
+        this->tick();
+    }, true);
+}
+
+/**
+ * @brief Clean up simulation resources
+ */
+Simulated::~Simulated() {
+    this->tickTimer.reset();
+
+    if(this->irqEvent) {
+        event_del(this->irqEvent);
+        event_free(this->irqEvent);
+        this->irqEvent = nullptr;
+    }
+}
+
+/**
+ * @brief Read the simulated nodes
+ *
+ * Each entry in the `nodes` array is a table with the following keys:
+ *
+ * - address: Short address of the node (mandatory)
+ * - pathLoss: Path loss between the node and coordinator, in dB (mandatory)
+ * - txPower: Transmit power of the node, in dBm
+ */
+void Simulated::readNodes(const toml::table &config) {
+    auto nodes = config["nodes"];
+    if(!nodes || !nodes.is_array()) {
+        throw std::runtime_error("invalid or missing `radio.transport.nodes` key (expected array)");
+    }
+
+    for(const auto &item : *nodes.as_array()) {
+        auto node = item.as_table();
+        if(!node) {
+            throw std::runtime_error("invalid `radio.transport.nodes` entry (expected table)");
+        }
+
+        const auto address = (*node)["address"], pathLoss = (*node)["pathLoss"];
+        if(!address || !address.is_integer() || !pathLoss || !pathLoss.is_number()) {
+            throw std::runtime_error("invalid `radio.transport.nodes` entry (need `address` and "
+                    "`pathLoss`)");
+        }
+
+        this->nodes.push_back(Node{
+            .address = static_cast<uint16_t>(address.value_or(0)),
+            .pathLoss = pathLoss.value_or(0.),
+            .txPower = (*node)["txPower"].value_or(kDefaultNodeTxPower),
+        });
+    }
+}
+
+
+
+/**
+ * @brief Reset the simulated radio
+ *
+ * All queued packets and configuration are discarded. A committed firmware update is installed,
+ * while blocks of an update in progress that weren't programmed yet are lost.
+ */
+void Simulated::reset() {
+    if(this->dfu.state == Response::DfuStatus::Committed) {
+        this->fwBuild = fmt::format("{:08x}", this->dfu.imageCrc);
+        this->dfu = {};
+
+        PLOG_INFO << "Simulated radio: booting updated firmware " << this->fwBuild;
+    } else if(!this->dfu.buffered.empty()) {
+        this->dfu.buffered.clear();
+        this->dfu.image.resize(this->dfu.programmed);
+    }
+
+    this->cmdSuccess = true;
+    this->radioConfig = {};
+    this->irqConfig = {};
+    this->irqPending = {};
+    this->counters = {};
+    this->rxQueue.clear();
+
+    this->beaconEnabled = false;
+    this->beaconInterval = std::chrono::milliseconds(0);
+    this->beaconFrame.clear();
+}
+
+/**
+ * @brief Execute a read command
+ *
+ * @param command Command id
+ * @param buffer Buffer to receive the command response
+ */
+void Simulated::sendCommandWithResponse(const CommandId command, std::span<std::byte> buffer) {
+    std::fill(buffer.begin(), buffer.end(), std::byte(0));
+
+    // copy a response structure into the buffer (truncated if needed)
+    auto respond = [&](const auto &response) {
+        memcpy(buffer.data(), &response, std::min(sizeof(response), buffer.size()));
+        this->cmdSuccess = true;
+    };
+
+    switch(command) {
+        case CommandId::GetInfo: {
+            Response::GetInfo info{};
+            info.status = 1;
+            info.fw.protocolVersion = 0x01;
+            strncpy(info.fw.build, this->fwBuild.c_str(), sizeof(info.fw.build));
+            info.hw.features = (this->txPowerOverride ?
+                    Response::GetInfo::HwFeatures::TxPowerOverride : 0) |
+                (this->beaconTiming ? Response::GetInfo::HwFeatures::BeaconTiming : 0) |
+                (this->dfuSupported ? Response::GetInfo::HwFeatures::Dfu : 0);
+            strncpy(info.hw.serial, "SIMULATED", sizeof(info.hw.serial));
+            info.hw.eui64[0] = 0x02;
+            info.radio.maxTxPower = this->maxTxPower;
+            respond(info);
+            break;
+        }
+
+        case CommandId::GetStatus: {
+            Response::GetStatus status{};
+            status.cmdSuccess = this->cmdSuccess;
+            status.radioActive = true;
+            status.rxQueueNotEmpty = !this->rxQueue.empty();
+            status.rxQueueFull = (this->rxQueue.size() >= kRxQueueDepth);
+            status.txQueueEmpty = true;
+            memcpy(buffer.data(), &status, std::min(sizeof(status), buffer.size()));
+            break;
+        }
+
+        case CommandId::GetPacketQueueStatus: {
+            Response::GetPacketQueueStatus status{};
+            if(!this->rxQueue.empty()) {
+                status.rxPacketPending = true;
+                status.rxPacketSize = this->rxQueue.front().data.size();
+            }
+            respond(status);
+            break;
+        }
+
+        case CommandId::ReadPacket: {
+            if(this->rxQueue.empty() || buffer.size() < sizeof(Response::ReadPacket)) {
+                this->cmdSuccess = false;
+                break;
+            }
+
+            auto packet = std::move(this->rxQueue.front());
+            this->rxQueue.pop_front();
+
+            auto header = reinterpret_cast<Response::ReadPacket *>(buffer.data());
+            header->rssi = packet.rssi;
+            header->lqi = packet.lqi;
+
+            const auto length = std::min(packet.data.size(),
+                    buffer.size() - sizeof(Response::ReadPacket));
+            memcpy(header->payload, packet.data.data(), length);
+
+            this->cmdSuccess = true;
+            break;
+        }
+
+        case CommandId::GetCounters: {
+            this->counters.currentTicks = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - this->startTime).count();
+            this->counters.rxQueue.packetsPending = this->rxQueue.size();
+            respond(this->counters);
+
+            this->counters = {};
+            break;
+        }
+
+        case CommandId::GetBeaconTiming: {
+            if(!this->beaconTiming) {
+                this->cmdSuccess = false;
+                break;
+            }
+
+            Response::GetBeaconTiming timing{};
+            timing.currentTime = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - this->startTime).count();
+            timing.lastBeacon = std::chrono::duration_cast<std::chrono::microseconds>(
+                    this->lastBeacon - this->startTime).count();
+            timing.beaconCount = this->beaconCount;
+            respond(timing);
+            break;
+        }
+
+        case CommandId::IrqStatus:
+            respond(this->irqPending);
+            this->irqPending = {};
+            break;
+
+        case CommandId::DfuStatus: {
+            if(!this->dfuSupported) {
+                this->cmdSuccess = false;
+                break;
+            }
+
+            Response::DfuStatus status{};
+            status.state = this->dfu.state;
+            status.freeBuffers = kDfuBuffers - this->dfu.buffered.size();
+            status.numBuffers = kDfuBuffers;
+            status.maxBlockSize = kDfuMaxBlockSize;
+            status.imageSize = this->dfu.imageSize;
+            status.imageCrc = this->dfu.imageCrc;
+            status.offset = this->dfu.image.size();
+            respond(status);
+            break;
+        }
+
+        default:
+            this->cmdSuccess = false;
+            break;
+    }
+}
+
+/**
+ * @brief Execute a write command
+ *
+ * @param command Command id
+ * @param payload Data payload to send with the command
+ */
+void Simulated::sendCommandWithPayload(const CommandId command,
+        std::span<const std::byte> payload) {
+    switch(command) {
+        case CommandId::NoOp:
+            this->cmdSuccess = true;
+            break;
+
+        case CommandId::RadioConfig:
+            if(payload.size() < sizeof(this->radioConfig)) {
+                this->cmdSuccess = false;
+                break;
+            }
+
+            memcpy(&this->radioConfig, payload.data(), sizeof(this->radioConfig));
+            this->cmdSuccess = true;
+            break;
+
+        case CommandId::IrqConfig:
+            if(payload.size() < sizeof(this->irqConfig)) {
+                this->cmdSuccess = false;
+                break;
+            }
+
+            memcpy(&this->irqConfig, payload.data(), sizeof(this->irqConfig));
+            this->cmdSuccess = true;
+            break;
+
+        case CommandId::TransmitPacket:
+            this->handleTransmit(payload);
+            break;
+
+        case CommandId::BeaconConfig:
+            this->handleBeaconConfig(payload);
+            break;
+
+        case CommandId::DfuBegin:
+            this->handleDfuBegin(payload);
+            break;
+        case CommandId::DfuWrite:
+            this->handleDfuWrite(payload);
+            break;
+        case CommandId::DfuCommit:
+            this->handleDfuCommit(payload);
+            break;
+
+        case CommandId::IrqStatus: {
+            if(payload.empty()) {
+                this->cmdSuccess = false;
+                break;
+            }
+
+            uint8_t pending, clear;
+            memcpy(&pending, &this->irqPending, sizeof(pending));
+            memcpy(&clear, payload.data(), sizeof(clear));
+
+            pending &= ~clear;
+            memcpy(&this->irqPending, &pending, sizeof(pending));
+            this->cmdSuccess = true;
+            break;
+        }
+
+        default:
+            this->cmdSuccess = false;
+            break;
+    }
+}
+
+
+
+/**
+ * @brief Transmit a packet
+ *
+ * The packet is sent right away. Unicast frames to a simulated node are received by it (and
+ * acknowledged) if they arrive with sufficient signal strength.
+ *
+ * Firmware without support for per-packet transmit power ignores the flag, so the power byte is
+ * treated as part of the packet, just like real firmware would.
+ */
+void Simulated::handleTransmit(std::span<const std::byte> payload) {
+    using namespace BlazeNet::Types;
+
+    if(payload.size() < sizeof(Request::TransmitPacket)) {
+        this->cmdSuccess = false;
+        return;
+    }
+
+    auto header = reinterpret_cast<const Request::TransmitPacket *>(payload.data());
+    auto frame = payload.subspan(sizeof(*header));
+    uint16_t power = this->radioConfig.txPower;
+
+    if(header->hasTxPower && this->txPowerOverride) {
+        if(frame.empty()) {
+            this->cmdSuccess = false;
+            return;
+        }
+
+        power = std::min<uint16_t>(power, static_cast<uint8_t>(frame[0]));
+        frame = frame.subspan(1);
+    }
+
+    this->cmdSuccess = true;
+    this->counters.txRadio.goodFrames++;
+    this->irqPending.txPacket = true;
+    this->irqPending.txQueueEmpty = true;
+    this->raiseIrq();
+
+    // find the node it's addressed to
+    if(frame.size() < sizeof(Phy::Header) + sizeof(Mac::Header)) {
+        return;
+    }
+
+    auto macHdr = reinterpret_cast<const Mac::Header *>(frame.data() + sizeof(Phy::Header));
+    const uint16_t destination = macHdr->destination;
+
+    auto node = std::find_if(this->nodes.begin(), this->nodes.end(), [&](const auto &node) {
+        return node.address == destination;
+    });
+    if(node == this->nodes.end()) {
+        return;
+    }
+
+    // update its statistics, and determine if it's received
+    const double dBm = power / 10.;
+
+    if(!node->framesSent) {
+        node->powerMin = node->powerMax = dBm;
+    } else {
+        node->powerMin = std::min(node->powerMin, dBm);
+        node->powerMax = std::max(node->powerMax, dBm);
+    }
+
+    node->framesSent++;
+    node->powerSum += dBm;
+
+    if(dBm - node->pathLoss + this->fade() < this->sensitivity) {
+        return;
+    }
+
+    node->framesReceived++;
+
+    // acknowledge it
+    std::array<std::byte, sizeof(Protocol::NetControl::Header) + sizeof(Protocol::NetControl::Ack)
+        + 1> ack{};
+
+    auto ncHdr = reinterpret_cast<Protocol::NetControl::Header *>(ack.data());
+    ncHdr->type = static_cast<uint8_t>(Protocol::NetControl::MessageType::Ack);
+
+    auto ackMsg = reinterpret_cast<Protocol::NetControl::Ack *>(ncHdr->payload);
+    ackMsg->numSequences = 1;
+    ackMsg->sequences[0] = macHdr->sequence;
+
+    this->transmitFromNode(*node, ack);
+}
+
+/**
+ * @brief Update the beacon configuration
+ */
+void Simulated::handleBeaconConfig(std::span<const std::byte> payload) {
+    if(payload.size() < sizeof(Request::BeaconConfig)) {
+        this->cmdSuccess = false;
+        return;
+    }
+
+    auto cmd = reinterpret_cast<const Request::BeaconConfig *>(payload.data());
+
+    if(cmd->updateConfig) {
+        this->beaconEnabled = cmd->enabled;
+        this->beaconInterval = std::chrono::milliseconds(cmd->interval);
+        this->nextBeacon = std::chrono::steady_clock::now() + this->beaconInterval;
+        this->beaconCount = 0;
+    }
+
+    if(payload.size() > sizeof(*cmd)) {
+        const auto frame = payload.subspan(sizeof(*cmd));
+        this->beaconFrame.assign(frame.begin(), frame.end());
+    }
+
+    this->cmdSuccess = true;
+}
+
+
+
+/**
+ * @brief Begin a firmware update
+ *
+ * Any update in progress (or committed, but not yet installed) is abandoned.
+ */
+void Simulated::handleDfuBegin(std::span<const std::byte> payload) {
+    if(!this->dfuSupported || payload.size() < sizeof(Request::DfuBegin)) {
+        this->cmdSuccess = false;
+        return;
+    }
+
+    auto cmd = reinterpret_cast<const Request::DfuBegin *>(payload.data());
+
+    this->dfu = {};
+    this->dfu.state = Response::DfuStatus::Receiving;
+    this->dfu.imageSize = cmd->imageSize;
+    this->dfu.imageCrc = cmd->imageCrc;
+
+    this->cmdSuccess = true;
+}
+
+/**
+ * @brief Write a firmware update block
+ *
+ * The block is accepted into a block buffer if one is free, it's at the expected offset, and its
+ * CRC matches. It's programmed later, from the simulation tick.
+ */
+void Simulated::handleDfuWrite(std::span<const std::byte> payload) {
+    auto &dfu = this->dfu;
+
+    if(dfu.state != Response::DfuStatus::Receiving || payload.size() <= sizeof(Request::DfuWrite)) {
+        this->cmdSuccess = false;
+        return;
+    }
+
+    auto cmd = reinterpret_cast<const Request::DfuWrite *>(payload.data());
+    const auto data = payload.subspan(sizeof(*cmd));
+
+    if(dfu.buffered.size() >= kDfuBuffers || data.size() > kDfuMaxBlockSize ||
+            cmd->offset != dfu.image.size() || data.size() > dfu.imageSize - dfu.image.size() ||
+            Support::Crc32(data) != cmd->crc) {
+        this->cmdSuccess = false;
+        return;
+    }
+
+    dfu.image.insert(dfu.image.end(), data.begin(), data.end());
+    dfu.buffered.push_back(data.size());
+
+    this->cmdSuccess = true;
+}
+
+/**
+ * @brief Commit a firmware update
+ *
+ * Succeeds if the entire image was received and programmed, and its CRC matches.
+ */
+void Simulated::handleDfuCommit(std::span<const std::byte> payload) {
+    auto &dfu = this->dfu;
+
+    if(payload.size() < sizeof(Request::DfuCommit) || dfu.state != Response::DfuStatus::Receiving) {
+        this->cmdSuccess = false;
+        return;
+    }
+
+    auto cmd = reinterpret_cast<const Request::DfuCommit *>(payload.data());
+
+    if(dfu.programmed != dfu.imageSize || cmd->imageCrc != dfu.imageCrc ||
+            Support::Crc32(dfu.image) != dfu.imageCrc) {
+        this->cmdSuccess = false;
+        return;
+    }
+
+    dfu.state = Response::DfuStatus::Committed;
+    this->cmdSuccess = true;
+}
+
+
+
+/**
+ * @brief Advance the simulation
+ *
+ * Send beacons when they're due, program buffered firmware update blocks, and periodically log
+ * statistics.
+ */
+void Simulated::tick() {
+    const auto now = std::chrono::steady_clock::now();
+
+    for(size_t i = 0; i < kDfuBlocksPerTick && !this->dfu.buffered.empty(); i++) {
+        this->dfu.programmed += this->dfu.buffered.front();
+        this->dfu.buffered.pop_front();
+    }
+
+    if(this->beaconEnabled && this->beaconInterval.count() > 0 && now >= this->nextBeacon) {
+        this->nextBeacon = now + this->beaconInterval;
+        this->sendBeacon();
+    }
+
+    if(this->mode != Mode::None && now >= this->nextLog) {
+        if(this->nextLog.time_since_epoch().count()) {
+            this->logStatistics();
+        }
+        this->nextLog = now + this->logInterval;
+    }
+}
+
+/**
+ * @brief Transmit a beacon
+ *
+ * Beacons are sent at the configured transmit power. Every node that receives it responds with a
+ * link report.
+ */
+void Simulated::sendBeacon() {
+    this->counters.txRadio.goodFrames++;
+
+    if(this->beaconTiming) {
+        this->lastBeacon = std::chrono::steady_clock::now();
+        this->beaconCount++;
+
+        this->irqPending.beaconSent = true;
+        this->raiseIrq();
+    }
+
+    const double dBm = this->radioConfig.txPower / 10.;
+
+    for(auto &node : this->nodes) {
+        const double rssi = dBm - node.pathLoss + this->fade();
+        if(rssi < this->sensitivity) {
+            continue;
+        }
+
+        std::array<std::byte, sizeof(Protocol::NetControl::Header)
+            + sizeof(Protocol::NetControl::LinkReport)> report{};
+
+        auto ncHdr = reinterpret_cast<Protocol::NetControl::Header *>(report.data());
+        ncHdr->type = static_cast<uint8_t>(Protocol::NetControl::MessageType::LinkReport);
+
+        auto msg = reinterpret_cast<Protocol::NetControl::LinkReport *>(ncHdr->payload);
+        msg->beaconRssi = std::clamp<long>(std::lround(rssi), INT8_MIN, INT8_MAX);
+        msg->beaconLqi = std::clamp((rssi - this->sensitivity) / kLqiRange, 0., 1.) * UINT8_MAX;
+
+        this->transmitFromNode(node, report);
+    }
+}
+
+/**
+ * @brief Log per-node transmit power statistics
+ *
+ * For each node that was sent frames since the last log, output the range of transmit powers
+ * used, the fraction of frames it received, and the power it would need (on average) to receive
+ * frames. A converged power controller settles a little above the required power.
+ */
+void Simulated::logStatistics() {
+    for(auto &node : this->nodes) {
+        if(!node.framesSent) {
+            continue;
+        }
+
+        PLOG_INFO << fmt::format("sim ${:04x}: {} frames, {:.1f}% received; tx {:.1f} dBm avg "
+                "({:.1f} .. {:.1f}), needs {:.1f} dBm", node.address, node.framesSent,
+                (node.framesReceived * 100.) / node.framesSent, node.powerSum / node.framesSent,
+                node.powerMin, node.powerMax, this->sensitivity + node.pathLoss);
+
+        node.framesSent = node.framesReceived = 0;
+        node.powerSum = 0;
+    }
+}
+
+
+
+/**
+ * @brief Send a network control message from a node to the coordinator
+ *
+ * The message is placed in the receive queue if it arrives with sufficient signal strength;
+ * otherwise, it's counted as a frame error.
+ *
+ * @param node Node that sends the message
+ * @param message Network control message (including its header)
+ */
+void Simulated::transmitFromNode(Node &node, std::span<const std::byte> message) {
+    using namespace BlazeNet::Types;
+
+    const double rssi = node.txPower - node.pathLoss + this->fade();
+    if(rssi < this->sensitivity) {
+        this->counters.rxRadio.frameErrors++;
+        return;
+    } else if(this->rxQueue.size() >= kRxQueueDepth) {
+        this->counters.rxQueue.queueDiscards++;
+        return;
+    }
+
+    // build the frame
+    RxPacket packet{
+        .rssi = static_cast<int8_t>(std::clamp<long>(std::lround(rssi), INT8_MIN, INT8_MAX)),
+        .lqi = static_cast<uint8_t>(std::clamp((rssi - this->sensitivity) / kLqiRange, 0., 1.)
+                * UINT8_MAX),
+    };
+    packet.data.resize(sizeof(Phy::Header) + sizeof(Mac::Header) + message.size());
+
+    auto phyHdr = reinterpret_cast<Phy::Header *>(packet.data.data());
+    phyHdr->length = packet.data.size() - 1;
+
+    auto macHdr = reinterpret_cast<Mac::Header *>(phyHdr->payload);
+    macHdr->flags = Mac::HeaderFlags::EndpointNetControl;
+    macHdr->sequence = node.sequence++;
+    macHdr->source = node.address;
+    macHdr->destination = this->radioConfig.myAddress;
+
+    memcpy(macHdr->payload, message.data(), message.size());
+
+    this->rxQueue.emplace_back(std::move(packet));
+    this->counters.rxRadio.goodFrames++;
+
+    this->irqPending.rxQueueNotEmpty = true;
+    this->raiseIrq();
+}
+
+/**
+ * @brief Get a random fading value (dB)
+ */
+double Simulated::fade() {
+    if(this->fading <= 0.) {
+        return 0.;
+    }
+
+    std::normal_distribution<double> dist(0., this->fading);
+    return dist(this->random);
+}
+
+/**
+ * @brief Signal an interrupt to the host, if any unmasked interrupts are pending
+ *
+ * Interrupt handlers are invoked from the event loop, rather than directly, since they will in
+ * turn issue commands to the transport.
+ */
+void Simulated::raiseIrq() {
+    uint8_t pending, mask;
+    memcpy(&pending, &this->irqPending, sizeof(pending));
+    memcpy(&mask, &this->irqConfig, sizeof(mask));
+
+    if(pending & mask) {
+        event_active(this->irqEvent, 0, 0);
+    }
+}
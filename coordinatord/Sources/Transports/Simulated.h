@@ -0,0 +1,230 @@
+#ifndef TRANSPORTS_SIMULATED_H
+#define TRANSPORTS_SIMULATED_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <toml++/toml.h>
+
+#include "Transports/Commands.h"
+#include "Transports/Base.h"
+
+struct event;
+
+namespace TristLib::Event {
+class Timer;
+}
+
+namespace Transports {
+/**
+ * @brief Simulated radio transport
+ *
+ * Emulates the radio firmware's command interface entirely in software, so the daemon can be run
+ * without any radio hardware attached. Transmitted packets are discarded, unless a simulation
+ * mode is enabled that models nodes on the network.
+ *
+ * The following simulation modes are available:
+ *
+ * - none: No nodes are simulated (default)
+ * - powerControl: A set of nodes at a fixed path loss from the coordinator. Nodes acknowledge
+ *   unicast frames they receive, and send link reports for received beacons. Whether a frame is
+ *   received depends on its transmit power, the path loss, and random fading. Statistics on the
+ *   transmit power chosen for each node are logged periodically, to validate that the transmit
+ *   power control converges.
+ *
+ * Firmware updates are emulated as well: the image is received into a buffer, blocks are
+ * "programmed" from the block buffers over subsequent simulation ticks, and when the radio is
+ * reset after a successful update, the firmware build string changes to the image's CRC.
+ */
+class Simulated: public TransportBase {
+    private:
+        /// Simulation tick interval
+        constexpr static const std::chrono::milliseconds kTickInterval{10};
+        /// Maximum number of packets in the receive queue
+        constexpr static const size_t kRxQueueDepth{32};
+
+        /// Default maximum transmit power (dBm)
+        constexpr static const double kDefaultMaxTxPower{10.};
+        /// Default receiver sensitivity (dBm)
+        constexpr static const double kDefaultSensitivity{-95.};
+        /// Default standard deviation of fading (dB)
+        constexpr static const double kDefaultFading{2.};
+        /// Default node transmit power (dBm)
+        constexpr static const double kDefaultNodeTxPower{0.};
+        /// Default interval between statistics logs
+        constexpr static const std::chrono::milliseconds kDefaultLogInterval{10'000};
+        /// Signal strength above sensitivity at which the link quality indicator saturates (dB)
+        constexpr static const double kLqiRange{30.};
+
+        /// Number of firmware update block buffers
+        constexpr static const size_t kDfuBuffers{2};
+        /// Largest firmware update block (bytes)
+        constexpr static const size_t kDfuMaxBlockSize{128};
+        /// Number of buffered firmware update blocks programmed per simulation tick
+        constexpr static const size_t kDfuBlocksPerTick{1};
+
+        /**
+         * @brief Simulation modes
+         */
+        enum class Mode {
+            /// No nodes are simulated
+            None,
+            /// Static nodes for transmit power control
+            PowerControl,
+        };
+
+        /**
+         * @brief A simulated node
+         */
+        struct Node {
+            /// Short address of the node
+            uint16_t address;
+            /// Path loss between node and coordinator (dB)
+            double pathLoss;
+            /// Transmit power of the node (dBm)
+            double txPower;
+
+            /// Sequence number for the next frame sent by the node
+            uint8_t sequence{0};
+
+            /// Unicast frames sent to the node (since the last statistics log)
+            size_t framesSent{0};
+            /// Unicast frames received by the node (since the last statistics log)
+            size_t framesReceived{0};
+            /// Sum of the transmit powers of frames sent to the node (dBm)
+            double powerSum{0};
+            /// Lowest and highest transmit power of frames sent to the node (dBm)
+            double powerMin{0}, powerMax{0};
+        };
+
+        /**
+         * @brief A packet waiting in the receive queue
+         */
+        struct RxPacket {
+            /// Received signal strength (dBm)
+            int8_t rssi;
+            /// Link quality indicator
+            uint8_t lqi;
+            /// Packet data (including PHY header)
+            std::vector<std::byte> data;
+        };
+
+        /**
+         * @brief Emulated firmware update state
+         */
+        struct Dfu {
+            /// Update state
+            uint8_t state{Response::DfuStatus::Idle};
+            /// Size of the image being received
+            uint32_t imageSize{0};
+            /// CRC of the image being received
+            uint32_t imageCrc{0};
+            /// Received image data (both programmed and buffered)
+            std::vector<std::byte> image;
+            /// Number of bytes programmed
+            uint32_t programmed{0};
+            /// Sizes of the blocks waiting in the block buffers, in the order they were written
+            std::deque<uint32_t> buffered;
+        };
+
+    public:
+        Simulated(const toml::table &config);
+        ~Simulated();
+
+        void reset() override;
+
+        void sendCommandWithResponse(const CommandId command, std::span<std::byte> buffer) override;
+        void sendCommandWithPayload(const CommandId command,
+                std::span<const std::byte> payload) override;
+
+    private:
+        void readNodes(const toml::table &config);
+
+        void handleTransmit(std::span<const std::byte> payload);
+        void handleBeaconConfig(std::span<const std::byte> payload);
+        void handleDfuBegin(std::span<const std::byte> payload);
+        void handleDfuWrite(std::span<const std::byte> payload);
+        void handleDfuCommit(std::span<const std::byte> payload);
+
+        void tick();
+        void sendBeacon();
+        void logStatistics();
+
+        void transmitFromNode(Node &node, std::span<const std::byte> message);
+        double fade();
+        void raiseIrq();
+
+    private:
+        /// Simulation mode
+        Mode mode{Mode::None};
+        /// Whether the emulated firmware supports per-packet transmit power
+        bool txPowerOverride{true};
+        /// Whether the emulated firmware reports beacon timing
+        bool beaconTiming{true};
+        /// Whether the emulated firmware can be updated
+        bool dfuSupported{true};
+        /// Maximum transmit power reported to the host (⅒th dBm)
+        uint8_t maxTxPower;
+        /// Receiver sensitivity of all radios (dBm)
+        double sensitivity{kDefaultSensitivity};
+        /// Standard deviation of the fading applied to each frame (dB)
+        double fading{kDefaultFading};
+        /// Interval between statistics logs
+        std::chrono::milliseconds logInterval{kDefaultLogInterval};
+
+        /// Simulated nodes
+        std::vector<Node> nodes;
+        /// Random number generator for fading
+        std::mt19937 random{std::random_device{}()};
+
+        /// Whether the last command succeeded
+        bool cmdSuccess{true};
+        /// Current radio configuration
+        Request::RadioConfig radioConfig{};
+        /// Interrupt configuration
+        Response::IrqConfig irqConfig{};
+        /// Interrupts pending
+        Response::IrqStatus irqPending{};
+        /// Performance counters (since they were last read)
+        Response::GetCounters counters{};
+        /// Packets waiting to be read by the host
+        std::deque<RxPacket> rxQueue;
+
+        /// Whether beacons are enabled
+        bool beaconEnabled{false};
+        /// Beacon interval
+        std::chrono::milliseconds beaconInterval{0};
+        /// Beacon frame
+        std::vector<std::byte> beaconFrame;
+        /// Time at which the next beacon is due
+        std::chrono::steady_clock::time_point nextBeacon;
+        /// Time at which the last beacon was sent
+        std::chrono::steady_clock::time_point lastBeacon;
+        /// Number of beacons sent since beaconing was enabled
+        uint32_t beaconCount{0};
+        /// Time at which statistics are next logged
+        std::chrono::steady_clock::time_point nextLog;
+
+        /// Firmware build string reported (changes when an update is installed)
+        std::string fwBuild{"sim"};
+        /// Firmware update state (retained across resets)
+        Dfu dfu;
+
+        /// Simulation timer
+        std::shared_ptr<TristLib::Event::Timer> tickTimer;
+        /// Event used to deliver interrupts from the event loop
+        struct event *irqEvent{nullptr};
+        /// Time the simulation was started
+        std::chrono::steady_clock::time_point startTime{std::chrono::steady_clock::now()};
+};
+}
+
+#endif
@@ -0,0 +1,284 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cbor.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <system_error>
+#include <vector>
+
+#include "Rpc/CborWriter.h"
+#include "Rpc/ClientConnection.h"
+#include "Rpc/Types.h"
+
+#include "Support/Fixture.h"
+
+/// Number of entries in the table reply
+constexpr static const size_t kTableEntries{64};
+/// The table reply is at least this large (bytes), so it'd be queued by reference
+constexpr static const size_t kMinTableSize{1024};
+
+/// Number of times `operator new` was invoked (by anything in the process)
+static std::atomic<size_t> gAllocations{0};
+
+/**
+ * @brief Count heap allocations
+ *
+ * This replaces the global allocation functions for the entire benchmark executable; array and
+ * nothrow forms end up here as well. Memory allocated by C libraries (libcbor, libevent) with
+ * `malloc()` directly isn't counted.
+ */
+void *operator new(const size_t size) {
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    if(auto ptr = malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+void operator delete(void *ptr, const size_t) noexcept {
+    free(ptr);
+}
+
+/**
+ * @brief Add a string keyed pair to a libcbor map
+ */
+static void AddPair(cbor_item_t *map, const char *key, cbor_item_t *value) {
+    cbor_map_add(map, (struct cbor_pair) {
+        .key = cbor_move(cbor_build_string(key)),
+        .value = cbor_move(value),
+    });
+}
+
+/**
+ * @brief Encode a radio counters reply with libcbor
+ *
+ * This is the same structure the status endpoint used to build as an item tree, followed by its
+ * serialization into a freshly allocated buffer.
+ *
+ * @return Number of bytes encoded
+ */
+static size_t EncodeCountersLibcbor(const uint64_t base) {
+    auto rxMap = cbor_new_definite_map(4);
+    AddPair(rxMap, "good", cbor_build_uint64(base));
+    AddPair(rxMap, "errors", cbor_build_uint64(base + 1));
+    AddPair(rxMap, "fifoOverflows", cbor_build_uint64(base + 2));
+    AddPair(rxMap, "queueDiscards", cbor_build_uint64(base + 3));
+
+    auto txMap = cbor_new_definite_map(4);
+    AddPair(txMap, "good", cbor_build_uint64(base));
+    AddPair(txMap, "ccaFails", cbor_build_uint64(base + 1));
+    AddPair(txMap, "fifoUnderruns", cbor_build_uint64(base + 2));
+    AddPair(txMap, "queueDiscards", cbor_build_uint64(base + 3));
+
+    auto root = cbor_new_definite_map(3);
+    AddPair(root, "tx", txMap);
+    AddPair(root, "rx", rxMap);
+    AddPair(root, "readAt", cbor_build_uint64(UINT64_MAX));
+
+    size_t bufLen;
+    unsigned char *buf{nullptr};
+    const auto length = cbor_serialize_alloc(root, &buf, &bufLen);
+    cbor_decref(&root);
+    free(buf);
+
+    return length;
+}
+
+/**
+ * @brief Encode a radio counters reply with the streaming writer
+ *
+ * @return Number of bytes encoded
+ */
+static size_t EncodeCountersWriter(std::vector<std::byte> &buffer, const uint64_t base) {
+    buffer.clear();
+    Rpc::CborWriter writer(buffer);
+
+    writer.putMap(3);
+    writer.putString("tx");
+    writer.putMap(4);
+    writer.putString("good");
+    writer.putUint(base);
+    writer.putString("ccaFails");
+    writer.putUint(base + 1);
+    writer.putString("fifoUnderruns");
+    writer.putUint(base + 2);
+    writer.putString("queueDiscards");
+    writer.putUint(base + 3);
+
+    writer.putString("rx");
+    writer.putMap(4);
+    writer.putString("good");
+    writer.putUint(base);
+    writer.putString("errors");
+    writer.putUint(base + 1);
+    writer.putString("fifoOverflows");
+    writer.putUint(base + 2);
+    writer.putString("queueDiscards");
+    writer.putUint(base + 3);
+
+    writer.putString("readAt");
+    writer.putUint(UINT64_MAX);
+
+    return writer.size();
+}
+
+/**
+ * @brief Encode a node table reply (array of per-node maps) with libcbor
+ *
+ * @return Number of bytes encoded
+ */
+static size_t EncodeTableLibcbor() {
+    auto root = cbor_new_definite_array(kTableEntries);
+
+    for(size_t i = 0; i < kTableEntries; i++) {
+        auto node = cbor_new_definite_map(4);
+        AddPair(node, "address", cbor_build_uint16(0x0100 + i));
+        AddPair(node, "eui64", cbor_build_uint64(0x0011223344556600 + i));
+        AddPair(node, "rssi", cbor_build_negint8(60 + (i % 30)));
+        AddPair(node, "sleepy", cbor_build_bool(i & 1));
+        cbor_array_push(root, cbor_move(node));
+    }
+
+    size_t bufLen;
+    unsigned char *buf{nullptr};
+    const auto length = cbor_serialize_alloc(root, &buf, &bufLen);
+    cbor_decref(&root);
+    free(buf);
+
+    return length;
+}
+
+/**
+ * @brief Encode a node table reply with the streaming writer
+ *
+ * @param writer Writer to append the reply to
+ */
+static void EncodeTable(Rpc::CborWriter &writer) {
+    writer.putArray(kTableEntries);
+    for(size_t i = 0; i < kTableEntries; i++) {
+        writer.putMap(4);
+        writer.putString("address");
+        writer.putUint(0x0100 + i);
+        writer.putString("eui64");
+        writer.putUint(0x0011223344556600 + i);
+        writer.putString("rssi");
+        writer.putInt(-61 - static_cast<int64_t>(i % 30));
+        writer.putString("sleepy");
+        writer.putBool(i & 1);
+    }
+}
+
+/**
+ * @brief Encode a node table reply into a buffer with the streaming writer
+ *
+ * @return Number of bytes encoded
+ */
+static size_t EncodeTableWriter(std::vector<std::byte> &buffer) {
+    buffer.clear();
+    Rpc::CborWriter writer(buffer);
+    EncodeTable(writer);
+    return writer.size();
+}
+
+/**
+ * @brief Reply encoding cost: streaming writer vs. libcbor item tree
+ *
+ * Encodes the same replies both ways: a small nested map (like the radio counters) and a table
+ * of per-node maps. The writer reuses its buffer across iterations, as connections do.
+ */
+TEST_CASE("CBOR reply encoding", "[benchmark][cbor]") {
+    std::vector<std::byte> buffer;
+    uint64_t base{0};
+
+    // the writer's output must be valid CBOR of the same shape
+    EncodeCountersWriter(buffer, 1);
+    struct cbor_load_result result{};
+    auto item = cbor_load(reinterpret_cast<const cbor_data>(buffer.data()), buffer.size(),
+            &result);
+    REQUIRE(result.error.code == CBOR_ERR_NONE);
+    REQUIRE(cbor_isa_map(item));
+    REQUIRE(cbor_map_size(item) == 3);
+    cbor_decref(&item);
+
+    BENCHMARK("counters, libcbor") {
+        return EncodeCountersLibcbor(base++);
+    };
+    BENCHMARK("counters, writer") {
+        return EncodeCountersWriter(buffer, base++);
+    };
+
+    BENCHMARK("node table, libcbor") {
+        return EncodeTableLibcbor();
+    };
+    BENCHMARK("node table, writer") {
+        return EncodeTableWriter(buffer);
+    };
+}
+
+/**
+ * @brief Replies don't allocate once warmed up
+ *
+ * Encodes replies with the writer, and sends them over a client connection (as a connection does
+ * for every request), and checks that neither allocates memory once the buffers have grown to
+ * size. The table reply is large enough that it would be queued by reference if the socket
+ * couldn't take it right away.
+ */
+TEST_CASE("CBOR reply allocations", "[cbor]") {
+    constexpr static const size_t kIterations{100};
+
+    std::vector<std::byte> buffer;
+    EncodeCountersWriter(buffer, 0);
+    EncodeTableWriter(buffer);
+
+    const auto before = gAllocations.load();
+    for(size_t i = 0; i < kIterations; i++) {
+        EncodeCountersWriter(buffer, i);
+        EncodeTableWriter(buffer);
+    }
+    REQUIRE(gAllocations.load() == before);
+
+    // send the same replies to a client over a local socket
+    auto &fixture = Tests::Fixture::The();
+
+    std::array<int, 2> fds;
+    if(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK, 0, fds.data())) {
+        throw std::system_error(errno, std::generic_category(), "socketpair");
+    }
+
+    auto client = std::make_shared<Rpc::ClientConnection>(fixture.getServer().get(), fds[0]);
+    std::array<std::byte, 4096> reply;
+
+    const auto sendReply = [&] {
+        EncodeTable(client->beginPush(Rpc::RequestEndpoint::Status));
+        client->endReply();
+
+        return recv(fds[1], reply.data(), reply.size(), 0);
+    };
+
+    REQUIRE(sendReply() > static_cast<ssize_t>(kMinTableSize));
+
+    const auto beforeSend = gAllocations.load();
+    for(size_t i = 0; i < kIterations; i++) {
+        sendReply();
+    }
+    REQUIRE(gAllocations.load() == beforeSend);
+
+    REQUIRE(!client->isDead());
+
+    client.reset();
+    close(fds[1]);
+}
@@ -0,0 +1,77 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <BlazeNet/Types.h>
+
+#include "Protocol/Fragmenter.h"
+#include "Protocol/Handler.h"
+#include "Protocol/NetControl.h"
+#include "Radio.h"
+
+#include "Support/Fixture.h"
+
+using namespace Protocol;
+
+/**
+ * @brief Build the fragments of a message, as a node would send them
+ *
+ * @return Fragment messages (following the network control header)
+ */
+static std::vector<std::vector<std::byte>> MakeFragments(const size_t length) {
+    const size_t count = (length + Fragmenter::kMaxFragmentData - 1)
+        / Fragmenter::kMaxFragmentData;
+    std::vector<std::vector<std::byte>> fragments;
+
+    for(size_t i = 0; i < count; i++) {
+        const auto offset = i * Fragmenter::kMaxFragmentData;
+        const auto chunk = std::min(Fragmenter::kMaxFragmentData, length - offset);
+
+        auto &fragment = fragments.emplace_back(sizeof(NetControl::Fragment) + chunk,
+                std::byte{0xA5});
+        auto hdr = reinterpret_cast<NetControl::Fragment *>(fragment.data());
+        hdr->messageId = 1;
+        hdr->index = i;
+        hdr->count = count;
+        hdr->totalLength = length;
+        hdr->endpoint = 1;
+    }
+
+    return fragments;
+}
+
+/**
+ * @brief Fragmentation and reassembly throughput
+ *
+ * Splits a message into fragments (and submits them to the simulated radio), and reassembles a
+ * message from its fragments, for a small and a maximum size message.
+ */
+TEST_CASE("Fragmentation throughput", "[benchmark][fragmenter]") {
+    auto &fragmenter = Tests::Fixture::The().getHandler()->getFragmenter();
+
+    for(const size_t length : {size_t{1024}, Fragmenter::kMaxMessageSize}) {
+        const std::vector<std::byte> message(length, std::byte{0x5A});
+
+        BENCHMARK("fragment, " + std::to_string(length) + " bytes") {
+            fragmenter->send(BlazeNet::Types::Mac::kBroadcastAddress,
+                    static_cast<BlazeNet::Types::Mac::HeaderFlags>(1),
+                    Radio::PacketPriority::Normal, message, {});
+        };
+
+        const auto fragments = MakeFragments(length);
+        const auto before = fragmenter->getCounters().rxReassembled;
+
+        BENCHMARK("reassemble, " + std::to_string(length) + " bytes") {
+            for(const auto &fragment : fragments) {
+                fragmenter->handleFragment(0x0100, fragment);
+            }
+        };
+
+        REQUIRE(fragmenter->getCounters().rxReassembled > before);
+    }
+}
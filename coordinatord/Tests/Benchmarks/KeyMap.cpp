@@ -0,0 +1,121 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Rpc/KeyMap.h"
+
+using namespace Rpc;
+
+/// Keys to build maps from (the first N are used for a map with N keys)
+constexpr static const std::array<std::string_view, 48> kKeys{
+    "key.00", "key.01", "key.02", "key.03", "key.04", "key.05", "key.06", "key.07",
+    "key.08", "key.09", "key.10", "key.11", "key.12", "key.13", "key.14", "key.15",
+    "key.16", "key.17", "key.18", "key.19", "key.20", "key.21", "key.22", "key.23",
+    "key.24", "key.25", "key.26", "key.27", "key.28", "key.29", "key.30", "key.31",
+    "key.32", "key.33", "key.34", "key.35", "key.36", "key.37", "key.38", "key.39",
+    "key.40", "key.41", "key.42", "key.43", "key.44", "key.45", "key.46", "key.47",
+};
+
+/**
+ * @brief Build a key map from the first N keys
+ *
+ * Each key maps to its index.
+ */
+template<size_t N, size_t... I>
+consteval KeyMap<size_t, N> MakeMap(std::index_sequence<I...>) {
+    const typename KeyMap<size_t, N>::Entry entries[N]{{kKeys[I], I}...};
+    return KeyMap<size_t, N>(entries);
+}
+
+/**
+ * @brief Look up a key the way endpoints used to
+ *
+ * The key is copied and lowercased, then compared against each key in turn (like an if/else
+ * chain of string compares.)
+ *
+ * @return Index of the key, or `N` if not found
+ */
+template<size_t N>
+static size_t FindLinear(const std::string_view key) {
+    std::string lower(key);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](const unsigned char c) {
+        return std::tolower(c);
+    });
+
+    for(size_t i = 0; i < N; i++) {
+        if(lower == kKeys[i]) {
+            return i;
+        }
+    }
+    return N;
+}
+
+/**
+ * @brief Get the keys to look up
+ *
+ * These are all keys of the map (with their first letter in uppercase, as a client might send
+ * them), followed by one that isn't in the map.
+ */
+template<size_t N>
+static std::vector<std::string> MakeQueries() {
+    std::vector<std::string> queries;
+    for(size_t i = 0; i < N; i++) {
+        auto &query = queries.emplace_back(kKeys[i]);
+        query[0] = 'K';
+    }
+    queries.emplace_back("key.unknown");
+    return queries;
+}
+
+/**
+ * @brief Dispatch cost as the number of keys grows
+ *
+ * Each iteration looks up every key of a map (and one missing key), once through the perfect hash
+ * map, and once by the previous copy, lowercase and compare approach.
+ */
+template<size_t N>
+static void BenchmarkDispatch() {
+    constexpr static const auto kMap = MakeMap<N>(std::make_index_sequence<N>{});
+    const auto queries = MakeQueries<N>();
+
+    size_t found{0};
+    for(const auto &query : queries) {
+        found += !!kMap.find(query);
+    }
+    REQUIRE(found == N);
+    for(const auto &query : queries) {
+        REQUIRE(FindLinear<N>(query) == (kMap.find(query) ? *kMap.find(query) : N));
+    }
+
+    BENCHMARK("KeyMap, " + std::to_string(N) + " keys") {
+        size_t sum{0};
+        for(const auto &query : queries) {
+            if(auto value = kMap.find(query)) {
+                sum += *value;
+            }
+        }
+        return sum;
+    };
+
+    BENCHMARK("linear compare, " + std::to_string(N) + " keys") {
+        size_t sum{0};
+        for(const auto &query : queries) {
+            sum += FindLinear<N>(query);
+        }
+        return sum;
+    };
+}
+
+TEST_CASE("RPC key dispatch", "[benchmark][rpc]") {
+    BenchmarkDispatch<4>();
+    BenchmarkDispatch<16>();
+    BenchmarkDispatch<48>();
+}
@@ -0,0 +1,51 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "Protocol/Handler.h"
+#include "Protocol/Retransmitter.h"
+#include "Radio.h"
+
+#include "Support/Fixture.h"
+
+/**
+ * @brief Cost of tracking frames for acknowledgement
+ *
+ * Measures tracking a frame and completing it with an acknowledgement, both for a single frame
+ * in flight and with many frames (to different nodes) outstanding at once.
+ */
+TEST_CASE("Retransmitter tracking", "[benchmark][retransmitter]") {
+    auto &retransmitter = Tests::Fixture::The().getHandler()->getRetransmitter();
+
+    std::array<std::byte, 64> frame{};
+    size_t completed{0};
+    const auto callback = [&completed](const bool acknowledged) {
+        completed += acknowledged;
+    };
+
+    BENCHMARK("track + ack, 1 in flight") {
+        retransmitter->track(0x0100, 0, Radio::PacketPriority::Normal, frame, callback);
+        retransmitter->handleAck(0x0100, 0);
+        return completed;
+    };
+
+    BENCHMARK_ADVANCED("track + ack, 1024 in flight")(Catch::Benchmark::Chronometer meter) {
+        constexpr static const size_t kInFlight{1024};
+
+        meter.measure([&] {
+            for(size_t i = 0; i < kInFlight; i++) {
+                retransmitter->track(0x0100 + (i / 256), i % 256, Radio::PacketPriority::Normal,
+                        frame, callback);
+            }
+            for(size_t i = 0; i < kInFlight; i++) {
+                retransmitter->handleAck(0x0100 + (i / 256), i % 256);
+            }
+            return completed;
+        });
+    };
+
+    REQUIRE(retransmitter->getCounters().spuriousAcks == 0);
+}
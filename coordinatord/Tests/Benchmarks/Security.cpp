@@ -0,0 +1,140 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <BlazeNet/Types.h>
+
+#include "Protocol/Fragmenter.h"
+#include "Protocol/Handler.h"
+#include "Protocol/Security.h"
+#include "Radio.h"
+
+#include "Support/Fixture.h"
+
+using namespace Protocol;
+
+/**
+ * @brief Build an unsecured frame, with room for the security overhead
+ *
+ * @param source Source address of the frame
+ * @param destination Destination address of the frame
+ * @param payloadSize Number of payload bytes
+ *
+ * @return Full frame (including PHY header), with the secured flag set
+ */
+static std::vector<std::byte> MakeFrame(const uint16_t source, const uint16_t destination,
+        const size_t payloadSize) {
+    using namespace BlazeNet::Types;
+
+    std::vector<std::byte> frame(Handler::kFrameHeaderSize + Security::kOverhead + payloadSize,
+            std::byte{0xA5});
+
+    auto phyHdr = reinterpret_cast<Phy::Header *>(frame.data());
+    phyHdr->length = frame.size() - 1;
+
+    auto macHdr = reinterpret_cast<Mac::Header *>(phyHdr->payload);
+    macHdr->flags = 1 | Security::kFlagSecured;
+    macHdr->sequence = 0;
+    macHdr->source = source;
+    macHdr->destination = destination;
+
+    return frame;
+}
+
+/**
+ * @brief Link layer security throughput
+ *
+ * Measures securing frames to a node, and verifying frames received from it, for a small and a
+ * maximum size payload. Each received frame carries a new frame counter, so it passes the replay
+ * check.
+ */
+TEST_CASE("Security protect/unprotect", "[benchmark][security]") {
+    auto &fixture = Tests::Fixture::The();
+    auto &security = fixture.getHandler()->getSecurity();
+
+    fixture.setSecurityEnabled(true);
+    const auto coordinator = fixture.getRadio()->getAddress();
+    const auto node = fixture.associateNode(0x0011223344556677);
+
+    for(const size_t payloadSize : {size_t{16}, Handler::kMaxPayloadSize}) {
+        const auto suffix = std::to_string(payloadSize) + " bytes";
+
+        auto txFrame = MakeFrame(coordinator, node, payloadSize);
+        BENCHMARK("protect, " + suffix) {
+            security->protect(txFrame);
+            return txFrame.back();
+        };
+
+        size_t verified{0}, total{0};
+        BENCHMARK_ADVANCED("unprotect, " + suffix)(Catch::Benchmark::Chronometer meter) {
+            std::vector<std::vector<std::byte>> frames(meter.runs());
+            for(auto &frame : frames) {
+                frame = MakeFrame(node, coordinator, payloadSize);
+                security->protect(frame);
+            }
+            total += frames.size();
+
+            std::vector<std::byte> payload;
+            meter.measure([&](const int i) {
+                verified += security->unprotect(frames[i], payload);
+                return verified;
+            });
+        };
+
+        REQUIRE(verified == total);
+    }
+
+    fixture.setSecurityEnabled(false);
+}
+
+/**
+ * @brief End to end transmit throughput, with and without security
+ *
+ * Each iteration sends a number of maximum size frames through the protocol handler to the
+ * simulated radio, either one at a time or as the fragments of a single message (which are
+ * secured in one pass), then processes the radio's events. Dividing the frame count by the time
+ * per iteration gives the frames per second on a single core.
+ */
+TEST_CASE("Security transmit throughput", "[benchmark][security]") {
+    constexpr static const size_t kNumFrames{16};
+
+    auto &fixture = Tests::Fixture::The();
+    auto &handler = fixture.getHandler();
+    const auto endpoint = static_cast<BlazeNet::Types::Mac::HeaderFlags>(1);
+
+    const std::vector<std::byte> payload(Handler::kMaxPayloadSize, std::byte{0x5A});
+    const std::vector<std::byte> message(kNumFrames * Fragmenter::kMaxFragmentData,
+            std::byte{0x5A});
+
+    for(const bool secured : {false, true}) {
+        fixture.setSecurityEnabled(secured);
+        REQUIRE(handler->getSecurity()->isEnabled() == secured);
+
+        const auto suffix = std::to_string(kNumFrames) + " frames, security "
+            + (secured ? "on" : "off");
+        const auto before = handler->getSecurity()->getCounters().txProtected;
+
+        BENCHMARK("single frames, " + suffix) {
+            for(size_t i = 0; i < kNumFrames; i++) {
+                handler->sendFrame(BlazeNet::Types::Mac::kBroadcastAddress, endpoint,
+                        Radio::PacketPriority::Normal, payload);
+            }
+            fixture.runPending();
+        };
+
+        BENCHMARK("fragment train, " + suffix) {
+            handler->sendMessage(BlazeNet::Types::Mac::kBroadcastAddress, endpoint,
+                    Radio::PacketPriority::Normal, message);
+            fixture.runPending();
+        };
+
+        const auto protectedFrames = handler->getSecurity()->getCounters().txProtected - before;
+        REQUIRE((protectedFrames != 0) == secured);
+    }
+
+    fixture.setSecurityEnabled(false);
+}
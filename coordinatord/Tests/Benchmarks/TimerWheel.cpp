@@ -0,0 +1,110 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Protocol/TimerWheel.h"
+
+using namespace Protocol;
+
+/// Number of timers outstanding in the wheel
+constexpr static const size_t kOutstanding{10'000};
+
+/**
+ * @brief Fill a wheel with timers
+ *
+ * Timeouts are spread evenly over the given range, so they land in all levels of the wheel.
+ *
+ * @param wheel Wheel to add the timers to
+ * @param minTimeout Shortest timeout
+ * @param maxTimeout Longest timeout
+ * @param outHandles If specified, the handles of all timers are appended to it
+ */
+static void Populate(TimerWheel &wheel, const std::chrono::milliseconds minTimeout,
+        const std::chrono::milliseconds maxTimeout,
+        std::vector<TimerWheel::Handle> *outHandles = nullptr) {
+    const auto step = (maxTimeout - minTimeout) / kOutstanding;
+
+    for(size_t i = 0; i < kOutstanding; i++) {
+        const auto handle = wheel.schedule(minTimeout + step * i, i);
+        if(outHandles) {
+            outHandles->push_back(handle);
+        }
+    }
+}
+
+/**
+ * @brief Timer wheel operations with many timers outstanding
+ *
+ * Measures scheduling and cancelling a single timer, advancing the wheel by one tick when nothing
+ * is due, and expiring all timers at once; always with 10k other timers in the wheel, about as
+ * many as a busy network has frames, fragments and polls waiting at once.
+ */
+TEST_CASE("Timer wheel", "[benchmark][timerwheel]") {
+    using namespace std::chrono_literals;
+
+    size_t expired{0};
+    const TimerWheel::ExpiryCallback countExpired = [&expired](auto, auto) {
+        expired++;
+    };
+
+    BENCHMARK_ADVANCED("schedule, 10k outstanding")(Catch::Benchmark::Chronometer meter) {
+        TimerWheel wheel;
+        Populate(wheel, 10ms, 60s);
+
+        meter.measure([&](const int i) {
+            return wheel.schedule(1s, i);
+        });
+
+        REQUIRE(wheel.size() == kOutstanding + meter.runs());
+    };
+
+    BENCHMARK_ADVANCED("cancel, 10k outstanding")(Catch::Benchmark::Chronometer meter) {
+        TimerWheel wheel;
+        std::vector<TimerWheel::Handle> handles;
+        Populate(wheel, 10ms, 60s, &handles);
+
+        for(int i = 0; i < meter.runs(); i++) {
+            handles.push_back(wheel.schedule(1s, i));
+        }
+
+        meter.measure([&](const int i) {
+            return wheel.cancel(handles[kOutstanding + i]);
+        });
+
+        REQUIRE(wheel.size() == kOutstanding);
+    };
+
+    BENCHMARK_ADVANCED("advance one tick, 10k outstanding")(Catch::Benchmark::Chronometer meter) {
+        TimerWheel wheel;
+        Populate(wheel, 60s, 120s);
+
+        // each run advances by one more tick, so none of the timers are due
+        const auto start = std::chrono::steady_clock::now();
+
+        meter.measure([&](const int i) {
+            return wheel.advance(start + wheel.getResolution() * (i + 1), countExpired);
+        });
+
+        REQUIRE(wheel.size() == kOutstanding);
+    };
+
+    BENCHMARK_ADVANCED("expire 10k")(Catch::Benchmark::Chronometer meter) {
+        std::vector<TimerWheel> wheels(meter.runs());
+        for(auto &wheel : wheels) {
+            Populate(wheel, 10ms, 10s);
+        }
+
+        const auto later = std::chrono::steady_clock::now() + 1h;
+        expired = 0;
+
+        meter.measure([&](const int i) {
+            return wheels[i].advance(later, countExpired);
+        });
+
+        REQUIRE(expired == kOutstanding * meter.runs());
+    };
+}
@@ -0,0 +1,108 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <BlazeNet/Types.h>
+
+#include "Radio.h"
+#include "Rpc/CborWriter.h"
+#include "Rpc/ClientConnection.h"
+#include "Rpc/Types.h"
+
+#include "Support/Fixture.h"
+
+/**
+ * @brief Build a tx request
+ *
+ * @param numFrames Number of frames in the batch; each is a broadcast with a 32 byte payload
+ *
+ * @return Full request packet (including RPC header)
+ */
+static std::vector<std::byte> MakeRequest(const size_t numFrames) {
+    const std::vector<std::byte> payload(32, std::byte{0x5A});
+
+    std::vector<std::byte> packet(sizeof(Rpc::RequestHeader));
+    Rpc::CborWriter writer(packet);
+
+    writer.putMap(2);
+    writer.putString("endpoint");
+    writer.putUint(1);
+    writer.putString("frames");
+    writer.putArray(numFrames);
+    for(size_t i = 0; i < numFrames; i++) {
+        writer.putArray(3);
+        writer.putUint(BlazeNet::Types::Mac::kBroadcastAddress);
+        writer.putUint(static_cast<uint8_t>(Radio::PacketPriority::Normal));
+        writer.putBytes(payload);
+    }
+
+    auto hdr = reinterpret_cast<Rpc::RequestHeader *>(packet.data());
+    hdr->version = Rpc::kCurrentVersion;
+    hdr->length = packet.size();
+    hdr->endpoint = Rpc::RequestEndpoint::Tx;
+    hdr->tag = 1;
+
+    return packet;
+}
+
+/**
+ * @brief Cost of injecting frames through the tx endpoint
+ *
+ * Each iteration sends a tx request over a local socket, lets the daemon handle it (queueing the
+ * frames with the simulated radio), and reads back the reply; dividing the batch size by the time
+ * per iteration gives the number of frames injected per second.
+ */
+TEST_CASE("Tx injection", "[benchmark][rpc]") {
+    auto &fixture = Tests::Fixture::The();
+
+    std::array<int, 2> fds;
+    if(socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK, 0, fds.data())) {
+        throw std::system_error(errno, std::generic_category(), "socketpair");
+    }
+
+    // the client connection takes ownership of its end of the socket
+    auto client = std::make_shared<Rpc::ClientConnection>(fixture.getServer().get(), fds[0]);
+    std::array<std::byte, 4096> reply;
+
+    const auto inject = [&](std::span<const std::byte> request) {
+        const auto sent = send(fds[1], request.data(), request.size(), 0);
+        if(sent != static_cast<ssize_t>(request.size())) {
+            throw std::system_error(errno, std::generic_category(), "send tx request");
+        }
+
+        fixture.runPending();
+
+        const auto read = recv(fds[1], reply.data(), reply.size(), 0);
+        if(read < static_cast<ssize_t>(sizeof(Rpc::RequestHeader))) {
+            throw std::runtime_error("no reply to tx request");
+        }
+        return read;
+    };
+
+    for(const size_t numFrames : {size_t{1}, size_t{16}, size_t{64}}) {
+        const auto request = MakeRequest(numFrames);
+
+        BENCHMARK("tx request, " + std::to_string(numFrames) + " frames") {
+            return inject(request);
+        };
+    }
+
+    REQUIRE(!client->isDead());
+    REQUIRE(client->getCounters().txFailed == 0);
+
+    client.reset();
+    close(fds[1]);
+}
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <map>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "Support/Confd.h"
+
+#include "FakeConfd.h"
+
+using namespace Support;
+
+/// Value of a key: integer, real or blob
+using Value = std::variant<int64_t, double, std::vector<std::byte>>;
+
+/// All keys that were set, by name
+static std::map<std::string, Value, std::less<>> gKeys;
+
+void Tests::FakeConfd::SetInteger(const std::string_view key, const int64_t value) {
+    gKeys.insert_or_assign(std::string(key), value);
+}
+
+void Tests::FakeConfd::SetReal(const std::string_view key, const double value) {
+    gKeys.insert_or_assign(std::string(key), value);
+}
+
+void Tests::FakeConfd::SetBlob(const std::string_view key, std::span<const std::byte> value) {
+    gKeys.insert_or_assign(std::string(key), std::vector<std::byte>(value.begin(), value.end()));
+}
+
+void Tests::FakeConfd::Remove(const std::string_view key) {
+    if(auto it = gKeys.find(key); it != gKeys.end()) {
+        gKeys.erase(it);
+    }
+}
+
+
+
+/**
+ * @brief Initialize confd connection
+ *
+ * There's nothing to connect to.
+ */
+void Confd::Init() {
+}
+
+/**
+ * @brief Read a key as an integer
+ */
+std::optional<int64_t> Confd::GetInteger(const std::string_view &key) {
+    auto it = gKeys.find(key);
+    if(it == gKeys.end() || !std::holds_alternative<int64_t>(it->second)) {
+        return std::nullopt;
+    }
+
+    return std::get<int64_t>(it->second);
+}
+
+/**
+ * @brief Read a key as a real number
+ */
+std::optional<double> Confd::GetReal(const std::string_view &key) {
+    auto it = gKeys.find(key);
+    if(it == gKeys.end()) {
+        return std::nullopt;
+    } else if(std::holds_alternative<int64_t>(it->second)) {
+        return std::get<int64_t>(it->second);
+    } else if(!std::holds_alternative<double>(it->second)) {
+        return std::nullopt;
+    }
+
+    return std::get<double>(it->second);
+}
+
+/**
+ * @brief Read a key as a blob
+ *
+ * @return Number of bytes read (0 if the key doesn't exist)
+ */
+size_t Confd::GetBlob(const std::string_view key, std::span<std::byte> outBuffer) {
+    auto it = gKeys.find(key);
+    if(it == gKeys.end() || !std::holds_alternative<std::vector<std::byte>>(it->second)) {
+        return 0;
+    }
+
+    const auto &value = std::get<std::vector<std::byte>>(it->second);
+    const auto actual = std::min(value.size(), outBuffer.size());
+    std::copy_n(value.begin(), actual, outBuffer.begin());
+
+    return actual;
+}
@@ -0,0 +1,22 @@
+#ifndef TESTS_SUPPORT_FAKECONFD_H
+#define TESTS_SUPPORT_FAKECONFD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+/**
+ * @brief In-memory stand-in for confd
+ *
+ * Tests link this instead of the confd client library: Support::Confd reads the values set here,
+ * and keys that were never set read as nonexistent.
+ */
+namespace Tests::FakeConfd {
+void SetInteger(const std::string_view key, const int64_t value);
+void SetReal(const std::string_view key, const double value);
+void SetBlob(const std::string_view key, std::span<const std::byte> value);
+void Remove(const std::string_view key);
+}
+
+#endif
@@ -0,0 +1,122 @@
+#include <event2/event.h>
+
+#include <TristLib/Core.h>
+#include <TristLib/Event.h>
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+
+#include "Config/Reader.h"
+#include "Protocol/Association.h"
+#include "Protocol/Handler.h"
+#include "Protocol/NetControl.h"
+#include "Protocol/Security.h"
+#include "Radio.h"
+#include "Rpc/Server.h"
+#include "Support/Confd.h"
+#include "Transports/Base.h"
+
+#include "FakeConfd.h"
+#include "Fixture.h"
+
+using namespace Tests;
+
+/**
+ * @brief Get the shared fixture
+ *
+ * It's set up on first use.
+ */
+Fixture &Fixture::The() {
+    static Fixture gFixture;
+    return gFixture;
+}
+
+/**
+ * @brief Set up the environment
+ *
+ * Read the benchmark config, seed the runtime configuration with the radio and beacon settings,
+ * then bring up the radio, protocol handler and RPC server.
+ */
+Fixture::Fixture() {
+    this->runLoop = std::make_shared<TristLib::Event::RunLoop>();
+    this->runLoop->arm();
+
+    Config::Read(TEST_CONFIG_FILE);
+    Support::Confd::Init();
+
+    FakeConfd::SetInteger("radio.phy.channel", 15);
+    FakeConfd::SetReal("radio.phy.txPower", 0.);
+    FakeConfd::SetInteger("radio.beacon.interval", 1000);
+
+    std::array<std::byte, 16> networkId;
+    networkId.fill(std::byte{0x42});
+    FakeConfd::SetBlob("radio.beacon.id", networkId);
+
+    auto transport = Transports::TransportBase::Make(Config::GetTransportConfig());
+    if(!transport) {
+        throw std::runtime_error("failed to initialize transport");
+    }
+
+    this->radio = std::make_shared<Radio>(transport);
+    this->handler = std::make_shared<Protocol::Handler>(this->radio);
+    this->server = std::make_shared<Rpc::Server>(this->radio, this->handler);
+}
+
+/**
+ * @brief Enable or disable link layer security
+ *
+ * A fixed network key is installed (or removed), and the security configuration reloaded.
+ */
+void Fixture::setSecurityEnabled(const bool enabled) {
+    if(enabled) {
+        std::array<std::byte, 16> key;
+        for(size_t i = 0; i < key.size(); i++) {
+            key[i] = std::byte(i);
+        }
+        FakeConfd::SetBlob("protocol.security.key", key);
+    } else {
+        FakeConfd::Remove("protocol.security.key");
+    }
+
+    this->handler->getSecurity()->reloadConfig();
+}
+
+/**
+ * @brief Associate a node with the network
+ *
+ * An association request is processed as if it had been received from the node, then the
+ * association is confirmed as if the node had sent a frame from its new address. Pairing is
+ * enabled in the benchmark config.
+ *
+ * @param eui64 EUI-64 of the node
+ *
+ * @return Short address assigned to the node
+ */
+uint16_t Fixture::associateNode(const uint64_t eui64) {
+    auto &association = this->handler->getAssociation();
+
+    Protocol::NetControl::AssociationRequest req{};
+    memcpy(req.eui64, &eui64, sizeof(req.eui64));
+    association->handleRequest(Protocol::NetControl::kUnassignedAddress,
+            std::as_bytes(std::span(&req, 1)));
+
+    uint32_t cursor{0};
+    while(auto node = association->findNode(cursor)) {
+        if(node->eui64 == eui64) {
+            association->handleFrame(node->address);
+            return node->address;
+        }
+    }
+
+    throw std::runtime_error("failed to associate node");
+}
+
+/**
+ * @brief Process all pending events, without waiting for new ones
+ */
+void Fixture::runPending() {
+    event_base_loop(this->runLoop->getEvBase(), EVLOOP_NONBLOCK);
+}
@@ -0,0 +1,77 @@
+#ifndef TESTS_SUPPORT_FIXTURE_H
+#define TESTS_SUPPORT_FIXTURE_H
+
+#include <cstdint>
+#include <memory>
+
+class Radio;
+
+namespace Protocol {
+class Handler;
+}
+
+namespace Rpc {
+class Server;
+}
+
+namespace TristLib::Event {
+class RunLoop;
+}
+
+namespace Tests {
+/**
+ * @brief Shared environment for tests and benchmarks
+ *
+ * Sets up the daemon the same way as the real entry point does, but with a simulated radio and an
+ * in-memory confd. It's created the first time it's used, and lives until the process exits,
+ * since configuration and run loop are process wide.
+ */
+class Fixture {
+    public:
+        static Fixture &The();
+
+        void setSecurityEnabled(const bool enabled);
+        uint16_t associateNode(const uint64_t eui64);
+        void runPending();
+
+        /**
+         * @brief Get the run loop
+         */
+        inline auto &getRunLoop() const {
+            return this->runLoop;
+        }
+        /**
+         * @brief Get the radio instance
+         */
+        inline auto &getRadio() const {
+            return this->radio;
+        }
+        /**
+         * @brief Get the protocol handler
+         */
+        inline auto &getHandler() const {
+            return this->handler;
+        }
+        /**
+         * @brief Get the RPC server
+         */
+        inline auto &getServer() const {
+            return this->server;
+        }
+
+    private:
+        Fixture();
+
+    private:
+        /// Main run loop
+        std::shared_ptr<TristLib::Event::RunLoop> runLoop;
+        /// Radio (on a simulated transport)
+        std::shared_ptr<Radio> radio;
+        /// Protocol handler
+        std::shared_ptr<Protocol::Handler> handler;
+        /// Local RPC server
+        std::shared_ptr<Rpc::Server> server;
+};
+}
+
+#endif
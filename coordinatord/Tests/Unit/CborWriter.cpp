@@ -0,0 +1,201 @@
+#include <catch2/catch_message.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cbor.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Rpc/CborWriter.h"
+
+/**
+ * @brief Build a byte vector from a list of values
+ */
+static std::vector<std::byte> Bytes(std::initializer_list<uint8_t> values) {
+    std::vector<std::byte> bytes;
+    for(const auto value : values) {
+        bytes.push_back(std::byte{value});
+    }
+    return bytes;
+}
+
+/**
+ * @brief Decode a buffer with libcbor
+ *
+ * The entire buffer must be consumed by a single item.
+ *
+ * @return Decoded item (the caller is responsible for releasing it)
+ */
+static cbor_item_t *Decode(const std::vector<std::byte> &buffer) {
+    struct cbor_load_result result{};
+    auto item = cbor_load(reinterpret_cast<cbor_data>(buffer.data()), buffer.size(), &result);
+
+    REQUIRE(result.error.code == CBOR_ERR_NONE);
+    REQUIRE(result.read == buffer.size());
+    REQUIRE(item);
+    return item;
+}
+
+/**
+ * @brief Get the value of an integer item (of either sign)
+ */
+static int64_t GetInt(const cbor_item_t *item) {
+    if(cbor_isa_uint(item)) {
+        return static_cast<int64_t>(cbor_get_int(item));
+    }
+    REQUIRE(cbor_isa_negint(item));
+    return -1 - static_cast<int64_t>(cbor_get_int(item));
+}
+
+/**
+ * @brief Get the value of a text string item
+ */
+static std::string_view GetString(const cbor_item_t *item) {
+    REQUIRE(cbor_isa_string(item));
+    return std::string_view(reinterpret_cast<const char *>(cbor_string_handle(item)),
+            cbor_string_length(item));
+}
+
+/**
+ * @brief Items are encoded with the shortest head, as in the examples of RFC 8949 (appendix A)
+ */
+TEST_CASE("CBOR writer encoding", "[cbor]") {
+    std::vector<std::byte> buffer;
+
+    const auto encode = [&buffer](auto &&put) {
+        buffer.clear();
+        Rpc::CborWriter writer(buffer);
+        put(writer);
+        return buffer;
+    };
+
+    // unsigned integers, at each head size boundary
+    REQUIRE(encode([](auto &w) { w.putUint(0); }) == Bytes({0x00}));
+    REQUIRE(encode([](auto &w) { w.putUint(23); }) == Bytes({0x17}));
+    REQUIRE(encode([](auto &w) { w.putUint(24); }) == Bytes({0x18, 0x18}));
+    REQUIRE(encode([](auto &w) { w.putUint(255); }) == Bytes({0x18, 0xff}));
+    REQUIRE(encode([](auto &w) { w.putUint(256); }) == Bytes({0x19, 0x01, 0x00}));
+    REQUIRE(encode([](auto &w) { w.putUint(1000000); }) ==
+            Bytes({0x1a, 0x00, 0x0f, 0x42, 0x40}));
+    REQUIRE(encode([](auto &w) { w.putUint(1000000000000); }) ==
+            Bytes({0x1b, 0x00, 0x00, 0x00, 0xe8, 0xd4, 0xa5, 0x10, 0x00}));
+    REQUIRE(encode([](auto &w) { w.putUint(UINT64_MAX); }) ==
+            Bytes({0x1b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff}));
+
+    // negative integers
+    REQUIRE(encode([](auto &w) { w.putInt(-1); }) == Bytes({0x20}));
+    REQUIRE(encode([](auto &w) { w.putInt(-24); }) == Bytes({0x37}));
+    REQUIRE(encode([](auto &w) { w.putInt(-25); }) == Bytes({0x38, 0x18}));
+    REQUIRE(encode([](auto &w) { w.putInt(-1000); }) == Bytes({0x39, 0x03, 0xe7}));
+    REQUIRE(encode([](auto &w) { w.putInt(100); }) == Bytes({0x18, 0x64}));
+
+    // strings, simple values and floats
+    REQUIRE(encode([](auto &w) { w.putString(""); }) == Bytes({0x60}));
+    REQUIRE(encode([](auto &w) { w.putString("IETF"); }) ==
+            Bytes({0x64, 0x49, 0x45, 0x54, 0x46}));
+    REQUIRE(encode([](auto &w) { w.putBytes(Bytes({1, 2, 3, 4})); }) ==
+            Bytes({0x44, 0x01, 0x02, 0x03, 0x04}));
+    REQUIRE(encode([](auto &w) { w.putBool(false); }) == Bytes({0xf4}));
+    REQUIRE(encode([](auto &w) { w.putBool(true); }) == Bytes({0xf5}));
+    REQUIRE(encode([](auto &w) { w.putFloat4(100000.0f); }) ==
+            Bytes({0xfa, 0x47, 0xc3, 0x50, 0x00}));
+    REQUIRE(encode([](auto &w) { w.putFloat8(1.1); }) ==
+            Bytes({0xfb, 0x3f, 0xf1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a}));
+
+    // containers
+    REQUIRE(encode([](auto &w) { w.putArray(0); }) == Bytes({0x80}));
+    REQUIRE(encode([](auto &w) { w.putMap(0); }) == Bytes({0xa0}));
+    REQUIRE(encode([](auto &w) {
+        w.beginArray();
+        w.putUint(1);
+        w.endArray();
+    }) == Bytes({0x9f, 0x01, 0xff}));
+}
+
+/**
+ * @brief Writer output decodes with libcbor to the values that were written
+ *
+ * Builds a reply shaped like the ones endpoints send: a map containing integers of all sizes and
+ * both signs, strings long enough to need a length head, bytes, floats, booleans, and nested
+ * definite and indefinite arrays.
+ */
+TEST_CASE("CBOR writer decodes with libcbor", "[cbor]") {
+    const std::vector<int64_t> ints{0, 1, 23, 24, 255, 256, 65535, 65536, 0xFFFFFFFF,
+        0x100000000, std::numeric_limits<int64_t>::max(), -1, -24, -25, -256, -257, -65537,
+        std::numeric_limits<int64_t>::min()};
+    const std::string longString(300, 'x');
+    const auto bytes = Bytes({0xde, 0xad, 0xbe, 0xef});
+
+    std::vector<std::byte> buffer;
+    Rpc::CborWriter writer(buffer);
+
+    writer.putMap(5);
+    writer.putString("ints");
+    writer.putArray(ints.size());
+    for(const auto value : ints) {
+        writer.putInt(value);
+    }
+    writer.putString("string");
+    writer.putString(longString);
+    writer.putString("bytes");
+    writer.putBytes(bytes);
+    writer.putString("floats");
+    writer.putArray(2);
+    writer.putFloat4(0.5f);
+    writer.putFloat8(-2.25);
+    writer.putString("list");
+    writer.beginArray();
+    writer.putBool(true);
+    writer.putBool(false);
+    writer.putArray(1);
+    writer.putUint(UINT64_MAX);
+    writer.endArray();
+
+    REQUIRE(writer.size() == buffer.size());
+
+    auto root = Decode(buffer);
+    REQUIRE(cbor_isa_map(root));
+    REQUIRE(cbor_map_size(root) == 5);
+    const auto pairs = cbor_map_handle(root);
+
+    REQUIRE(GetString(pairs[0].key) == "ints");
+    REQUIRE(cbor_isa_array(pairs[0].value));
+    REQUIRE(cbor_array_size(pairs[0].value) == ints.size());
+    for(size_t i = 0; i < ints.size(); i++) {
+        INFO("value: " << ints[i]);
+        REQUIRE(GetInt(cbor_array_handle(pairs[0].value)[i]) == ints[i]);
+    }
+
+    REQUIRE(GetString(pairs[1].key) == "string");
+    REQUIRE(GetString(pairs[1].value) == longString);
+
+    REQUIRE(GetString(pairs[2].key) == "bytes");
+    REQUIRE(cbor_isa_bytestring(pairs[2].value));
+    const auto decodedBytes = cbor_bytestring_handle(pairs[2].value);
+    REQUIRE(std::vector<std::byte>(reinterpret_cast<const std::byte *>(decodedBytes),
+                reinterpret_cast<const std::byte *>(decodedBytes)
+                + cbor_bytestring_length(pairs[2].value)) == bytes);
+
+    REQUIRE(GetString(pairs[3].key) == "floats");
+    const auto floats = cbor_array_handle(pairs[3].value);
+    REQUIRE(cbor_isa_float_ctrl(floats[0]));
+    REQUIRE(cbor_float_get_float(floats[0]) == 0.5);
+    REQUIRE(cbor_float_get_float(floats[1]) == -2.25);
+
+    REQUIRE(GetString(pairs[4].key) == "list");
+    REQUIRE(cbor_array_is_indefinite(pairs[4].value));
+    REQUIRE(cbor_array_size(pairs[4].value) == 3);
+    const auto list = cbor_array_handle(pairs[4].value);
+    REQUIRE(cbor_is_bool(list[0]));
+    REQUIRE(cbor_get_bool(list[0]));
+    REQUIRE(!cbor_get_bool(list[1]));
+    REQUIRE(cbor_array_size(list[2]) == 1);
+    REQUIRE(cbor_get_int(cbor_array_handle(list[2])[0]) == UINT64_MAX);
+
+    cbor_decref(&root);
+}
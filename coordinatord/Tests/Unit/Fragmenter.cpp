@@ -0,0 +1,192 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include <BlazeNet/Types.h>
+
+#include "Protocol/Fragmenter.h"
+#include "Protocol/Handler.h"
+#include "Protocol/NetControl.h"
+
+#include "Support/Fixture.h"
+
+using namespace Protocol;
+
+/**
+ * @brief Messages delivered by the protocol handler
+ */
+struct Delivered {
+    /// Source address of each message
+    std::vector<uint16_t> sources;
+    /// Payload of each message
+    std::vector<std::vector<std::byte>> messages;
+};
+
+/**
+ * @brief Get the messages delivered so far
+ *
+ * A message handler recording them is registered the first time this is called.
+ */
+static Delivered &GetDelivered() {
+    static Delivered delivered;
+    static bool registered{false};
+
+    if(!registered) {
+        Tests::Fixture::The().getHandler()->addMessageHandler([](const uint16_t source, auto,
+                    std::span<const std::byte> payload) {
+            delivered.sources.push_back(source);
+            delivered.messages.emplace_back(payload.begin(), payload.end());
+        });
+        registered = true;
+    }
+
+    return delivered;
+}
+
+/**
+ * @brief Build a message whose every byte differs from its neighbours
+ */
+static std::vector<std::byte> MakeMessage(const size_t length) {
+    std::vector<std::byte> message(length);
+    for(size_t i = 0; i < length; i++) {
+        message[i] = static_cast<std::byte>(i * 7 + (i >> 8));
+    }
+    return message;
+}
+
+/**
+ * @brief Split a message into fragments, as a node would send them
+ *
+ * @return Fragment messages (following the network control header)
+ */
+static std::vector<std::vector<std::byte>> MakeFragments(const uint16_t messageId,
+        std::span<const std::byte> message) {
+    const size_t count = (message.size() + Fragmenter::kMaxFragmentData - 1)
+        / Fragmenter::kMaxFragmentData;
+    std::vector<std::vector<std::byte>> fragments;
+
+    for(size_t i = 0; i < count; i++) {
+        const auto offset = i * Fragmenter::kMaxFragmentData;
+        const auto chunk = message.subspan(offset,
+                std::min(Fragmenter::kMaxFragmentData, message.size() - offset));
+
+        auto &fragment = fragments.emplace_back(sizeof(NetControl::Fragment));
+        auto hdr = reinterpret_cast<NetControl::Fragment *>(fragment.data());
+        hdr->messageId = messageId;
+        hdr->index = i;
+        hdr->count = count;
+        hdr->totalLength = message.size();
+        hdr->endpoint = 1;
+
+        fragment.insert(fragment.end(), chunk.begin(), chunk.end());
+    }
+
+    return fragments;
+}
+
+/**
+ * @brief Fragments received out of order are reassembled into the original message
+ */
+TEST_CASE("Fragment reassembly out of order", "[fragmenter]") {
+    auto &fragmenter = Tests::Fixture::The().getHandler()->getFragmenter();
+    auto &delivered = GetDelivered();
+    delivered = {};
+
+    const auto message = MakeMessage(Fragmenter::kMaxFragmentData * 3 + 17);
+    const auto fragments = MakeFragments(0x10, message);
+    REQUIRE(fragments.size() == 4);
+
+    const auto before = fragmenter->getCounters();
+
+    for(const size_t i : {3, 1, 0, 2}) {
+        REQUIRE(delivered.messages.empty());
+        fragmenter->handleFragment(0x0201, fragments[i]);
+    }
+
+    REQUIRE(delivered.messages.size() == 1);
+    REQUIRE(delivered.sources[0] == 0x0201);
+    REQUIRE(delivered.messages[0] == message);
+
+    REQUIRE(fragmenter->getCounters().rxReassembled == before.rxReassembled + 1);
+    REQUIRE(fragmenter->getCounters().rxInvalid == before.rxInvalid);
+    REQUIRE(fragmenter->getNumReassembling() == 0);
+}
+
+/**
+ * @brief Duplicate fragments are counted and dropped
+ *
+ * The message is delivered exactly once, with the contents of the first copy of each fragment.
+ */
+TEST_CASE("Fragment reassembly with duplicates", "[fragmenter]") {
+    auto &fragmenter = Tests::Fixture::The().getHandler()->getFragmenter();
+    auto &delivered = GetDelivered();
+    delivered = {};
+
+    const auto message = MakeMessage(Fragmenter::kMaxFragmentData * 2 + 1);
+    const auto fragments = MakeFragments(0x11, message);
+
+    // same header as the first fragment, but different data
+    auto corrupt = fragments[0];
+    std::fill(corrupt.begin() + sizeof(NetControl::Fragment), corrupt.end(), std::byte{0xEE});
+
+    const auto before = fragmenter->getCounters();
+
+    fragmenter->handleFragment(0x0202, fragments[0]);
+    fragmenter->handleFragment(0x0202, corrupt);
+    fragmenter->handleFragment(0x0202, fragments[1]);
+    fragmenter->handleFragment(0x0202, fragments[1]);
+    REQUIRE(delivered.messages.empty());
+    fragmenter->handleFragment(0x0202, fragments[2]);
+
+    REQUIRE(delivered.messages.size() == 1);
+    REQUIRE(delivered.messages[0] == message);
+
+    const auto &counters = fragmenter->getCounters();
+    REQUIRE(counters.rxDuplicates == before.rxDuplicates + 2);
+    REQUIRE(counters.rxReassembled == before.rxReassembled + 1);
+}
+
+/**
+ * @brief Incomplete messages are discarded after the reassembly timeout
+ *
+ * The test config sets a short timeout; the run loop is serviced until the fragmenter's tick
+ * timer expires the message. A fragment arriving afterwards starts over, rather than completing
+ * the discarded message.
+ */
+TEST_CASE("Fragment reassembly timeout", "[fragmenter]") {
+    using namespace std::chrono_literals;
+
+    auto &fixture = Tests::Fixture::The();
+    auto &fragmenter = fixture.getHandler()->getFragmenter();
+    auto &delivered = GetDelivered();
+    delivered = {};
+
+    const auto message = MakeMessage(Fragmenter::kMaxFragmentData + 1);
+    const auto fragments = MakeFragments(0x12, message);
+
+    const auto before = fragmenter->getCounters();
+    const auto reassembling = fragmenter->getNumReassembling();
+
+    fragmenter->handleFragment(0x0203, fragments[0]);
+    REQUIRE(fragmenter->getNumReassembling() == reassembling + 1);
+
+    const auto deadline = std::chrono::steady_clock::now() + 5s;
+    while(fragmenter->getCounters().rxTimeouts == before.rxTimeouts &&
+            std::chrono::steady_clock::now() < deadline) {
+        fixture.runPending();
+        std::this_thread::sleep_for(10ms);
+    }
+
+    REQUIRE(fragmenter->getCounters().rxTimeouts == before.rxTimeouts + 1);
+    REQUIRE(fragmenter->getNumReassembling() == reassembling);
+
+    fragmenter->handleFragment(0x0203, fragments[1]);
+    REQUIRE(delivered.messages.empty());
+    REQUIRE(fragmenter->getCounters().rxReassembled == before.rxReassembled);
+}
@@ -0,0 +1,50 @@
+#include <catch2/catch_message.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <string_view>
+
+#include "Rpc/KeyMap.h"
+
+using namespace Rpc;
+
+/// Map under test: a few keys sharing prefixes and lengths
+constexpr static const KeyMap<int, 6> kMap({
+    {"status", 1},
+    {"stats", 2},
+    {"radio", 3},
+    {"radio.counters", 4},
+    {"node.table", 5},
+    {"node.tables", 6},
+});
+
+/**
+ * @brief Every key is found, in any case
+ */
+TEST_CASE("KeyMap hits", "[keymap]") {
+    for(const auto &entry : kMap.getEntries()) {
+        const auto value = kMap.find(entry.key);
+        REQUIRE(value);
+        REQUIRE(*value == entry.value);
+    }
+
+    REQUIRE(*kMap.find("STATUS") == 1);
+    REQUIRE(*kMap.find("Radio.Counters") == 4);
+    REQUIRE(*kMap.find("node.TABLES") == 6);
+}
+
+/**
+ * @brief Keys not in the map aren't found
+ *
+ * This includes prefixes and extensions of keys, and keys differing in a single character.
+ */
+TEST_CASE("KeyMap misses", "[keymap]") {
+    for(const std::string_view key : {"", "s", "stat", "statuses", "statu5", "radio.", "radios",
+            "node.tablez", "node table", "unknown"}) {
+        INFO("key: " << key);
+        REQUIRE(!kMap.find(key));
+    }
+
+    // lookups also work at compile time
+    static_assert(kMap.find("stats") && *kMap.find("stats") == 2);
+    static_assert(!kMap.find("state"));
+}
@@ -0,0 +1,85 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "Protocol/TimerWheel.h"
+
+using namespace Protocol;
+
+/**
+ * @brief Timers expire in order of their deadlines
+ *
+ * Timers are scheduled out of order, with timeouts far enough apart that scheduling jitter can't
+ * move one across another's tick; the long one lives in a higher level of the wheel, and has to
+ * be cascaded down before it expires.
+ */
+TEST_CASE("Timer wheel expiry order", "[timerwheel]") {
+    using namespace std::chrono_literals;
+
+    TimerWheel wheel(10ms);
+    std::vector<uint64_t> expired;
+    const TimerWheel::ExpiryCallback record = [&expired](auto, const uint64_t cookie) {
+        expired.push_back(cookie);
+    };
+
+    wheel.schedule(300ms, 3);
+    wheel.schedule(10s, 4);
+    wheel.schedule(100ms, 1);
+    wheel.schedule(200ms, 2);
+    REQUIRE(wheel.size() == 4);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    REQUIRE(wheel.advance(start + 150ms, record) == 1);
+    REQUIRE(expired == std::vector<uint64_t>{1});
+
+    REQUIRE(wheel.advance(start + 1s, record) == 2);
+    REQUIRE(expired == std::vector<uint64_t>{1, 2, 3});
+
+    // advancing to the same time again expires nothing
+    REQUIRE(wheel.advance(start + 1s, record) == 0);
+    REQUIRE(wheel.size() == 1);
+
+    REQUIRE(wheel.advance(start + 1h, record) == 1);
+    REQUIRE(expired == std::vector<uint64_t>{1, 2, 3, 4});
+    REQUIRE(wheel.empty());
+}
+
+/**
+ * @brief Cancelled timers don't expire, and stale handles are rejected
+ *
+ * A handle stays invalid after its timer expired or was cancelled, even once its entry has been
+ * reused for a new timer.
+ */
+TEST_CASE("Timer wheel cancellation", "[timerwheel]") {
+    using namespace std::chrono_literals;
+
+    TimerWheel wheel(10ms);
+    std::vector<uint64_t> expired;
+    const TimerWheel::ExpiryCallback record = [&expired](auto, const uint64_t cookie) {
+        expired.push_back(cookie);
+    };
+
+    const auto first = wheel.schedule(100ms, 1);
+    const auto second = wheel.schedule(100ms, 2);
+
+    REQUIRE(wheel.cancel(first));
+    REQUIRE(!wheel.cancel(first));
+    REQUIRE(!wheel.cancel(TimerWheel::kInvalidHandle));
+    REQUIRE(wheel.size() == 1);
+
+    REQUIRE(wheel.advance(std::chrono::steady_clock::now() + 1s, record) == 1);
+    REQUIRE(expired == std::vector<uint64_t>{2});
+    REQUIRE(!wheel.cancel(second));
+
+    // reuses the entry of one of the previous timers
+    const auto third = wheel.schedule(100ms, 3);
+    REQUIRE(!wheel.cancel(first));
+    REQUIRE(!wheel.cancel(second));
+    REQUIRE(wheel.size() == 1);
+
+    REQUIRE(wheel.cancel(third));
+    REQUIRE(wheel.empty());
+}